@@ -6,6 +6,7 @@
 #define _ARCH_ARCH_H
 
 #include "arch/i686/686init.h"
+#include "arch/i686/chksum.h"
 #include "arch/i686/cpu.h"
 #include "arch/i686/gdt.h"
 #include "arch/i686/interrupts.h"
@@ -14,9 +15,12 @@
 #include "arch/i686/mouse.h"
 #include "arch/i686/paging.h"
 #include "arch/i686/pci.h"
+#include "arch/i686/sysenter.h"
 #include "arch/i686/timer.h"
 #include "arch/i686/tss.h"
+#include "arch/i686/uaccess.h"
 #include "arch/i686/util.h"
+#include "arch/i686/vdso.h"
 #include "arch/i686/vga.h"
 
 #endif
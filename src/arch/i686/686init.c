@@ -4,9 +4,11 @@
 #include "interrupts.h"
 #include "legacytty.h"
 #include "paging.h"
+#include "sysenter.h"
 #include "timer.h"
 #include "tss.h"
 #include "util.h"
+#include "vdso.h"
 
 static gdt_entry_t gdt[GDT_ENTRY_COUNT] = {0};
 static idt_entry_t idt_entries[256] = {0};
@@ -43,9 +45,11 @@ void init_686(void) {
 
     // Initialize TSS for user mode support
     tss_init(INITIAL_KERNEL_STACK_TOP);
+    sysenter_init(INITIAL_KERNEL_STACK_TOP);
 
     // Initialize system timer (100 Hz)
     init_timer(100);
+    vdso_init(100);
 
     printf("mateOS init done\n");
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "chksum.h"
+
+// One's complement sums are byte-order and word-size agnostic: adding the
+// data as 32-bit little-endian words with end-around carry and folding to
+// 16 bits gives the same result as lwIP's 16-bit loop. x86 allows
+// unaligned loads, so no alignment fix-up is needed either.
+
+static inline uint32_t add_carry(uint32_t sum, uint32_t v) {
+    sum += v;
+    return sum + (sum < v);
+}
+
+static inline uint16_t fold(uint32_t sum) {
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += sum >> 16;
+    return (uint16_t)sum;
+}
+
+// Sum `blocks` 32-byte blocks: one adc chain, carries folded in at the end
+static uint32_t sum_blocks(const uint8_t *p, uint32_t blocks, uint32_t sum) {
+    asm volatile("clc\n"
+                 "1:\n\t"
+                 "adcl 0(%1), %0\n\t"
+                 "adcl 4(%1), %0\n\t"
+                 "adcl 8(%1), %0\n\t"
+                 "adcl 12(%1), %0\n\t"
+                 "adcl 16(%1), %0\n\t"
+                 "adcl 20(%1), %0\n\t"
+                 "adcl 24(%1), %0\n\t"
+                 "adcl 28(%1), %0\n\t"
+                 "leal 32(%1), %1\n\t" // lea/dec leave CF alone
+                 "decl %2\n\t"
+                 "jnz 1b\n\t"
+                 "adcl $0, %0"
+                 : "+r"(sum), "+r"(p), "+r"(blocks)
+                 :
+                 : "memory", "cc");
+    return sum;
+}
+
+#define COPY_SUM(off)                                                          \
+    "movl " #off "(%[s]), %[t]\n\t"                                            \
+    "adcl %[t], %[sum]\n\t"                                                    \
+    "movl %[t], " #off "(%[d])\n\t"
+
+static uint32_t copy_sum_blocks(uint8_t *d, const uint8_t *s, uint32_t blocks,
+                                uint32_t sum) {
+    uint32_t t;
+    asm volatile("clc\n"
+                 "1:\n\t" COPY_SUM(0) COPY_SUM(4) COPY_SUM(8) COPY_SUM(12)
+                     COPY_SUM(16) COPY_SUM(20) COPY_SUM(24) COPY_SUM(28)
+                 "leal 32(%[s]), %[s]\n\t"
+                 "leal 32(%[d]), %[d]\n\t"
+                 "decl %[n]\n\t"
+                 "jnz 1b\n\t"
+                 "adcl $0, %[sum]"
+                 : [sum] "+r"(sum), [s] "+r"(s), [d] "+r"(d), [n] "+r"(blocks),
+                   [t] "=&r"(t)
+                 :
+                 : "memory", "cc");
+    return sum;
+}
+
+uint16_t net_chksum(const void *data, int len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t sum = 0;
+    if (len <= 0)
+        return 0;
+
+    uint32_t blocks = (uint32_t)len >> 5;
+    if (blocks) {
+        sum = sum_blocks(p, blocks, sum);
+        p += blocks << 5;
+        len &= 31;
+    }
+    for (; len >= 4; len -= 4, p += 4) {
+        uint32_t w;
+        __builtin_memcpy(&w, p, 4);
+        sum = add_carry(sum, w);
+    }
+    if (len >= 2) {
+        sum = add_carry(sum, (uint32_t)p[0] | ((uint32_t)p[1] << 8));
+        p += 2;
+        len -= 2;
+    }
+    if (len)
+        sum = add_carry(sum, p[0]); // odd byte pads with a zero high byte
+    return fold(sum);
+}
+
+uint16_t net_chksum_copy(void *dst, const void *src, uint16_t len) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t n = len;
+    uint32_t sum = 0;
+
+    uint32_t blocks = n >> 5;
+    if (blocks) {
+        sum = copy_sum_blocks(d, s, blocks, sum);
+        d += blocks << 5;
+        s += blocks << 5;
+        n &= 31;
+    }
+    for (; n >= 4; n -= 4, d += 4, s += 4) {
+        uint32_t w;
+        __builtin_memcpy(&w, s, 4);
+        __builtin_memcpy(d, &w, 4);
+        sum = add_carry(sum, w);
+    }
+    if (n >= 2) {
+        d[0] = s[0];
+        d[1] = s[1];
+        sum = add_carry(sum, (uint32_t)s[0] | ((uint32_t)s[1] << 8));
+        d += 2;
+        s += 2;
+        n -= 2;
+    }
+    if (n) {
+        d[0] = s[0];
+        sum = add_carry(sum, s[0]);
+    }
+    return fold(sum);
+}
@@ -0,0 +1,13 @@
+#ifndef _CHKSUM_H
+#define _CHKSUM_H
+
+#include <stdint.h>
+
+// Internet checksum (RFC 1071) used by lwIP as LWIP_CHKSUM and
+// LWIP_CHKSUM_COPY. Both return the folded 16-bit one's complement sum
+// (not inverted) in memory byte order, like lwip_standard_chksum().
+uint16_t net_chksum(const void *data, int len);
+// memcpy(dst, src, len) and the checksum of the bytes copied, in one pass
+uint16_t net_chksum_copy(void *dst, const void *src, uint16_t len);
+
+#endif
@@ -1,8 +1,10 @@
 #include "interrupts.h"
 #include "io.h"
+#include "ktrace.h"
 #include "lib.h"
 #include "memlayout.h"
 #include "proc/task.h"
+#include "uaccess.h"
 #include "util.h"
 
 #define MASTER_PIC_COMMAND 0x20
@@ -194,7 +196,17 @@ void idt_exception_handler(uint32_t number, uint32_t noerror,
     case 0xE: {
         extern uint32_t get_cr2(void);
         uint32_t fault_addr = get_cr2();
+        KTRACE(KT_PAGE_FAULT, fault_addr, fault_eip, noerror);
         uint32_t *r = (uint32_t *)regs_ptr;
+        // Kernel fault inside a uaccess primitive: a bad user pointer, so
+        // resume at its fixup (the saved eip sits after pusha + error code)
+        if (!(fault_cs & 3) && r) {
+            uint32_t fixup = uaccess_fixup(fault_eip);
+            if (fixup) {
+                r[9] = fixup;
+                return;
+            }
+        }
         uint32_t reg_edi = r ? r[0] : 0;
         uint32_t reg_esi = r ? r[1] : 0;
         uint32_t reg_ebp = r ? r[2] : 0;
@@ -285,9 +297,11 @@ void idt_irq_handler(uint32_t number, uint32_t number2) {
     uint8_t irq = number - 0x20;
     pic_acknowledge(irq);
 
+    KTRACE(KT_IRQ_ENTER, irq, 0, 0);
     if (has_handler) {
         interruptPointers[number](number, number2);
     }
+    KTRACE(KT_IRQ_EXIT, irq, 0, 0);
 }
 
 void irq_list(void) {
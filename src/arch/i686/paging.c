@@ -2,6 +2,7 @@
 #include "lib.h"
 #include "memlayout.h"
 #include "proc/pmm.h"
+#include "vdso.h"
 
 // Assembly functions to manipulate control registers
 extern void enable_paging(uint32_t page_directory_physical);
@@ -129,10 +130,35 @@ void paging_map_vbe(uint32_t phys_addr, uint32_t size) {
            end, (end - start) / 0x1000, vbe_dir_count);
 }
 
+// Map device registers into the kernel MMIO window. The window's PTEs live
+// in the shared kernel page tables, so no per-process fixup is needed.
+uint32_t paging_map_mmio(uint32_t phys_addr, uint32_t size) {
+    static uint32_t mmio_next = KERNEL_MMIO_START;
+    if (!current_page_dir || !size)
+        return 0;
+
+    uint32_t start = phys_addr & ~0xFFF;
+    uint32_t end = (phys_addr + size + 0xFFF) & ~0xFFF;
+    if (end - start > KERNEL_MMIO_END - mmio_next) {
+        printf("[paging] MMIO window full (0x%x)\n", phys_addr);
+        return 0;
+    }
+
+    uint32_t va = mmio_next;
+    for (uint32_t addr = start; addr < end; addr += 0x1000) {
+        paging_map_page(current_page_dir, va + (addr - start), addr,
+                        PAGE_PRESENT | PAGE_WRITE | PAGE_PCD | PAGE_PWT);
+    }
+    mmio_next += end - start;
+
+    printf("[paging] MMIO mapped: 0x%x-0x%x at 0x%x\n", start, end, va);
+    return va + (phys_addr & 0xFFF);
+}
+
 // Create a new address space for a user process.
-// Only copies higher-half kernel entries (768+) and VBE entries.
-// User page tables (entries 0-767) are allocated on demand by
-// paging_map_page().
+// Only copies higher-half kernel entries (768+) and VBE entries, and maps
+// the read-only vDSO page. Other user page tables (entries 0-767) are
+// allocated on demand by paging_map_page().
 page_directory_t *paging_create_address_space(void) {
     // Allocate a page-aligned page directory from PMM
     uint32_t pd_phys = pmm_alloc_frame();
@@ -156,6 +182,14 @@ page_directory_t *paging_create_address_space(void) {
         new_dir->tables[idx] = current_page_dir->tables[idx];
     }
 
+    // The frame is kernel BSS, below PMM_START, so
+    // paging_destroy_address_space() leaves it alone
+    if (paging_map_page(new_dir, USER_VDSO_VADDR, vdso_phys(),
+                        PAGE_PRESENT | PAGE_USER) != 0) {
+        pmm_free_frame(pd_phys);
+        return NULL;
+    }
+
     return new_dir;
 }
 
@@ -174,7 +208,7 @@ int paging_map_page(page_directory_t *page_dir, uint32_t virtual_addr,
             printf("[paging] failed to allocate page table\n");
             return -1;
         }
-        memset((void *)PHYS_TO_KVIRT(pt_phys), 0, sizeof(page_table_t));
+        zero_page((void *)PHYS_TO_KVIRT(pt_phys));
         page_dir->tables[dir_idx] =
             pt_phys | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
     }
@@ -204,6 +238,29 @@ void paging_unmap_page(page_directory_t *page_dir, uint32_t virtual_addr) {
     __asm__ volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
 }
 
+// Unmap a user page and give its frame back to the PMM (heap shrink).
+// Frames outside the PMM pool (shared VBE/MMIO) are only unmapped.
+void paging_free_user_page(page_directory_t *page_dir,
+                           uint32_t virtual_addr) {
+    uint32_t dir_idx = virtual_addr >> 22;
+    uint32_t table_idx = (virtual_addr >> 12) & 0x3FF;
+
+    if (!(page_dir->tables[dir_idx] & PAGE_PRESENT))
+        return;
+
+    page_table_t *pt =
+        (page_table_t *)PHYS_TO_KVIRT(page_dir->tables[dir_idx] & ~0xFFF);
+    uint32_t entry = pt->pages[table_idx];
+    if (!(entry & PAGE_PRESENT))
+        return;
+    pt->pages[table_idx] = 0;
+    __asm__ volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+
+    uint32_t frame = entry & ~0xFFF;
+    if (frame >= PMM_START && frame < PMM_END)
+        pmm_free_frame(frame);
+}
+
 // Switch to a different address space.
 // page_dir is always a virtual (higher-half) pointer — convert to physical
 // for CR3.
@@ -7,6 +7,8 @@
 #define PAGE_PRESENT 0x1
 #define PAGE_WRITE 0x2
 #define PAGE_USER 0x4
+#define PAGE_PWT 0x8 // write-through
+#define PAGE_PCD 0x10 // cache disable
 
 typedef struct page_directory {
     uint32_t tables[1024];
@@ -49,9 +51,13 @@ void paging_destroy_address_space(page_directory_t *page_dir);
 
 // Map VBE framebuffer into kernel page directory (called once at gfx_init)
 void paging_map_vbe(uint32_t phys_addr, uint32_t size);
+// Map device registers (uncached) into the kernel MMIO window. Returns the
+// kernel virtual address of phys_addr, or 0 if the window is exhausted.
+uint32_t paging_map_mmio(uint32_t phys_addr, uint32_t size);
 int paging_map_page(page_directory_t *page_dir, uint32_t virtual_addr,
                     uint32_t physical_addr, uint32_t flags);
 void paging_unmap_page(page_directory_t *page_dir, uint32_t virtual_addr);
+void paging_free_user_page(page_directory_t *page_dir, uint32_t virtual_addr);
 void paging_switch(page_directory_t *page_dir);
 page_directory_t *paging_get_kernel_dir(void);
 
@@ -0,0 +1,42 @@
+#include "sysenter.h"
+#include "tss.h"
+#include "util.h"
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define CPUID_EDX_SEP (1u << 11)
+
+extern void sysenter_entry(void);
+
+static int sysenter_on = 0;
+
+static inline void wrmsr(uint32_t msr, uint32_t value) {
+    __asm__ volatile("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+}
+
+void sysenter_init(uint32_t kernel_stack) {
+    cpu_info_t info;
+    cpu_get_info(&info);
+    // The original Pentium Pro reports SEP but lacks the instructions
+    if (!(info.feature_edx & CPUID_EDX_SEP) ||
+        (info.family == 6 && info.model < 3 && info.stepping < 3)) {
+        printf("SYSENTER not supported, syscalls use int 0x80\n");
+        return;
+    }
+
+    // SYSEXIT derives the user CS/SS as CS+16 and CS+24, which matches the
+    // GDT layout (kernel code, kernel data, user code, user data)
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CODE_SEG);
+    wrmsr(MSR_SYSENTER_ESP, kernel_stack);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+    sysenter_on = 1;
+    printf("SYSENTER fast syscalls enabled\n");
+}
+
+int sysenter_enabled(void) { return sysenter_on; }
+
+void sysenter_set_stack(uint32_t esp0) {
+    if (sysenter_on)
+        wrmsr(MSR_SYSENTER_ESP, esp0);
+}
@@ -0,0 +1,16 @@
+#ifndef _SYSENTER_H
+#define _SYSENTER_H
+
+#include "lib.h"
+
+// Program the SYSENTER MSRs if the CPU supports them. int 0x80 stays
+// available either way.
+void sysenter_init(uint32_t kernel_stack);
+
+// Nonzero once the SYSENTER path is set up
+int sysenter_enabled(void);
+
+// Point SYSENTER at the current task's kernel stack (called on task switch)
+void sysenter_set_stack(uint32_t esp0);
+
+#endif
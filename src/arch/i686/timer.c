@@ -1,9 +1,12 @@
 #include "timer.h"
 #include "interrupts.h"
 #include "io.h"
+#include "ktrace.h"
 #include "lib.h"
 #include "net/net.h"
 #include "proc/task.h"
+#include "prof.h"
+#include "vdso.h"
 
 #define MASTER_PIC_COMMAND 0x20
 #define MASTER_PIC_DATA 0x21
@@ -16,6 +19,7 @@ static uint32_t timer_frequency = 0;
 void timer_handler(uint32_t irq __attribute__((unused)),
                    uint32_t error_code __attribute__((unused))) {
     system_ticks++;
+    vdso_tick(system_ticks);
 }
 
 // Timer handler with context switch support
@@ -23,18 +27,24 @@ void timer_handler(uint32_t irq __attribute__((unused)),
 // is_hw: 1 if called from a real hardware IRQ, 0 if from software int $0x81
 uint32_t *timer_handler_switch(uint32_t *esp, uint32_t is_hw) {
     if (is_hw) {
+        KTRACE(KT_IRQ_ENTER, 0, 0, 0);
         system_ticks++;
+        vdso_tick(system_ticks);
         // Only send EOI for real hardware interrupts
         outb(MASTER_PIC_COMMAND, 0x20);
-        // Process lwIP timeouts (ARP, TCP retransmits, etc.)
-        net_poll();
+        // Wake the net task if its lwIP timeout deadline has passed
+        net_timer_tick();
+        // Frame from irq0_task: gs fs es ds, pusha (ebp at [6]), then the
+        // iret frame (eip at [12], cs at [13])
+        prof_sample(esp[12], esp[13] & 3, esp[6]);
     }
 
     // Call scheduler if multitasking is enabled
-    if (task_is_enabled()) {
-        return schedule(esp, is_hw);
-    }
+    if (task_is_enabled())
+        esp = schedule(esp, is_hw);
 
+    if (is_hw)
+        KTRACE(KT_IRQ_EXIT, 0, 0, 0);
     return esp;
 }
 
@@ -66,6 +76,8 @@ void init_timer(uint32_t frequency) {
 
 uint32_t get_tick_count(void) { return system_ticks; }
 
+uint32_t get_timer_frequency(void) { return timer_frequency; }
+
 uint32_t get_uptime_seconds(void) {
     if (timer_frequency == 0) {
         return 0;
@@ -5,6 +5,7 @@
 
 void init_timer(uint32_t frequency);
 uint32_t get_tick_count(void);
+uint32_t get_timer_frequency(void);
 uint32_t get_uptime_seconds(void);
 void timer_handler(uint32_t irq, uint32_t error_code);
 
@@ -1,6 +1,7 @@
 #include "tss.h"
 #include "gdt.h"
 #include "lib.h"
+#include "sysenter.h"
 
 // Global TSS entry
 static tss_entry_t tss __attribute__((aligned(4096)));
@@ -39,6 +40,9 @@ void tss_init(uint32_t kernel_stack) {
            kernel_stack);
 }
 
-void tss_set_kernel_stack(uint32_t esp0) { tss.esp0 = esp0; }
+void tss_set_kernel_stack(uint32_t esp0) {
+    tss.esp0 = esp0;
+    sysenter_set_stack(esp0);
+}
 
 uint32_t tss_get_kernel_stack(void) { return tss.esp0; }
@@ -0,0 +1,75 @@
+#include "uaccess.h"
+#include "memlayout.h"
+
+typedef struct {
+    uint32_t insn;  // instruction that may fault on a user address
+    uint32_t fixup; // where to resume if it does
+} ex_entry_t;
+
+// Bounds of the __ex_table section (linker.ld)
+extern const ex_entry_t __ex_table_start[];
+extern const ex_entry_t __ex_table_end[];
+
+extern int uaccess_copy(void *dst, const void *src, uint32_t n);
+extern int uaccess_strncpy(char *dst, const char *src, uint32_t n);
+extern int uaccess_probe(const void *ptr, uint32_t n, int write);
+
+int user_range_ok(uint32_t ptr, uint32_t size) {
+    if (ptr == 0)
+        return 0; // NULL pointer
+    if (ptr < USER_REGION_START)
+        return 0; // below user region
+    if (size > USER_REGION_END - USER_REGION_START)
+        return 0; // impossibly large
+    if (ptr + size < ptr)
+        return 0; // overflow
+    if (ptr + size > USER_REGION_END)
+        return 0; // exceeds user region
+    return 1;
+}
+
+int copy_from_user(void *dst, const void *usrc, uint32_t n) {
+    if (n == 0)
+        return 0;
+    if (!user_range_ok((uint32_t)usrc, n))
+        return -1;
+    return uaccess_copy(dst, usrc, n);
+}
+
+int copy_to_user(void *udst, const void *src, uint32_t n) {
+    if (n == 0)
+        return 0;
+    if (!user_range_ok((uint32_t)udst, n))
+        return -1;
+    return uaccess_copy(udst, src, n);
+}
+
+int strncpy_from_user(char *dst, const char *usrc, uint32_t n) {
+    uint32_t p = (uint32_t)usrc;
+    if (n == 0 || p < USER_REGION_START || p >= USER_REGION_END)
+        return -1;
+    // Stop at the end of the user region; running into it unterminated is
+    // a bad pointer rather than a long string
+    uint32_t room = USER_REGION_END - p;
+    uint32_t lim = n < room ? n : room;
+    int len = uaccess_strncpy(dst, usrc, lim);
+    if (len == (int)lim && lim < n)
+        return -1;
+    return len;
+}
+
+int probe_user(const void *uptr, uint32_t n, int write) {
+    if (n == 0)
+        return 0;
+    if (!user_range_ok((uint32_t)uptr, n))
+        return -1;
+    return uaccess_probe(uptr, n, write);
+}
+
+uint32_t uaccess_fixup(uint32_t eip) {
+    for (const ex_entry_t *e = __ex_table_start; e < __ex_table_end; e++) {
+        if (e->insn == eip)
+            return e->fixup;
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef _UACCESS_H
+#define _UACCESS_H
+
+#include "lib.h"
+
+// Kernel <-> user memory copies. The user side is range-checked against the
+// user region, and a page fault while touching it is caught through the
+// exception table (see uaccess_asm.S) instead of killing the task, so a
+// bad pointer just makes the call fail with -1.
+
+// Nonzero if [ptr, ptr+size) lies inside the user region
+int user_range_ok(uint32_t ptr, uint32_t size);
+
+// Copy n bytes in or out. Returns 0, or -1 on a bad user pointer.
+int copy_from_user(void *dst, const void *usrc, uint32_t n);
+int copy_to_user(void *udst, const void *src, uint32_t n);
+
+// Copy a NUL-terminated user string into dst[n]. Returns its length, n if
+// no NUL was found in the first n bytes (dst is then not terminated), or -1
+// on a bad pointer.
+int strncpy_from_user(char *dst, const char *usrc, uint32_t n);
+
+// Touch every page of a user buffer the kernel is about to access directly
+// (for reads, or writes when write is set). Returns 0 if all of it is
+// mapped, -1 otherwise.
+int probe_user(const void *uptr, uint32_t n, int write);
+
+// Page fault handler hook: the address to resume at when eip is one of the
+// user access instructions, or 0 if the fault is not ours to fix up
+uint32_t uaccess_fixup(uint32_t eip);
+
+#endif
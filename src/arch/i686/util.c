@@ -111,6 +111,14 @@ void cpu_get_info(cpu_info_t *out) {
     out->stepping = stepping;
     out->feature_ecx = ecx;
     out->feature_edx = edx;
+
+    out->feature7_ebx = 0;
+    if (out->max_leaf >= 7) {
+        __asm__ volatile("cpuid"
+                         : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                         : "a"(7), "c"(0));
+        out->feature7_ebx = ebx;
+    }
 }
 
 void print_cpu_info(void) {
@@ -123,4 +131,5 @@ void print_cpu_info(void) {
             info.stepping);
     kprintf("Feature ECX: 0x%x\n", info.feature_ecx);
     kprintf("Feature EDX: 0x%x\n", info.feature_edx);
+    kprintf("Feature leaf 7 EBX: 0x%x\n", info.feature7_ebx);
 }
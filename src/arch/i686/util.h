@@ -16,7 +16,10 @@ typedef struct {
     uint32_t stepping;
     uint32_t feature_ecx;
     uint32_t feature_edx;
+    uint32_t feature7_ebx; // CPUID leaf 7 subleaf 0, 0 if unsupported
 } cpu_info_t;
+
+#define CPUID7_EBX_ERMS (1u << 9) // enhanced rep movsb/stosb
 void cpu_get_info(cpu_info_t *out);
 
 extern void halt_and_catch_fire(void);
@@ -0,0 +1,73 @@
+#include "vdso.h"
+#include "memlayout.h"
+#include "net/net.h"
+#include "proc/pmm.h"
+
+// Ticks to average over when calibrating the TSC (a power of two so the
+// 64-bit delta divides with a shift)
+#define VDSO_CAL_SHIFT 6
+
+// Lives in kernel BSS, below PMM_START, so tearing down an address space
+// never frees it
+static union {
+    vdso_data_t data;
+    uint8_t page[4096];
+} vdso_page __attribute__((aligned(4096)));
+
+static uint32_t cal_start_tick = 0;
+static uint64_t cal_start_tsc = 0;
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+void vdso_init(uint32_t tick_hz) {
+    vdso_data_t *v = &vdso_page.data;
+    v->tick_hz = tick_hz;
+    v->gfx_info = (8u << 24) | (320u << 12) | 200u; // Mode 13h until gfx_init
+    v->magic = VDSO_MAGIC;
+    printf("[vdso] shared page at 0x%x (user 0x%x)\n", vdso_phys(),
+           USER_VDSO_VADDR);
+}
+
+uint32_t vdso_phys(void) { return KVIRT_TO_PHYS((uint32_t)&vdso_page); }
+
+static void calibrate(vdso_data_t *v, uint32_t ticks, uint64_t tsc) {
+    if (!cal_start_tick) {
+        cal_start_tick = ticks;
+        cal_start_tsc = tsc;
+        return;
+    }
+    if (ticks - cal_start_tick < (1u << VDSO_CAL_SHIFT))
+        return;
+    uint32_t per_tick = (uint32_t)((tsc - cal_start_tsc) >> VDSO_CAL_SHIFT);
+    uint32_t ms_per_tick = v->tick_hz ? 1000 / v->tick_hz : 0;
+    if (ms_per_tick)
+        v->tsc_per_ms = per_tick / ms_per_tick;
+}
+
+void vdso_tick(uint32_t ticks) {
+    vdso_data_t *v = &vdso_page.data;
+    uint64_t tsc = rdtsc();
+    if (!v->tsc_per_ms)
+        calibrate(v, ticks, tsc);
+
+    v->seq++;
+    __asm__ volatile("" ::: "memory");
+    v->ticks = ticks;
+    v->tsc_lo = (uint32_t)tsc;
+    v->tsc_hi = (uint32_t)(tsc >> 32);
+    v->free_frames = pmm_free_count();
+    v->total_frames = PMM_FRAME_COUNT;
+    net_get_stats(&v->rx_packets, &v->tx_packets);
+    __asm__ volatile("" ::: "memory");
+    v->seq++;
+}
+
+void vdso_set_pid(uint32_t pid) { vdso_page.data.pid = pid; }
+
+uint32_t vdso_tsc_per_ms(void) { return vdso_page.data.tsc_per_ms; }
+
+void vdso_set_gfx_info(uint32_t info) { vdso_page.data.gfx_info = info; }
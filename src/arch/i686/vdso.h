@@ -0,0 +1,37 @@
+#ifndef _VDSO_H
+#define _VDSO_H
+
+#include "lib.h"
+
+// Read-only page mapped at USER_VDSO_VADDR in every user address space.
+// The kernel keeps it current so userland can read the clock and other
+// hot values without a syscall. Layout is shared with userland/syscalls.h.
+#define VDSO_MAGIC 0x4F534456u // "VDSO"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;        // odd while the per-tick fields below are updated
+    uint32_t ticks;      // timer ticks since boot
+    uint32_t tick_hz;    // timer frequency
+    uint32_t tsc_lo;     // TSC sampled at the last tick
+    uint32_t tsc_hi;
+    uint32_t tsc_per_ms; // TSC cycles per millisecond, 0 until calibrated
+    uint32_t free_frames; // PMM free 4KB frames
+    uint32_t total_frames;
+    uint32_t rx_packets; // NIC packet counters (0 without a NIC)
+    uint32_t tx_packets;
+    uint32_t pid;        // id of the running task (written on every switch)
+    uint32_t gfx_info;   // SYS_GFX_INFO value
+} vdso_data_t;
+
+void vdso_init(uint32_t tick_hz);
+// Physical address of the page, for paging_create_address_space()
+uint32_t vdso_phys(void);
+// Timer IRQ: refresh ticks, TSC and counters (runs with IF=0)
+void vdso_tick(uint32_t ticks);
+void vdso_set_pid(uint32_t pid);
+// TSC calibration from the timer, 0 until known
+uint32_t vdso_tsc_per_ms(void);
+void vdso_set_gfx_info(uint32_t info);
+
+#endif
@@ -1,5 +1,6 @@
 #include "ata_pio.h"
 #include "arch/i686/io.h"
+#include "ktrace.h"
 
 #define ATA_IO_BASE 0x1F0
 #define ATA_CTRL_BASE 0x3F6
@@ -25,7 +26,9 @@
 #define ATA_SR_DRDY 0x40
 #define ATA_SR_BSY 0x80
 
-static int ata_ready = 0;
+// Per-drive state: index 0 = primary master, 1 = primary slave.
+static int ata_ready[2];
+static int ata_selected = -1; // drive currently addressed by HDDEVSEL
 
 static void ata_delay_400ns(void) {
     (void)inb(ATA_REG_ALTSTATUS);
@@ -54,11 +57,27 @@ static int ata_wait_drq(uint32_t spins) {
     return -1;
 }
 
-int ata_pio_init(void) {
-    ata_ready = 0;
+// Point the channel at `drive`. Switching drives needs the 400ns settle
+// time and the new drive to drop BSY before its registers are valid.
+static int ata_select(uint8_t drive, uint32_t lba) {
+    outb(ATA_REG_HDDEVSEL,
+         (uint8_t)(0xE0 | (drive << 4) | ((lba >> 24) & 0x0F)));
+    if (ata_selected != drive) {
+        ata_selected = drive;
+        ata_delay_400ns();
+        if (ata_wait_not_busy(1000000) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int ata_pio_init_drive(uint8_t drive) {
+    if (drive > 1)
+        return -1;
+    ata_ready[drive] = 0;
 
-    // Select primary master
-    outb(ATA_REG_HDDEVSEL, 0xA0);
+    outb(ATA_REG_HDDEVSEL, (uint8_t)(0xA0 | (drive << 4)));
+    ata_selected = drive;
     ata_delay_400ns();
 
     outb(ATA_REG_SECCOUNT0, 0);
@@ -69,8 +88,8 @@ int ata_pio_init(void) {
     ata_delay_400ns();
 
     uint8_t status = inb(ATA_REG_STATUS);
-    if (status == 0) {
-        return -1; // No device
+    if (status == 0 || status == 0xFF) {
+        return -1; // No device (0xFF = floating bus)
     }
 
     // If LBA1/LBA2 are non-zero, this is likely ATAPI or unsupported here.
@@ -89,12 +108,14 @@ int ata_pio_init(void) {
         (void)inw(ATA_REG_DATA);
     }
 
-    ata_ready = 1;
+    ata_ready[drive] = 1;
     return 0;
 }
 
-int ata_pio_read(uint32_t lba, uint8_t count, void *buf) {
-    if (!ata_ready || !buf || count == 0)
+int ata_pio_init(void) { return ata_pio_init_drive(0); }
+
+static int ata_read(uint8_t drive, uint32_t lba, uint8_t count, void *buf) {
+    if (drive > 1 || !ata_ready[drive] || !buf || count == 0)
         return -1;
 
     // 28-bit LBA only in this minimal implementation
@@ -104,7 +125,9 @@ int ata_pio_read(uint32_t lba, uint8_t count, void *buf) {
     if (ata_wait_not_busy(1000000) < 0)
         return -1;
 
-    outb(ATA_REG_HDDEVSEL, (uint8_t)(0xE0 | ((lba >> 24) & 0x0F)));
+    if (ata_select(drive, lba) < 0)
+        return -1;
+
     outb(ATA_REG_SECCOUNT0, count);
     outb(ATA_REG_LBA0, (uint8_t)(lba & 0xFF));
     outb(ATA_REG_LBA1, (uint8_t)((lba >> 8) & 0xFF));
@@ -124,8 +147,9 @@ int ata_pio_read(uint32_t lba, uint8_t count, void *buf) {
     return 0;
 }
 
-int ata_pio_write(uint32_t lba, uint8_t count, const void *buf) {
-    if (!ata_ready || !buf || count == 0)
+static int ata_write(uint8_t drive, uint32_t lba, uint8_t count,
+                     const void *buf) {
+    if (drive > 1 || !ata_ready[drive] || !buf || count == 0)
         return -1;
     if (lba & 0xF0000000u)
         return -1;
@@ -133,7 +157,9 @@ int ata_pio_write(uint32_t lba, uint8_t count, const void *buf) {
     if (ata_wait_not_busy(1000000) < 0)
         return -1;
 
-    outb(ATA_REG_HDDEVSEL, (uint8_t)(0xE0 | ((lba >> 24) & 0x0F)));
+    if (ata_select(drive, lba) < 0)
+        return -1;
+
     outb(ATA_REG_SECCOUNT0, count);
     outb(ATA_REG_LBA0, (uint8_t)(lba & 0xFF));
     outb(ATA_REG_LBA1, (uint8_t)((lba >> 8) & 0xFF));
@@ -156,4 +182,27 @@ int ata_pio_write(uint32_t lba, uint8_t count, const void *buf) {
     return 0;
 }
 
-int ata_pio_is_ready(void) { return ata_ready; }
+int ata_pio_read_drive(uint8_t drive, uint32_t lba, uint8_t count, void *buf) {
+    KTRACE(KT_DISK_START, lba, count, drive);
+    int r = ata_read(drive, lba, count, buf);
+    KTRACE(KT_DISK_DONE, lba, r, drive);
+    return r;
+}
+
+int ata_pio_write_drive(uint8_t drive, uint32_t lba, uint8_t count,
+                        const void *buf) {
+    KTRACE(KT_DISK_START, lba, count, drive | 2);
+    int r = ata_write(drive, lba, count, buf);
+    KTRACE(KT_DISK_DONE, lba, r, drive | 2);
+    return r;
+}
+
+int ata_pio_read(uint32_t lba, uint8_t count, void *buf) {
+    return ata_pio_read_drive(0, lba, count, buf);
+}
+
+int ata_pio_write(uint32_t lba, uint8_t count, const void *buf) {
+    return ata_pio_write_drive(0, lba, count, buf);
+}
+
+int ata_pio_is_ready(void) { return ata_ready[0]; }
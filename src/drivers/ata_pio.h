@@ -18,4 +18,11 @@ int ata_pio_write(uint32_t lba, uint8_t count, const void *buf);
 // Returns 1 if an ATA disk was successfully initialized, else 0.
 int ata_pio_is_ready(void);
 
+// Same operations on a specific drive of the primary channel
+// (0 = master, 1 = slave). The functions above address the master.
+int ata_pio_init_drive(uint8_t drive);
+int ata_pio_read_drive(uint8_t drive, uint32_t lba, uint8_t count, void *buf);
+int ata_pio_write_drive(uint8_t drive, uint32_t lba, uint8_t count,
+                        const void *buf);
+
 #endif
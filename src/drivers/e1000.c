@@ -0,0 +1,464 @@
+#include "e1000.h"
+#include "arch/i686/interrupts.h"
+#include "arch/i686/paging.h"
+#include "arch/i686/pci.h"
+#include "ktrace.h"
+#include "memlayout.h"
+#include "proc/pmm.h"
+
+#include "lwip/pbuf.h"
+
+// ---- Intel 8254x (e1000) constants ----
+#define E1000_VENDOR_ID 0x8086
+#define E1000_DEVICE_ID 0x100E // 82540EM, QEMU -device e1000
+
+#define E1000_MMIO_SIZE 0x20000
+
+#define E1000_CTRL 0x0000
+#define E1000_STATUS 0x0008
+#define E1000_EERD 0x0014
+#define E1000_ICR 0x00C0
+#define E1000_ITR 0x00C4
+#define E1000_IMS 0x00D0
+#define E1000_IMC 0x00D8
+#define E1000_RCTL 0x0100
+#define E1000_TCTL 0x0400
+#define E1000_TIPG 0x0410
+#define E1000_RDBAL 0x2800
+#define E1000_RDBAH 0x2804
+#define E1000_RDLEN 0x2808
+#define E1000_RDH 0x2810
+#define E1000_RDT 0x2818
+#define E1000_RDTR 0x2820
+#define E1000_RADV 0x282C
+#define E1000_TDBAL 0x3800
+#define E1000_TDBAH 0x3804
+#define E1000_TDLEN 0x3808
+#define E1000_TDH 0x3810
+#define E1000_TDT 0x3818
+#define E1000_MTA 0x5200
+#define E1000_RAL0 0x5400
+#define E1000_RAH0 0x5404
+
+#define E1000_CTRL_ASDE (1u << 5)
+#define E1000_CTRL_SLU (1u << 6)
+#define E1000_CTRL_RST (1u << 26)
+
+#define E1000_EERD_START 0x01
+#define E1000_EERD_DONE 0x10
+
+#define E1000_INT_TXDW 0x01
+#define E1000_INT_LSC 0x04
+#define E1000_INT_RXDMT0 0x10
+#define E1000_INT_RXO 0x40
+#define E1000_INT_RXT0 0x80
+#define E1000_IMS_RX                                                           \
+    (E1000_INT_LSC | E1000_INT_RXDMT0 | E1000_INT_RXO | E1000_INT_RXT0)
+
+#define E1000_RCTL_EN (1u << 1)
+#define E1000_RCTL_BAM (1u << 15)
+#define E1000_RCTL_SECRC (1u << 26) // strip Ethernet CRC
+// BSIZE = 00 with BSEX = 0 selects 2048-byte receive buffers
+
+#define E1000_TCTL_EN (1u << 1)
+#define E1000_TCTL_PSP (1u << 3)
+#define E1000_TCTL_CT (0x10u << 4)
+#define E1000_TCTL_COLD (0x40u << 12)
+#define E1000_TIPG_DEFAULT (10u | (8u << 10) | (6u << 20))
+
+// Interrupt throttling: ITR counts 256ns units between interrupts.
+// 488 caps the card at ~8000 interrupts/s under load.
+#define E1000_ITR_DEFAULT 488
+
+#define E1000_RXD_DD 0x01
+#define E1000_RXD_EOP 0x02
+#define E1000_TXD_CMD_EOP 0x01
+#define E1000_TXD_CMD_IFCS 0x02
+#define E1000_TXD_CMD_RS 0x08
+#define E1000_TXD_DD 0x01
+
+#define E1000_RING_SIZE 256
+#define E1000_RX_BUF_SIZE 2048
+// One spare beyond the 255 postable descriptors, so a refill can happen
+// while a frame is still up in the stack.
+#define E1000_RX_BUFS E1000_RING_SIZE
+#define E1000_TX_MAX_SEGS 16
+
+typedef struct {
+    uint64_t addr;
+    uint16_t length;
+    uint16_t csum;
+    uint8_t status;
+    uint8_t errors;
+    uint16_t special;
+} __attribute__((packed)) e1000_rx_desc_t;
+
+typedef struct {
+    uint64_t addr;
+    uint16_t length;
+    uint8_t cso;
+    uint8_t cmd;
+    uint8_t status;
+    uint8_t css;
+    uint16_t special;
+} __attribute__((packed)) e1000_tx_desc_t;
+
+// RX buffer: a custom pbuf over a DMA-able 2KB half of a PMM frame. lwIP
+// gets the buffer itself; freeing the pbuf returns it to the free list.
+typedef struct {
+    struct pbuf_custom pc; // must be first
+    uint8_t *data;
+    uint32_t phys;
+} e1000_rxbuf_t;
+
+static volatile uint32_t *e1000_regs = 0;
+static uint8_t e1000_irq = 0;
+static int irq_wired = 0;
+static uint8_t e1000_mac[6];
+
+static e1000_rx_desc_t rx_ring[E1000_RING_SIZE] __attribute__((aligned(128)));
+static e1000_tx_desc_t tx_ring[E1000_RING_SIZE] __attribute__((aligned(128)));
+
+static e1000_rxbuf_t rxbufs[E1000_RX_BUFS];
+static e1000_rxbuf_t *rx_free[E1000_RX_BUFS]; // free-buffer stack
+static int rx_free_count = 0;
+static e1000_rxbuf_t *rx_slot[E1000_RING_SIZE]; // buffer posted per desc
+static uint32_t rx_next = 0;                    // next desc to check for DD
+static uint32_t rx_tail = 0;                    // mirrors RDT
+
+static struct pbuf *tx_pbuf[E1000_RING_SIZE]; // held until the desc is done
+static uint32_t tx_clean = 0;                 // oldest in-flight desc
+static uint32_t tx_tail = 0;                  // mirrors TDT
+
+static uint32_t rx_packets = 0;
+static uint32_t tx_packets = 0;
+
+static nic_rx_callback_t rx_callback = 0;
+static nic_irq_callback_t irq_callback = 0;
+
+static inline uint32_t e1000_read(uint32_t reg) {
+    return e1000_regs[reg / 4];
+}
+
+static inline void e1000_write(uint32_t reg, uint32_t val) {
+    e1000_regs[reg / 4] = val;
+}
+
+// ---- RX buffer pool ----
+static void e1000_rxbuf_free(struct pbuf *p) {
+    rx_free[rx_free_count++] = (e1000_rxbuf_t *)p;
+}
+
+static int e1000_rxbuf_init(void) {
+    for (int i = 0; i < E1000_RX_BUFS; i += 2) {
+        uint32_t phys = pmm_alloc_frame();
+        if (!phys)
+            return -1;
+        for (int j = 0; j < 2; j++) {
+            e1000_rxbuf_t *b = &rxbufs[i + j];
+            b->phys = phys + (uint32_t)j * E1000_RX_BUF_SIZE;
+            b->data = (uint8_t *)PHYS_TO_KVIRT(b->phys);
+            b->pc.custom_free_function = e1000_rxbuf_free;
+            rx_free[rx_free_count++] = b;
+        }
+    }
+    return 0;
+}
+
+// Post free buffers to empty descriptors. At most RING_SIZE-1 are posted:
+// RDH == RDT means "no descriptors" to the card.
+static void e1000_rx_refill(void) {
+    uint32_t old_tail = rx_tail;
+    while (rx_free_count > 0 &&
+           (rx_tail + 1) % E1000_RING_SIZE != rx_next) {
+        e1000_rxbuf_t *b = rx_free[--rx_free_count];
+        rx_slot[rx_tail] = b;
+        rx_ring[rx_tail].addr = b->phys;
+        rx_ring[rx_tail].status = 0;
+        rx_tail = (rx_tail + 1) % E1000_RING_SIZE;
+    }
+    if (rx_tail != old_tail)
+        e1000_write(E1000_RDT, rx_tail);
+}
+
+// ---- TX ----
+static void e1000_tx_reclaim(void) {
+    uint32_t n = 0;
+    while (tx_clean != tx_tail && (tx_ring[tx_clean].status & E1000_TXD_DD)) {
+        if (tx_pbuf[tx_clean]) {
+            pbuf_free(tx_pbuf[tx_clean]);
+            tx_pbuf[tx_clean] = NULL;
+        }
+        tx_clean = (tx_clean + 1) % E1000_RING_SIZE;
+        n++;
+    }
+    if (n)
+        KTRACE(KT_NIC_TX_DONE, n, 0, 0);
+}
+
+static uint32_t e1000_tx_free(void) {
+    uint32_t used = (tx_tail + E1000_RING_SIZE - tx_clean) % E1000_RING_SIZE;
+    return E1000_RING_SIZE - 1 - used;
+}
+
+// Only memory in the kernel's linear map has a known physical address.
+static int e1000_dma_ok(const void *va) {
+    uint32_t v = (uint32_t)va;
+    return v >= KERNEL_VIRTUAL_BASE && v < KERNEL_MMIO_START;
+}
+
+// Scatter-gather: one descriptor per pbuf in the chain, pointing at the
+// pbuf's own payload. The chain is referenced until the card is done.
+static int e1000_send(struct pbuf *p) {
+    if (!e1000_regs)
+        return -1;
+
+    uint32_t segs = 0;
+    int direct = 1;
+    for (struct pbuf *q = p; q; q = q->next) {
+        if (!q->len)
+            continue;
+        segs++;
+        if (!e1000_dma_ok(q->payload))
+            direct = 0;
+    }
+    if (!segs)
+        return 0;
+
+    struct pbuf *frame = p;
+    if (!direct || segs > E1000_TX_MAX_SEGS) {
+        frame = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        if (!frame)
+            return -1;
+        segs = 1;
+    } else {
+        pbuf_ref(p);
+    }
+
+    e1000_tx_reclaim();
+    if (e1000_tx_free() < segs) {
+        pbuf_free(frame);
+        return -1;
+    }
+
+    uint32_t last = tx_tail;
+    for (struct pbuf *q = frame; q; q = q->next) {
+        if (!q->len)
+            continue;
+        e1000_tx_desc_t *d = &tx_ring[tx_tail];
+        d->addr = KVIRT_TO_PHYS((uint32_t)q->payload);
+        d->length = q->len;
+        d->cso = 0;
+        d->css = 0;
+        d->special = 0;
+        d->status = 0;
+        d->cmd = E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS;
+        last = tx_tail;
+        tx_tail = (tx_tail + 1) % E1000_RING_SIZE;
+    }
+    tx_ring[last].cmd |= E1000_TXD_CMD_EOP;
+    tx_pbuf[last] = frame;
+
+    __asm__ volatile("" : : : "memory");
+    e1000_write(E1000_TDT, tx_tail);
+    tx_packets++;
+    return 0;
+}
+
+// ---- RX ----
+static int e1000_rx_poll(int budget) {
+    if (!e1000_regs)
+        return 0;
+
+    int done = 0;
+    while (done < budget && (rx_ring[rx_next].status & E1000_RXD_DD)) {
+        e1000_rx_desc_t *d = &rx_ring[rx_next];
+        e1000_rxbuf_t *b = rx_slot[rx_next];
+        rx_slot[rx_next] = NULL;
+        rx_next = (rx_next + 1) % E1000_RING_SIZE;
+
+        // 2KB buffers hold any non-jumbo frame, so a frame that is not a
+        // single EOP descriptor, or that the card flagged, is dropped.
+        if (!(d->status & E1000_RXD_EOP) || d->errors || !d->length) {
+            rx_free[rx_free_count++] = b;
+            continue;
+        }
+
+        struct pbuf *p = pbuf_alloced_custom(PBUF_RAW, d->length, PBUF_REF,
+                                             &b->pc, b->data,
+                                             E1000_RX_BUF_SIZE);
+        if (rx_callback)
+            rx_callback(p);
+        else
+            pbuf_free(p);
+        rx_packets++;
+        done++;
+    }
+
+    e1000_rx_refill();
+    e1000_tx_reclaim();
+    return done;
+}
+
+// ---- Interrupts ----
+// Reading ICR acknowledges it. RX work is deferred to the irq callback
+// with the card masked; events arriving meanwhile stay latched in ICR and
+// fire again on unmask.
+static void e1000_irq_handler(uint32_t irq __attribute__((unused)),
+                              uint32_t err __attribute__((unused))) {
+    if (!e1000_regs)
+        return;
+    uint32_t icr = e1000_read(E1000_ICR);
+    if (!(icr & E1000_IMS_RX))
+        return;
+    e1000_write(E1000_IMC, 0xFFFFFFFFu);
+    if (irq_callback)
+        irq_callback();
+}
+
+static void e1000_irq_enable(void) {
+    if (e1000_regs)
+        e1000_write(E1000_IMS, E1000_IMS_RX);
+}
+
+static int e1000_irq_wired(void) { return irq_wired; }
+
+// ---- MAC address ----
+static uint16_t e1000_eeprom_read(uint8_t addr) {
+    e1000_write(E1000_EERD, ((uint32_t)addr << 8) | E1000_EERD_START);
+    uint32_t v;
+    int spins = 100000;
+    while (!((v = e1000_read(E1000_EERD)) & E1000_EERD_DONE) && --spins)
+        ;
+    return (uint16_t)(v >> 16);
+}
+
+static void e1000_read_mac(void) {
+    uint32_t ral = e1000_read(E1000_RAL0);
+    uint32_t rah = e1000_read(E1000_RAH0);
+    if (ral || (rah & 0xFFFF)) {
+        for (int i = 0; i < 4; i++)
+            e1000_mac[i] = (uint8_t)(ral >> (i * 8));
+        e1000_mac[4] = (uint8_t)rah;
+        e1000_mac[5] = (uint8_t)(rah >> 8);
+        return;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        uint16_t w = e1000_eeprom_read(i);
+        e1000_mac[i * 2] = (uint8_t)w;
+        e1000_mac[i * 2 + 1] = (uint8_t)(w >> 8);
+    }
+}
+
+// ---- Probe / init ----
+static int e1000_probe(nic_rx_callback_t rx_cb, nic_irq_callback_t irq_cb) {
+    rx_callback = rx_cb;
+    irq_callback = irq_cb;
+
+    pci_device_t *dev = pci_find_device(E1000_VENDOR_ID, E1000_DEVICE_ID);
+    if (!dev) {
+        kprintf("[e1000] not found\n");
+        return -1;
+    }
+
+    if (dev->bar[0] & 0x07) {
+        kprintf("[e1000] BAR0 not 32-bit MMIO\n");
+        return -1;
+    }
+
+    uint32_t mmio = paging_map_mmio(dev->bar[0] & ~0xFu, E1000_MMIO_SIZE);
+    if (!mmio)
+        return -1;
+    if (e1000_rxbuf_init() != 0) {
+        kprintf("[e1000] out of memory for RX buffers\n");
+        return -1;
+    }
+    e1000_regs = (volatile uint32_t *)mmio;
+    e1000_irq = dev->irq_line;
+
+    pci_enable_bus_mastering(dev);
+
+    e1000_write(E1000_IMC, 0xFFFFFFFFu);
+    e1000_write(E1000_CTRL, e1000_read(E1000_CTRL) | E1000_CTRL_RST);
+    for (int spins = 100000;
+         (e1000_read(E1000_CTRL) & E1000_CTRL_RST) && spins; spins--)
+        ;
+    e1000_write(E1000_IMC, 0xFFFFFFFFu);
+    (void)e1000_read(E1000_ICR);
+
+    e1000_write(E1000_CTRL,
+                e1000_read(E1000_CTRL) | E1000_CTRL_SLU | E1000_CTRL_ASDE);
+
+    e1000_read_mac();
+    e1000_write(E1000_RAL0, (uint32_t)e1000_mac[0] |
+                                ((uint32_t)e1000_mac[1] << 8) |
+                                ((uint32_t)e1000_mac[2] << 16) |
+                                ((uint32_t)e1000_mac[3] << 24));
+    e1000_write(E1000_RAH0, (uint32_t)e1000_mac[4] |
+                                ((uint32_t)e1000_mac[5] << 8) | (1u << 31));
+    for (int i = 0; i < 128; i++)
+        e1000_write(E1000_MTA + (uint32_t)i * 4, 0);
+
+    // RX ring. Rings are in BSS at higher-half VMA; DMA needs physical.
+    memset(rx_ring, 0, sizeof(rx_ring));
+    e1000_write(E1000_RDBAL, KVIRT_TO_PHYS((uint32_t)rx_ring));
+    e1000_write(E1000_RDBAH, 0);
+    e1000_write(E1000_RDLEN, sizeof(rx_ring));
+    e1000_write(E1000_RDH, 0);
+    e1000_write(E1000_RDT, 0);
+    rx_next = rx_tail = 0;
+    e1000_rx_refill();
+    e1000_write(E1000_RDTR, 0);
+    e1000_write(E1000_RADV, 0);
+    e1000_write(E1000_RCTL, E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC);
+
+    // TX ring
+    memset(tx_ring, 0, sizeof(tx_ring));
+    e1000_write(E1000_TDBAL, KVIRT_TO_PHYS((uint32_t)tx_ring));
+    e1000_write(E1000_TDBAH, 0);
+    e1000_write(E1000_TDLEN, sizeof(tx_ring));
+    e1000_write(E1000_TDH, 0);
+    e1000_write(E1000_TDT, 0);
+    tx_clean = tx_tail = 0;
+    e1000_write(E1000_TIPG, E1000_TIPG_DEFAULT);
+    e1000_write(E1000_TCTL, E1000_TCTL_EN | E1000_TCTL_PSP | E1000_TCTL_CT |
+                                E1000_TCTL_COLD);
+
+    e1000_write(E1000_ITR, E1000_ITR_DEFAULT);
+
+    if (e1000_irq != 0 && e1000_irq != 0xFF) {
+        register_interrupt_handler((uint8_t)(0x20 + e1000_irq),
+                                   e1000_irq_handler);
+        pic_unmask_irq(e1000_irq);
+        irq_wired = 1;
+    }
+    e1000_irq_enable();
+
+    kprintf("[e1000] mmio=0x%x irq=%d mac=%x:%x:%x:%x:%x:%x ring=%d\n",
+            dev->bar[0] & ~0xFu, e1000_irq, e1000_mac[0], e1000_mac[1],
+            e1000_mac[2], e1000_mac[3], e1000_mac[4], e1000_mac[5],
+            E1000_RING_SIZE);
+    return 0;
+}
+
+static void e1000_get_mac(uint8_t mac[6]) { memcpy(mac, e1000_mac, 6); }
+
+static void e1000_get_stats(uint32_t *rx, uint32_t *tx) {
+    if (rx)
+        *rx = rx_packets;
+    if (tx)
+        *tx = tx_packets;
+}
+
+static const nic_ops_t e1000_ops = {
+    .name = "e1000",
+    .probe = e1000_probe,
+    .send = e1000_send,
+    .rx_poll = e1000_rx_poll,
+    .irq_enable = e1000_irq_enable,
+    .irq_wired = e1000_irq_wired,
+    .get_mac = e1000_get_mac,
+    .get_stats = e1000_get_stats,
+};
+
+const nic_ops_t *e1000_get_ops(void) { return &e1000_ops; }
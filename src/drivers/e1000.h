@@ -0,0 +1,10 @@
+#ifndef _E1000_H
+#define _E1000_H
+
+#include "nic.h"
+
+// Intel 82540EM (QEMU -device e1000): 256-entry RX/TX descriptor rings,
+// zero-copy RX into custom pbufs, scatter-gather TX from pbuf chains.
+const nic_ops_t *e1000_get_ops(void);
+
+#endif
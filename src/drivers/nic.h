@@ -0,0 +1,34 @@
+#ifndef _NIC_H
+#define _NIC_H
+
+#include "lib.h"
+
+struct pbuf;
+
+// Receive callback — driver hands each frame to the stack as a pbuf, which
+// the callee then owns
+typedef void (*nic_rx_callback_t)(struct pbuf *p);
+// IRQ callback — called from the NIC IRQ with the card's interrupts masked
+typedef void (*nic_irq_callback_t)(void);
+
+// NIC driver operations - each Ethernet driver implements these
+typedef struct nic_ops {
+    const char *name;
+    // Find and bring up the card. Returns 0 if present, -1 otherwise.
+    int (*probe)(nic_rx_callback_t rx_cb, nic_irq_callback_t irq_cb);
+    // Queue a frame (possibly a pbuf chain). The driver takes its own pbuf
+    // reference if it transmits in place. Returns 0, or -1 when the TX ring
+    // is full and the frame was not queued.
+    int (*send)(struct pbuf *p);
+    // Deliver at most `budget` received frames; returns how many were
+    // delivered. A return equal to the budget means more may be waiting.
+    int (*rx_poll)(int budget);
+    // Re-arm RX interrupts after the IRQ callback masked them
+    void (*irq_enable)(void);
+    // Nonzero if the card has a working IRQ line (otherwise poll it)
+    int (*irq_wired)(void);
+    void (*get_mac)(uint8_t mac[6]);
+    void (*get_stats)(uint32_t *rx_packets, uint32_t *tx_packets);
+} nic_ops_t;
+
+#endif
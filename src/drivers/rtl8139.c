@@ -4,6 +4,8 @@
 #include "arch/i686/pci.h"
 #include "memlayout.h"
 
+#include "lwip/pbuf.h"
+
 // ---- RTL8139 constants ----
 #define RTL_VENDOR_ID 0x10EC
 #define RTL_DEVICE_ID 0x8139
@@ -21,6 +23,8 @@
 #define RTL_RCR 0x44
 #define RTL_CONFIG1 0x52
 
+#define RTL_TSD_OWN 0x2000 // set once the slot's frame has been DMA'd out
+
 #define RTL_CR_RESET 0x10
 #define RTL_CR_RX_EN 0x08
 #define RTL_CR_TX_EN 0x04
@@ -30,6 +34,8 @@
 #define RTL_INT_TOK 0x04
 #define RTL_INT_RXOVW 0x10
 #define RTL_INT_FOVW 0x40
+#define RTL_IMR_ALL                                                            \
+    (RTL_INT_ROK | RTL_INT_RER | RTL_INT_TOK | RTL_INT_RXOVW | RTL_INT_FOVW)
 
 #define RTL_RCR_AAP 0x01
 #define RTL_RCR_APM 0x02
@@ -51,32 +57,50 @@ static uint8_t rx_buf[RX_BUF_SIZE] __attribute__((aligned(16)));
 static uint16_t rx_offset = 0; // Logical read pointer in 8KB RX ring
 static uint8_t tx_buf[TX_DESC_COUNT][TX_BUF_SIZE] __attribute__((aligned(16)));
 static int tx_cur = 0;
+static uint8_t tx_busy[TX_DESC_COUNT];
 static uint32_t rx_packets = 0;
 static uint32_t tx_packets = 0;
 
 static nic_rx_callback_t rx_callback = 0;
-
-// ---- Send raw Ethernet frame ----
-void rtl8139_send(const uint8_t *data, uint16_t len) {
-    if (!rtl_io || len > TX_BUF_SIZE)
-        return;
-    int idx = tx_cur % TX_DESC_COUNT;
-    memcpy(tx_buf[idx], data, len);
+static nic_irq_callback_t irq_callback = 0;
+static int irq_wired = 0;
+
+// ---- Send Ethernet frame ----
+// The pbuf chain is flattened straight into the slot's DMA buffer. A slot
+// may only be reused once the card has set OWN on its previous frame.
+static int rtl8139_send(struct pbuf *p) {
+    if (!rtl_io || p->tot_len > TX_BUF_SIZE)
+        return -1;
+    int idx = tx_cur;
+    uint16_t tsd = (uint16_t)(RTL_TSD0 + (idx * 4));
+    if (tx_busy[idx]) {
+        int spins = 100000;
+        while (!(inl(rtl_io + tsd) & RTL_TSD_OWN) && --spins)
+            ;
+        if (!spins)
+            return -1;
+    }
+    uint16_t len = pbuf_copy_partial(p, tx_buf[idx], p->tot_len, 0);
     // DMA needs physical address; tx_buf is in BSS at higher-half VMA
     outl(rtl_io + RTL_TSAD0 + (idx * 4),
          KVIRT_TO_PHYS((uint32_t)tx_buf[idx]));
-    outl(rtl_io + RTL_TSD0 + (idx * 4), len);
+    outl(rtl_io + tsd, len);
+    tx_busy[idx] = 1;
     tx_cur = (tx_cur + 1) % TX_DESC_COUNT;
     tx_packets++;
+    return 0;
 }
 
 // ---- RX polling ----
-void rtl8139_rx_poll(void) {
+// Deliver at most `budget` frames; returns how many were delivered. A return
+// equal to the budget means the ring may still hold more.
+static int rtl8139_rx_poll(int budget) {
     if (!rtl_io)
-        return;
+        return 0;
 
+    int done = 0;
     // Poll until RX buffer empty (CR bit0 = BUFE).
-    while ((inb(rtl_io + RTL_CR) & 0x01) == 0) {
+    while (done < budget && (inb(rtl_io + RTL_CR) & 0x01) == 0) {
         uint16_t hdr_off = rx_offset;
         uint16_t status = *(uint16_t *)(rx_buf + hdr_off);
         uint16_t length = *(uint16_t *)(rx_buf + hdr_off + 2);
@@ -93,19 +117,24 @@ void rtl8139_rx_poll(void) {
             pkt_len = 1514;
         }
 
-        static uint8_t pkt[1600];
-        if (data_off + pkt_len <= RX_BUF_SIZE) {
-            memcpy(pkt, rx_buf + data_off, pkt_len);
-        } else {
-            uint16_t first = (uint16_t)(RX_BUF_LEN - data_off);
-            memcpy(pkt, rx_buf + data_off, first);
-            memcpy(pkt + first, rx_buf, (uint16_t)(pkt_len - first));
-        }
-
-        if (rx_callback) {
-            rx_callback(pkt, pkt_len);
+        // Copy out of the ring directly into a pbuf; if the pool is dry
+        // the frame is dropped but still consumed.
+        struct pbuf *p = pbuf_alloc(PBUF_RAW, pkt_len, PBUF_POOL);
+        if (p) {
+            if (data_off + pkt_len <= RX_BUF_SIZE) {
+                pbuf_take(p, rx_buf + data_off, pkt_len);
+            } else {
+                uint16_t first = (uint16_t)(RX_BUF_LEN - data_off);
+                pbuf_take(p, rx_buf + data_off, first);
+                pbuf_take_at(p, rx_buf, (uint16_t)(pkt_len - first), first);
+            }
+            if (rx_callback)
+                rx_callback(p);
+            else
+                pbuf_free(p);
         }
         rx_packets++;
+        done++;
 
         rx_offset = (uint16_t)(rx_offset + length + 4);
         rx_offset = (uint16_t)((rx_offset + 3) & ~3);
@@ -114,8 +143,20 @@ void rtl8139_rx_poll(void) {
         // CAPR should always track read ptr - 16 inside the 8KB ring.
         outw(rtl_io + RTL_CAPR, (uint16_t)((rx_offset - 16) & 0x1FFF));
     }
+    return done;
 }
 
+// ---- Interrupt mask ----
+// RX work is deferred: the IRQ handler masks the NIC and hands off to the
+// irq callback; whoever drains the ring unmasks it once idle. Events that
+// arrive while masked stay latched in ISR and fire on unmask.
+static void rtl8139_irq_enable(void) {
+    if (rtl_io)
+        outw(rtl_io + RTL_IMR, RTL_IMR_ALL);
+}
+
+static int rtl8139_irq_wired(void) { return irq_wired; }
+
 // ---- IRQ handler ----
 static void rtl_irq_handler(uint32_t irq __attribute__((unused)),
                             uint32_t err __attribute__((unused))) {
@@ -127,23 +168,26 @@ static void rtl_irq_handler(uint32_t irq __attribute__((unused)),
     outw(rtl_io + RTL_ISR, isr);
 
     if (isr & (RTL_INT_ROK | RTL_INT_RER | RTL_INT_RXOVW | RTL_INT_FOVW)) {
-        rtl8139_rx_poll();
+        outw(rtl_io + RTL_IMR, 0);
+        if (irq_callback)
+            irq_callback();
     }
 }
 
-// ---- Init ----
-void rtl8139_init(nic_rx_callback_t rx_cb) {
+// ---- Probe / init ----
+static int rtl8139_probe(nic_rx_callback_t rx_cb, nic_irq_callback_t irq_cb) {
     rx_callback = rx_cb;
+    irq_callback = irq_cb;
 
     pci_device_t *dev = pci_find_device(RTL_VENDOR_ID, RTL_DEVICE_ID);
     if (!dev) {
         kprintf("[rtl8139] not found\n");
-        return;
+        return -1;
     }
 
     if (!(dev->bar[0] & 0x01)) {
         kprintf("[rtl8139] BAR0 not IO\n");
-        return;
+        return -1;
     }
 
     rtl_io = (uint16_t)(dev->bar[0] & 0xFFFC);
@@ -165,32 +209,46 @@ void rtl8139_init(nic_rx_callback_t rx_cb) {
     outl(rtl_io + RTL_RBSTART, KVIRT_TO_PHYS((uint32_t)rx_buf));
     rx_offset = 0;
     outw(rtl_io + RTL_CAPR, 0xFFF0);
+    tx_cur = 0;
+    memset(tx_busy, 0, sizeof(tx_busy));
 
     outb(rtl_io + RTL_CR, RTL_CR_RX_EN | RTL_CR_TX_EN);
 
     outl(rtl_io + RTL_RCR,
          RTL_RCR_AB | RTL_RCR_APM | RTL_RCR_AM | RTL_RCR_WRAP);
 
-    outw(rtl_io + RTL_IMR, RTL_INT_ROK | RTL_INT_RER | RTL_INT_TOK |
-                               RTL_INT_RXOVW | RTL_INT_FOVW);
+    outw(rtl_io + RTL_IMR, RTL_IMR_ALL);
 
     if (rtl_irq != 0 && rtl_irq != 0xFF) {
         register_interrupt_handler((uint8_t)(0x20 + rtl_irq), rtl_irq_handler);
         pic_unmask_irq(rtl_irq);
+        irq_wired = 1;
     }
 
     kprintf("[rtl8139] io=0x%x irq=%d mac=%x:%x:%x:%x:%x:%x\n", rtl_io, rtl_irq,
             rtl_mac[0], rtl_mac[1], rtl_mac[2], rtl_mac[3], rtl_mac[4],
             rtl_mac[5]);
+    return 0;
 }
 
-int rtl8139_available(void) { return rtl_io != 0; }
-
-void rtl8139_get_mac(uint8_t mac[6]) { memcpy(mac, rtl_mac, 6); }
+static void rtl8139_get_mac(uint8_t mac[6]) { memcpy(mac, rtl_mac, 6); }
 
-void rtl8139_get_stats(uint32_t *rx, uint32_t *tx) {
+static void rtl8139_get_stats(uint32_t *rx, uint32_t *tx) {
     if (rx)
         *rx = rx_packets;
     if (tx)
         *tx = tx_packets;
 }
+
+static const nic_ops_t rtl8139_ops = {
+    .name = "rtl8139",
+    .probe = rtl8139_probe,
+    .send = rtl8139_send,
+    .rx_poll = rtl8139_rx_poll,
+    .irq_enable = rtl8139_irq_enable,
+    .irq_wired = rtl8139_irq_wired,
+    .get_mac = rtl8139_get_mac,
+    .get_stats = rtl8139_get_stats,
+};
+
+const nic_ops_t *rtl8139_get_ops(void) { return &rtl8139_ops; }
@@ -0,0 +1,511 @@
+#include "virtio_net.h"
+#include "arch/i686/interrupts.h"
+#include "arch/i686/io.h"
+#include "arch/i686/pci.h"
+#include "ktrace.h"
+#include "liballoc/liballoc_1_1.h"
+#include "memlayout.h"
+#include "proc/pmm.h"
+
+#include "lwip/pbuf.h"
+
+// ---- virtio (legacy PCI, v0.9.5) constants ----
+#define VIRTIO_VENDOR_ID 0x1AF4
+#define VIRTIO_NET_DEVICE_ID 0x1000 // transitional virtio-net
+
+// Legacy I/O BAR0 register layout (no MSI-X)
+#define VIRTIO_HOST_FEATURES 0x00
+#define VIRTIO_GUEST_FEATURES 0x04
+#define VIRTIO_QUEUE_PFN 0x08
+#define VIRTIO_QUEUE_SIZE 0x0C
+#define VIRTIO_QUEUE_SEL 0x0E
+#define VIRTIO_QUEUE_NOTIFY 0x10
+#define VIRTIO_STATUS 0x12
+#define VIRTIO_ISR 0x13
+#define VIRTIO_NET_CFG_MAC 0x14
+
+#define VIRTIO_STATUS_ACK 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+
+#define VIRTIO_ISR_QUEUE 0x01
+
+#define VIRTIO_NET_F_MAC (1u << 5)
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29)
+
+#define VRING_DESC_F_NEXT 1
+#define VRING_DESC_F_WRITE 2
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+#define VRING_ALIGN 4096
+
+#define VIRTIO_NET_RXQ 0
+#define VIRTIO_NET_TXQ 1
+
+// struct virtio_net_hdr without MRG_RXBUF. Legacy devices want it in its
+// own descriptor, ahead of the frame.
+#define VIRTIO_NET_HDR_SIZE 10
+
+// RX: each buffer is a 2KB half of a PMM frame posted as a two-descriptor
+// chain (header, frame). The frame starts 16 bytes in.
+#define VIRTIO_NET_RX_BUFS 128
+#define VIRTIO_NET_RX_BUF_SIZE 2048
+#define VIRTIO_NET_RX_DATA_OFF 16
+#define VIRTIO_NET_TX_MAX_SEGS 16
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[]; // then uint16_t used_event
+} vring_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[]; // then uint16_t avail_event
+} vring_used_t;
+
+typedef struct {
+    uint16_t index; // queue number, for notify
+    uint16_t size;
+    vring_desc_t *desc;
+    vring_avail_t *avail;
+    vring_used_t *used;
+    uint16_t avail_idx; // shadow of avail->idx
+    uint16_t kicked_idx; // avail idx at the last notify
+    uint16_t last_used;
+    uint16_t free_head;
+    uint16_t num_free;
+    void **cookie; // per chain head: pbuf (TX) or rx buffer (RX)
+} virtq_t;
+
+typedef struct {
+    struct pbuf_custom pc; // must be first
+    uint8_t *buf;
+    uint32_t phys;
+    uint16_t head; // descriptor chain this buffer is bound to
+} vnet_rxbuf_t;
+
+static uint16_t vnet_io = 0;
+static uint8_t vnet_irq = 0;
+static int irq_wired = 0;
+static int event_idx = 0;
+static uint8_t vnet_mac[6];
+
+static virtq_t rxq, txq;
+static vnet_rxbuf_t rxbufs[VIRTIO_NET_RX_BUFS];
+static int rx_buf_count = 0;
+static vnet_rxbuf_t *rx_repost[VIRTIO_NET_RX_BUFS]; // freed, awaiting post
+static int rx_repost_count = 0;
+static uint8_t *tx_hdrs; // one zeroed header per TX descriptor
+
+static uint32_t rx_packets = 0;
+static uint32_t tx_packets = 0;
+
+static nic_rx_callback_t rx_callback = 0;
+static nic_irq_callback_t irq_callback = 0;
+
+// ---- Virtqueue helpers ----
+static inline uint16_t *vq_used_event(virtq_t *q) {
+    return &q->avail->ring[q->size];
+}
+
+static inline uint16_t *vq_avail_event(virtq_t *q) {
+    return (uint16_t *)&q->used->ring[q->size];
+}
+
+// Event-index test from the virtio spec: has `idx` moved past `event`
+// since `old`?
+static inline int vring_need_event(uint16_t event, uint16_t idx,
+                                   uint16_t old) {
+    return (uint16_t)(idx - event - 1) < (uint16_t)(idx - old);
+}
+
+static int virtq_init(virtq_t *q, uint16_t index) {
+    outw(vnet_io + VIRTIO_QUEUE_SEL, index);
+    uint16_t size = inw(vnet_io + VIRTIO_QUEUE_SIZE);
+    if (size == 0 || (size & (size - 1)))
+        return -1;
+
+    uint32_t avail_end = 16u * size + 6u + 2u * size;
+    uint32_t used_off = (avail_end + VRING_ALIGN - 1) & ~(VRING_ALIGN - 1);
+    uint32_t bytes = used_off + 6u + 8u * size;
+    uint32_t pages = (bytes + 0xFFF) / 0x1000;
+    uint32_t phys = pmm_alloc_frames(pages);
+    if (!phys)
+        return -1;
+    uint8_t *mem = (uint8_t *)PHYS_TO_KVIRT(phys);
+    memset(mem, 0, pages * 0x1000);
+
+    q->index = index;
+    q->size = size;
+    q->desc = (vring_desc_t *)mem;
+    q->avail = (vring_avail_t *)(mem + 16u * size);
+    q->used = (vring_used_t *)(mem + used_off);
+    q->avail_idx = q->kicked_idx = q->last_used = 0;
+    q->cookie = (void **)kmalloc(sizeof(void *) * size);
+    if (!q->cookie)
+        return -1;
+    memset(q->cookie, 0, sizeof(void *) * size);
+    for (uint16_t i = 0; i < size; i++)
+        q->desc[i].next = (uint16_t)(i + 1);
+    q->free_head = 0;
+    q->num_free = size;
+
+    outl(vnet_io + VIRTIO_QUEUE_PFN, phys >> 12);
+    return 0;
+}
+
+// Make a chain visible to the device. The notify is deferred to
+// virtq_kick() so a batch of posts costs one doorbell.
+static void virtq_push(virtq_t *q, uint16_t head) {
+    q->avail->ring[q->avail_idx % q->size] = head;
+    q->avail_idx++;
+    __asm__ volatile("" : : : "memory");
+    q->avail->idx = q->avail_idx;
+}
+
+// Notify the device of new chains unless it asked not to be: with event
+// index it publishes the avail idx it wants a kick at, otherwise the
+// NO_NOTIFY flag in the used ring.
+static void virtq_kick(virtq_t *q) {
+    if (q->avail_idx == q->kicked_idx)
+        return;
+    __sync_synchronize();
+    int kick;
+    if (event_idx)
+        kick = vring_need_event(*vq_avail_event(q), q->avail_idx,
+                                q->kicked_idx);
+    else
+        kick = !(q->used->flags & 1); // VRING_USED_F_NO_NOTIFY
+    q->kicked_idx = q->avail_idx;
+    if (kick)
+        outw(vnet_io + VIRTIO_QUEUE_NOTIFY, q->index);
+}
+
+static inline int virtq_has_used(virtq_t *q) {
+    return q->last_used != q->used->idx;
+}
+
+// Ask for (or stop) a used-buffer interrupt on this queue. Returns nonzero
+// if work raced in before interrupts were back on.
+static int virtq_irq(virtq_t *q, int on) {
+    if (event_idx)
+        *vq_used_event(q) = on ? q->last_used : (uint16_t)(q->last_used - 1);
+    else if (on)
+        q->avail->flags &= (uint16_t)~VRING_AVAIL_F_NO_INTERRUPT;
+    else
+        q->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+    if (!on)
+        return 0;
+    __sync_synchronize();
+    return virtq_has_used(q);
+}
+
+// ---- RX ----
+static void vnet_rxbuf_free(struct pbuf *p) {
+    rx_repost[rx_repost_count++] = (vnet_rxbuf_t *)p;
+}
+
+static void vnet_rx_post(vnet_rxbuf_t *b) {
+    vring_desc_t *d = rxq.desc;
+    uint16_t h = b->head;
+    uint16_t n = d[h].next;
+    d[h].addr = b->phys;
+    d[h].len = VIRTIO_NET_HDR_SIZE;
+    d[h].flags = VRING_DESC_F_NEXT | VRING_DESC_F_WRITE;
+    d[n].addr = b->phys + VIRTIO_NET_RX_DATA_OFF;
+    d[n].len = VIRTIO_NET_RX_BUF_SIZE - VIRTIO_NET_RX_DATA_OFF;
+    d[n].flags = VRING_DESC_F_WRITE;
+    rxq.cookie[h] = b;
+    virtq_push(&rxq, h);
+}
+
+static int vnet_rx_setup(void) {
+    // RX chains are fixed pairs carved from the descriptor table up front.
+    int bufs = rxq.size / 2;
+    if (bufs > VIRTIO_NET_RX_BUFS)
+        bufs = VIRTIO_NET_RX_BUFS;
+    for (int i = 0; i < bufs; i += 2) {
+        uint32_t phys = pmm_alloc_frame();
+        if (!phys)
+            return -1;
+        for (int j = 0; j < 2 && i + j < bufs; j++) {
+            vnet_rxbuf_t *b = &rxbufs[i + j];
+            b->phys = phys + (uint32_t)j * VIRTIO_NET_RX_BUF_SIZE;
+            b->buf = (uint8_t *)PHYS_TO_KVIRT(b->phys);
+            b->head = (uint16_t)((i + j) * 2);
+            b->pc.custom_free_function = vnet_rxbuf_free;
+            rxq.desc[b->head].next = (uint16_t)(b->head + 1);
+            vnet_rx_post(b);
+        }
+    }
+    rx_buf_count = bufs;
+    rxq.num_free = 0;
+    return 0;
+}
+
+static int vnet_rx_poll(int budget) {
+    if (!vnet_io)
+        return 0;
+
+    int done = 0;
+    while (done < budget && virtq_has_used(&rxq)) {
+        vring_used_elem_t *e = &rxq.used->ring[rxq.last_used % rxq.size];
+        vnet_rxbuf_t *b = (vnet_rxbuf_t *)rxq.cookie[e->id];
+        uint32_t len = e->len;
+        rxq.last_used++;
+
+        if (len <= VIRTIO_NET_HDR_SIZE) {
+            rx_repost[rx_repost_count++] = b;
+            continue;
+        }
+        len -= VIRTIO_NET_HDR_SIZE;
+        struct pbuf *p = pbuf_alloced_custom(
+            PBUF_RAW, (uint16_t)len, PBUF_REF, &b->pc,
+            b->buf + VIRTIO_NET_RX_DATA_OFF,
+            VIRTIO_NET_RX_BUF_SIZE - VIRTIO_NET_RX_DATA_OFF);
+        if (rx_callback)
+            rx_callback(p);
+        else
+            pbuf_free(p);
+        rx_packets++;
+        done++;
+    }
+
+    // Repost every buffer the stack has given back, then one doorbell.
+    while (rx_repost_count > 0)
+        vnet_rx_post(rx_repost[--rx_repost_count]);
+    virtq_kick(&rxq);
+    return done;
+}
+
+// ---- TX ----
+static void vnet_tx_reclaim(void) {
+    uint32_t done = 0;
+    while (virtq_has_used(&txq)) {
+        vring_used_elem_t *e = &txq.used->ring[txq.last_used % txq.size];
+        uint16_t head = (uint16_t)e->id;
+        uint16_t tail = head;
+        uint16_t n = 1;
+        while (txq.desc[tail].flags & VRING_DESC_F_NEXT) {
+            tail = txq.desc[tail].next;
+            n++;
+        }
+        txq.desc[tail].next = txq.free_head;
+        txq.free_head = head;
+        txq.num_free = (uint16_t)(txq.num_free + n);
+        if (txq.cookie[head]) {
+            pbuf_free((struct pbuf *)txq.cookie[head]);
+            txq.cookie[head] = NULL;
+        }
+        txq.last_used++;
+        done += n;
+    }
+    if (done)
+        KTRACE(KT_NIC_TX_DONE, done, 0, 0);
+}
+
+static uint16_t vnet_tx_alloc(void) {
+    uint16_t d = txq.free_head;
+    txq.free_head = txq.desc[d].next;
+    txq.num_free--;
+    return d;
+}
+
+static int vnet_dma_ok(const void *va) {
+    uint32_t v = (uint32_t)va;
+    return v >= KERNEL_VIRTUAL_BASE && v < KERNEL_MMIO_START;
+}
+
+// Header descriptor followed by one descriptor per pbuf in the chain; the
+// chain is referenced until the device returns it on the used ring.
+static int vnet_send(struct pbuf *p) {
+    if (!vnet_io)
+        return -1;
+
+    uint16_t segs = 0;
+    int direct = 1;
+    for (struct pbuf *q = p; q; q = q->next) {
+        if (!q->len)
+            continue;
+        segs++;
+        if (!vnet_dma_ok(q->payload))
+            direct = 0;
+    }
+    if (!segs)
+        return 0;
+
+    struct pbuf *frame = p;
+    if (!direct || segs > VIRTIO_NET_TX_MAX_SEGS) {
+        frame = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        if (!frame)
+            return -1;
+        segs = 1;
+    } else {
+        pbuf_ref(p);
+    }
+
+    vnet_tx_reclaim();
+    if (txq.num_free < segs + 1) {
+        pbuf_free(frame);
+        return -1;
+    }
+
+    uint16_t head = vnet_tx_alloc();
+    vring_desc_t *d = &txq.desc[head];
+    d->addr = KVIRT_TO_PHYS((uint32_t)(tx_hdrs + head * VIRTIO_NET_HDR_SIZE));
+    d->len = VIRTIO_NET_HDR_SIZE;
+    d->flags = VRING_DESC_F_NEXT;
+    for (struct pbuf *q = frame; q; q = q->next) {
+        if (!q->len)
+            continue;
+        uint16_t n = vnet_tx_alloc();
+        d->next = n;
+        d = &txq.desc[n];
+        d->addr = KVIRT_TO_PHYS((uint32_t)q->payload);
+        d->len = q->len;
+        d->flags = VRING_DESC_F_NEXT;
+    }
+    d->flags = 0;
+    txq.cookie[head] = frame;
+
+    virtq_push(&txq, head);
+    virtq_kick(&txq);
+    tx_packets++;
+    return 0;
+}
+
+// ---- Interrupts ----
+// Reading ISR acknowledges the interrupt and drops the line. RX
+// interrupts stay off until the net task has drained the queue.
+static void vnet_irq_handler(uint32_t irq __attribute__((unused)),
+                             uint32_t err __attribute__((unused))) {
+    if (!vnet_io)
+        return;
+    uint8_t isr = inb(vnet_io + VIRTIO_ISR);
+    if (!(isr & VIRTIO_ISR_QUEUE))
+        return;
+    virtq_irq(&rxq, 0);
+    if (irq_callback)
+        irq_callback();
+}
+
+static void vnet_irq_enable(void) {
+    if (!vnet_io)
+        return;
+    // A frame that landed after the last poll but before the re-arm would
+    // raise no interrupt; treat it as if one had fired.
+    if (virtq_irq(&rxq, 1) && irq_callback) {
+        virtq_irq(&rxq, 0);
+        irq_callback();
+    }
+}
+
+static int vnet_irq_wired(void) { return irq_wired; }
+
+// ---- Probe / init ----
+static int vnet_probe(nic_rx_callback_t rx_cb, nic_irq_callback_t irq_cb) {
+    rx_callback = rx_cb;
+    irq_callback = irq_cb;
+
+    pci_device_t *dev = pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_NET_DEVICE_ID);
+    if (!dev) {
+        kprintf("[virtio-net] not found\n");
+        return -1;
+    }
+
+    if (!(dev->bar[0] & 0x01)) {
+        kprintf("[virtio-net] BAR0 not IO (modern-only device?)\n");
+        return -1;
+    }
+
+    vnet_io = (uint16_t)(dev->bar[0] & 0xFFFC);
+    vnet_irq = dev->irq_line;
+
+    pci_enable_bus_mastering(dev);
+
+    outb(vnet_io + VIRTIO_STATUS, 0); // reset
+    outb(vnet_io + VIRTIO_STATUS, VIRTIO_STATUS_ACK);
+    outb(vnet_io + VIRTIO_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+
+    uint32_t host = inl(vnet_io + VIRTIO_HOST_FEATURES);
+    uint32_t guest = host & (VIRTIO_NET_F_MAC | VIRTIO_RING_F_EVENT_IDX);
+    outl(vnet_io + VIRTIO_GUEST_FEATURES, guest);
+    event_idx = (guest & VIRTIO_RING_F_EVENT_IDX) != 0;
+
+    if (virtq_init(&rxq, VIRTIO_NET_RXQ) != 0 ||
+        virtq_init(&txq, VIRTIO_NET_TXQ) != 0) {
+        kprintf("[virtio-net] queue setup failed\n");
+        outb(vnet_io + VIRTIO_STATUS, 0x80); // FAILED
+        vnet_io = 0;
+        return -1;
+    }
+    tx_hdrs = (uint8_t *)kmalloc((uint32_t)txq.size * VIRTIO_NET_HDR_SIZE);
+    if (!tx_hdrs || vnet_rx_setup() != 0) {
+        kprintf("[virtio-net] out of memory\n");
+        outb(vnet_io + VIRTIO_STATUS, 0x80);
+        vnet_io = 0;
+        return -1;
+    }
+    memset(tx_hdrs, 0, (uint32_t)txq.size * VIRTIO_NET_HDR_SIZE);
+
+    // TX completions are reaped lazily on the next send or RX pass.
+    virtq_irq(&txq, 0);
+
+    if (guest & VIRTIO_NET_F_MAC) {
+        for (int i = 0; i < 6; i++)
+            vnet_mac[i] = inb(vnet_io + VIRTIO_NET_CFG_MAC + i);
+    }
+
+    if (vnet_irq != 0 && vnet_irq != 0xFF) {
+        register_interrupt_handler((uint8_t)(0x20 + vnet_irq),
+                                   vnet_irq_handler);
+        pic_unmask_irq(vnet_irq);
+        irq_wired = 1;
+    }
+
+    outb(vnet_io + VIRTIO_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER |
+                                      VIRTIO_STATUS_DRIVER_OK);
+    virtq_kick(&rxq);
+
+    kprintf("[virtio-net] io=0x%x irq=%d mac=%x:%x:%x:%x:%x:%x rxq=%d txq=%d "
+            "rxbufs=%d evidx=%d\n",
+            vnet_io, vnet_irq, vnet_mac[0], vnet_mac[1], vnet_mac[2],
+            vnet_mac[3], vnet_mac[4], vnet_mac[5], rxq.size, txq.size,
+            rx_buf_count, event_idx);
+    return 0;
+}
+
+static void vnet_get_mac(uint8_t mac[6]) { memcpy(mac, vnet_mac, 6); }
+
+static void vnet_get_stats(uint32_t *rx, uint32_t *tx) {
+    if (rx)
+        *rx = rx_packets;
+    if (tx)
+        *tx = tx_packets;
+}
+
+static const nic_ops_t virtio_net_ops = {
+    .name = "virtio-net",
+    .probe = vnet_probe,
+    .send = vnet_send,
+    .rx_poll = vnet_rx_poll,
+    .irq_enable = vnet_irq_enable,
+    .irq_wired = vnet_irq_wired,
+    .get_mac = vnet_get_mac,
+    .get_stats = vnet_get_stats,
+};
+
+const nic_ops_t *virtio_net_get_ops(void) { return &virtio_net_ops; }
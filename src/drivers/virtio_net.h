@@ -0,0 +1,10 @@
+#ifndef _VIRTIO_NET_H
+#define _VIRTIO_NET_H
+
+#include "nic.h"
+
+// virtio-net over legacy (transitional) PCI: separate RX/TX virtqueues,
+// pre-posted RX buffers, event-index notification/interrupt suppression.
+const nic_ops_t *virtio_net_get_ops(void);
+
+#endif
@@ -0,0 +1,154 @@
+#include "blkcache.h"
+#include "liballoc/liballoc_1_1.h"
+
+void blkcache_invalidate_all(blkcache_t *c) {
+    for (int i = 0; i < BLKCACHE_BLOCKS; i++)
+        c->blk[i] = 0;
+}
+
+void blkcache_init(blkcache_t *c, int (*read)(uint32_t, uint32_t, void *),
+                   uint32_t base_lba, uint32_t limit_sectors) {
+    if (!c->data) {
+        c->data = (uint8_t *)kmalloc(BLKCACHE_BLOCKS * BLKCACHE_BYTES);
+        c->staging =
+            (uint8_t *)kmalloc(BLKCACHE_RA_MAX_BLOCKS * BLKCACHE_BYTES);
+        if (!c->data || !c->staging) {
+            // Run uncached; callers fall back to their direct path.
+            if (c->data) kfree(c->data);
+            if (c->staging) kfree(c->staging);
+            c->data = NULL;
+            c->staging = NULL;
+        }
+    }
+    c->read = read;
+    c->base_lba = base_lba;
+    c->limit_sectors = limit_sectors;
+    c->clock = 0;
+    c->hits = c->misses = c->prefetched = 0;
+    blkcache_invalidate_all(c);
+}
+
+int blkcache_enabled(const blkcache_t *c) { return c->data != NULL; }
+
+static int blkcache_find(blkcache_t *c, uint32_t blk) {
+    for (int i = 0; i < BLKCACHE_BLOCKS; i++) {
+        if (c->blk[i] == blk + 1) {
+            c->stamp[i] = ++c->clock;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int blkcache_victim(const blkcache_t *c) {
+    int v = 0;
+    for (int i = 0; i < BLKCACHE_BLOCKS; i++) {
+        if (c->blk[i] == 0)
+            return i;
+        if (c->stamp[i] < c->stamp[v])
+            v = i;
+    }
+    return v;
+}
+
+void blkcache_invalidate_range(blkcache_t *c, uint32_t lba, uint32_t count) {
+    if (!c->data || count == 0 || lba + count <= c->base_lba)
+        return;
+    uint32_t first = (lba > c->base_lba) ? lba - c->base_lba : 0;
+    uint32_t last = lba + count - 1 - c->base_lba;
+    first /= BLKCACHE_SECTORS;
+    last /= BLKCACHE_SECTORS;
+    for (int i = 0; i < BLKCACHE_BLOCKS; i++) {
+        uint32_t b = c->blk[i];
+        if (b != 0 && b - 1 >= first && b - 1 <= last)
+            c->blk[i] = 0;
+    }
+}
+
+// Load blocks [blk, blk + count) that are not yet cached. Consecutive
+// missing blocks are fetched with a single disk read into the staging
+// buffer, then spread into cache slots.
+static int blkcache_fill(blkcache_t *c, uint32_t blk, uint32_t count) {
+    uint32_t i = 0;
+    while (i < count) {
+        if (blkcache_find(c, blk + i) >= 0) {
+            i++;
+            continue;
+        }
+        uint32_t n = 1;
+        while (i + n < count && n < BLKCACHE_RA_MAX_BLOCKS &&
+               blkcache_find(c, blk + i + n) < 0)
+            n++;
+        uint32_t lba = c->base_lba + (blk + i) * BLKCACHE_SECTORS;
+        if (c->read(lba, n * BLKCACHE_SECTORS, c->staging) < 0)
+            return -1;
+        for (uint32_t k = 0; k < n; k++) {
+            int slot = blkcache_victim(c);
+            memcpy(c->data + (uint32_t)slot * BLKCACHE_BYTES,
+                   c->staging + k * BLKCACHE_BYTES, BLKCACHE_BYTES);
+            c->blk[slot] = blk + i + k + 1;
+            c->stamp[slot] = ++c->clock;
+        }
+        // Everything past the first requested block is read-ahead.
+        c->prefetched += (i == 0) ? n - 1 : n;
+        i += n;
+    }
+    return 0;
+}
+
+void blkcache_stream_note(blkcache_stream_t *s, uint32_t pos) {
+    if (pos == s->next_pos) {
+        if (s->window == 0)
+            s->window = BLKCACHE_RA_MIN_BLOCKS;
+        else if (s->window < BLKCACHE_RA_MAX_BLOCKS)
+            s->window *= 2;
+    } else {
+        s->window = 0;
+    }
+}
+
+uint32_t blkcache_stream_span(const blkcache_stream_t *s, uint32_t need,
+                              uint32_t file_left) {
+    uint32_t span = need + s->window * BLKCACHE_BYTES;
+    return (span > file_left) ? file_left : span;
+}
+
+int blkcache_read(blkcache_t *c, uint32_t lba, uint32_t sec_off,
+                  uint32_t run_secs, uint32_t span, uint8_t *out,
+                  uint32_t need) {
+    if (!c->data || lba < c->base_lba)
+        return 0;
+    uint32_t rel = lba - c->base_lba;
+    uint32_t blk = rel / BLKCACHE_SECTORS;
+    if ((blk + 1) * BLKCACHE_SECTORS > c->limit_sectors)
+        return 0; // partial block at the end of the region
+
+    int slot = blkcache_find(c, blk);
+    if (slot >= 0) {
+        c->hits++;
+    } else {
+        c->misses++;
+        uint32_t secs = (sec_off + span + 511) / 512;
+        if (secs > run_secs) secs = run_secs;
+        if (secs == 0) secs = 1;
+        uint32_t last_blk = (rel + secs - 1) / BLKCACHE_SECTORS;
+        while (last_blk > blk &&
+               (last_blk + 1) * BLKCACHE_SECTORS > c->limit_sectors)
+            last_blk--;
+        uint32_t nblk = last_blk - blk + 1;
+        if (nblk > BLKCACHE_RA_MAX_BLOCKS) nblk = BLKCACHE_RA_MAX_BLOCKS;
+        if (blkcache_fill(c, blk, nblk) < 0)
+            return -1;
+        slot = blkcache_find(c, blk);
+        if (slot < 0)
+            return -1;
+    }
+
+    uint32_t boff = (rel % BLKCACHE_SECTORS) * 512 + sec_off;
+    uint32_t take = BLKCACHE_BYTES - boff;
+    if (take > need) take = need;
+    if (take > run_secs * 512 - sec_off)
+        take = run_secs * 512 - sec_off;
+    memcpy(out, c->data + (uint32_t)slot * BLKCACHE_BYTES + boff, take);
+    return (int)take;
+}
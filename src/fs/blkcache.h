@@ -0,0 +1,66 @@
+#ifndef _BLKCACHE_H
+#define _BLKCACHE_H
+
+#include "lib.h"
+
+// Data block cache with read-ahead, shared by the FAT drivers. A cache
+// covers one region of a disk starting at base_lba; blocks are
+// BLKCACHE_SECTORS consecutive sectors of that region. Write-through:
+// callers must report every disk write with blkcache_invalidate_range().
+
+#define BLKCACHE_BLOCKS 24
+#define BLKCACHE_SECTORS 8
+#define BLKCACHE_BYTES (BLKCACHE_SECTORS * 512)
+#define BLKCACHE_RA_MIN_BLOCKS 1
+#define BLKCACHE_RA_MAX_BLOCKS 8
+// Reads at least this large should bypass the cache and go straight to the
+// caller's buffer.
+#define BLKCACHE_DIRECT_BYTES (4 * BLKCACHE_BYTES)
+
+typedef struct {
+    int (*read)(uint32_t lba, uint32_t count, void *buf);
+    uint32_t base_lba;
+    uint32_t limit_sectors;  // sectors of the region that may be cached
+    uint8_t *data;           // BLKCACHE_BLOCKS * BLKCACHE_BYTES
+    uint8_t *staging;        // BLKCACHE_RA_MAX_BLOCKS * BLKCACHE_BYTES
+    uint32_t blk[BLKCACHE_BLOCKS]; // block number + 1, 0 = unused
+    uint32_t stamp[BLKCACHE_BLOCKS];
+    uint32_t clock;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t prefetched;     // blocks loaded by read-ahead
+} blkcache_t;
+
+// Per-handle sequential-stream state.
+typedef struct {
+    uint32_t next_pos; // where the previous read ended
+    uint32_t window;   // read-ahead window in blocks
+} blkcache_stream_t;
+
+// Allocate buffers (first call only) and empty the cache. On allocation
+// failure the cache stays disabled and blkcache_read() always returns 0.
+void blkcache_init(blkcache_t *c, int (*read)(uint32_t, uint32_t, void *),
+                   uint32_t base_lba, uint32_t limit_sectors);
+void blkcache_invalidate_all(blkcache_t *c);
+void blkcache_invalidate_range(blkcache_t *c, uint32_t lba, uint32_t count);
+int blkcache_enabled(const blkcache_t *c);
+
+// Update stream state for a read at `pos`: continuing where the previous
+// read stopped grows the window, anything else collapses it.
+void blkcache_stream_note(blkcache_stream_t *s, uint32_t pos);
+
+// Bytes a stream should have loaded from `pos`: the request plus the
+// read-ahead window, clipped to the end of the file.
+uint32_t blkcache_stream_span(const blkcache_stream_t *s, uint32_t need,
+                              uint32_t file_left);
+
+// Copy up to `need` bytes starting `sec_off` bytes into sector `lba`.
+// `run_secs` is the number of contiguous sectors from lba that belong to
+// the file; on a miss, blocks covering `span` bytes (see
+// blkcache_stream_span) along that run are fetched in one disk read.
+// Returns bytes copied, 0 if the block cannot be cached, -1 on I/O error.
+int blkcache_read(blkcache_t *c, uint32_t lba, uint32_t sec_off,
+                  uint32_t run_secs, uint32_t span, uint8_t *out,
+                  uint32_t need);
+
+#endif
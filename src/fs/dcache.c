@@ -0,0 +1,188 @@
+#include "dcache.h"
+
+#define DCACHE_NONE (-1)
+
+typedef struct {
+    const void *owner; // NULL = slot free
+    uint32_t dir;
+    uint32_t hash;
+    int16_t hnext; // bucket chain
+    int16_t lprev; // LRU list, head = most recently used
+    int16_t lnext;
+    uint8_t negative;
+    uint16_t off;
+    uint32_t lba;
+    char name[DCACHE_NAME_MAX];
+    uint8_t dirent[DCACHE_DIRENT_SIZE];
+} dcache_entry_t;
+
+static dcache_entry_t dc_ent[DCACHE_ENTRIES];
+static int16_t dc_bucket[DCACHE_BUCKETS];
+static int16_t dc_lru_head = DCACHE_NONE;
+static int16_t dc_lru_tail = DCACHE_NONE;
+static int dc_ready;
+static dcache_stats_t dc_stats;
+
+static void dcache_setup(void) {
+    for (int i = 0; i < DCACHE_BUCKETS; i++)
+        dc_bucket[i] = DCACHE_NONE;
+    for (int i = 0; i < DCACHE_ENTRIES; i++)
+        dc_ent[i].owner = NULL;
+    dc_lru_head = dc_lru_tail = DCACHE_NONE;
+    dc_ready = 1;
+}
+
+// FNV-1a over the name, mixed with the owner and directory key.
+static uint32_t dcache_hash(const void *owner, uint32_t dir, const char *name) {
+    uint32_t h = 2166136261u ^ (uint32_t)(uintptr_t)owner;
+    h = (h ^ dir) * 16777619u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void lru_unlink(int i) {
+    dcache_entry_t *e = &dc_ent[i];
+    if (e->lprev != DCACHE_NONE)
+        dc_ent[e->lprev].lnext = e->lnext;
+    else
+        dc_lru_head = e->lnext;
+    if (e->lnext != DCACHE_NONE)
+        dc_ent[e->lnext].lprev = e->lprev;
+    else
+        dc_lru_tail = e->lprev;
+}
+
+static void lru_push_front(int i) {
+    dcache_entry_t *e = &dc_ent[i];
+    e->lprev = DCACHE_NONE;
+    e->lnext = dc_lru_head;
+    if (dc_lru_head != DCACHE_NONE)
+        dc_ent[dc_lru_head].lprev = (int16_t)i;
+    dc_lru_head = (int16_t)i;
+    if (dc_lru_tail == DCACHE_NONE)
+        dc_lru_tail = (int16_t)i;
+}
+
+static void dcache_remove(int i) {
+    dcache_entry_t *e = &dc_ent[i];
+    int16_t *pp = &dc_bucket[e->hash % DCACHE_BUCKETS];
+    while (*pp != DCACHE_NONE && *pp != i)
+        pp = &dc_ent[*pp].hnext;
+    if (*pp == i)
+        *pp = e->hnext;
+    lru_unlink(i);
+    e->owner = NULL;
+    dc_stats.entries--;
+}
+
+static int dcache_find(const void *owner, uint32_t dir, const char *name,
+                       uint32_t hash) {
+    for (int i = dc_bucket[hash % DCACHE_BUCKETS]; i != DCACHE_NONE;
+         i = dc_ent[i].hnext) {
+        dcache_entry_t *e = &dc_ent[i];
+        if (e->hash == hash && e->owner == owner && e->dir == dir &&
+            strcmp(e->name, name) == 0)
+            return i;
+    }
+    return DCACHE_NONE;
+}
+
+int dcache_lookup(const void *owner, uint32_t dir, const char *name,
+                  dcache_hit_t *out) {
+    if (!dc_ready || !owner || !name || strlen(name) >= DCACHE_NAME_MAX)
+        return DCACHE_MISS;
+    int i = dcache_find(owner, dir, name, dcache_hash(owner, dir, name));
+    if (i == DCACHE_NONE) {
+        dc_stats.misses++;
+        return DCACHE_MISS;
+    }
+    lru_unlink(i);
+    lru_push_front(i);
+    dcache_entry_t *e = &dc_ent[i];
+    if (e->negative) {
+        dc_stats.negative_hits++;
+        return DCACHE_NEGATIVE;
+    }
+    dc_stats.hits++;
+    if (out) {
+        memcpy(out->dirent, e->dirent, DCACHE_DIRENT_SIZE);
+        out->lba = e->lba;
+        out->off = e->off;
+    }
+    return DCACHE_FOUND;
+}
+
+void dcache_insert(const void *owner, uint32_t dir, const char *name,
+                   const void *dirent, uint32_t lba, uint16_t off) {
+    size_t len = name ? strlen(name) : DCACHE_NAME_MAX;
+    if (!owner || len >= DCACHE_NAME_MAX)
+        return;
+    if (!dc_ready)
+        dcache_setup();
+
+    uint32_t hash = dcache_hash(owner, dir, name);
+    int i = dcache_find(owner, dir, name, hash);
+    if (i != DCACHE_NONE) {
+        dcache_remove(i);
+    } else {
+        for (i = 0; i < DCACHE_ENTRIES; i++)
+            if (!dc_ent[i].owner)
+                break;
+        if (i == DCACHE_ENTRIES) {
+            i = dc_lru_tail;
+            dcache_remove(i);
+            dc_stats.evictions++;
+        }
+    }
+
+    dcache_entry_t *e = &dc_ent[i];
+    e->owner = owner;
+    e->dir = dir;
+    e->hash = hash;
+    e->negative = dirent ? 0 : 1;
+    e->lba = lba;
+    e->off = off;
+    memcpy(e->name, name, len + 1);
+    if (dirent)
+        memcpy(e->dirent, dirent, DCACHE_DIRENT_SIZE);
+    e->hnext = dc_bucket[hash % DCACHE_BUCKETS];
+    dc_bucket[hash % DCACHE_BUCKETS] = (int16_t)i;
+    lru_push_front(i);
+    dc_stats.entries++;
+}
+
+void dcache_invalidate_dir(const void *owner, uint32_t dir) {
+    for (int i = 0; i < DCACHE_ENTRIES; i++) {
+        if (dc_ent[i].owner == owner && dc_ent[i].dir == dir) {
+            dcache_remove(i);
+            dc_stats.invalidations++;
+        }
+    }
+}
+
+void dcache_invalidate_range(const void *owner, uint32_t lba, uint32_t count) {
+    if (dc_stats.entries == 0)
+        return;
+    for (int i = 0; i < DCACHE_ENTRIES; i++) {
+        dcache_entry_t *e = &dc_ent[i];
+        if (e->owner == owner && !e->negative && e->lba >= lba &&
+            e->lba - lba < count) {
+            dcache_remove(i);
+            dc_stats.invalidations++;
+        }
+    }
+}
+
+void dcache_invalidate_owner(const void *owner) {
+    for (int i = 0; i < DCACHE_ENTRIES; i++) {
+        if (dc_ent[i].owner == owner) {
+            dcache_remove(i);
+            dc_stats.invalidations++;
+        }
+    }
+}
+
+void dcache_get_stats(dcache_stats_t *out) { *out = dc_stats; }
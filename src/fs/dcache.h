@@ -0,0 +1,57 @@
+#ifndef _DCACHE_H
+#define _DCACHE_H
+
+#include "lib.h"
+
+// Directory-entry cache shared by the VFS backends. Maps (owner, directory,
+// name) to the backend's on-disk directory entry, or records that the name
+// does not exist (negative entry). `owner` is any pointer unique to one
+// mounted filesystem; `dir` is the backend's directory key (e.g. its first
+// cluster). Entries are hashed by directory + name and evicted LRU.
+//
+// Coherency rules for backends:
+//   - report every disk write with dcache_invalidate_range() so entries
+//     whose directory sector was rewritten are dropped;
+//   - call dcache_invalidate_dir() after creating a name in a directory
+//     (negative entries have no sector to match) and after removing a
+//     directory.
+
+#define DCACHE_ENTRIES 128
+#define DCACHE_BUCKETS 64
+#define DCACHE_NAME_MAX 64
+#define DCACHE_DIRENT_SIZE 32
+
+#define DCACHE_MISS (-1)
+#define DCACHE_NEGATIVE 0
+#define DCACHE_FOUND 1
+
+typedef struct {
+    uint8_t dirent[DCACHE_DIRENT_SIZE];
+    uint32_t lba;
+    uint16_t off;
+} dcache_hit_t;
+
+typedef struct {
+    uint32_t entries; // entries in use
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t invalidations;
+} dcache_stats_t;
+
+// Returns DCACHE_FOUND (out filled), DCACHE_NEGATIVE or DCACHE_MISS.
+int dcache_lookup(const void *owner, uint32_t dir, const char *name,
+                  dcache_hit_t *out);
+
+// Record a lookup result. `dirent` NULL records a negative entry.
+void dcache_insert(const void *owner, uint32_t dir, const char *name,
+                   const void *dirent, uint32_t lba, uint16_t off);
+
+void dcache_invalidate_dir(const void *owner, uint32_t dir);
+void dcache_invalidate_range(const void *owner, uint32_t lba, uint32_t count);
+void dcache_invalidate_owner(const void *owner);
+
+void dcache_get_stats(dcache_stats_t *out);
+
+#endif
@@ -0,0 +1,168 @@
+#include "dirindex.h"
+#include "liballoc/liballoc_1_1.h"
+
+#define DIRINDEX_INITIAL_CAP 1024
+
+static dirindex_t *slots[DIRINDEX_SLOTS];
+static uint32_t use_clock;
+static dirindex_stats_t di_stats;
+
+static char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+// Paths are compared without leading/trailing '/' and case-insensitively,
+// so "/BIN/", "bin" and "/bin" name the same directory.
+static int path_same(const char *a, const char *b) {
+    while (*a == '/')
+        a++;
+    while (*b == '/')
+        b++;
+    while (*a && *b && fold(*a) == fold(*b)) {
+        a++;
+        b++;
+    }
+    while (*a == '/')
+        a++;
+    while (*b == '/')
+        b++;
+    return *a == '\0' && *b == '\0';
+}
+
+static void dirindex_free(dirindex_t *idx) {
+    if (idx->buf)
+        kfree(idx->buf);
+    kfree(idx);
+}
+
+static void slot_drop(int i) {
+    dirindex_t *idx = slots[i];
+    slots[i] = NULL;
+    di_stats.cached--;
+    di_stats.bytes -= idx->len;
+    dirindex_put(idx);
+}
+
+dirindex_t *dirindex_get(const char *path) {
+    for (int i = 0; i < DIRINDEX_SLOTS; i++) {
+        // Exact match only: a differently-cased path may list differently
+        // on a case-sensitive backend.
+        if (slots[i] && strcmp(slots[i]->path, path) == 0) {
+            slots[i]->refs++;
+            slots[i]->last_use = ++use_clock;
+            di_stats.hits++;
+            return slots[i];
+        }
+    }
+    return NULL;
+}
+
+dirindex_t *dirindex_new(const char *path) {
+    dirindex_t *idx = (dirindex_t *)kmalloc(sizeof(dirindex_t));
+    if (!idx)
+        return NULL;
+    memset(idx, 0, sizeof(*idx));
+    size_t n = strlen(path);
+    if (n >= VFS_PATH_MAX)
+        n = VFS_PATH_MAX - 1;
+    memcpy(idx->path, path, n);
+    idx->path[n] = '\0';
+    idx->refs = 1;
+    return idx;
+}
+
+int dirindex_add(dirindex_t *idx, const char *name, uint32_t size,
+                 uint32_t type) {
+    size_t n = strlen(name);
+    if (n > 255)
+        n = 255;
+    uint32_t reclen = VFS_DIRENT_RECLEN(n);
+    if (idx->len + reclen > idx->cap) {
+        uint32_t cap = idx->cap ? idx->cap * 2 : DIRINDEX_INITIAL_CAP;
+        while (cap < idx->len + reclen)
+            cap *= 2;
+        uint8_t *nb = (uint8_t *)krealloc(idx->buf, cap);
+        if (!nb)
+            return -1;
+        idx->buf = nb;
+        idx->cap = cap;
+    }
+    vfs_dirent_t *de = (vfs_dirent_t *)(idx->buf + idx->len);
+    de->size = size;
+    de->reclen = (uint16_t)reclen;
+    de->type = (uint8_t)type;
+    de->namelen = (uint8_t)n;
+    memcpy(de->name, name, n);
+    memset(de->name + n, 0, reclen - sizeof(vfs_dirent_t) - n);
+    idx->len += reclen;
+    idx->count++;
+    return 0;
+}
+
+void dirindex_publish(dirindex_t *idx) {
+    di_stats.builds++;
+    // Replace an older index of the same path, else take a free slot,
+    // else evict the least recently used.
+    int victim = -1;
+    for (int i = 0; i < DIRINDEX_SLOTS && victim < 0; i++)
+        if (slots[i] && strcmp(slots[i]->path, idx->path) == 0)
+            victim = i;
+    for (int i = 0; i < DIRINDEX_SLOTS && victim < 0; i++)
+        if (!slots[i])
+            victim = i;
+    if (victim < 0) {
+        victim = 0;
+        for (int i = 1; i < DIRINDEX_SLOTS; i++)
+            if (slots[i]->last_use < slots[victim]->last_use)
+                victim = i;
+    }
+    if (slots[victim])
+        slot_drop(victim);
+    idx->refs++;
+    idx->last_use = ++use_clock;
+    slots[victim] = idx;
+    di_stats.cached++;
+    di_stats.bytes += idx->len;
+}
+
+void dirindex_put(dirindex_t *idx) {
+    if (idx && --idx->refs <= 0)
+        dirindex_free(idx);
+}
+
+const vfs_dirent_t *dirindex_at(dirindex_t *idx, uint32_t index) {
+    if (index >= idx->count)
+        return NULL;
+    uint32_t i = 0, off = 0;
+    if (index >= idx->hint_index) {
+        i = idx->hint_index;
+        off = idx->hint_off;
+    }
+    while (i < index) {
+        off += ((const vfs_dirent_t *)(idx->buf + off))->reclen;
+        i++;
+    }
+    idx->hint_index = i;
+    idx->hint_off = off;
+    return (const vfs_dirent_t *)(idx->buf + off);
+}
+
+void dirindex_invalidate(const char *path) {
+    for (int i = 0; i < DIRINDEX_SLOTS; i++) {
+        if (slots[i] && path_same(slots[i]->path, path)) {
+            slot_drop(i);
+            di_stats.invalidations++;
+        }
+    }
+}
+
+void dirindex_invalidate_all(void) {
+    for (int i = 0; i < DIRINDEX_SLOTS; i++) {
+        if (slots[i]) {
+            slot_drop(i);
+            di_stats.invalidations++;
+        }
+    }
+}
+
+void dirindex_get_stats(dirindex_stats_t *out) { *out = di_stats; }
@@ -0,0 +1,61 @@
+#ifndef _DIRINDEX_H
+#define _DIRINDEX_H
+
+#include "vfs.h"
+
+// In-memory directory index: every entry of one directory stored as packed
+// vfs_dirent_t records, exactly the layout getdents hands to user space.
+// Built once by the VFS from the backends' listdir ops and kept in a small
+// LRU cache keyed by path, so alternating listings of several directories
+// do not rescan the disk. Open directory fds hold a reference, so an index
+// dropped from the cache stays readable until the last fd closes.
+
+#define DIRINDEX_SLOTS 8
+
+typedef struct {
+    char path[VFS_PATH_MAX];
+    uint8_t *buf;          // packed vfs_dirent_t records
+    uint32_t len;          // bytes used
+    uint32_t cap;
+    uint32_t count;        // records
+    int refs;              // open dir fds + the cache slot
+    uint32_t last_use;
+    uint32_t hint_index;   // index-based readdir resumes from here
+    uint32_t hint_off;
+} dirindex_t;
+
+typedef struct {
+    uint32_t cached;       // directories currently indexed
+    uint32_t hits;
+    uint32_t builds;
+    uint32_t invalidations;
+    uint32_t bytes;        // record bytes held by cached indexes
+} dirindex_stats_t;
+
+// Cached index for path with a reference taken, or NULL.
+dirindex_t *dirindex_get(const char *path);
+
+// Empty index for path (one reference). Fill with dirindex_add().
+dirindex_t *dirindex_new(const char *path);
+
+// Append a record. Returns 0, or -1 when out of memory.
+int dirindex_add(dirindex_t *idx, const char *name, uint32_t size,
+                 uint32_t type);
+
+// Insert a freshly built index into the cache (takes its own reference).
+void dirindex_publish(dirindex_t *idx);
+
+// Drop a reference; frees the index when no one holds it.
+void dirindex_put(dirindex_t *idx);
+
+// Record at position `index`, O(1) when walked in order. NULL past the end.
+const vfs_dirent_t *dirindex_at(dirindex_t *idx, uint32_t index);
+
+// Forget cached indexes for `path` (compared case-insensitively, since the
+// FAT backends are), or every cached index.
+void dirindex_invalidate(const char *path);
+void dirindex_invalidate_all(void);
+
+void dirindex_get_stats(dirindex_stats_t *out);
+
+#endif
@@ -1,4 +1,7 @@
 #include "fat16.h"
+#include "blkcache.h"
+#include "dcache.h"
+#include "fatcommon.h"
 #include "drivers/ata_pio.h"
 #include "lib.h"
 #include "liballoc/liballoc_1_1.h"
@@ -62,20 +65,6 @@ typedef struct __attribute__((packed)) {
     uint32_t sector_count;
 } mbr_part_t;
 
-// LFN (Long File Name) directory entry — attribute byte 0x0F marks these.
-// Entries are stored in reverse order before the short 8.3 dirent, each
-// tagged with a 1-based sequence number (last entry ORed with 0x40).
-typedef struct __attribute__((packed)) {
-    uint8_t  seq;          // sequence number (1-based, 0x40 = last/first-in-chain)
-    uint8_t  name1[10];    // 5 UTF-16LE chars
-    uint8_t  attr;         // 0x0F = LFN marker
-    uint8_t  type;         // 0
-    uint8_t  checksum;     // checksum of the associated 8.3 name
-    uint8_t  name2[12];    // 6 UTF-16LE chars
-    uint16_t cluster;      // 0 (unused for LFN)
-    uint8_t  name3[4];     // 2 UTF-16LE chars
-} fat16_lfn_t;
-
 typedef struct {
     int mounted;
     uint32_t part_lba;
@@ -95,12 +84,14 @@ typedef struct {
 typedef struct {
     int in_use;
     int flags;
-    uint16_t first_cluster;
+    uint32_t first_cluster;
     uint32_t size;
     uint32_t pos;
     uint8_t attr;
     uint32_t dirent_lba;
     uint16_t dirent_off;
+    fat_extents_t ext;    // cluster chain as runs (fatcommon.c)
+    blkcache_stream_t ra; // sequential-stream detection for read-ahead
 } fat16_open_t;
 
 // Represents the location of a directory (root dir vs subdir cluster chain).
@@ -148,203 +139,56 @@ static uint8_t *fat_cache_get(uint32_t lba) {
     return fat_cache[slot].data;
 }
 
-// Invalidate a specific LBA (after writes to FAT)
-static void fat_cache_evict(uint32_t lba) {
+// Refresh a cached FAT sector in place after it was written to disk.
+static void fat_cache_update(uint32_t lba, const uint8_t *data) {
     for (int i = 0; i < FAT_CACHE_SIZE; i++) {
         if (fat_cache[i].lba == lba)
-            fat_cache[i].lba = 0;
+            memcpy(fat_cache[i].data, data, FAT16_SECTOR_SIZE);
     }
 }
 
-// ---------------------------------------------------------------------------
-// Readdir cache — avoids O(N²) rescanning for index-based readdir API.
-// On index==0 (or path change), scan the entire directory once and cache
-// all entry names. Subsequent readdir calls just index into the cache.
-// ---------------------------------------------------------------------------
-#define RDCACHE_MAX 256  // raised from 128: silently truncating directories is confusing
-#define RDCACHE_NAME 64  // long filenames up to 63 chars + NUL
-static struct {
-    char path[FAT16_MAX_PATH]; // cached directory path
-    char names[RDCACHE_MAX][RDCACHE_NAME];
-    int count;                 // number of cached entries
-    int valid;                 // cache is populated
-} rdcache;
-
-static void rdcache_invalidate(void) {
-    rdcache.valid = 0;
-}
+// Data block cache (blkcache.c): small reads are served from recently read
+// and read-ahead blocks of the data region.
+static blkcache_t g_bcache;
+
+// Free-cluster map and allocator state (fatcommon.c). FAT16 volumes are
+// small enough that the map is always built at mount.
+static fat_vol_t g_vol;
 
 static int is_fat16_part_type(uint8_t type) {
     return (type == 0x04 || type == 0x06 || type == 0x0E);
 }
 
-static char upper_ascii(char c) {
-    if (c >= 'a' && c <= 'z')
-        return (char)(c - ('a' - 'A'));
-    return c;
-}
-
-static int is_83_char(char c) {
-    if (c >= 'A' && c <= 'Z')
-        return 1;
-    if (c >= '0' && c <= '9')
-        return 1;
-    if (c == '_' || c == '$' || c == '~' || c == '-' || c == '!')
-        return 1;
-    return 0;
-}
-
-// Compute the 8.3 checksum used to associate LFN entries with their short dirent.
-static uint8_t lfn_checksum(const uint8_t name83[11]) {
-    uint8_t sum = 0;
-    for (int i = 0; i < 11; i++)
-        sum = ((sum & 1) ? 0x80 : 0) + (sum >> 1) + name83[i];
-    return sum;
-}
-
-// Extract up to `count` UTF-16LE chars from `src` into ASCII `out` buffer.
-// Stops at NUL or 0xFFFF padding. Returns 0.
-static int lfn_extract_chars(const uint8_t *src, int count, char *out, int *pos,
-                              int maxlen) {
-    for (int i = 0; i < count; i++) {
-        uint8_t lo = src[i * 2];
-        uint8_t hi = src[i * 2 + 1];
-        if (lo == 0xFF && hi == 0xFF) break; // 0xFFFF = padding
-        if (lo == 0 && hi == 0) break;       // NUL terminator
-        if (*pos < maxlen - 1)
-            out[(*pos)++] = (char)lo;        // ASCII-safe: take low byte
-    }
-    return 0;
-}
-
-// Generate a short 8.3 alias for a long name that cannot be represented
-// directly. Uses up to 6 chars of base + "~N" suffix, plus up to 3 ext chars.
-// Does NOT check for collisions — caller is responsible for uniqueness if needed.
-static void fat16_make_short_alias(const char *longname, uint8_t out[11],
-                                   int suffix_num) {
-    for (int i = 0; i < 11; i++) out[i] = ' ';
-
-    // Find last dot for extension
-    const char *dot = (const char *)0;
-    for (const char *p = longname; *p; p++) {
-        if (*p == '.') dot = p;
-    }
-
-    // Build base (up to 6 valid 8.3 chars)
-    int base_len = 0;
-    const char *p = longname;
-    const char *base_end = dot ? dot : (longname + strlen(longname));
-    while (p < base_end && base_len < 6) {
-        char c = upper_ascii(*p++);
-        if (is_83_char(c)) {
-            out[base_len++] = (uint8_t)c;
-        } else if (c != ' ') {
-            out[base_len++] = '_'; // replace invalid char
-        }
-    }
-
-    // Append ~N suffix (N = suffix_num, 1-9)
-    char suffix[3] = { '~', (char)('0' + suffix_num), '\0' };
-    // suffix needs 2 chars; if base_len > 6 already capped; just place at [6] and [7]
-    // But base is only up to 6, so positions [base_len] and [base_len+1] (if < 8)
-    if (base_len > 6) base_len = 6;
-    out[base_len]     = '~';
-    out[base_len + 1] = (uint8_t)('0' + suffix_num);
-    (void)suffix; // silence unused warning
-
-    // Extension: up to 3 chars after the last dot
-    if (dot) {
-        int ext_len = 0;
-        p = dot + 1;
-        while (*p && ext_len < 3) {
-            char c = upper_ascii(*p++);
-            if (is_83_char(c))
-                out[8 + ext_len++] = (uint8_t)c;
-        }
-    }
+static int ata_read_sector(uint32_t lba, uint8_t *out) {
+    return ata_pio_read(lba, 1, out);
 }
 
-// Write LFN directory entries for `longname` into `sec` at `off`, going
-// backwards. `lfn_count` is the number of LFN entries to write (already
-// computed). `checksum` is the checksum of the associated 8.3 name.
-// Returns 0 on success, -1 if the entries don't fit in the sector
-// (caller must ensure there is room).
-static void lfn_write_entries(uint8_t *sec, int start_off, int lfn_count,
-                               const char *longname, uint8_t checksum) {
-    int namelen = (int)strlen(longname);
-    // LFN entries are written in reverse order: highest seq first (lowest addr),
-    // seq 1 last (just before the 8.3 dirent).
-    for (int seq = lfn_count; seq >= 1; seq--) {
-        int entry_off = start_off + (seq - 1) * 32;
-        fat16_lfn_t *lfn = (fat16_lfn_t *)(sec + entry_off);
-        memset(lfn, 0xFF, sizeof(*lfn)); // fill with 0xFF (padding)
-        lfn->attr     = FAT16_ATTR_LFN;
-        lfn->type     = 0;
-        lfn->checksum = checksum;
-        lfn->cluster  = 0;
-        // which characters does this entry cover?
-        // seq 1 covers chars 0-12, seq 2 covers 13-25, etc.
-        int char_start = (seq - 1) * 13;
-        uint8_t seq_num = (uint8_t)seq;
-        if (seq == lfn_count) seq_num |= 0x40; // mark as last (first in reverse order)
-        lfn->seq = seq_num;
-
-        // Fill name1[10], name2[12], name3[4] with UTF-16LE chars
-        // For each of the 13 chars in this entry:
-        // positions 0-4 -> name1, 5-10 -> name2, 11-12 -> name3
-        for (int ci = 0; ci < 13; ci++) {
-            int char_idx = char_start + ci;
-            uint8_t lo, hi;
-            if (char_idx < namelen) {
-                lo = (uint8_t)longname[char_idx];
-                hi = 0;
-            } else if (char_idx == namelen) {
-                lo = 0; hi = 0; // NUL terminator
-            } else {
-                lo = 0xFF; hi = 0xFF; // padding
-            }
-            uint8_t *field;
-            int field_idx;
-            if (ci < 5) {
-                field = lfn->name1;
-                field_idx = ci;
-            } else if (ci < 11) {
-                field = lfn->name2;
-                field_idx = ci - 5;
-            } else {
-                field = lfn->name3;
-                field_idx = ci - 11;
-            }
-            field[field_idx * 2]     = lo;
-            field[field_idx * 2 + 1] = hi;
-        }
-    }
+static int fat16_disk_read(uint32_t lba, uint32_t count, void *out) {
+    return ata_pio_read(lba, (uint8_t)count, out);
 }
 
-static int ata_read_sector(uint32_t lba, uint8_t *out) {
-    return ata_pio_read(lba, 1, out);
+// All FAT16 disk writes go through here so the data block cache and the
+// dentry cache stay coherent with the disk.
+static int fat16_disk_write(uint32_t lba, uint32_t count, const void *in) {
+    blkcache_invalidate_range(&g_bcache, lba, count);
+    dcache_invalidate_range(&g_fat, lba, count);
+    return ata_pio_write(lba, (uint8_t)count, in);
 }
 
 static int ata_write_sector(uint32_t lba, const uint8_t *in) {
-    return ata_pio_write(lba, 1, in);
+    return fat16_disk_write(lba, 1, in);
 }
 
-static uint32_t cluster_to_lba(uint16_t cluster) {
-    return g_fat.data_start_lba +
-           ((uint32_t)(cluster - 2) * g_fat.sectors_per_cluster);
+static uint32_t cluster_to_lba(uint32_t cluster) {
+    return g_fat.data_start_lba + (cluster - 2) * g_fat.sectors_per_cluster;
 }
 
 static uint16_t read_u16(const uint8_t *p) {
     return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
 }
 
-static void write_u16(uint8_t *p, uint16_t v) {
-    p[0] = (uint8_t)(v & 0xFF);
-    p[1] = (uint8_t)(v >> 8);
-}
-
-static uint16_t fat16_get_entry(uint16_t cluster) {
-    uint32_t fat_offset = (uint32_t)cluster * 2;
+static uint32_t fat16_get_entry(uint32_t cluster) {
+    uint32_t fat_offset = cluster * 2;
     uint32_t fat_sec = g_fat.fat_start_lba + (fat_offset / FAT16_SECTOR_SIZE);
     uint32_t ent_off = fat_offset % FAT16_SECTOR_SIZE;
 
@@ -354,168 +198,68 @@ static uint16_t fat16_get_entry(uint16_t cluster) {
     return read_u16(sec + ent_off);
 }
 
-static int fat16_set_entry(uint16_t cluster, uint16_t value) {
-    uint8_t sec[FAT16_SECTOR_SIZE];
-    uint32_t fat_offset = (uint32_t)cluster * 2;
-    uint32_t fat_rel_sec = fat_offset / FAT16_SECTOR_SIZE;
-    uint32_t ent_off = fat_offset % FAT16_SECTOR_SIZE;
-
-    // Mirror to all FAT copies
-    for (uint8_t fat_i = 0; fat_i < g_fat.fat_count; fat_i++) {
-        uint32_t fat_sec =
-            g_fat.fat_start_lba + fat_i * g_fat.sectors_per_fat + fat_rel_sec;
-        if (ata_read_sector(fat_sec, sec) < 0)
-            return -1;
-        write_u16(sec + ent_off, value);
-        if (ata_write_sector(fat_sec, sec) < 0)
-            return -1;
-        // Evict cached copy since we wrote new data
-        fat_cache_evict(fat_sec);
-    }
-
-    return 0;
-}
-
-static int fat16_alloc_cluster(uint16_t *out_cluster) {
-    if (!out_cluster)
+// Copy FAT sector `rel` (relative to the first FAT) into `sec` for editing.
+static int fat16_fat_load(uint32_t rel, uint8_t *sec) {
+    uint8_t *cached = fat_cache_get(g_fat.fat_start_lba + rel);
+    if (!cached)
         return -1;
-
-    for (uint32_t c = 2; c < g_fat.cluster_count + 2; c++) {
-        uint16_t v = fat16_get_entry((uint16_t)c);
-        if (v == 0x0000) {
-            if (fat16_set_entry((uint16_t)c, FAT16_EOC) < 0)
-                return -1;
-
-            // Zero the newly allocated cluster on disk
-            uint8_t zero[FAT16_SECTOR_SIZE];
-            memset(zero, 0, sizeof(zero));
-            uint32_t lba = cluster_to_lba((uint16_t)c);
-            for (uint8_t s = 0; s < g_fat.sectors_per_cluster; s++) {
-                if (ata_write_sector(lba + s, zero) < 0)
-                    return -1;
-            }
-
-            *out_cluster = (uint16_t)c;
-            return 0;
-        }
-    }
-    return -1;
-}
-
-static int fat16_free_chain(uint16_t first) {
-    uint16_t c = first;
-    // Limit iterations to total cluster count to prevent infinite loops
-    // on corrupt FAT chains with cycles (e.g. A->B->C->A).
-    uint32_t max_iter = g_fat.cluster_count + 2;
-    uint32_t iter = 0;
-    while (c >= 2 && c < 0xFFF8 && iter < max_iter) {
-        uint16_t next = fat16_get_entry(c);
-        if (fat16_set_entry(c, 0x0000) < 0)
-            return -1;
-        if (next == c)
-            break;
-        c = next;
-        iter++;
-    }
+    memcpy(sec, cached, FAT16_SECTOR_SIZE);
     return 0;
 }
 
-static int fat16_ensure_cluster_for_index(fat16_open_t *f, uint32_t idx,
-                                          uint16_t *out_cluster) {
-    if (!f || !out_cluster)
-        return -1;
-
-    if (f->first_cluster < 2) {
-        uint16_t n;
-        if (fat16_alloc_cluster(&n) < 0)
+// Write an edited FAT sector to every FAT copy and refresh the cache.
+static int fat16_fat_store(uint32_t rel, const uint8_t *sec) {
+    for (uint8_t fat_i = 0; fat_i < g_fat.fat_count; fat_i++) {
+        uint32_t lba =
+            g_fat.fat_start_lba + fat_i * g_fat.sectors_per_fat + rel;
+        if (ata_write_sector(lba, sec) < 0)
             return -1;
-        f->first_cluster = n;
-    }
-
-    uint16_t c = f->first_cluster;
-    for (uint32_t i = 0; i < idx; i++) {
-        uint16_t next = fat16_get_entry(c);
-        if (next >= 0xFFF8 || next < 2) {
-            uint16_t n;
-            if (fat16_alloc_cluster(&n) < 0)
-                return -1;
-            if (fat16_set_entry(c, n) < 0)
-                return -1;
-            if (fat16_set_entry(n, FAT16_EOC) < 0)
-                return -1;
-            next = n;
-        }
-        c = next;
     }
-
-    *out_cluster = c;
+    fat_cache_update(g_fat.fat_start_lba + rel, sec);
     return 0;
 }
 
-static void fat16_dirent_name_to_string(const fat16_dirent_t *de, char *out) {
-    int p = 0;
-    for (int i = 0; i < 8; i++) {
-        if (de->name[i] == ' ')
-            break;
-        out[p++] = (char)de->name[i];
-    }
+// Largest transfer issued as one ATA command (count register is 8 bits).
+#define FAT16_MAX_IO_SECTORS 128
 
-    int has_ext = 0;
-    for (int i = 8; i < 11; i++) {
-        if (de->name[i] != ' ') {
-            has_ext = 1;
-            break;
-        }
-    }
+static const uint8_t fat16_zero_block[FAT16_SECTOR_SIZE * 8];
 
-    if (has_ext) {
-        out[p++] = '.';
-        for (int i = 8; i < 11; i++) {
-            if (de->name[i] == ' ')
-                break;
-            out[p++] = (char)de->name[i];
-        }
+static int fat16_zero_clusters(uint32_t first, uint32_t count) {
+    uint32_t lba = cluster_to_lba(first);
+    uint32_t left = count * g_fat.sectors_per_cluster;
+    while (left > 0) {
+        uint32_t n = (left > 8) ? 8 : left;
+        if (fat16_disk_write(lba, n, fat16_zero_block) < 0)
+            return -1;
+        lba += n;
+        left -= n;
     }
-    out[p] = '\0';
+    return 0;
 }
 
-static int fat16_name_to_83(const char *in, uint8_t out[11]) {
-    if (!in || !*in)
-        return -1;
-
-    for (int i = 0; i < 11; i++)
-        out[i] = ' ';
-
-    int i = 0;
-    int base_len = 0;
-    while (in[i] && in[i] != '.') {
-        char c = upper_ascii(in[i]);
-        if (!is_83_char(c))
-            return -1;
-        if (base_len >= 8)
-            return -1;
-        out[base_len++] = (uint8_t)c;
-        i++;
-    }
-    if (base_len == 0)
-        return -1;
+static const fat_vol_ops_t fat16_vol_ops = {
+    .get_entry = fat16_get_entry,
+    .fat_load = fat16_fat_load,
+    .fat_store = fat16_fat_store,
+    .disk_read = fat16_disk_read,
+    .zero_clusters = fat16_zero_clusters,
+};
 
-    if (in[i] == '.') {
-        i++;
-        int ext_len = 0;
-        while (in[i]) {
-            char c = upper_ascii(in[i]);
-            if (!is_83_char(c))
-                return -1;
-            if (ext_len >= 3)
-                return -1;
-            out[8 + ext_len] = (uint8_t)c;
-            ext_len++;
-            i++;
-        }
+// The chain behind a dirent was truncated or replaced through one handle:
+// drop stale mappings held by every other handle on the same file.
+static void fat16_chain_changed(const fat16_open_t *src) {
+    for (int i = 0; i < FAT16_MAX_OPEN; i++) {
+        fat16_open_t *o = &g_open[i];
+        if (!o->in_use || o == src || o->dirent_lba != src->dirent_lba ||
+            o->dirent_off != src->dirent_off)
+            continue;
+        o->first_cluster = src->first_cluster;
+        if (o->size > src->size)
+            o->size = src->size;
+        if (o->pos > o->size)
+            o->pos = o->size;
+        fat_extents_reset(&o->ext);
     }
-
-    return 0;
 }
 
 // ---------------------------------------------------------------------------
@@ -527,18 +271,15 @@ static int fat16_name_to_83(const char *in, uint8_t out[11]) {
 // chain. Returns 0 on match, -1 on not found. Optionally returns first free
 // slot.
 // Helper: scan a sector buffer for a matching 8.3 name (or long name) or free slot.
-// `pending_lfn` is the long name accumulated from preceding LFN entries (may be "").
-// `pending_lfn_start_lba/off` records where those LFN entries began (for free-slot
-// reporting when a deleted entry is found).
+// `pending_lfn`/`pending_lfn_seq` carry the long name accumulated from
+// preceding LFN entries across sectors (see fat_lfn_accumulate).
 // Returns 1 if match found, -1 if end-of-directory (0x00 marker), 0 to keep scanning.
 static int fat16_scan_dir_sector(const uint8_t *sec, uint32_t lba,
                                  const uint8_t name83[11],
                                  const char *longname,
                                  fat16_dirent_t *out, uint32_t *out_lba,
                                  uint16_t *out_off, uint32_t *free_lba,
-                                 uint16_t *free_off,
-                                 // LFN state: accumulated name and its storage info
-                                 char *pending_lfn, int pending_lfn_maxlen,
+                                 uint16_t *free_off, char *pending_lfn,
                                  int *pending_lfn_seq) {
     for (int off = 0; off < FAT16_SECTOR_SIZE; off += 32) {
         const fat16_dirent_t *de = (const fat16_dirent_t *)(sec + off);
@@ -552,8 +293,7 @@ static int fat16_scan_dir_sector(const uint8_t *sec, uint32_t lba,
         }
         if (de->name[0] == 0xE5) {
             // Deleted entry: reset pending LFN state and record as free slot
-            if (pending_lfn) pending_lfn[0] = '\0';
-            if (pending_lfn_seq) *pending_lfn_seq = 0;
+            *pending_lfn_seq = 0;
             if (free_lba && *free_lba == 0) {
                 *free_lba = lba;
                 *free_off = (uint16_t)off;
@@ -561,75 +301,28 @@ static int fat16_scan_dir_sector(const uint8_t *sec, uint32_t lba,
             continue;
         }
         if (de->attr == FAT16_ATTR_LFN) {
-            // Accumulate LFN characters into pending_lfn.
-            // LFN entries arrive in reverse seq order on disk, so the entry with
-            // the highest seq (ORed with 0x40) arrives first, down to seq 1.
-            // We process them in arrival order, prepending each entry's chars.
-            // Simple approach: rebuild the name when we see each entry.
-            // Since we see them from last->first, we can store them and reassemble
-            // when we hit the short entry. For simplicity, do a forward pass:
-            // treat them in arrival order and just store the whole name.
-            if (pending_lfn && pending_lfn_seq) {
-                const fat16_lfn_t *lfn = (const fat16_lfn_t *)de;
-                uint8_t seq = lfn->seq & 0x3F; // strip 0x40 flag
-                if (lfn->seq & 0x40) {
-                    // This is the last LFN entry (highest seq, first on disk)
-                    // — reset and start accumulating from here
-                    *pending_lfn_seq = (int)seq;
-                    pending_lfn[0] = '\0';
-                }
-                // Prepend this entry's chars: entry with seq=N covers chars (N-1)*13..N*13-1
-                // Build a temporary buffer for just this entry's contribution
-                char chunk[14];
-                int cpos = 0;
-                lfn_extract_chars(lfn->name1, 5, chunk, &cpos, 14);
-                lfn_extract_chars(lfn->name2, 6, chunk, &cpos, 14);
-                lfn_extract_chars(lfn->name3, 2, chunk, &cpos, 14);
-                chunk[cpos] = '\0';
-                // Each chunk corresponds to chars at position (seq-1)*13 in the final name.
-                // Rather than complex insertion, just overwrite those positions.
-                int char_start = ((int)seq - 1) * 13;
-                for (int ci = 0; ci < cpos && (char_start + ci) < pending_lfn_maxlen - 1; ci++)
-                    pending_lfn[char_start + ci] = chunk[ci];
-                // NUL-terminate at the known end
-                int total_chars = *pending_lfn_seq * 13;
-                if (total_chars < pending_lfn_maxlen)
-                    pending_lfn[total_chars] = '\0';
-                else
-                    pending_lfn[pending_lfn_maxlen - 1] = '\0';
-            }
+            fat_lfn_accumulate((const fat_lfn_t *)de, pending_lfn,
+                               pending_lfn_seq);
             continue;
         }
         if (de->attr & FAT16_ATTR_VOLUMEID) {
-            // Volume label: reset pending LFN
-            if (pending_lfn) pending_lfn[0] = '\0';
-            if (pending_lfn_seq) *pending_lfn_seq = 0;
+            *pending_lfn_seq = 0;
             continue;
         }
 
-        // Short 8.3 entry: check for match
-        int matched = 0;
-        if (memcmp(de->name, name83, 11) == 0)
-            matched = 1;
-        // Also match by long name if provided and pending_lfn has content
-        if (!matched && longname && pending_lfn && pending_lfn[0] != '\0') {
-            if (strcmp(pending_lfn, longname) == 0)
-                matched = 1;
-        }
+        // Short 8.3 entry: match the 8.3 name, or the long name if one
+        // was provided and the entry carries one
+        int matched = (memcmp(de->name, name83, 11) == 0);
+        if (!matched && longname && *pending_lfn_seq > 0)
+            matched = (strcmp(pending_lfn, longname) == 0);
+        *pending_lfn_seq = 0;
 
         if (matched) {
             if (out)   *out    = *de;
             if (out_lba) *out_lba = lba;
             if (out_off) *out_off = (uint16_t)off;
-            // Reset pending LFN state
-            if (pending_lfn) pending_lfn[0] = '\0';
-            if (pending_lfn_seq) *pending_lfn_seq = 0;
             return 1; // found
         }
-
-        // No match: reset pending LFN for next entry
-        if (pending_lfn) pending_lfn[0] = '\0';
-        if (pending_lfn_seq) *pending_lfn_seq = 0;
     }
     return 0; // keep scanning
 }
@@ -645,15 +338,38 @@ static int fat16_lookup_in_dir(fat16_dir_loc_t dir, const uint8_t name83[11],
     if (!g_fat.mounted || !name83)
         return -1;
 
+    // Dentry cache, for lookups by user-visible name only (alias collision
+    // checks pass no longname). A negative entry can't answer a caller that
+    // also wants a free slot.
+    fat16_dirent_t found;
+    uint32_t found_lba = 0;
+    uint16_t found_off = 0;
+    if (!out) out = &found;
+    if (!out_lba) out_lba = &found_lba;
+    if (!out_off) out_off = &found_off;
+    if (longname) {
+        dcache_hit_t hit;
+        int dc = dcache_lookup(&g_fat, dir.cluster, longname, &hit);
+        if (dc == DCACHE_FOUND) {
+            memcpy(out, hit.dirent, sizeof(*out));
+            *out_lba = hit.lba;
+            *out_off = hit.off;
+            return 0;
+        }
+        if (dc == DCACHE_NEGATIVE && !free_lba)
+            return -1;
+    }
+
     // Heap-allocate bulk read buffer to avoid kernel stack overflow (8KB limit)
     uint32_t bufsz = FAT16_SECTOR_SIZE * 8;
     uint8_t *bulk = (uint8_t *)kmalloc(bufsz);
     if (!bulk)
         return -1;
     int result = -1;
+    int io_err = 0;
 
     // LFN accumulator state (persists across sector boundaries)
-    char pending_lfn[RDCACHE_NAME];
+    char pending_lfn[FAT_NAME_MAX];
     int  pending_lfn_seq = 0;
     pending_lfn[0] = '\0';
 
@@ -664,13 +380,15 @@ static int fat16_lookup_in_dir(fat16_dir_loc_t dir, const uint8_t name83[11],
             uint32_t batch = g_fat.root_dir_sectors - s;
             if (batch > 8) batch = 8;
             uint32_t base_lba = g_fat.root_start_lba + s;
-            if (ata_pio_read(base_lba, (uint8_t)batch, bulk) < 0)
+            if (ata_pio_read(base_lba, (uint8_t)batch, bulk) < 0) {
+                io_err = 1;
                 goto out;
+            }
             for (uint32_t b = 0; b < batch; b++) {
                 int rc = fat16_scan_dir_sector(
                     bulk + b * FAT16_SECTOR_SIZE, base_lba + b,
                     name83, longname, out, out_lba, out_off, free_lba, free_off,
-                    pending_lfn, RDCACHE_NAME, &pending_lfn_seq);
+                    pending_lfn, &pending_lfn_seq);
                 if (rc == 1) { result = 0; goto out; }
                 if (rc == -1) goto out;
             }
@@ -683,25 +401,29 @@ static int fat16_lookup_in_dir(fat16_dir_loc_t dir, const uint8_t name83[11],
         while (cl >= 2 && cl < 0xFFF8) {
             uint32_t base_lba = cluster_to_lba(cl);
             if (can_bulk) {
-                if (ata_pio_read(base_lba, g_fat.sectors_per_cluster, bulk) < 0)
+                if (ata_pio_read(base_lba, g_fat.sectors_per_cluster, bulk) < 0) {
+                    io_err = 1;
                     goto out;
+                }
                 for (uint8_t b = 0; b < g_fat.sectors_per_cluster; b++) {
                     int rc = fat16_scan_dir_sector(
                         bulk + b * FAT16_SECTOR_SIZE, base_lba + b,
                         name83, longname, out, out_lba, out_off, free_lba, free_off,
-                        pending_lfn, RDCACHE_NAME, &pending_lfn_seq);
+                        pending_lfn, &pending_lfn_seq);
                     if (rc == 1) { result = 0; goto out; }
                     if (rc == -1) goto out;
                 }
             } else {
                 uint8_t sec[FAT16_SECTOR_SIZE];
                 for (uint8_t s = 0; s < g_fat.sectors_per_cluster; s++) {
-                    if (ata_read_sector(base_lba + s, sec) < 0)
+                    if (ata_read_sector(base_lba + s, sec) < 0) {
+                        io_err = 1;
                         goto out;
+                    }
                     int rc = fat16_scan_dir_sector(
                         sec, base_lba + s,
                         name83, longname, out, out_lba, out_off, free_lba, free_off,
-                        pending_lfn, RDCACHE_NAME, &pending_lfn_seq);
+                        pending_lfn, &pending_lfn_seq);
                     if (rc == 1) { result = 0; goto out; }
                     if (rc == -1) goto out;
                 }
@@ -712,6 +434,9 @@ static int fat16_lookup_in_dir(fat16_dir_loc_t dir, const uint8_t name83[11],
 
 out:
     kfree(bulk);
+    if (longname && !io_err)
+        dcache_insert(&g_fat, dir.cluster, longname, result == 0 ? out : NULL,
+                      *out_lba, *out_off);
     return result;
 }
 
@@ -749,8 +474,8 @@ static int fat16_resolve_path(const char *path, fat16_dir_loc_t *parent_dir,
             continue;
         }
 
-        // Extract component name (up to RDCACHE_NAME-1 chars for LFN support)
-        char comp[RDCACHE_NAME];
+        // Extract component name (up to FAT_NAME_MAX-1 chars for LFN support)
+        char comp[FAT_NAME_MAX];
         if (comp_len >= (int)sizeof(comp))
             return -1; // name too long
         memcpy(comp, path, (size_t)comp_len);
@@ -758,7 +483,7 @@ static int fat16_resolve_path(const char *path, fat16_dir_loc_t *parent_dir,
 
         // Convert to 8.3 — may fail for long names; use all-spaces as sentinel
         uint8_t c83[11];
-        int c83_ok = (fat16_name_to_83(comp, c83) == 0);
+        int c83_ok = (fat_name_to_83(comp, c83) == 0);
         if (!c83_ok) {
             // Long name: build a dummy 8.3 alias for the lookup.
             // The scan will match via the LFN string comparison path.
@@ -851,87 +576,90 @@ static int fat16_update_dirent(fat16_open_t *f) {
     return 0;
 }
 
-// Read from a cluster chain. Uses multi-sector ATA reads when possible:
-// reads an entire cluster (sectors_per_cluster sectors) in one ATA command
-// instead of one sector at a time.
-static int fat16_read_file(uint16_t first_cluster, uint32_t pos, void *buf,
+// Read from an open file's cluster chain. Small reads go through the data
+// block cache with adaptive read-ahead for sequential streams. Large
+// sector-aligned spans go straight into the caller's buffer, one ATA
+// command per contiguous run of clusters; unaligned head/tail sectors of
+// large reads pass through a bounce buffer.
+static int fat16_read_file(fat16_open_t *f, uint32_t pos, void *buf,
                            uint32_t len) {
     if (len == 0)
         return 0;
 
-    if (first_cluster < 2)
+    if (f->first_cluster < 2)
         return 0;
 
-    uint8_t *out = (uint8_t *)buf;
-    uint32_t cluster_size =
-        (uint32_t)g_fat.sectors_per_cluster * FAT16_SECTOR_SIZE;
-    uint32_t skip_clusters = pos / cluster_size;
-    uint32_t in_cluster = pos % cluster_size;
-
-    uint16_t cl = first_cluster;
-    for (uint32_t i = 0; i < skip_clusters; i++) {
-        uint16_t next = fat16_get_entry(cl);
-        if (next >= 0xFFF8 || next == FAT16_EOC || next < 2)
-            return 0;
-        cl = next;
-    }
+    blkcache_stream_note(&f->ra, pos);
+    int cached = blkcache_enabled(&g_bcache) && len < BLKCACHE_DIRECT_BYTES;
 
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t spc = g_fat.sectors_per_cluster;
+    uint32_t cluster_size = spc * FAT16_SECTOR_SIZE;
     uint32_t done = 0;
-    // Heap-allocate cluster buffer to avoid kernel stack overflow (8KB limit)
-    int can_bulk = (g_fat.sectors_per_cluster <= 8);
-    uint8_t *cluster_buf = NULL;
-    if (can_bulk) {
-        cluster_buf = (uint8_t *)kmalloc(FAT16_SECTOR_SIZE * 8);
-        if (!cluster_buf)
-            can_bulk = 0; // fall back to per-sector reads
-    }
+    // Heap-allocate bounce buffer to avoid kernel stack overflow (8KB limit)
+    uint8_t *bounce = NULL;
 
-    while (done < len && cl >= 2 && cl < 0xFFF8) {
-        uint32_t lba = cluster_to_lba(cl);
+    while (done < len) {
+        uint32_t abs_pos = pos + done;
+        uint32_t cl_idx = abs_pos / cluster_size;
+        uint32_t in_cl = abs_pos % cluster_size;
+        uint32_t want = (in_cl + (len - done) + cluster_size - 1) / cluster_size;
+        if (cached)
+            want += (f->ra.window * BLKCACHE_BYTES + cluster_size - 1) /
+                    cluster_size;
+
+        uint32_t cl, run;
+        if (fat_extents_map(&g_vol, &f->ext, f->first_cluster, cl_idx, want,
+                            &cl, &run) < 0)
+            break;
+
+        uint32_t sec_in_cl = in_cl / FAT16_SECTOR_SIZE;
+        uint32_t sec_off = in_cl % FAT16_SECTOR_SIZE;
+        uint32_t lba = cluster_to_lba(cl) + sec_in_cl;
+        uint32_t run_secs = run * spc - sec_in_cl;
+
+        if (cached) {
+            uint32_t span =
+                blkcache_stream_span(&f->ra, len - done, f->size - abs_pos);
+            int n = blkcache_read(&g_bcache, lba, sec_off, run_secs, span,
+                                  out + done, len - done);
+            if (n < 0)
+                break;
+            if (n > 0) {
+                done += (uint32_t)n;
+                continue;
+            }
+        }
 
-        if (can_bulk && in_cluster == 0 && (len - done) >= cluster_size) {
-            // Fast path: read entire cluster directly into output buffer
-            if (ata_pio_read(lba, g_fat.sectors_per_cluster, out + done) < 0)
+        if (sec_off == 0 && (len - done) >= FAT16_SECTOR_SIZE) {
+            uint32_t n = (len - done) / FAT16_SECTOR_SIZE;
+            if (n > run_secs) n = run_secs;
+            if (n > FAT16_MAX_IO_SECTORS) n = FAT16_MAX_IO_SECTORS;
+            if (ata_pio_read(lba, (uint8_t)n, out + done) < 0)
                 break;
-            done += cluster_size;
-        } else if (can_bulk) {
-            // Partial cluster: bulk read into temp buffer, copy needed portion
-            if (ata_pio_read(lba, g_fat.sectors_per_cluster, cluster_buf) < 0)
+            done += n * FAT16_SECTOR_SIZE;
+        } else {
+            if (!bounce) {
+                bounce = (uint8_t *)kmalloc(FAT16_SECTOR_SIZE * 8);
+                if (!bounce)
+                    break;
+            }
+            uint32_t n = (sec_off + (len - done) + FAT16_SECTOR_SIZE - 1) /
+                         FAT16_SECTOR_SIZE;
+            if (n > run_secs) n = run_secs;
+            if (n > 8) n = 8;
+            if (ata_pio_read(lba, (uint8_t)n, bounce) < 0)
                 break;
-            uint32_t avail = cluster_size - in_cluster;
+            uint32_t avail = n * FAT16_SECTOR_SIZE - sec_off;
             uint32_t need = len - done;
             uint32_t take = (avail < need) ? avail : need;
-            memcpy(out + done, cluster_buf + in_cluster, take);
+            memcpy(out + done, bounce + sec_off, take);
             done += take;
-        } else {
-            // Large cluster or OOM: read sector by sector
-            for (uint8_t s = 0; s < g_fat.sectors_per_cluster && done < len;
-                 s++) {
-                uint32_t sector_off = (uint32_t)s * FAT16_SECTOR_SIZE;
-                if (in_cluster >= sector_off + FAT16_SECTOR_SIZE)
-                    continue;
-
-                uint8_t sec[FAT16_SECTOR_SIZE];
-                if (ata_read_sector(lba + s, sec) < 0) {
-                    if (cluster_buf) kfree(cluster_buf);
-                    return (int)done;
-                }
-
-                uint32_t start = 0;
-                if (in_cluster > sector_off)
-                    start = in_cluster - sector_off;
-                uint32_t avail = FAT16_SECTOR_SIZE - start;
-                uint32_t need = len - done;
-                uint32_t take = (avail < need) ? avail : need;
-                memcpy(out + done, sec + start, take);
-                done += take;
-            }
         }
-        in_cluster = 0;
-        cl = fat16_get_entry(cl);
     }
 
-    if (cluster_buf) kfree(cluster_buf);
+    if (bounce) kfree(bounce);
+    f->ra.next_pos = pos + done;
     return (int)done;
 }
 
@@ -966,35 +694,35 @@ static int fat16_vfs_open(const char *path, int flags) {
             return -1;
         if (free_lba == 0)
             return -1;
-        rdcache_invalidate(); // new file being created
+        // Drop the negative dentry for the name (no name lookups follow).
+        dcache_invalidate_dir(&g_fat, parent.cluster);
 
         // Determine whether we need LFN entries.
         // Extract the last path component as the filename.
         const char *fname = path;
         for (const char *p = path; *p; p++)
             if (*p == '/') fname = p + 1;
-        int need_lfn = (fat16_name_to_83(fname, name83) < 0);
+        int need_lfn = (fat_name_to_83(fname, name83) < 0);
         uint8_t actual_name83[11];
         if (need_lfn) {
             // Generate a short alias and write LFN entries first.
-            // Find a non-colliding alias suffix.
+            // Find a non-colliding alias suffix: if the alias already
+            // exists, try the next one.
             int suffix = 1;
-            fat16_make_short_alias(fname, actual_name83, suffix);
-            // Simple collision check: if alias already exists, try next suffix
-            while (suffix <= 9) {
+            while (suffix <= FAT_ALIAS_MAX) {
                 fat16_dirent_t check_de;
-                fat16_make_short_alias(fname, actual_name83, suffix);
+                fat_make_short_alias(fname, actual_name83, suffix);
                 if (fat16_lookup_in_dir(parent, actual_name83, NULL,
                                         &check_de, NULL, NULL, NULL, NULL) < 0)
                     break; // not found = no collision
                 suffix++;
             }
-            if (suffix > 9) return -1; // gave up
+            if (suffix > FAT_ALIAS_MAX) return -1; // gave up
 
             // Compute how many LFN entries we need
             int fname_len = (int)strlen(fname);
             int lfn_count = (fname_len + 12) / 13; // ceil(len/13)
-            uint8_t checksum = lfn_checksum(actual_name83);
+            uint8_t checksum = fat_lfn_checksum(actual_name83);
 
             // We need lfn_count + 1 consecutive free slots. For now, require
             // the free slot found earlier to be followed by enough space in
@@ -1008,7 +736,7 @@ static int fat16_vfs_open(const char *path, int flags) {
 
             if (can_fit_lfn) {
                 // Write LFN entries before the short entry
-                lfn_write_entries(sec, (int)free_off, lfn_count, fname, checksum);
+                fat_lfn_write_entries(sec, (int)free_off, lfn_count, fname, checksum);
                 // Write short entry after LFN entries
                 int short_off = (int)free_off + lfn_count * 32;
                 fat16_dirent_t *nde = (fat16_dirent_t *)(sec + short_off);
@@ -1059,7 +787,7 @@ static int fat16_vfs_open(const char *path, int flags) {
     // Truncate regular file when requested and writable.
     if ((flags & O_TRUNC) && access != O_RDONLY) {
         if (de.first_cluster_lo >= 2) {
-            if (fat16_free_chain(de.first_cluster_lo) < 0)
+            if (fat_free_chain(&g_vol, de.first_cluster_lo) < 0)
                 return -1;
         }
         de.first_cluster_lo = 0;
@@ -1093,6 +821,11 @@ static int fat16_vfs_open(const char *path, int flags) {
     g_open[h].attr = de.attr;
     g_open[h].dirent_lba = de_lba;
     g_open[h].dirent_off = de_off;
+    fat_extents_reset(&g_open[h].ext);
+    g_open[h].ra.next_pos = 0;
+    g_open[h].ra.window = 0;
+    if ((flags & O_TRUNC) && access != O_RDONLY)
+        fat16_chain_changed(&g_open[h]);
     return h;
 }
 
@@ -1113,7 +846,7 @@ static int fat16_vfs_read(int handle, void *buf, uint32_t len) {
     if (len > remain)
         len = remain;
 
-    int n = fat16_read_file(f->first_cluster, f->pos, buf, len);
+    int n = fat16_read_file(f, f->pos, buf, len);
     if (n > 0)
         f->pos += (uint32_t)n;
     return n;
@@ -1136,23 +869,39 @@ static int fat16_vfs_write(int handle, const void *buf, uint32_t len) {
     if (f->flags & O_APPEND)
         f->pos = f->size;
 
-    uint32_t cluster_size =
-        (uint32_t)g_fat.sectors_per_cluster * FAT16_SECTOR_SIZE;
+    uint32_t spc = g_fat.sectors_per_cluster;
+    uint32_t cluster_size = spc * FAT16_SECTOR_SIZE;
     uint32_t done = 0;
 
     while (done < len) {
         uint32_t abs_pos = f->pos + done;
         uint32_t cl_idx = abs_pos / cluster_size;
         uint32_t in_cl = abs_pos % cluster_size;
+        uint32_t want = (in_cl + (len - done) + cluster_size - 1) / cluster_size;
 
-        uint16_t cl;
-        if (fat16_ensure_cluster_for_index(f, cl_idx, &cl) < 0)
+        // Grows the chain by whole runs, so a large write allocates its
+        // clusters contiguously up front instead of one at a time.
+        uint32_t cl, run;
+        if (fat_extents_grow(&g_vol, &f->ext, &f->first_cluster, cl_idx, want,
+                             0, &cl, &run) < 0)
             break;
 
         uint32_t sec_idx = in_cl / FAT16_SECTOR_SIZE;
         uint32_t sec_off = in_cl % FAT16_SECTOR_SIZE;
         uint32_t lba = cluster_to_lba(cl) + sec_idx;
 
+        if (sec_off == 0 && (len - done) >= FAT16_SECTOR_SIZE) {
+            // Whole sectors: write straight from the caller's buffer.
+            uint32_t n = (len - done) / FAT16_SECTOR_SIZE;
+            uint32_t run_secs = run * spc - sec_idx;
+            if (n > run_secs) n = run_secs;
+            if (n > FAT16_MAX_IO_SECTORS) n = FAT16_MAX_IO_SECTORS;
+            if (fat16_disk_write(lba, n, (const uint8_t *)buf + done) < 0)
+                break;
+            done += n * FAT16_SECTOR_SIZE;
+            continue;
+        }
+
         uint8_t sec[FAT16_SECTOR_SIZE];
         if (ata_read_sector(lba, sec) < 0)
             break;
@@ -1254,220 +1003,138 @@ static int fat16_vfs_stat(const char *path, vfs_stat_t *st) {
     return 0;
 }
 
-// Scan a directory and collect all visible entry names into the rdcache.
-// Called once per directory; subsequent readdir calls index into the cache.
-static void fat16_readdir_fill_cache(const char *path, fat16_dir_loc_t dir) {
-    rdcache.count = 0;
-    rdcache.valid = 0;
-
-    // Store the path for cache-hit comparison
-    int pi = 0;
-    if (path) {
-        for (; path[pi] && pi < FAT16_MAX_PATH - 1; pi++)
-            rdcache.path[pi] = path[pi];
+// listdir scan state, carried across sectors and clusters.
+typedef struct {
+    vfs_dir_emit_t emit;
+    void *ctx;
+    int is_subdir;
+    char pending_lfn[FAT_NAME_MAX];
+    int pending_lfn_seq;
+} fat16_list_t;
+
+// Emit the visible entries of one directory sector. Skips '.', '..', volume
+// labels and deleted entries; LFN runs name the short entry that follows.
+// Returns 1 at the end of the directory or when the callback stops the walk.
+static int fat16_list_sector(fat16_list_t *ls, const uint8_t *sec) {
+    for (int off = 0; off < FAT16_SECTOR_SIZE; off += 32) {
+        const fat16_dirent_t *de = (const fat16_dirent_t *)(sec + off);
+        if (de->name[0] == 0x00)
+            return 1;
+        if (de->attr == FAT16_ATTR_LFN && de->name[0] != 0xE5) {
+            fat_lfn_accumulate((const fat_lfn_t *)de, ls->pending_lfn,
+                               &ls->pending_lfn_seq);
+            continue;
+        }
+        int skip = de->name[0] == 0xE5 || (de->attr & FAT16_ATTR_VOLUMEID) ||
+                   (ls->is_subdir && de->name[0] == '.' &&
+                    (de->name[1] == ' ' ||
+                     (de->name[1] == '.' && de->name[2] == ' ')));
+        char name[FAT_NAME_MAX];
+        if (!skip) {
+            if (ls->pending_lfn_seq > 0)
+                memcpy(name, ls->pending_lfn, FAT_NAME_MAX);
+            else
+                fat_83_to_name(de->name, name);
+        }
+        ls->pending_lfn_seq = 0;
+        if (skip)
+            continue;
+        uint32_t type = (de->attr & FAT16_ATTR_DIR) ? VFS_DIR : VFS_FILE;
+        if (ls->emit(ls->ctx, name, de->file_size, type))
+            return 1;
     }
-    rdcache.path[pi] = '\0';
+    return 0;
+}
 
-    int is_subdir = (dir.cluster != 0);
+// Enumerate a directory in one pass, handing each entry (with size and
+// type) to the VFS, which keeps the result in its directory index.
+static int fat16_vfs_listdir(const char *path, vfs_dir_emit_t emit,
+                             void *ctx) {
+    if (!g_fat.mounted || !path || !emit)
+        return -1;
+
+    fat16_dir_loc_t dir;
+    if (fat16_resolve_dir(path, &dir) < 0)
+        return -1;
 
     // Heap-allocate bulk read buffer to avoid kernel stack overflow (8KB limit)
     uint8_t *bulk = (uint8_t *)kmalloc(FAT16_SECTOR_SIZE * 8);
     if (!bulk)
-        return;
-
-    // LFN accumulator: collect pending long-name from LFN entries
-    char pending_lfn[RDCACHE_NAME];
-    int  pending_lfn_seq = 0;
-    pending_lfn[0] = '\0';
+        return -1;
 
-    // Helper macro to add an entry to the cache, using LFN if available
-#define RDCACHE_ADD(de_ptr) do { \
-    if (rdcache.count < RDCACHE_MAX) { \
-        if (pending_lfn[0] != '\0') { \
-            int _n = 0; \
-            for (; pending_lfn[_n] && _n < RDCACHE_NAME - 1; _n++) \
-                rdcache.names[rdcache.count][_n] = pending_lfn[_n]; \
-            rdcache.names[rdcache.count][_n] = '\0'; \
-        } else { \
-            fat16_dirent_name_to_string((de_ptr), rdcache.names[rdcache.count]); \
-        } \
-        rdcache.count++; \
-    } \
-    pending_lfn[0] = '\0'; \
-    pending_lfn_seq = 0; \
-} while (0)
+    fat16_list_t ls;
+    ls.emit = emit;
+    ls.ctx = ctx;
+    ls.is_subdir = (dir.cluster != 0);
+    ls.pending_lfn[0] = '\0';
+    ls.pending_lfn_seq = 0;
 
     if (dir.cluster == 0) {
         // Root directory — bulk-read sectors
         uint32_t s = 0;
-        while (s < g_fat.root_dir_sectors && rdcache.count < RDCACHE_MAX) {
+        while (s < g_fat.root_dir_sectors) {
             uint32_t batch = g_fat.root_dir_sectors - s;
             if (batch > 8) batch = 8;
             if (ata_pio_read(g_fat.root_start_lba + s, (uint8_t)batch, bulk) <
                 0)
                 goto done;
-            for (uint32_t b = 0; b < batch; b++) {
-                uint8_t *sec = bulk + b * FAT16_SECTOR_SIZE;
-                for (int off = 0; off < FAT16_SECTOR_SIZE; off += 32) {
-                    fat16_dirent_t *de = (fat16_dirent_t *)(sec + off);
-                    if (de->name[0] == 0x00)
-                        goto done;
-                    if (de->name[0] == 0xE5) {
-                        pending_lfn[0] = '\0'; pending_lfn_seq = 0;
-                        continue;
-                    }
-                    if (de->attr == FAT16_ATTR_LFN) {
-                        // Accumulate LFN chars
-                        const fat16_lfn_t *lfn = (const fat16_lfn_t *)de;
-                        uint8_t seq = lfn->seq & 0x3F;
-                        if (lfn->seq & 0x40) {
-                            pending_lfn_seq = (int)seq;
-                            pending_lfn[0] = '\0';
-                        }
-                        int char_start = ((int)seq - 1) * 13;
-                        char chunk[14]; int cpos = 0;
-                        lfn_extract_chars(lfn->name1, 5, chunk, &cpos, 14);
-                        lfn_extract_chars(lfn->name2, 6, chunk, &cpos, 14);
-                        lfn_extract_chars(lfn->name3, 2, chunk, &cpos, 14);
-                        for (int ci = 0; ci < cpos && (char_start+ci) < RDCACHE_NAME-1; ci++)
-                            pending_lfn[char_start + ci] = chunk[ci];
-                        int total_chars = pending_lfn_seq * 13;
-                        if (total_chars < RDCACHE_NAME)
-                            pending_lfn[total_chars] = '\0';
-                        else
-                            pending_lfn[RDCACHE_NAME - 1] = '\0';
-                        continue;
-                    }
-                    if (de->attr & FAT16_ATTR_VOLUMEID) {
-                        pending_lfn[0] = '\0'; pending_lfn_seq = 0;
-                        continue;
-                    }
-                    RDCACHE_ADD(de);
-                }
-            }
+            for (uint32_t b = 0; b < batch; b++)
+                if (fat16_list_sector(&ls, bulk + b * FAT16_SECTOR_SIZE))
+                    goto done;
             s += batch;
         }
     } else {
         // Subdirectory: follow cluster chain, bulk-read
         int can_bulk = (g_fat.sectors_per_cluster <= 8);
         uint16_t cl = dir.cluster;
-        while (cl >= 2 && cl < 0xFFF8 && rdcache.count < RDCACHE_MAX) {
+        while (cl >= 2 && cl < 0xFFF8) {
             uint32_t base_lba = cluster_to_lba(cl);
-            uint8_t *data;
-            uint8_t sec_single[FAT16_SECTOR_SIZE];
-
-            if (can_bulk) {
-                if (ata_pio_read(base_lba, g_fat.sectors_per_cluster, bulk) < 0)
-                    goto done;
-                data = bulk;
-            } else {
-                data = NULL;
-            }
-
+            if (can_bulk &&
+                ata_pio_read(base_lba, g_fat.sectors_per_cluster, bulk) < 0)
+                goto done;
             for (uint8_t s = 0; s < g_fat.sectors_per_cluster; s++) {
-                uint8_t *sec;
-                if (can_bulk) {
-                    sec = data + s * FAT16_SECTOR_SIZE;
-                } else {
-                    if (ata_read_sector(base_lba + s, sec_single) < 0)
-                        goto done;
-                    sec = sec_single;
-                }
-                for (int off = 0; off < FAT16_SECTOR_SIZE; off += 32) {
-                    fat16_dirent_t *de = (fat16_dirent_t *)(sec + off);
-                    if (de->name[0] == 0x00)
-                        goto done;
-                    if (de->name[0] == 0xE5) {
-                        pending_lfn[0] = '\0'; pending_lfn_seq = 0;
-                        continue;
-                    }
-                    if (de->attr == FAT16_ATTR_LFN) {
-                        const fat16_lfn_t *lfn = (const fat16_lfn_t *)de;
-                        uint8_t seq = lfn->seq & 0x3F;
-                        if (lfn->seq & 0x40) {
-                            pending_lfn_seq = (int)seq;
-                            pending_lfn[0] = '\0';
-                        }
-                        int char_start = ((int)seq - 1) * 13;
-                        char chunk[14]; int cpos = 0;
-                        lfn_extract_chars(lfn->name1, 5, chunk, &cpos, 14);
-                        lfn_extract_chars(lfn->name2, 6, chunk, &cpos, 14);
-                        lfn_extract_chars(lfn->name3, 2, chunk, &cpos, 14);
-                        for (int ci = 0; ci < cpos && (char_start+ci) < RDCACHE_NAME-1; ci++)
-                            pending_lfn[char_start + ci] = chunk[ci];
-                        int total_chars = pending_lfn_seq * 13;
-                        if (total_chars < RDCACHE_NAME)
-                            pending_lfn[total_chars] = '\0';
-                        else
-                            pending_lfn[RDCACHE_NAME - 1] = '\0';
-                        continue;
-                    }
-                    if (de->attr & FAT16_ATTR_VOLUMEID) {
-                        pending_lfn[0] = '\0'; pending_lfn_seq = 0;
-                        continue;
-                    }
-                    if (is_subdir) {
-                        if (de->name[0] == '.' && de->name[1] == ' ') {
-                            pending_lfn[0] = '\0'; continue;
-                        }
-                        if (de->name[0] == '.' && de->name[1] == '.' &&
-                            de->name[2] == ' ') {
-                            pending_lfn[0] = '\0'; continue;
-                        }
-                    }
-                    RDCACHE_ADD(de);
-                }
+                uint8_t *sec = bulk;
+                if (can_bulk)
+                    sec = bulk + s * FAT16_SECTOR_SIZE;
+                else if (ata_read_sector(base_lba + s, bulk) < 0)
+                    goto done;
+                if (fat16_list_sector(&ls, sec))
+                    goto done;
             }
             cl = fat16_get_entry(cl);
         }
     }
-#undef RDCACHE_ADD
 
 done:
     kfree(bulk);
-    rdcache.valid = 1;
-}
-
-// Check if the readdir cache is valid for the given path.
-static int rdcache_hit(const char *path) {
-    if (!rdcache.valid)
-        return 0;
-    const char *a = path ? path : "";
-    return (strcmp(a, rdcache.path) == 0);
+    return 0;
 }
 
-// Enumerate entries in a directory. Supports root and subdirectories.
-// Skips '.', '..', volume labels, LFN entries, and deleted entries.
-// Uses a cache: the first call (or path change) scans once; subsequent
-// calls return from cache in O(1).
-static int fat16_vfs_readdir(const char *path, int index, char *buf,
-                             uint32_t size) {
-    if (!g_fat.mounted || !buf || size == 0 || index < 0)
-        return 0;
-
-    // Populate cache on first call or path change
-    if (!rdcache_hit(path)) {
-        fat16_dir_loc_t dir;
-        if (fat16_resolve_dir(path, &dir) < 0)
-            return 0;
-        fat16_readdir_fill_cache(path, dir);
+// Mark LFN entries preceding a dirent as deleted.
+// Scans backward from `de_off` in the sector at `de_lba`, marking 0xE5.
+static void fat16_delete_preceding_lfn(uint32_t de_lba, uint16_t de_off) {
+    uint8_t sec[FAT16_SECTOR_SIZE];
+    if (ata_read_sector(de_lba, sec) < 0)
+        return;
+    int off = (int)de_off - 32;
+    int changed = 0;
+    while (off >= 0) {
+        fat16_dirent_t *e = (fat16_dirent_t *)(sec + off);
+        if (e->attr == FAT16_ATTR_LFN && e->name[0] != 0xE5) {
+            e->name[0] = 0xE5; // mark deleted
+            changed = 1;
+            off -= 32;
+        } else {
+            break;
+        }
     }
-
-    if (index >= rdcache.count)
-        return 0;
-
-    const char *name = rdcache.names[index];
-    size_t n = strlen(name);
-    if (n >= size) n = size - 1;
-    memcpy(buf, name, n);
-    buf[n] = '\0';
-    return (int)(n + 1);
+    if (changed)
+        ata_write_sector(de_lba, sec);
 }
 
 static int fat16_vfs_unlink(const char *path) {
     if (!g_fat.mounted || !path)
         return -1;
-    rdcache_invalidate(); // directory contents will change
 
     fat16_dirent_t de;
     uint32_t de_lba = 0;
@@ -1480,7 +1147,7 @@ static int fat16_vfs_unlink(const char *path) {
         return -1;
 
     if (de.first_cluster_lo >= 2) {
-        if (fat16_free_chain(de.first_cluster_lo) < 0)
+        if (fat_free_chain(&g_vol, de.first_cluster_lo) < 0)
             return -1;
     }
 
@@ -1491,6 +1158,7 @@ static int fat16_vfs_unlink(const char *path) {
     wde->name[0] = 0xE5; // 0xE5 = deleted entry marker
     if (ata_write_sector(de_lba, sec) < 0)
         return -1;
+    fat16_delete_preceding_lfn(de_lba, de_off);
 
     return 0;
 }
@@ -1499,7 +1167,6 @@ static int fat16_vfs_unlink(const char *path) {
 static int fat16_vfs_mkdir(const char *path) {
     if (!g_fat.mounted || !path)
         return -1;
-    rdcache_invalidate(); // directory contents will change
 
     fat16_dir_loc_t parent;
     fat16_dirent_t de;
@@ -1519,8 +1186,8 @@ static int fat16_vfs_mkdir(const char *path) {
         return -1;
 
     // Allocate a cluster for the new directory's contents
-    uint16_t new_cl;
-    if (fat16_alloc_cluster(&new_cl) < 0)
+    uint32_t new_cl;
+    if (fat_alloc_cluster(&g_vol, &new_cl) < 0)
         return -1;
 
     // Write '.' and '..' entries in the new cluster
@@ -1558,6 +1225,7 @@ static int fat16_vfs_mkdir(const char *path) {
     if (ata_write_sector(free_lba, sec) < 0)
         return -1;
 
+    dcache_invalidate_dir(&g_fat, parent.cluster);
     return 0;
 }
 
@@ -1565,7 +1233,6 @@ static int fat16_vfs_mkdir(const char *path) {
 static int fat16_vfs_rmdir(const char *path) {
     if (!g_fat.mounted || !path)
         return -1;
-    rdcache_invalidate(); // directory contents will change
 
     fat16_dirent_t de;
     uint32_t de_lba = 0;
@@ -1617,7 +1284,7 @@ done_check:
         return -1; // directory not empty
 
     // Free the directory's cluster chain
-    if (fat16_free_chain(cl) < 0)
+    if (fat_free_chain(&g_vol, cl) < 0)
         return -1;
 
     // Mark directory entry as deleted in parent
@@ -1627,39 +1294,20 @@ done_check:
     wde->name[0] = 0xE5; // 0xE5 = deleted entry marker
     if (ata_write_sector(de_lba, sec) < 0)
         return -1;
+    fat16_delete_preceding_lfn(de_lba, de_off);
 
+    // Entries cached under the removed directory must not survive cluster reuse.
+    dcache_invalidate_dir(&g_fat, cl);
     return 0;
 }
 
 // ---------------------------------------------------------------------------
 // Rename: move/rename a file or directory.
 // ---------------------------------------------------------------------------
-// Helper: mark LFN entries preceding a dirent as deleted.
-// Scans backward from `de_off` in the sector at `de_lba`, marking 0xE5.
-static void fat16_delete_preceding_lfn(uint32_t de_lba, uint16_t de_off) {
-    uint8_t sec[FAT16_SECTOR_SIZE];
-    if (ata_read_sector(de_lba, sec) < 0)
-        return;
-    int off = (int)de_off - 32;
-    int changed = 0;
-    while (off >= 0) {
-        fat16_dirent_t *e = (fat16_dirent_t *)(sec + off);
-        if (e->attr == FAT16_ATTR_LFN && e->name[0] != 0xE5) {
-            e->name[0] = 0xE5; // mark deleted
-            changed = 1;
-            off -= 32;
-        } else {
-            break;
-        }
-    }
-    if (changed)
-        ata_write_sector(de_lba, sec);
-}
 
 static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
     if (!g_fat.mounted || !oldpath || !newpath)
         return -1;
-    rdcache_invalidate();
 
     // Resolve old path
     fat16_dir_loc_t old_parent;
@@ -1673,7 +1321,7 @@ static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
         return -1; // old path doesn't exist
 
     // Resolve new path (parent must exist)
-    fat16_dir_loc_t new_parent;
+    fat16_dir_loc_t new_parent = {.cluster = 0};
     fat16_dirent_t new_de;
     uint32_t new_lba = 0, new_free_lba = 0;
     uint16_t new_off = 0, new_free_off = 0;
@@ -1681,6 +1329,9 @@ static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
     int new_rc = fat16_resolve_path(newpath, &new_parent, &new_de, &new_lba,
                                     &new_off, new_name83, &new_free_lba,
                                     &new_free_off);
+    // The new name is about to exist in new_parent; no name lookups follow,
+    // so drop its cached entries now.
+    dcache_invalidate_dir(&g_fat, new_parent.cluster);
 
     // Extract new filename component
     const char *new_fname = newpath;
@@ -1693,7 +1344,7 @@ static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
             return -1; // can't overwrite directory
         // Delete the existing target file first
         if (new_de.first_cluster_lo >= 2)
-            fat16_free_chain(new_de.first_cluster_lo);
+            fat_free_chain(&g_vol, new_de.first_cluster_lo);
         {
             uint8_t sec[FAT16_SECTOR_SIZE];
             if (ata_read_sector(new_lba, sec) < 0) return -1;
@@ -1711,19 +1362,19 @@ static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
     int same_parent = (old_parent.cluster == new_parent.cluster);
 
     // Build new 8.3 name (may need LFN)
-    int new_need_lfn = (fat16_name_to_83(new_fname, new_name83) < 0);
+    int new_need_lfn = (fat_name_to_83(new_fname, new_name83) < 0);
     uint8_t actual_new83[11];
     if (new_need_lfn) {
         int suffix = 1;
-        while (suffix <= 9) {
+        while (suffix <= FAT_ALIAS_MAX) {
             fat16_dirent_t check_de;
-            fat16_make_short_alias(new_fname, actual_new83, suffix);
+            fat_make_short_alias(new_fname, actual_new83, suffix);
             if (fat16_lookup_in_dir(new_parent, actual_new83, NULL,
                                     &check_de, NULL, NULL, NULL, NULL) < 0)
                 break;
             suffix++;
         }
-        if (suffix > 9) return -1;
+        if (suffix > FAT_ALIAS_MAX) return -1;
     } else {
         memcpy(actual_new83, new_name83, 11);
     }
@@ -1751,10 +1402,10 @@ static int fat16_vfs_rename(const char *oldpath, const char *newpath) {
         if (new_need_lfn) {
             int fname_len = (int)strlen(new_fname);
             int lfn_count = (fname_len + 12) / 13;
-            uint8_t checksum = lfn_checksum(actual_new83);
+            uint8_t checksum = fat_lfn_checksum(actual_new83);
             int can_fit = (new_free_off + (uint16_t)((lfn_count + 1) * 32) <= FAT16_SECTOR_SIZE);
             if (can_fit) {
-                lfn_write_entries(sec, (int)new_free_off, lfn_count, new_fname, checksum);
+                fat_lfn_write_entries(sec, (int)new_free_off, lfn_count, new_fname, checksum);
                 int short_off = (int)new_free_off + lfn_count * 32;
                 fat16_dirent_t *nde = (fat16_dirent_t *)(sec + short_off);
                 *nde = old_de;
@@ -1818,42 +1469,42 @@ static int fat16_vfs_ftruncate(int handle, uint32_t length) {
         if (length == 0) {
             // Free entire chain
             if (f->first_cluster >= 2) {
-                if (fat16_free_chain(f->first_cluster) < 0)
+                if (fat_free_chain(&g_vol, f->first_cluster) < 0)
                     return -1;
                 f->first_cluster = 0;
             }
         } else {
-            // Walk to the cluster containing (length - 1), set its FAT entry
+            // Find the cluster containing (length - 1), set its FAT entry
             // to EOC, free the rest.
             uint32_t keep_idx = (length - 1) / cluster_size;
-            uint16_t cl = f->first_cluster;
-            for (uint32_t i = 0; i < keep_idx; i++) {
-                uint16_t next = fat16_get_entry(cl);
-                if (next >= 0xFFF8 || next < 2)
-                    break;
-                cl = next;
-            }
+            uint32_t cl, run;
+            if (fat_extents_map(&g_vol, &f->ext, f->first_cluster, keep_idx, 1,
+                                &cl, &run) < 0)
+                return -1;
             // Free everything after cl
-            uint16_t next = fat16_get_entry(cl);
-            if (fat16_set_entry(cl, FAT16_EOC) < 0)
+            uint32_t next = fat16_get_entry(cl);
+            if (fat_set_entry(&g_vol, cl, FAT16_EOC) < 0)
                 return -1;
-            if (next >= 2 && next < 0xFFF8)
-                fat16_free_chain(next);
+            if (fat_valid_cluster(&g_vol, next))
+                fat_free_chain(&g_vol, next);
         }
 
         f->size = length;
         if (f->pos > length)
             f->pos = length;
+        fat_extents_reset(&f->ext);
+        fat16_chain_changed(f);
     } else {
         // Grow: allocate clusters until we reach `length`.
-        // New clusters from fat16_alloc_cluster are zeroed.  Bytes within
-        // the existing last cluster beyond old_size are zeroed here via
-        // read-modify-write on the sector(s) spanning [old_size, cluster_end).
+        // New clusters are allocated zeroed.  Bytes within the existing last
+        // cluster beyond old_size are zeroed here via read-modify-write on
+        // the sector(s) spanning [old_size, cluster_end).
         uint32_t old_size = f->size;
         uint32_t need_clusters = (length + cluster_size - 1) / cluster_size;
         if (need_clusters == 0) need_clusters = 1;
-        uint16_t cl;
-        if (fat16_ensure_cluster_for_index(f, need_clusters - 1, &cl) < 0)
+        uint32_t cl, run;
+        if (fat_extents_grow(&g_vol, &f->ext, &f->first_cluster,
+                             need_clusters - 1, 1, 1, &cl, &run) < 0)
             return -1;
         f->size = length;
 
@@ -1861,26 +1512,23 @@ static int fat16_vfs_ftruncate(int handle, uint32_t length) {
         // lesser of the cluster boundary and the new length).
         if (old_size > 0 && old_size < length) {
             uint32_t old_cl_idx = (old_size - 1) / cluster_size;
-            uint32_t cl_end = (old_cl_idx + 1) * cluster_size;
+            uint32_t cl_start = old_cl_idx * cluster_size;
+            uint32_t cl_end = cl_start + cluster_size;
             uint32_t zero_end = cl_end < length ? cl_end : length;
-            if (old_size < zero_end) {
-                // Walk FAT chain to old last cluster
-                uint16_t zcl = f->first_cluster;
-                for (uint32_t i = 0; i < old_cl_idx; i++) {
-                    uint16_t next = fat16_get_entry(zcl);
-                    if (next >= 0xFFF8 || next < 2) break;
-                    zcl = next;
-                }
+            uint32_t zcl;
+            if (old_size < zero_end &&
+                fat_extents_map(&g_vol, &f->ext, f->first_cluster, old_cl_idx,
+                                1, &zcl, &run) == 0) {
                 uint32_t lba = cluster_to_lba(zcl);
                 // Iterate over affected sectors within the cluster
                 uint32_t pos = old_size;
                 while (pos < zero_end) {
-                    uint32_t sec = pos / FAT16_SECTOR_SIZE;
+                    uint32_t sec = (pos - cl_start) / FAT16_SECTOR_SIZE;
                     uint32_t boff = pos % FAT16_SECTOR_SIZE;
+                    uint32_t sec_end = cl_start + (sec + 1) * FAT16_SECTOR_SIZE;
                     uint32_t bend = FAT16_SECTOR_SIZE;
-                    uint32_t sec_end = (sec + 1) * FAT16_SECTOR_SIZE;
-                    if (sec_end > zero_end) bend = zero_end % FAT16_SECTOR_SIZE;
-                    if (bend == 0) bend = FAT16_SECTOR_SIZE;
+                    if (sec_end > zero_end)
+                        bend = FAT16_SECTOR_SIZE - (sec_end - zero_end);
                     uint8_t sec_buf[FAT16_SECTOR_SIZE];
                     if (ata_read_sector(lba + sec, sec_buf) == 0) {
                         for (uint32_t b = boff; b < bend; b++) sec_buf[b] = 0;
@@ -1907,7 +1555,7 @@ static const vfs_fs_ops_t fat16_ops = {
     .close = fat16_vfs_close,
     .seek = fat16_vfs_seek,
     .stat = fat16_vfs_stat,
-    .readdir = fat16_vfs_readdir,
+    .listdir = fat16_vfs_listdir,
     .unlink = fat16_vfs_unlink,
     .mkdir = fat16_vfs_mkdir,
     .rmdir = fat16_vfs_rmdir,
@@ -1949,6 +1597,11 @@ static int fat16_try_mount_at(uint32_t part_lba) {
     if (clusters < 4085 || clusters >= 65525)
         return -1;
 
+    // Never address clusters the FAT itself has no entries for.
+    uint32_t fat_entries = (uint32_t)b->sectors_per_fat_16 * (FAT16_SECTOR_SIZE / 2);
+    if (clusters + 2 > fat_entries)
+        clusters = fat_entries - 2;
+
     memset(&g_fat, 0, sizeof(g_fat));
     g_fat.mounted = 1;
     g_fat.part_lba = part_lba;
@@ -1966,9 +1619,19 @@ static int fat16_try_mount_at(uint32_t part_lba) {
     g_fat.cluster_count = clusters;
 
     memset(g_open, 0, sizeof(g_open));
+    blkcache_init(&g_bcache, fat16_disk_read, g_fat.data_start_lba,
+                  clusters * g_fat.sectors_per_cluster);
+
+    fat_vol_init(&g_vol, &fat16_vol_ops, 2, g_fat.fat_start_lba, clusters);
+    if (fat_build_free_map(&g_vol) < 0) {
+        printf("[fat16] free-cluster map allocation failed\n");
+        g_fat.mounted = 0;
+        return -1;
+    }
 
-    printf("[fat16] mounted at LBA %d (spc=%d, root_entries=%d)\n",
-           g_fat.part_lba, g_fat.sectors_per_cluster, g_fat.root_entry_count);
+    printf("[fat16] mounted at LBA %d (spc=%d, root_entries=%d, free=%d)\n",
+           g_fat.part_lba, g_fat.sectors_per_cluster, g_fat.root_entry_count,
+           g_vol.free_count);
     return 0;
 }
 
@@ -1976,6 +1639,7 @@ int fat16_init(void) {
     memset(&g_fat, 0, sizeof(g_fat));
     memset(g_open, 0, sizeof(g_open));
     fat_cache_invalidate();
+    dcache_invalidate_owner(&g_fat);
 
     if (ata_pio_init() < 0) {
         printf("[fat16] ATA PIO disk not found\n");
@@ -2005,3 +1669,17 @@ int fat16_init(void) {
 }
 
 const vfs_fs_ops_t *fat16_get_ops(void) { return &fat16_ops; }
+
+void fat16_get_stats(fat16_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!g_fat.mounted)
+        return;
+    out->mounted = 1;
+    out->cluster_count = g_fat.cluster_count;
+    out->free_clusters = g_vol.free_count;
+    out->cluster_size = g_fat.sectors_per_cluster * FAT16_SECTOR_SIZE;
+    out->cache_blocks = blkcache_enabled(&g_bcache) ? BLKCACHE_BLOCKS : 0;
+    out->cache_hits = g_bcache.hits;
+    out->cache_misses = g_bcache.misses;
+    out->cache_prefetched = g_bcache.prefetched;
+}
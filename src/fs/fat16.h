@@ -10,4 +10,18 @@ int fat16_init(void);
 // Access VFS backend ops for FAT16.
 const vfs_fs_ops_t *fat16_get_ops(void);
 
+typedef struct {
+    uint32_t mounted;
+    uint32_t cluster_count;
+    uint32_t free_clusters;
+    uint32_t cluster_size;
+    uint32_t cache_blocks;     // data block cache size (4KB blocks)
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t cache_prefetched; // blocks loaded by read-ahead
+} fat16_stats_t;
+
+// Snapshot of volume and block-cache counters (for mos/kvfs).
+void fat16_get_stats(fat16_stats_t *out);
+
 #endif
@@ -0,0 +1,1412 @@
+#include "fat32.h"
+#include "blkcache.h"
+#include "dcache.h"
+#include "fatcommon.h"
+#include "drivers/ata_pio.h"
+#include "lib.h"
+#include "liballoc/liballoc_1_1.h"
+#include "vfs.h"
+
+#define FAT32_SECTOR_SIZE 512
+#define FAT32_MAX_OPEN 16
+#define FAT32_ATA_DRIVE 1 // primary slave
+
+#define FAT32_ATTR_READONLY 0x01
+#define FAT32_ATTR_HIDDEN 0x02
+#define FAT32_ATTR_SYSTEM 0x04
+#define FAT32_ATTR_VOLUMEID 0x08
+#define FAT32_ATTR_DIR 0x10
+#define FAT32_ATTR_ARCHIVE 0x20
+#define FAT32_ATTR_LFN 0x0F
+
+// FAT32 entries are 28 bits; the top nibble is reserved and preserved.
+#define FAT32_MASK 0x0FFFFFFFu
+#define FAT32_EOC 0x0FFFFFFFu
+#define FAT32_IS_EOC(c) ((c) >= 0x0FFFFFF8u)
+
+#define FAT32_FSINFO_LEAD 0x41615252u
+#define FAT32_FSINFO_STRUCT 0x61417272u
+#define FAT32_FSINFO_UNKNOWN 0xFFFFFFFFu
+
+// Extra open flags (must match vfs.h / userland/syscalls.h)
+#define O_APPEND 0x10
+
+typedef struct __attribute__((packed)) {
+    uint8_t jump[3];
+    uint8_t oem[8];
+    uint16_t bytes_per_sector;
+    uint8_t sectors_per_cluster;
+    uint16_t reserved_sector_count;
+    uint8_t fat_count;
+    uint16_t root_entry_count; // 0 on FAT32
+    uint16_t total_sectors_16;
+    uint8_t media;
+    uint16_t sectors_per_fat_16; // 0 on FAT32
+    uint16_t sectors_per_track;
+    uint16_t num_heads;
+    uint32_t hidden_sectors;
+    uint32_t total_sectors_32;
+    // FAT32 extended BPB
+    uint32_t sectors_per_fat_32;
+    uint16_t ext_flags; // bit 7 = mirroring off, bits 0-3 = active FAT
+    uint16_t fs_version;
+    uint32_t root_cluster;
+    uint16_t fs_info_sector;
+    uint16_t backup_boot_sector;
+    uint8_t reserved[12];
+    uint8_t drive_number;
+    uint8_t reserved1;
+    uint8_t boot_sig;
+    uint32_t volume_id;
+    uint8_t volume_label[11];
+    uint8_t fs_type[8];
+} fat32_bpb_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t lead_sig;
+    uint8_t reserved1[480];
+    uint32_t struct_sig;
+    uint32_t free_count; // last known free cluster count, or 0xFFFFFFFF
+    uint32_t next_free;  // hint for the next free cluster, or 0xFFFFFFFF
+    uint8_t reserved2[12];
+    uint32_t trail_sig;
+} fat32_fsinfo_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t name[11];
+    uint8_t attr;
+    uint8_t ntres;
+    uint8_t crt_time_tenth;
+    uint16_t crt_time;
+    uint16_t crt_date;
+    uint16_t last_access_date;
+    uint16_t first_cluster_hi;
+    uint16_t wrt_time;
+    uint16_t wrt_date;
+    uint16_t first_cluster_lo;
+    uint32_t file_size;
+} fat32_dirent_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t status;
+    uint8_t chs_first[3];
+    uint8_t type;
+    uint8_t chs_last[3];
+    uint32_t lba_first;
+    uint32_t sector_count;
+} fat32_mbr_part_t;
+
+typedef struct {
+    int mounted;
+    uint32_t part_lba;
+    uint32_t fat_start_lba; // FAT read by lookups (the active one)
+    uint32_t data_start_lba;
+    uint32_t sectors_per_fat;
+    uint32_t total_sectors;
+    uint32_t cluster_count;
+    uint32_t root_cluster;
+    uint32_t fsinfo_lba; // 0 = no FSInfo sector
+    uint32_t mirror_lba; // first FAT copy written on updates
+    uint8_t fat_count;   // FAT copies written on updates
+    uint8_t sectors_per_cluster;
+} fat32_state_t;
+
+typedef struct {
+    int in_use;
+    int flags;
+    uint32_t first_cluster;
+    uint32_t size;
+    uint32_t pos;
+    uint8_t attr;
+    uint32_t dirent_lba;
+    uint16_t dirent_off;
+    fat_extents_t ext;
+    blkcache_stream_t ra;
+} fat32_open_t;
+
+// Sector-by-sector position in a directory's cluster chain.
+typedef struct {
+    uint32_t cluster; // 0 = end of chain
+    uint32_t sec;     // sector within cluster
+    uint32_t steps;   // clusters visited, bounds corrupt chains
+} fat32_dirpos_t;
+
+static fat32_state_t g_fat32;
+static fat32_open_t g_open32[FAT32_MAX_OPEN];
+static blkcache_t g_bcache32;
+// Allocator state (fatcommon.c). free_count/next_free are the FSInfo hints,
+// kept in memory and written back by fat32_fsinfo_flush.
+static fat_vol_t g_vol32;
+
+
+// ---------------------------------------------------------------------------
+// Disk access — every write invalidates the block cache and dentry cache
+// ranges it touches.
+// ---------------------------------------------------------------------------
+static int fat32_disk_read(uint32_t lba, uint32_t count, void *out) {
+    return ata_pio_read_drive(FAT32_ATA_DRIVE, lba, (uint8_t)count, out);
+}
+
+static int fat32_disk_write(uint32_t lba, uint32_t count, const void *in) {
+    blkcache_invalidate_range(&g_bcache32, lba, count);
+    dcache_invalidate_range(&g_fat32, lba, count);
+    return ata_pio_write_drive(FAT32_ATA_DRIVE, lba, (uint8_t)count, in);
+}
+
+static int fat32_read_sector(uint32_t lba, uint8_t *out) {
+    return fat32_disk_read(lba, 1, out);
+}
+
+static int fat32_write_sector(uint32_t lba, const uint8_t *in) {
+    return fat32_disk_write(lba, 1, in);
+}
+
+// Directory sectors live in the data region, so they go through the block
+// cache too: repeated path lookups then cost no disk I/O.
+static int fat32_read_dir_sector(uint32_t lba, uint8_t *out) {
+    if (blkcache_read(&g_bcache32, lba, 0, 1, FAT32_SECTOR_SIZE, out,
+                      FAT32_SECTOR_SIZE) == FAT32_SECTOR_SIZE)
+        return 0;
+    return fat32_read_sector(lba, out);
+}
+
+static uint32_t cluster_to_lba(uint32_t cluster) {
+    return g_fat32.data_start_lba +
+           (cluster - 2) * g_fat32.sectors_per_cluster;
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint32_t dirent_cluster(const fat32_dirent_t *de) {
+    return ((uint32_t)de->first_cluster_hi << 16) | de->first_cluster_lo;
+}
+
+static void dirent_set_cluster(fat32_dirent_t *de, uint32_t cluster) {
+    de->first_cluster_hi = (uint16_t)(cluster >> 16);
+    de->first_cluster_lo = (uint16_t)(cluster & 0xFFFF);
+}
+
+// ---------------------------------------------------------------------------
+// FAT sector cache (same scheme as fat16.c).
+// ---------------------------------------------------------------------------
+#define FAT32_FAT_CACHE_SIZE 8
+static struct {
+    uint32_t lba; // 0 = unused
+    uint8_t data[FAT32_SECTOR_SIZE];
+} fat32_fat_cache[FAT32_FAT_CACHE_SIZE];
+static int fat32_fat_cache_next;
+
+static void fat32_fat_cache_invalidate(void) {
+    for (int i = 0; i < FAT32_FAT_CACHE_SIZE; i++)
+        fat32_fat_cache[i].lba = 0;
+    fat32_fat_cache_next = 0;
+}
+
+static uint8_t *fat32_fat_cache_get(uint32_t lba) {
+    for (int i = 0; i < FAT32_FAT_CACHE_SIZE; i++) {
+        if (fat32_fat_cache[i].lba == lba)
+            return fat32_fat_cache[i].data;
+    }
+    int slot = fat32_fat_cache_next;
+    fat32_fat_cache_next = (fat32_fat_cache_next + 1) % FAT32_FAT_CACHE_SIZE;
+    fat32_fat_cache[slot].lba = 0;
+    if (fat32_read_sector(lba, fat32_fat_cache[slot].data) < 0)
+        return NULL;
+    fat32_fat_cache[slot].lba = lba;
+    return fat32_fat_cache[slot].data;
+}
+
+static void fat32_fat_cache_update(uint32_t lba, const uint8_t *data) {
+    for (int i = 0; i < FAT32_FAT_CACHE_SIZE; i++) {
+        if (fat32_fat_cache[i].lba == lba)
+            memcpy(fat32_fat_cache[i].data, data, FAT32_SECTOR_SIZE);
+    }
+}
+
+static uint32_t fat32_get_entry(uint32_t cluster) {
+    uint32_t fat_offset = cluster * 4;
+    uint8_t *sec =
+        fat32_fat_cache_get(g_fat32.fat_start_lba + fat_offset / FAT32_SECTOR_SIZE);
+    if (!sec)
+        return FAT32_EOC;
+    return read_u32(sec + fat_offset % FAT32_SECTOR_SIZE) & FAT32_MASK;
+}
+
+static int fat32_fat_load(uint32_t rel, uint8_t *sec) {
+    uint8_t *cached = fat32_fat_cache_get(g_fat32.fat_start_lba + rel);
+    if (!cached)
+        return -1;
+    memcpy(sec, cached, FAT32_SECTOR_SIZE);
+    return 0;
+}
+
+// Write an edited FAT sector to every mirrored FAT copy and refresh the cache.
+static int fat32_fat_store(uint32_t rel, const uint8_t *sec) {
+    for (uint8_t fat_i = 0; fat_i < g_fat32.fat_count; fat_i++) {
+        uint32_t lba =
+            g_fat32.mirror_lba + fat_i * g_fat32.sectors_per_fat + rel;
+        if (fat32_write_sector(lba, sec) < 0)
+            return -1;
+    }
+    fat32_fat_cache_update(g_fat32.fat_start_lba + rel, sec);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// FSInfo — free count and next-free hint. FAT32 volumes can have millions
+// of clusters, so instead of a free bitmap the allocator scans the FAT from
+// the next-free hint and the hints are persisted for the next mount.
+// ---------------------------------------------------------------------------
+static int fat32_fsinfo_flush(void) {
+    if (!g_vol32.free_dirty || g_fat32.fsinfo_lba == 0)
+        return 0;
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    if (fat32_read_sector(g_fat32.fsinfo_lba, sec) < 0)
+        return -1;
+    fat32_fsinfo_t *fi = (fat32_fsinfo_t *)sec;
+    if (fi->lead_sig != FAT32_FSINFO_LEAD ||
+        fi->struct_sig != FAT32_FSINFO_STRUCT)
+        return -1;
+    fi->free_count = g_vol32.free_count;
+    fi->next_free = g_vol32.next_free;
+    if (fat32_write_sector(g_fat32.fsinfo_lba, sec) < 0)
+        return -1;
+    g_vol32.free_dirty = 0;
+    return 0;
+}
+
+// Largest transfer issued as one ATA command (count register is 8 bits).
+#define FAT32_MAX_IO_SECTORS 128
+
+static const uint8_t fat32_zero_block[FAT32_SECTOR_SIZE * 8];
+
+static int fat32_zero_clusters(uint32_t first, uint32_t count) {
+    uint32_t lba = cluster_to_lba(first);
+    uint32_t left = count * g_fat32.sectors_per_cluster;
+    while (left > 0) {
+        uint32_t n = (left > 8) ? 8 : left;
+        if (fat32_disk_write(lba, n, fat32_zero_block) < 0)
+            return -1;
+        lba += n;
+        left -= n;
+    }
+    return 0;
+}
+
+static const fat_vol_ops_t fat32_vol_ops = {
+    .get_entry = fat32_get_entry,
+    .fat_load = fat32_fat_load,
+    .fat_store = fat32_fat_store,
+    .disk_read = fat32_disk_read,
+    .zero_clusters = fat32_zero_clusters,
+};
+
+static void fat32_chain_changed(const fat32_open_t *src) {
+    for (int i = 0; i < FAT32_MAX_OPEN; i++) {
+        fat32_open_t *o = &g_open32[i];
+        if (!o->in_use || o == src || o->dirent_lba != src->dirent_lba ||
+            o->dirent_off != src->dirent_off)
+            continue;
+        o->first_cluster = src->first_cluster;
+        if (o->size > src->size)
+            o->size = src->size;
+        if (o->pos > o->size)
+            o->pos = o->size;
+        fat_extents_reset(&o->ext);
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Directories — every directory, including the root, is a cluster chain.
+// ---------------------------------------------------------------------------
+static void fat32_dirpos_init(fat32_dirpos_t *p, uint32_t dir_cluster) {
+    p->cluster = fat_valid_cluster(&g_vol32, dir_cluster) ? dir_cluster : 0;
+    p->sec = 0;
+    p->steps = 0;
+}
+
+// Step to the next sector of a directory. Returns 1 with *lba set, or 0
+// at the end of the chain.
+static int fat32_dirpos_next(fat32_dirpos_t *p, uint32_t *lba) {
+    if (p->cluster == 0)
+        return 0;
+    *lba = cluster_to_lba(p->cluster) + p->sec;
+    if (++p->sec >= g_fat32.sectors_per_cluster) {
+        p->sec = 0;
+        uint32_t next = fat32_get_entry(p->cluster);
+        if (!fat_valid_cluster(&g_vol32, next) || ++p->steps > g_fat32.cluster_count)
+            next = 0;
+        p->cluster = next;
+    }
+    return 1;
+}
+
+// Look up `name` in a directory, matching the long name or the 8.3 name
+// (case-insensitive). If `name83` is given, only that exact short name
+// matches (alias collision checks). Returns 0 when found.
+static int fat32_lookup_in_dir(uint32_t dir, const char *name,
+                               const uint8_t *name83, fat32_dirent_t *out,
+                               uint32_t *out_lba, uint16_t *out_off) {
+    // Dentry cache for lookups by name (alias checks pass name83 instead).
+    fat32_dirent_t found;
+    uint32_t found_lba = 0;
+    uint16_t found_off = 0;
+    if (!out) out = &found;
+    if (!out_lba) out_lba = &found_lba;
+    if (!out_off) out_off = &found_off;
+    if (!name83) {
+        dcache_hit_t hit;
+        int dc = dcache_lookup(&g_fat32, dir, name, &hit);
+        if (dc == DCACHE_FOUND) {
+            memcpy(out, hit.dirent, sizeof(*out));
+            *out_lba = hit.lba;
+            *out_off = hit.off;
+            return 0;
+        }
+        if (dc == DCACHE_NEGATIVE)
+            return -1;
+    }
+
+    uint8_t want83[11];
+    int have83 = 0;
+    if (name83) {
+        memcpy(want83, name83, 11);
+        have83 = 1;
+    } else if (fat_name_to_83(name, want83) == 0) {
+        have83 = 1;
+    }
+
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    char pending[FAT_NAME_MAX];
+    int pending_seq = 0;
+    pending[0] = '\0';
+    fat32_dirpos_t pos;
+    uint32_t lba;
+    fat32_dirpos_init(&pos, dir);
+    while (fat32_dirpos_next(&pos, &lba)) {
+        if (fat32_read_dir_sector(lba, sec) < 0)
+            return -1;
+        for (int off = 0; off < FAT32_SECTOR_SIZE; off += 32) {
+            const fat32_dirent_t *de = (const fat32_dirent_t *)(sec + off);
+            if (de->name[0] == 0x00)
+                goto not_found;
+            if (de->name[0] == 0xE5 ||
+                (de->attr != FAT32_ATTR_LFN && (de->attr & FAT32_ATTR_VOLUMEID))) {
+                pending_seq = 0;
+                continue;
+            }
+            if (de->attr == FAT32_ATTR_LFN) {
+                fat_lfn_accumulate((const fat_lfn_t *)de, pending,
+                                     &pending_seq);
+                continue;
+            }
+            int matched = have83 && memcmp(de->name, want83, 11) == 0;
+            if (!matched && !name83 && pending_seq > 0)
+                matched = fat_name_eq_nocase(pending, name);
+            pending_seq = 0;
+            if (matched) {
+                *out = *de;
+                *out_lba = lba;
+                *out_off = (uint16_t)off;
+                if (!name83)
+                    dcache_insert(&g_fat32, dir, name, out, lba, (uint16_t)off);
+                return 0;
+            }
+        }
+    }
+not_found:
+    if (!name83)
+        dcache_insert(&g_fat32, dir, name, NULL, 0, 0);
+    return -1;
+}
+
+// Strip the /data mount prefix. Returns the path inside the volume ("" for
+// the volume root) or NULL when the path belongs to another filesystem.
+static const char *fat32_strip_mount(const char *path) {
+    if (!path)
+        return NULL;
+    while (*path == '/')
+        path++;
+    size_t n = strlen(FAT32_MOUNT_NAME);
+    if (strncmp(path, FAT32_MOUNT_NAME, n) != 0)
+        return NULL;
+    if (path[n] != '\0' && path[n] != '/')
+        return NULL;
+    path += n;
+    while (*path == '/')
+        path++;
+    return path;
+}
+
+// Resolve a volume-relative path. Returns 0 if the final entry was found,
+// -1 if not (*parent is still set when the parent exists, and *leaf points
+// at the final component), -2 for the volume root itself.
+static int fat32_resolve_path(const char *rel, uint32_t *parent,
+                              const char **leaf, fat32_dirent_t *de,
+                              uint32_t *de_lba, uint16_t *de_off) {
+    if (parent) *parent = 0;
+    if (*rel == '\0')
+        return -2;
+
+    uint32_t cur = g_fat32.root_cluster;
+    while (1) {
+        const char *end = rel;
+        while (*end && *end != '/')
+            end++;
+        int len = (int)(end - rel);
+        if (len >= FAT_NAME_MAX)
+            return -1;
+        char comp[FAT_NAME_MAX];
+        memcpy(comp, rel, (size_t)len);
+        comp[len] = '\0';
+
+        const char *rest = end;
+        while (*rest == '/')
+            rest++;
+
+        if (*rest == '\0') {
+            if (parent) *parent = cur;
+            if (leaf) *leaf = rel;
+            return fat32_lookup_in_dir(cur, comp, NULL, de, de_lba, de_off);
+        }
+
+        fat32_dirent_t d;
+        if (fat32_lookup_in_dir(cur, comp, NULL, &d, NULL, NULL) < 0)
+            return -1;
+        if (!(d.attr & FAT32_ATTR_DIR))
+            return -1;
+        cur = dirent_cluster(&d);
+        if (cur == 0)
+            cur = g_fat32.root_cluster; // ".." of a top-level directory
+        rel = rest;
+    }
+}
+
+// Append a new zeroed cluster to a directory chain ending at `tail`.
+static int fat32_dir_extend(uint32_t tail, uint32_t *out_lba) {
+    uint32_t cl;
+    if (fat_alloc_cluster(&g_vol32, &cl) < 0)
+        return -1;
+    if (fat_set_entry(&g_vol32, tail, cl) < 0) {
+        fat_free_chain(&g_vol32, cl);
+        return -1;
+    }
+    *out_lba = cluster_to_lba(cl);
+    return 0;
+}
+
+// Find `slots` consecutive free entries inside one sector of `dir`,
+// growing the directory by a cluster when it is full.
+static int fat32_dir_find_slots(uint32_t dir, int slots, uint32_t *out_lba,
+                                uint16_t *out_off) {
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    fat32_dirpos_t pos;
+    uint32_t lba;
+    uint32_t tail = dir;
+    fat32_dirpos_init(&pos, dir);
+    while (1) {
+        uint32_t cur_cluster = pos.cluster;
+        if (!fat32_dirpos_next(&pos, &lba))
+            break;
+        tail = cur_cluster;
+        if (fat32_read_dir_sector(lba, sec) < 0)
+            return -1;
+        int run = 0;
+        int end_off = -1; // first 0x00 (end-of-directory) entry
+        for (int off = 0; off < FAT32_SECTOR_SIZE; off += 32) {
+            uint8_t b = sec[off];
+            if (b == 0x00 && end_off < 0)
+                end_off = off;
+            if (b == 0x00 || b == 0xE5) {
+                if (++run == slots) {
+                    *out_lba = lba;
+                    *out_off = (uint16_t)(off - (slots - 1) * 32);
+                    return 0;
+                }
+            } else {
+                run = 0;
+            }
+        }
+        // The entry goes in a later sector: the unused tail of this one
+        // must stop reading as end-of-directory.
+        if (end_off >= 0) {
+            for (int off = end_off; off < FAT32_SECTOR_SIZE; off += 32)
+                sec[off] = 0xE5;
+            if (fat32_write_sector(lba, sec) < 0)
+                return -1;
+        }
+    }
+    if (fat32_dir_extend(tail, out_lba) < 0)
+        return -1;
+    *out_off = 0;
+    return 0;
+}
+
+// Create a directory entry for `name` in `dir`, with VFAT long-name entries
+// when the name is not a valid 8.3 name. `tmpl` supplies attr/cluster/size.
+static int fat32_dir_add(uint32_t dir, const char *name,
+                         const fat32_dirent_t *tmpl, fat32_dirent_t *out,
+                         uint32_t *out_lba, uint16_t *out_off) {
+    uint8_t name83[11];
+    int lfn_count = 0;
+    if (fat_name_to_83(name, name83) < 0) {
+        int len = (int)strlen(name);
+        if (len == 0 || len >= FAT_NAME_MAX)
+            return -1;
+        int suffix = 1;
+        for (; suffix <= FAT_ALIAS_MAX; suffix++) {
+            fat_make_short_alias(name, name83, suffix);
+            if (fat32_lookup_in_dir(dir, NULL, name83, NULL, NULL, NULL) < 0)
+                break;
+        }
+        if (suffix > FAT_ALIAS_MAX)
+            return -1;
+        lfn_count = (len + 12) / 13;
+    }
+
+    uint32_t lba;
+    uint16_t off;
+    if (fat32_dir_find_slots(dir, lfn_count + 1, &lba, &off) < 0)
+        return -1;
+
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    if (fat32_read_dir_sector(lba, sec) < 0)
+        return -1;
+    if (lfn_count > 0)
+        fat_lfn_write_entries(sec, off, lfn_count, name,
+                              fat_lfn_checksum(name83));
+    uint16_t short_off = (uint16_t)(off + lfn_count * 32);
+    fat32_dirent_t *nde = (fat32_dirent_t *)(sec + short_off);
+    *nde = *tmpl;
+    memcpy(nde->name, name83, 11);
+    if (fat32_write_sector(lba, sec) < 0)
+        return -1;
+    dcache_invalidate_dir(&g_fat32, dir);
+
+    if (out) *out = *nde;
+    if (out_lba) *out_lba = lba;
+    if (out_off) *out_off = short_off;
+    return 0;
+}
+
+// Mark a short entry and the LFN entries before it (same sector) deleted.
+static int fat32_dir_remove(uint32_t lba, uint16_t off) {
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    if (fat32_read_dir_sector(lba, sec) < 0)
+        return -1;
+    sec[off] = 0xE5;
+    for (int o = (int)off - 32; o >= 0; o -= 32) {
+        fat32_dirent_t *e = (fat32_dirent_t *)(sec + o);
+        if (e->attr != FAT32_ATTR_LFN || e->name[0] == 0xE5)
+            break;
+        e->name[0] = 0xE5;
+    }
+    return fat32_write_sector(lba, sec);
+}
+
+static int fat32_update_dirent(fat32_open_t *f) {
+    if (f->dirent_lba == 0)
+        return -1;
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    if (fat32_read_dir_sector(f->dirent_lba, sec) < 0)
+        return -1;
+    fat32_dirent_t *de = (fat32_dirent_t *)(sec + f->dirent_off);
+    dirent_set_cluster(de, f->first_cluster);
+    de->file_size = f->size;
+    de->attr = f->attr;
+    return fat32_write_sector(f->dirent_lba, sec);
+}
+
+// ---------------------------------------------------------------------------
+// File data
+// ---------------------------------------------------------------------------
+
+// Read from an open file (same strategy as fat16_read_file: small reads via
+// the block cache with read-ahead, large aligned spans straight into buf).
+static int fat32_read_file(fat32_open_t *f, uint32_t pos, void *buf,
+                           uint32_t len) {
+    if (len == 0 || !fat_valid_cluster(&g_vol32, f->first_cluster))
+        return 0;
+
+    blkcache_stream_note(&f->ra, pos);
+    int cached = blkcache_enabled(&g_bcache32) && len < BLKCACHE_DIRECT_BYTES;
+
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t spc = g_fat32.sectors_per_cluster;
+    uint32_t cluster_size = spc * FAT32_SECTOR_SIZE;
+    uint32_t done = 0;
+    uint8_t *bounce = NULL;
+
+    while (done < len) {
+        uint32_t abs_pos = pos + done;
+        uint32_t cl_idx = abs_pos / cluster_size;
+        uint32_t in_cl = abs_pos % cluster_size;
+        uint32_t want = (in_cl + (len - done) + cluster_size - 1) / cluster_size;
+        if (cached)
+            want += (f->ra.window * BLKCACHE_BYTES + cluster_size - 1) /
+                    cluster_size;
+
+        uint32_t cl, run;
+        if (fat_extents_map(&g_vol32, &f->ext, f->first_cluster, cl_idx, want,
+                            &cl, &run) < 0)
+            break;
+
+        uint32_t sec_in_cl = in_cl / FAT32_SECTOR_SIZE;
+        uint32_t sec_off = in_cl % FAT32_SECTOR_SIZE;
+        uint32_t lba = cluster_to_lba(cl) + sec_in_cl;
+        uint32_t run_secs = run * spc - sec_in_cl;
+
+        if (cached) {
+            uint32_t span =
+                blkcache_stream_span(&f->ra, len - done, f->size - abs_pos);
+            int n = blkcache_read(&g_bcache32, lba, sec_off, run_secs, span,
+                                  out + done, len - done);
+            if (n < 0)
+                break;
+            if (n > 0) {
+                done += (uint32_t)n;
+                continue;
+            }
+        }
+
+        if (sec_off == 0 && (len - done) >= FAT32_SECTOR_SIZE) {
+            uint32_t n = (len - done) / FAT32_SECTOR_SIZE;
+            if (n > run_secs) n = run_secs;
+            if (n > FAT32_MAX_IO_SECTORS) n = FAT32_MAX_IO_SECTORS;
+            if (fat32_disk_read(lba, n, out + done) < 0)
+                break;
+            done += n * FAT32_SECTOR_SIZE;
+        } else {
+            if (!bounce) {
+                bounce = (uint8_t *)kmalloc(FAT32_SECTOR_SIZE * 8);
+                if (!bounce)
+                    break;
+            }
+            uint32_t n = (sec_off + (len - done) + FAT32_SECTOR_SIZE - 1) /
+                         FAT32_SECTOR_SIZE;
+            if (n > run_secs) n = run_secs;
+            if (n > 8) n = 8;
+            if (fat32_disk_read(lba, n, bounce) < 0)
+                break;
+            uint32_t avail = n * FAT32_SECTOR_SIZE - sec_off;
+            uint32_t take = (avail < len - done) ? avail : len - done;
+            memcpy(out + done, bounce + sec_off, take);
+            done += take;
+        }
+    }
+
+    if (bounce) kfree(bounce);
+    f->ra.next_pos = pos + done;
+    return (int)done;
+}
+
+// ---------------------------------------------------------------------------
+// VFS operations
+// ---------------------------------------------------------------------------
+static int fat32_vfs_open(const char *path, int flags) {
+    const char *rel = fat32_strip_mount(path);
+    if (!g_fat32.mounted || !rel)
+        return -1;
+
+    int access = flags & 0x3;
+    if (!(access == O_RDONLY || access == O_WRONLY || access == O_RDWR))
+        return -1;
+
+    uint32_t parent;
+    const char *leaf;
+    fat32_dirent_t de;
+    uint32_t de_lba = 0;
+    uint16_t de_off = 0;
+    int rc = fat32_resolve_path(rel, &parent, &leaf, &de, &de_lba, &de_off);
+    if (rc == -2)
+        return -1; // can't open the volume root as a file
+
+    if (rc < 0) {
+        if (!(flags & O_CREAT) || parent == 0)
+            return -1;
+        fat32_dirent_t tmpl;
+        memset(&tmpl, 0, sizeof(tmpl));
+        tmpl.attr = FAT32_ATTR_ARCHIVE;
+        if (fat32_dir_add(parent, leaf, &tmpl, &de, &de_lba, &de_off) < 0)
+            return -1;
+    }
+
+    if (de.attr & FAT32_ATTR_DIR)
+        return -1;
+
+    int h = -1;
+    for (int i = 0; i < FAT32_MAX_OPEN; i++) {
+        if (!g_open32[i].in_use) {
+            h = i;
+            break;
+        }
+    }
+    if (h < 0)
+        return -1;
+
+    fat32_open_t *f = &g_open32[h];
+    memset(f, 0, sizeof(*f));
+    f->in_use = 1;
+    f->flags = flags;
+    f->first_cluster = dirent_cluster(&de);
+    f->size = de.file_size;
+    f->attr = de.attr;
+    f->dirent_lba = de_lba;
+    f->dirent_off = de_off;
+
+    // Truncate regular file when requested and writable.
+    if ((flags & O_TRUNC) && access != O_RDONLY && (f->size || f->first_cluster)) {
+        if (fat_valid_cluster(&g_vol32, f->first_cluster) &&
+            fat_free_chain(&g_vol32, f->first_cluster) < 0) {
+            f->in_use = 0;
+            return -1;
+        }
+        f->first_cluster = 0;
+        f->size = 0;
+        if (fat32_update_dirent(f) < 0) {
+            f->in_use = 0;
+            return -1;
+        }
+        fat32_chain_changed(f);
+    }
+    return h;
+}
+
+static fat32_open_t *fat32_handle(int handle) {
+    if (!g_fat32.mounted || handle < 0 || handle >= FAT32_MAX_OPEN)
+        return NULL;
+    if (!g_open32[handle].in_use)
+        return NULL;
+    return &g_open32[handle];
+}
+
+static int fat32_vfs_read(int handle, void *buf, uint32_t len) {
+    fat32_open_t *f = fat32_handle(handle);
+    if (!f || !buf || (f->flags & 0x3) == O_WRONLY)
+        return -1;
+    if (f->pos >= f->size)
+        return 0;
+    if (len > f->size - f->pos)
+        len = f->size - f->pos;
+    int n = fat32_read_file(f, f->pos, buf, len);
+    if (n > 0)
+        f->pos += (uint32_t)n;
+    return n;
+}
+
+static int fat32_vfs_write(int handle, const void *buf, uint32_t len) {
+    fat32_open_t *f = fat32_handle(handle);
+    if (!f || !buf || (f->flags & 0x3) == O_RDONLY)
+        return -1;
+    if (len == 0)
+        return 0;
+    if (f->flags & O_APPEND)
+        f->pos = f->size;
+    // Files are limited to 4GB - 1 by the 32-bit dirent size field.
+    if (len > 0xFFFFFFFFu - f->pos)
+        len = 0xFFFFFFFFu - f->pos;
+
+    uint32_t spc = g_fat32.sectors_per_cluster;
+    uint32_t cluster_size = spc * FAT32_SECTOR_SIZE;
+    uint32_t done = 0;
+
+    while (done < len) {
+        uint32_t abs_pos = f->pos + done;
+        uint32_t cl_idx = abs_pos / cluster_size;
+        uint32_t in_cl = abs_pos % cluster_size;
+        uint32_t want = (in_cl + (len - done) + cluster_size - 1) / cluster_size;
+
+        uint32_t cl, run;
+        if (fat_extents_grow(&g_vol32, &f->ext, &f->first_cluster, cl_idx,
+                             want, 0, &cl, &run) < 0)
+            break;
+
+        uint32_t sec_idx = in_cl / FAT32_SECTOR_SIZE;
+        uint32_t sec_off = in_cl % FAT32_SECTOR_SIZE;
+        uint32_t lba = cluster_to_lba(cl) + sec_idx;
+
+        if (sec_off == 0 && (len - done) >= FAT32_SECTOR_SIZE) {
+            uint32_t n = (len - done) / FAT32_SECTOR_SIZE;
+            uint32_t run_secs = run * spc - sec_idx;
+            if (n > run_secs) n = run_secs;
+            if (n > FAT32_MAX_IO_SECTORS) n = FAT32_MAX_IO_SECTORS;
+            if (fat32_disk_write(lba, n, (const uint8_t *)buf + done) < 0)
+                break;
+            done += n * FAT32_SECTOR_SIZE;
+            continue;
+        }
+
+        uint8_t sec[FAT32_SECTOR_SIZE];
+        if (fat32_read_sector(lba, sec) < 0)
+            break;
+        uint32_t space = FAT32_SECTOR_SIZE - sec_off;
+        uint32_t take = (space < len - done) ? space : len - done;
+        memcpy(sec + sec_off, (const uint8_t *)buf + done, take);
+        if (fat32_write_sector(lba, sec) < 0)
+            break;
+        done += take;
+    }
+
+    f->pos += done;
+    if (f->pos > f->size)
+        f->size = f->pos;
+    if (done > 0 && fat32_update_dirent(f) < 0)
+        printf("[fat32] warning: dirent update failed after %d byte write\n",
+               (int)done);
+    return (int)done;
+}
+
+static int fat32_vfs_close(int handle) {
+    fat32_open_t *f = fat32_handle(handle);
+    if (!f)
+        return -1;
+    memset(f, 0, sizeof(*f));
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static int fat32_vfs_seek(int handle, int offset, int whence) {
+    fat32_open_t *f = fat32_handle(handle);
+    if (!f)
+        return -1;
+    int pos;
+    switch (whence) {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = (int)f->pos + offset;
+        break;
+    case SEEK_END:
+        pos = (int)f->size + offset;
+        break;
+    default:
+        return -1;
+    }
+    if (pos < 0)
+        pos = 0;
+    if ((uint32_t)pos > f->size)
+        pos = (int)f->size;
+    f->pos = (uint32_t)pos;
+    return pos;
+}
+
+static int fat32_vfs_stat(const char *path, vfs_stat_t *st) {
+    const char *rel = fat32_strip_mount(path);
+    if (!g_fat32.mounted || !rel || !st)
+        return -1;
+    fat32_dirent_t de;
+    int rc = fat32_resolve_path(rel, NULL, NULL, &de, NULL, NULL);
+    if (rc == -2) {
+        st->size = 0;
+        st->type = VFS_DIR;
+        return 0;
+    }
+    if (rc < 0)
+        return -1;
+    st->size = de.file_size;
+    st->type = (de.attr & FAT32_ATTR_DIR) ? VFS_DIR : VFS_FILE;
+    return 0;
+}
+
+// Enumerate a directory in one pass for the VFS directory index.
+static int fat32_vfs_listdir(const char *path, vfs_dir_emit_t emit,
+                             void *ctx) {
+    if (!g_fat32.mounted || !path || !emit)
+        return -1;
+
+    // The mount point shows up as an entry of "/".
+    const char *p = path;
+    while (*p == '/')
+        p++;
+    if (*p == '\0') {
+        emit(ctx, FAT32_MOUNT_NAME, 0, VFS_DIR);
+        return 0;
+    }
+
+    const char *rel = fat32_strip_mount(path);
+    if (!rel)
+        return -1;
+
+    uint32_t dir = g_fat32.root_cluster;
+    if (*rel != '\0') {
+        fat32_dirent_t de;
+        if (fat32_resolve_path(rel, NULL, NULL, &de, NULL, NULL) < 0)
+            return -1;
+        if (!(de.attr & FAT32_ATTR_DIR))
+            return -1;
+        dir = dirent_cluster(&de);
+    }
+
+    fat32_dirpos_t pos;
+    fat32_dirpos_init(&pos, dir);
+    uint32_t lba = 0;
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    char pending[FAT_NAME_MAX];
+    int pending_seq = 0;
+    pending[0] = '\0';
+
+    while (fat32_dirpos_next(&pos, &lba)) {
+        if (fat32_read_dir_sector(lba, sec) < 0)
+            break;
+        for (int off = 0; off < FAT32_SECTOR_SIZE; off += 32) {
+            const fat32_dirent_t *de = (const fat32_dirent_t *)(sec + off);
+            if (de->name[0] == 0x00)
+                return 0;
+            if (de->name[0] == 0xE5 ||
+                (de->attr != FAT32_ATTR_LFN &&
+                 (de->attr & FAT32_ATTR_VOLUMEID))) {
+                pending_seq = 0;
+                continue;
+            }
+            if (de->attr == FAT32_ATTR_LFN) {
+                fat_lfn_accumulate((const fat_lfn_t *)de, pending,
+                                     &pending_seq);
+                continue;
+            }
+            if (de->name[0] == '.' &&
+                (de->name[1] == ' ' ||
+                 (de->name[1] == '.' && de->name[2] == ' '))) {
+                pending_seq = 0;
+                continue;
+            }
+
+            char name[FAT_NAME_MAX];
+            if (pending_seq > 0)
+                memcpy(name, pending, FAT_NAME_MAX);
+            else
+                fat_83_to_name(de->name, name);
+            pending_seq = 0;
+            uint32_t type = (de->attr & FAT32_ATTR_DIR) ? VFS_DIR : VFS_FILE;
+            if (emit(ctx, name, de->file_size, type))
+                return 0;
+        }
+    }
+    return 0;
+}
+
+static int fat32_vfs_unlink(const char *path) {
+    const char *rel = fat32_strip_mount(path);
+    if (!g_fat32.mounted || !rel)
+        return -1;
+
+    fat32_dirent_t de;
+    uint32_t de_lba;
+    uint16_t de_off;
+    if (fat32_resolve_path(rel, NULL, NULL, &de, &de_lba, &de_off) < 0)
+        return -1;
+    if (de.attr & FAT32_ATTR_DIR)
+        return -1;
+    uint32_t cl = dirent_cluster(&de);
+    if (fat_valid_cluster(&g_vol32, cl) && fat_free_chain(&g_vol32, cl) < 0)
+        return -1;
+    if (fat32_dir_remove(de_lba, de_off) < 0)
+        return -1;
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static int fat32_vfs_mkdir(const char *path) {
+    const char *rel = fat32_strip_mount(path);
+    if (!g_fat32.mounted || !rel)
+        return -1;
+
+    uint32_t parent;
+    const char *leaf;
+    int rc = fat32_resolve_path(rel, &parent, &leaf, NULL, NULL, NULL);
+    if (rc == 0 || rc == -2 || parent == 0)
+        return -1; // exists, is the root, or parent missing
+
+    uint32_t new_cl;
+    if (fat_alloc_cluster(&g_vol32, &new_cl) < 0)
+        return -1;
+
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    memset(sec, 0, sizeof(sec));
+    fat32_dirent_t *dot = (fat32_dirent_t *)sec;
+    memset(dot->name, ' ', 11);
+    dot->name[0] = '.';
+    dot->attr = FAT32_ATTR_DIR;
+    dirent_set_cluster(dot, new_cl);
+    fat32_dirent_t *dotdot = (fat32_dirent_t *)(sec + 32);
+    memset(dotdot->name, ' ', 11);
+    dotdot->name[0] = '.';
+    dotdot->name[1] = '.';
+    dotdot->attr = FAT32_ATTR_DIR;
+    // ".." of a top-level directory points at cluster 0, not the root chain.
+    dirent_set_cluster(dotdot, parent == g_fat32.root_cluster ? 0 : parent);
+    if (fat32_write_sector(cluster_to_lba(new_cl), sec) < 0 ||
+        fat_set_entry(&g_vol32, new_cl, FAT32_EOC) < 0) {
+        fat_free_chain(&g_vol32, new_cl);
+        return -1;
+    }
+
+    fat32_dirent_t tmpl;
+    memset(&tmpl, 0, sizeof(tmpl));
+    tmpl.attr = FAT32_ATTR_DIR;
+    dirent_set_cluster(&tmpl, new_cl);
+    if (fat32_dir_add(parent, leaf, &tmpl, NULL, NULL, NULL) < 0) {
+        fat_free_chain(&g_vol32, new_cl);
+        fat32_fsinfo_flush();
+        return -1;
+    }
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static int fat32_dir_is_empty(uint32_t dir) {
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    fat32_dirpos_t pos;
+    uint32_t lba;
+    fat32_dirpos_init(&pos, dir);
+    while (fat32_dirpos_next(&pos, &lba)) {
+        if (fat32_read_dir_sector(lba, sec) < 0)
+            return 0;
+        for (int off = 0; off < FAT32_SECTOR_SIZE; off += 32) {
+            const fat32_dirent_t *e = (const fat32_dirent_t *)(sec + off);
+            if (e->name[0] == 0x00)
+                return 1;
+            if (e->name[0] == 0xE5 || e->attr == FAT32_ATTR_LFN)
+                continue;
+            if (e->name[0] == '.' &&
+                (e->name[1] == ' ' || (e->name[1] == '.' && e->name[2] == ' ')))
+                continue;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int fat32_vfs_rmdir(const char *path) {
+    const char *rel = fat32_strip_mount(path);
+    if (!g_fat32.mounted || !rel)
+        return -1;
+
+    fat32_dirent_t de;
+    uint32_t de_lba;
+    uint16_t de_off;
+    if (fat32_resolve_path(rel, NULL, NULL, &de, &de_lba, &de_off) < 0)
+        return -1;
+    if (!(de.attr & FAT32_ATTR_DIR))
+        return -1;
+    uint32_t cl = dirent_cluster(&de);
+    if (!fat_valid_cluster(&g_vol32, cl) || !fat32_dir_is_empty(cl))
+        return -1;
+    if (fat_free_chain(&g_vol32, cl) < 0)
+        return -1;
+    if (fat32_dir_remove(de_lba, de_off) < 0)
+        return -1;
+    dcache_invalidate_dir(&g_fat32, cl);
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static int fat32_vfs_rename(const char *oldpath, const char *newpath) {
+    const char *old_rel = fat32_strip_mount(oldpath);
+    const char *new_rel = fat32_strip_mount(newpath);
+    if (!g_fat32.mounted || !old_rel || !new_rel)
+        return -1;
+
+    fat32_dirent_t old_de;
+    uint32_t old_lba, old_parent;
+    uint16_t old_off;
+    if (fat32_resolve_path(old_rel, &old_parent, NULL, &old_de, &old_lba,
+                           &old_off) < 0)
+        return -1;
+
+    uint32_t new_parent;
+    const char *new_leaf;
+    fat32_dirent_t new_de;
+    uint32_t new_lba;
+    uint16_t new_off;
+    int rc = fat32_resolve_path(new_rel, &new_parent, &new_leaf, &new_de,
+                                &new_lba, &new_off);
+    if (rc == -2 || new_parent == 0)
+        return -1;
+    if (rc == 0) {
+        if (new_lba == old_lba && new_off == old_off)
+            return 0; // same entry (e.g. case-only rename)
+        if (new_de.attr & FAT32_ATTR_DIR)
+            return -1; // can't overwrite a directory
+        uint32_t cl = dirent_cluster(&new_de);
+        if (fat_valid_cluster(&g_vol32, cl))
+            fat_free_chain(&g_vol32, cl);
+        if (fat32_dir_remove(new_lba, new_off) < 0)
+            return -1;
+    }
+
+    // Write the new entry first so a failure leaves the old name intact.
+    uint32_t added_lba;
+    uint16_t added_off;
+    if (fat32_dir_add(new_parent, new_leaf, &old_de, NULL, &added_lba,
+                      &added_off) < 0)
+        return -1;
+    if (fat32_dir_remove(old_lba, old_off) < 0)
+        return -1;
+
+    // A directory moved to another parent needs its ".." updated.
+    uint32_t cl = dirent_cluster(&old_de);
+    if ((old_de.attr & FAT32_ATTR_DIR) && old_parent != new_parent &&
+        fat_valid_cluster(&g_vol32, cl)) {
+        uint8_t sec[FAT32_SECTOR_SIZE];
+        uint32_t lba = cluster_to_lba(cl);
+        if (fat32_read_dir_sector(lba, sec) == 0) {
+            fat32_dirent_t *dotdot = (fat32_dirent_t *)(sec + 32);
+            if (dotdot->name[0] == '.' && dotdot->name[1] == '.') {
+                dirent_set_cluster(dotdot, new_parent == g_fat32.root_cluster
+                                               ? 0
+                                               : new_parent);
+                fat32_write_sector(lba, sec);
+            }
+        }
+    }
+
+    for (int i = 0; i < FAT32_MAX_OPEN; i++) {
+        if (g_open32[i].in_use && g_open32[i].dirent_lba == old_lba &&
+            g_open32[i].dirent_off == old_off) {
+            g_open32[i].dirent_lba = added_lba;
+            g_open32[i].dirent_off = added_off;
+        }
+    }
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static int fat32_vfs_ftruncate(int handle, uint32_t length) {
+    fat32_open_t *f = fat32_handle(handle);
+    if (!f)
+        return -1;
+    if (length == f->size)
+        return 0;
+
+    uint32_t cluster_size = g_fat32.sectors_per_cluster * FAT32_SECTOR_SIZE;
+    if (length < f->size) {
+        if (length == 0) {
+            if (fat_valid_cluster(&g_vol32, f->first_cluster) &&
+                fat_free_chain(&g_vol32, f->first_cluster) < 0)
+                return -1;
+            f->first_cluster = 0;
+        } else {
+            uint32_t cl, run;
+            if (fat_extents_map(&g_vol32, &f->ext, f->first_cluster,
+                                (length - 1) / cluster_size, 1, &cl, &run) < 0)
+                return -1;
+            uint32_t next = fat32_get_entry(cl);
+            if (fat_set_entry(&g_vol32, cl, FAT32_EOC) < 0)
+                return -1;
+            if (fat_valid_cluster(&g_vol32, next))
+                fat_free_chain(&g_vol32, next);
+        }
+        f->size = length;
+        if (f->pos > length)
+            f->pos = length;
+        fat_extents_reset(&f->ext);
+        fat32_chain_changed(f);
+    } else {
+        // Grow with zeroed clusters, then clear the stale tail of the old
+        // last cluster.
+        uint32_t old_size = f->size;
+        uint32_t need = (length + cluster_size - 1) / cluster_size;
+        uint32_t cl, run;
+        if (fat_extents_grow(&g_vol32, &f->ext, &f->first_cluster, need - 1, 1,
+                             1, &cl, &run) < 0)
+            return -1;
+        f->size = length;
+
+        if (old_size > 0) {
+            uint32_t idx = (old_size - 1) / cluster_size;
+            uint32_t cl_start = idx * cluster_size;
+            uint32_t cl_end = cl_start + cluster_size;
+            uint32_t zero_end = cl_end < length ? cl_end : length;
+            uint32_t zcl;
+            if (old_size < zero_end &&
+                fat_extents_map(&g_vol32, &f->ext, f->first_cluster, idx, 1,
+                                &zcl, &run) == 0) {
+                uint32_t lba = cluster_to_lba(zcl);
+                uint32_t pos = old_size;
+                while (pos < zero_end) {
+                    uint32_t s = (pos - cl_start) / FAT32_SECTOR_SIZE;
+                    uint32_t boff = pos % FAT32_SECTOR_SIZE;
+                    uint32_t sec_end = cl_start + (s + 1) * FAT32_SECTOR_SIZE;
+                    uint32_t bend = FAT32_SECTOR_SIZE;
+                    if (sec_end > zero_end)
+                        bend = FAT32_SECTOR_SIZE - (sec_end - zero_end);
+                    uint8_t sec[FAT32_SECTOR_SIZE];
+                    if (fat32_read_sector(lba + s, sec) == 0) {
+                        memset(sec + boff, 0, bend - boff);
+                        fat32_write_sector(lba + s, sec);
+                    }
+                    pos = sec_end;
+                }
+            }
+        }
+    }
+
+    if (fat32_update_dirent(f) < 0)
+        return -1;
+    fat32_fsinfo_flush();
+    return 0;
+}
+
+static const vfs_fs_ops_t fat32_ops = {
+    .name = "fat32",
+    .open = fat32_vfs_open,
+    .read = fat32_vfs_read,
+    .write = fat32_vfs_write,
+    .close = fat32_vfs_close,
+    .seek = fat32_vfs_seek,
+    .stat = fat32_vfs_stat,
+    .listdir = fat32_vfs_listdir,
+    .unlink = fat32_vfs_unlink,
+    .mkdir = fat32_vfs_mkdir,
+    .rmdir = fat32_vfs_rmdir,
+    .rename = fat32_vfs_rename,
+    .ftruncate = fat32_vfs_ftruncate,
+};
+
+// ---------------------------------------------------------------------------
+// Mount
+// ---------------------------------------------------------------------------
+static int is_fat32_part_type(uint8_t type) {
+    return (type == 0x0B || type == 0x0C);
+}
+
+static int fat32_try_mount_at(uint32_t part_lba) {
+    uint8_t sec[FAT32_SECTOR_SIZE];
+    if (fat32_read_sector(part_lba, sec) < 0)
+        return -1;
+    if (sec[510] != 0x55 || sec[511] != 0xAA)
+        return -1;
+
+    fat32_bpb_t *b = (fat32_bpb_t *)sec;
+    if (b->bytes_per_sector != FAT32_SECTOR_SIZE)
+        return -1;
+    uint8_t spc = b->sectors_per_cluster;
+    if (spc == 0 || (spc & (spc - 1)) != 0)
+        return -1;
+    // FAT32 is told apart by its BPB shape: no fixed root directory and no
+    // 16-bit FAT size.
+    if (b->fat_count == 0 || b->root_entry_count != 0 ||
+        b->sectors_per_fat_16 != 0 || b->sectors_per_fat_32 == 0)
+        return -1;
+    if (b->root_cluster < 2)
+        return -1;
+
+    uint32_t total = b->total_sectors_16 ? b->total_sectors_16
+                                         : b->total_sectors_32;
+    uint32_t meta = (uint32_t)b->reserved_sector_count +
+                    (uint32_t)b->fat_count * b->sectors_per_fat_32;
+    if (total <= meta)
+        return -1;
+    uint32_t clusters = (total - meta) / spc;
+    uint32_t fat_entries = b->sectors_per_fat_32 * (FAT32_SECTOR_SIZE / 4);
+    if (clusters + 2 > fat_entries)
+        clusters = fat_entries - 2;
+    if (b->root_cluster >= clusters + 2)
+        return -1;
+
+    memset(&g_fat32, 0, sizeof(g_fat32));
+    g_fat32.part_lba = part_lba;
+    g_fat32.sectors_per_cluster = spc;
+    g_fat32.sectors_per_fat = b->sectors_per_fat_32;
+    g_fat32.total_sectors = total;
+    g_fat32.cluster_count = clusters;
+    g_fat32.root_cluster = b->root_cluster;
+    g_fat32.data_start_lba = part_lba + meta;
+
+    uint32_t fat0 = part_lba + b->reserved_sector_count;
+    if (b->ext_flags & 0x80) {
+        // Mirroring disabled: only the active FAT is used and written.
+        uint32_t active = b->ext_flags & 0x0F;
+        if (active >= b->fat_count)
+            return -1;
+        g_fat32.fat_start_lba = fat0 + active * b->sectors_per_fat_32;
+        g_fat32.mirror_lba = g_fat32.fat_start_lba;
+        g_fat32.fat_count = 1;
+    } else {
+        g_fat32.fat_start_lba = fat0;
+        g_fat32.mirror_lba = fat0;
+        g_fat32.fat_count = b->fat_count;
+    }
+    if (b->fs_info_sector != 0 && b->fs_info_sector != 0xFFFF &&
+        b->fs_info_sector < b->reserved_sector_count)
+        g_fat32.fsinfo_lba = part_lba + b->fs_info_sector;
+
+    memset(g_open32, 0, sizeof(g_open32));
+    fat32_fat_cache_invalidate();
+    dcache_invalidate_owner(&g_fat32);
+    blkcache_init(&g_bcache32, fat32_disk_read, g_fat32.data_start_lba,
+                  clusters * spc);
+    fat_vol_init(&g_vol32, &fat32_vol_ops, 4, g_fat32.fat_start_lba, clusters);
+
+    // Free-cluster hints from FSInfo; scan the FAT only if they are missing
+    // or implausible.
+    int hints_ok = 0;
+    if (g_fat32.fsinfo_lba && fat32_read_sector(g_fat32.fsinfo_lba, sec) == 0) {
+        fat32_fsinfo_t *fi = (fat32_fsinfo_t *)sec;
+        if (fi->lead_sig == FAT32_FSINFO_LEAD &&
+            fi->struct_sig == FAT32_FSINFO_STRUCT &&
+            fi->free_count != FAT32_FSINFO_UNKNOWN &&
+            fi->free_count <= clusters) {
+            g_vol32.free_count = fi->free_count;
+            g_vol32.next_free = fi->next_free;
+            hints_ok = 1;
+        }
+    }
+    if (!hints_ok && fat_count_free(&g_vol32) < 0)
+        return -1;
+
+    g_fat32.mounted = 1;
+    printf("[fat32] mounted /%s at LBA %d (spc=%d, clusters=%d, free=%d)\n",
+           FAT32_MOUNT_NAME, g_fat32.part_lba, g_fat32.sectors_per_cluster,
+           g_fat32.cluster_count, g_vol32.free_count);
+    return 0;
+}
+
+int fat32_init(void) {
+    memset(&g_fat32, 0, sizeof(g_fat32));
+    memset(g_open32, 0, sizeof(g_open32));
+
+    if (ata_pio_init_drive(FAT32_ATA_DRIVE) < 0) {
+        printf("[fat32] no data disk on primary slave\n");
+        return -1;
+    }
+
+    uint8_t mbr[FAT32_SECTOR_SIZE];
+    if (fat32_read_sector(0, mbr) == 0 && mbr[510] == 0x55 &&
+        mbr[511] == 0xAA) {
+        fat32_mbr_part_t *p = (fat32_mbr_part_t *)(mbr + 446);
+        for (int i = 0; i < 4; i++) {
+            if (is_fat32_part_type(p[i].type) && p[i].sector_count > 0 &&
+                fat32_try_mount_at(p[i].lba_first) == 0)
+                return 0;
+        }
+    }
+
+    // Fallback: superfloppy FAT32 directly at LBA0
+    if (fat32_try_mount_at(0) == 0)
+        return 0;
+
+    printf("[fat32] no FAT32 volume on data disk\n");
+    return -1;
+}
+
+const vfs_fs_ops_t *fat32_get_ops(void) { return &fat32_ops; }
+
+void fat32_get_stats(fat32_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!g_fat32.mounted)
+        return;
+    out->mounted = 1;
+    out->cluster_count = g_fat32.cluster_count;
+    out->free_clusters = g_vol32.free_count;
+    out->cluster_size = g_fat32.sectors_per_cluster * FAT32_SECTOR_SIZE;
+    out->cache_blocks = blkcache_enabled(&g_bcache32) ? BLKCACHE_BLOCKS : 0;
+    out->cache_hits = g_bcache32.hits;
+    out->cache_misses = g_bcache32.misses;
+    out->cache_prefetched = g_bcache32.prefetched;
+}
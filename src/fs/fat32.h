@@ -0,0 +1,31 @@
+#ifndef _FAT32_H
+#define _FAT32_H
+
+#include "vfs.h"
+
+// Directory the FAT32 data disk appears under.
+#define FAT32_MOUNT_NAME "data"
+
+// Initialize FAT32 backend on the primary-slave ATA disk.
+// Returns 0 when mounted, -1 otherwise (no disk or not FAT32).
+int fat32_init(void);
+
+// Access VFS backend ops for FAT32. Paths outside /data are rejected so
+// the boot filesystem keeps answering for everything else.
+const vfs_fs_ops_t *fat32_get_ops(void);
+
+typedef struct {
+    uint32_t mounted;
+    uint32_t cluster_count;
+    uint32_t free_clusters;
+    uint32_t cluster_size;
+    uint32_t cache_blocks;     // data block cache size (4KB blocks)
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t cache_prefetched; // blocks loaded by read-ahead
+} fat32_stats_t;
+
+// Snapshot of volume and block-cache counters (for mos/kvfs).
+void fat32_get_stats(fat32_stats_t *out);
+
+#endif
@@ -0,0 +1,572 @@
+#include "fatcommon.h"
+#include "liballoc/liballoc_1_1.h"
+
+// ---------------------------------------------------------------------------
+// FAT entries. FAT16 entries are 16 bits; FAT32 entries are 28 bits in a
+// 32-bit slot whose top 4 bits are reserved and must be preserved.
+// ---------------------------------------------------------------------------
+#define FAT32_ENTRY_MASK 0x0FFFFFFFu
+
+uint32_t fat_eoc(const fat_vol_t *v) {
+    return v->width == 2 ? 0xFFFFu : FAT32_ENTRY_MASK;
+}
+
+int fat_valid_cluster(const fat_vol_t *v, uint32_t c) {
+    return c >= 2 && c < v->cluster_count + 2;
+}
+
+static uint32_t fat_read_ent(const fat_vol_t *v, const uint8_t *p) {
+    if (v->width == 2)
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+    uint32_t raw = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                   ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    return raw & FAT32_ENTRY_MASK;
+}
+
+static void fat_write_ent(const fat_vol_t *v, uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)((value >> 8) & 0xFF);
+    if (v->width == 2)
+        return;
+    p[2] = (uint8_t)((value >> 16) & 0xFF);
+    p[3] = (uint8_t)((p[3] & 0xF0) | ((value >> 24) & 0x0F));
+}
+
+static uint32_t fat_ent_sector(const fat_vol_t *v, uint32_t cluster) {
+    return (cluster * v->width) / FAT_SECTOR_SIZE;
+}
+
+static uint8_t *fat_ent_ptr(const fat_vol_t *v, uint8_t *sec,
+                            uint32_t cluster) {
+    return sec + (cluster * v->width) % FAT_SECTOR_SIZE;
+}
+
+int fat_set_entry(fat_vol_t *v, uint32_t cluster, uint32_t value) {
+    uint8_t sec[FAT_SECTOR_SIZE];
+    uint32_t rel = fat_ent_sector(v, cluster);
+    if (v->ops->fat_load(rel, sec) < 0)
+        return -1;
+    fat_write_ent(v, fat_ent_ptr(v, sec, cluster), value);
+    return v->ops->fat_store(rel, sec);
+}
+
+// ---------------------------------------------------------------------------
+// Free-cluster accounting
+// ---------------------------------------------------------------------------
+void fat_vol_init(fat_vol_t *v, const fat_vol_ops_t *ops, uint32_t width,
+                  uint32_t fat_lba, uint32_t cluster_count) {
+    if (v->free_map)
+        kfree(v->free_map);
+    memset(v, 0, sizeof(*v));
+    v->ops = ops;
+    v->width = width;
+    v->fat_lba = fat_lba;
+    v->cluster_count = cluster_count;
+    v->next_free = 2;
+}
+
+static int fat_cluster_free(const fat_vol_t *v, uint32_t c) {
+    if (v->free_map)
+        return !((v->free_map[c >> 5] >> (c & 31)) & 1);
+    return v->ops->get_entry(c) == 0;
+}
+
+// Record an in-use/free transition of cluster `c`.
+static void fat_mark(fat_vol_t *v, uint32_t c, int used) {
+    if (v->free_map) {
+        int was_used = (v->free_map[c >> 5] >> (c & 31)) & 1;
+        if (was_used == used)
+            return;
+        v->free_map[c >> 5] ^= 1u << (c & 31);
+    }
+    if (used) {
+        if (v->free_count > 0)
+            v->free_count--;
+    } else {
+        v->free_count++;
+        if (c < v->next_free)
+            v->next_free = c;
+    }
+    v->free_dirty = 1;
+}
+
+// Count free clusters in the on-disk FAT, setting free map bits for the
+// ones in use when there is a map.
+static int fat_scan_free(fat_vol_t *v) {
+    uint8_t *bulk = (uint8_t *)kmalloc(FAT_SECTOR_SIZE * 8);
+    if (!bulk)
+        return -1;
+    uint32_t per_sec = FAT_SECTOR_SIZE / v->width;
+    uint32_t last = v->cluster_count + 2;
+    uint32_t fat_secs = (last * v->width + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+    uint32_t free_count = 0;
+    uint32_t first_free = 0;
+    for (uint32_t s = 0; s < fat_secs; s += 8) {
+        uint32_t batch = fat_secs - s;
+        if (batch > 8) batch = 8;
+        if (v->ops->disk_read(v->fat_lba + s, batch, bulk) < 0) {
+            kfree(bulk);
+            return -1;
+        }
+        for (uint32_t i = 0; i < batch * per_sec; i++) {
+            uint32_t c = s * per_sec + i;
+            if (c < 2 || c >= last)
+                continue;
+            if (fat_read_ent(v, bulk + i * v->width) != 0) {
+                if (v->free_map)
+                    v->free_map[c >> 5] |= 1u << (c & 31);
+            } else if (free_count++ == 0) {
+                first_free = c;
+            }
+        }
+    }
+    kfree(bulk);
+    v->free_count = free_count;
+    v->next_free = first_free ? first_free : 2;
+    v->free_dirty = 1;
+    return 0;
+}
+
+int fat_build_free_map(fat_vol_t *v) {
+    if (v->free_map) {
+        kfree(v->free_map);
+        v->free_map = NULL;
+    }
+    uint32_t words = (v->cluster_count + 2 + 31) / 32;
+    v->free_map = (uint32_t *)kmalloc(words * sizeof(uint32_t));
+    if (!v->free_map)
+        return -1;
+    memset(v->free_map, 0, words * sizeof(uint32_t));
+    v->free_map[0] |= 0x3; // clusters 0 and 1 are reserved
+    if (fat_scan_free(v) < 0) {
+        kfree(v->free_map);
+        v->free_map = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int fat_count_free(fat_vol_t *v) {
+    return fat_scan_free(v);
+}
+
+// Chain clusters [first, first + count) together and terminate with EOC.
+// Entries sharing a FAT sector are written with one store per FAT copy.
+static int fat_link_run(fat_vol_t *v, uint32_t first, uint32_t count) {
+    uint8_t sec[FAT_SECTOR_SIZE];
+    uint32_t per_sec = FAT_SECTOR_SIZE / v->width;
+    uint32_t c = first;
+    uint32_t end = first + count;
+    while (c < end) {
+        uint32_t rel = fat_ent_sector(v, c);
+        uint32_t sec_end = (rel + 1) * per_sec;
+        uint32_t stop = (end < sec_end) ? end : sec_end;
+        if (v->ops->fat_load(rel, sec) < 0)
+            return -1;
+        for (uint32_t x = c; x < stop; x++)
+            fat_write_ent(v, fat_ent_ptr(v, sec, x),
+                          (x + 1 == end) ? fat_eoc(v) : x + 1);
+        if (v->ops->fat_store(rel, sec) < 0)
+            return -1;
+        for (uint32_t x = c; x < stop; x++)
+            fat_mark(v, x, 1);
+        c = stop;
+    }
+    return 0;
+}
+
+int fat_alloc_run(fat_vol_t *v, uint32_t want, int zero, uint32_t *out_first,
+                  uint32_t *out_count) {
+    if (!out_first || !out_count || want == 0 || v->free_count == 0)
+        return -1;
+
+    uint32_t lo = 2;
+    uint32_t hi = v->cluster_count + 2;
+    uint32_t c = v->next_free;
+    if (c < lo || c >= hi)
+        c = lo;
+    uint32_t scanned = 0;
+    while (!fat_cluster_free(v, c)) {
+        if (++scanned >= v->cluster_count)
+            return -1;
+        if (++c >= hi)
+            c = lo;
+    }
+
+    uint32_t n = 1;
+    while (n < want && c + n < hi && fat_cluster_free(v, c + n))
+        n++;
+
+    if (fat_link_run(v, c, n) < 0)
+        return -1;
+    if (zero && v->ops->zero_clusters(c, n) < 0)
+        return -1;
+
+    v->next_free = (c + n < hi) ? c + n : lo;
+    *out_first = c;
+    *out_count = n;
+    return 0;
+}
+
+int fat_alloc_cluster(fat_vol_t *v, uint32_t *out_cluster) {
+    uint32_t n;
+    return fat_alloc_run(v, 1, 1, out_cluster, &n);
+}
+
+int fat_free_chain(fat_vol_t *v, uint32_t first) {
+    uint8_t sec[FAT_SECTOR_SIZE];
+    uint32_t cur_rel = 0xFFFFFFFFu;
+    uint32_t c = first;
+    // Limit iterations to the cluster count so a corrupt chain with a
+    // cycle (e.g. A->B->C->A) can't loop forever.
+    uint32_t max_iter = v->cluster_count + 2;
+    uint32_t iter = 0;
+    while (fat_valid_cluster(v, c) && iter < max_iter) {
+        uint32_t rel = fat_ent_sector(v, c);
+        if (rel != cur_rel) {
+            if (cur_rel != 0xFFFFFFFFu && v->ops->fat_store(cur_rel, sec) < 0)
+                return -1;
+            if (v->ops->fat_load(rel, sec) < 0)
+                return -1;
+            cur_rel = rel;
+        }
+        uint8_t *ent = fat_ent_ptr(v, sec, c);
+        uint32_t next = fat_read_ent(v, ent);
+        if (next == 0)
+            break; // already free: corrupt chain
+        fat_write_ent(v, ent, 0);
+        fat_mark(v, c, 0);
+        if (next == c)
+            break;
+        c = next;
+        iter++;
+    }
+    if (cur_rel != 0xFFFFFFFFu && v->ops->fat_store(cur_rel, sec) < 0)
+        return -1;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Per-handle extent cache: maps file cluster index -> disk cluster without
+// re-walking the chain from the first cluster on every read/write.
+// ---------------------------------------------------------------------------
+void fat_extents_reset(fat_extents_t *x) {
+    x->count = 0;
+    x->end = 0;
+    x->walk_idx = 0;
+    x->walk_cluster = 0;
+}
+
+// Record that file cluster `idx` lives at disk cluster `cl`. Called in chain
+// order; positions past a full ext[] only advance the walk cursor.
+static void fat_extents_note(fat_extents_t *x, uint32_t idx, uint32_t cl) {
+    x->walk_idx = idx;
+    x->walk_cluster = cl;
+    if (idx != x->end)
+        return;
+    if (x->count > 0) {
+        fat_extent_t *e = &x->ext[x->count - 1];
+        if (e->cluster + e->count == cl) {
+            e->count++;
+            x->end++;
+            return;
+        }
+    }
+    if (x->count < FAT_MAX_EXTENTS) {
+        fat_extent_t *e = &x->ext[x->count++];
+        e->file_idx = idx;
+        e->cluster = cl;
+        e->count = 1;
+        x->end++;
+    }
+}
+
+// Returns -1 if the chain ends before idx; the tail is then in walk_*.
+int fat_extents_map(fat_vol_t *v, fat_extents_t *x, uint32_t first,
+                    uint32_t idx, uint32_t want, uint32_t *out_cluster,
+                    uint32_t *out_run) {
+    if (!fat_valid_cluster(v, first))
+        return -1;
+    if (x->walk_cluster == 0)
+        fat_extents_note(x, 0, first);
+
+    if (idx < x->walk_idx && idx >= x->end) {
+        // Seeking backwards past the cached prefix: restart at its end.
+        fat_extent_t *e = &x->ext[x->count - 1];
+        x->walk_idx = x->end - 1;
+        x->walk_cluster = e->cluster + e->count - 1;
+    }
+
+    uint32_t target = idx + (want ? want - 1 : 0);
+    uint32_t steps = 0;
+    while (x->walk_idx < target) {
+        if (x->walk_idx >= idx && x->walk_idx >= x->end)
+            break; // past the prefix there is no run to extend
+        uint32_t next = v->ops->get_entry(x->walk_cluster);
+        if (!fat_valid_cluster(v, next))
+            break;
+        if (++steps > v->cluster_count)
+            return -1; // cycle in a corrupt chain
+        fat_extents_note(x, x->walk_idx + 1, next);
+    }
+
+    if (idx < x->end) {
+        for (int i = (int)x->count - 1; i >= 0; i--) {
+            fat_extent_t *e = &x->ext[i];
+            if (idx >= e->file_idx) {
+                uint32_t d = idx - e->file_idx;
+                *out_cluster = e->cluster + d;
+                *out_run = e->count - d;
+                return 0;
+            }
+        }
+    }
+    if (idx == x->walk_idx) {
+        *out_cluster = x->walk_cluster;
+        *out_run = 1;
+        return 0;
+    }
+    return -1;
+}
+
+int fat_extents_grow(fat_vol_t *v, fat_extents_t *x, uint32_t *first,
+                     uint32_t idx, uint32_t want, int zero,
+                     uint32_t *out_cluster, uint32_t *out_run) {
+    if (!first || !out_cluster || !out_run)
+        return -1;
+    if (want == 0)
+        want = 1;
+    if (fat_extents_map(v, x, *first, idx, want, out_cluster, out_run) == 0)
+        return 0;
+
+    uint32_t have = fat_valid_cluster(v, *first) ? x->walk_idx + 1 : 0;
+    uint32_t need = idx + want - have;
+    while (need > 0) {
+        uint32_t run_first, got;
+        if (fat_alloc_run(v, need, zero, &run_first, &got) < 0)
+            break;
+        if (have == 0) {
+            *first = run_first;
+            fat_extents_reset(x);
+        } else if (fat_set_entry(v, x->walk_cluster, run_first) < 0) {
+            fat_free_chain(v, run_first);
+            return -1;
+        }
+        for (uint32_t k = 0; k < got; k++)
+            fat_extents_note(x, have + k, run_first + k);
+        have += got;
+        need -= got;
+    }
+    // Partial allocation (disk full) still lets the caller use what exists.
+    return fat_extents_map(v, x, *first, idx, 1, out_cluster, out_run);
+}
+
+// ---------------------------------------------------------------------------
+// Names: 8.3 conversion and VFAT long names
+// ---------------------------------------------------------------------------
+static char upper_ascii(char c) {
+    if (c >= 'a' && c <= 'z')
+        return (char)(c - ('a' - 'A'));
+    return c;
+}
+
+static int is_83_char(char c) {
+    if (c >= 'A' && c <= 'Z')
+        return 1;
+    if (c >= '0' && c <= '9')
+        return 1;
+    if (c == '_' || c == '$' || c == '~' || c == '-' || c == '!')
+        return 1;
+    return 0;
+}
+
+int fat_name_eq_nocase(const char *a, const char *b) {
+    while (*a && *b) {
+        if (upper_ascii(*a) != upper_ascii(*b))
+            return 0;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Compute the 8.3 checksum used to associate LFN entries with their short
+// dirent.
+uint8_t fat_lfn_checksum(const uint8_t name83[11]) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++)
+        sum = ((sum & 1) ? 0x80 : 0) + (sum >> 1) + name83[i];
+    return sum;
+}
+
+int fat_name_to_83(const char *in, uint8_t out[11]) {
+    if (!in || !*in)
+        return -1;
+    for (int i = 0; i < 11; i++)
+        out[i] = ' ';
+
+    int i = 0;
+    int base_len = 0;
+    while (in[i] && in[i] != '.') {
+        char c = upper_ascii(in[i]);
+        if (!is_83_char(c) || base_len >= 8)
+            return -1;
+        out[base_len++] = (uint8_t)c;
+        i++;
+    }
+    if (base_len == 0)
+        return -1;
+    if (in[i] == '.') {
+        i++;
+        int ext_len = 0;
+        while (in[i]) {
+            char c = upper_ascii(in[i]);
+            if (!is_83_char(c) || ext_len >= 3)
+                return -1;
+            out[8 + ext_len++] = (uint8_t)c;
+            i++;
+        }
+    }
+    return 0;
+}
+
+void fat_83_to_name(const uint8_t name83[11], char *out) {
+    int p = 0;
+    for (int i = 0; i < 8 && name83[i] != ' '; i++)
+        out[p++] = (char)name83[i];
+    if (name83[8] != ' ') {
+        out[p++] = '.';
+        for (int i = 8; i < 11 && name83[i] != ' '; i++)
+            out[p++] = (char)name83[i];
+    }
+    out[p] = '\0';
+}
+
+// Short alias for a long name: base chars + "~N" + up to 3 ext chars. The
+// base shrinks as N grows so the alias always fits in 8 chars. Like VFAT,
+// after FAT_ALIAS_PLAIN tries the base becomes 2 name chars + 4 hex digits
+// of a name hash, so directories full of names sharing a prefix don't need
+// hundreds of collision probes per create.
+#define FAT_ALIAS_PLAIN 4
+
+void fat_make_short_alias(const char *longname, uint8_t out[11],
+                          int suffix_num) {
+    for (int i = 0; i < 11; i++)
+        out[i] = ' ';
+    const char *dot = NULL;
+    for (const char *p = longname; *p; p++)
+        if (*p == '.')
+            dot = p;
+
+    int tail = suffix_num;
+    int hashed = suffix_num > FAT_ALIAS_PLAIN;
+    if (hashed)
+        tail -= FAT_ALIAS_PLAIN;
+    char digits[4];
+    int nd = 0;
+    for (int v = tail; v > 0 && nd < 3; v /= 10)
+        digits[nd++] = (char)('0' + v % 10);
+
+    int base_len = 0;
+    int base_max = 7 - nd;
+    int name_max = hashed ? 2 : base_max;
+    const char *base_end = dot ? dot : longname + strlen(longname);
+    for (const char *p = longname; p < base_end && base_len < name_max; p++) {
+        char c = upper_ascii(*p);
+        if (is_83_char(c))
+            out[base_len++] = (uint8_t)c;
+        else if (c != ' ' && c != '.')
+            out[base_len++] = '_';
+    }
+    if (base_len == 0)
+        out[base_len++] = '_';
+    if (hashed) {
+        uint32_t h = 2166136261u;
+        for (const char *p = longname; *p; p++)
+            h = (h ^ (uint8_t)*p) * 16777619u;
+        for (int i = 0; i < 4 && base_len < base_max; i++) {
+            uint32_t nib = (h >> (12 - 4 * i)) & 0xF;
+            out[base_len++] = (uint8_t)(nib < 10 ? '0' + nib : 'A' + nib - 10);
+        }
+    }
+    out[base_len++] = '~';
+    while (nd > 0)
+        out[base_len++] = (uint8_t)digits[--nd];
+
+    if (dot) {
+        int ext_len = 0;
+        for (const char *p = dot + 1; *p && ext_len < 3; p++) {
+            char c = upper_ascii(*p);
+            if (is_83_char(c))
+                out[8 + ext_len++] = (uint8_t)c;
+        }
+    }
+}
+
+// Entries arrive highest sequence number first; each covers 13 chars at
+// (seq-1)*13.
+void fat_lfn_accumulate(const fat_lfn_t *lfn, char *pending,
+                        int *pending_seq) {
+    int seq = lfn->seq & 0x3F;
+    if (lfn->seq & 0x40) {
+        *pending_seq = seq;
+        int total = seq * 13;
+        if (total > FAT_NAME_MAX - 1)
+            total = FAT_NAME_MAX - 1;
+        pending[total] = '\0';
+    }
+    if (*pending_seq == 0 || seq == 0)
+        return;
+    const uint8_t *parts[3] = {lfn->name1, lfn->name2, lfn->name3};
+    const int counts[3] = {5, 6, 2};
+    int ci = (seq - 1) * 13;
+    for (int part = 0; part < 3; part++) {
+        for (int k = 0; k < counts[part]; k++, ci++) {
+            uint8_t lo = parts[part][k * 2];
+            uint8_t hi = parts[part][k * 2 + 1];
+            if (ci >= FAT_NAME_MAX - 1)
+                return;
+            if ((lo == 0 && hi == 0) || (lo == 0xFF && hi == 0xFF)) {
+                pending[ci] = '\0';
+                return;
+            }
+            pending[ci] = (char)lo; // ASCII-safe: take low byte
+        }
+    }
+}
+
+void fat_lfn_write_entries(uint8_t *sec, int start_off, int lfn_count,
+                           const char *longname, uint8_t checksum) {
+    int namelen = (int)strlen(longname);
+    for (int seq = lfn_count; seq >= 1; seq--) {
+        // Highest sequence first (lowest address), seq 1 just before the
+        // short entry.
+        fat_lfn_t *lfn = (fat_lfn_t *)(sec + start_off + (lfn_count - seq) * 32);
+        memset(lfn, 0xFF, sizeof(*lfn));
+        lfn->seq = (uint8_t)(seq | (seq == lfn_count ? 0x40 : 0));
+        lfn->attr = FAT_ATTR_LFN;
+        lfn->type = 0;
+        lfn->checksum = checksum;
+        lfn->cluster = 0;
+        for (int ci = 0; ci < 13; ci++) {
+            int idx = (seq - 1) * 13 + ci;
+            uint8_t lo = 0xFF, hi = 0xFF;
+            if (idx < namelen) {
+                lo = (uint8_t)longname[idx];
+                hi = 0;
+            } else if (idx == namelen) {
+                lo = 0;
+                hi = 0;
+            }
+            uint8_t *field;
+            if (ci < 5)
+                field = lfn->name1 + ci * 2;
+            else if (ci < 11)
+                field = lfn->name2 + (ci - 5) * 2;
+            else
+                field = lfn->name3 + (ci - 11) * 2;
+            field[0] = lo;
+            field[1] = hi;
+        }
+    }
+}
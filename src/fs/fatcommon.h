@@ -0,0 +1,131 @@
+#ifndef _FATCOMMON_H
+#define _FATCOMMON_H
+
+#include "lib.h"
+
+// Code shared by the FAT16 and FAT32 drivers: free-cluster allocation, the
+// per-handle extent cache and 8.3 / VFAT long-name handling. The drivers
+// keep FAT entry access, FSInfo and root-directory handling; these helpers
+// reach the FAT through a fat_vol_t that records the entry width.
+
+#define FAT_SECTOR_SIZE 512
+#define FAT_NAME_MAX 64    // long filenames up to 63 chars + NUL
+#define FAT_ALIAS_MAX 999  // highest ~N short-name alias
+#define FAT_MAX_EXTENTS 16
+#define FAT_ATTR_LFN 0x0F
+
+// LFN (Long File Name) directory entry — attribute byte 0x0F marks these.
+// Entries are stored in reverse order before the short 8.3 dirent, each
+// tagged with a 1-based sequence number (last entry ORed with 0x40).
+typedef struct __attribute__((packed)) {
+    uint8_t seq;
+    uint8_t name1[10]; // 5 UTF-16LE chars
+    uint8_t attr;
+    uint8_t type;
+    uint8_t checksum;  // checksum of the associated 8.3 name
+    uint8_t name2[12]; // 6 UTF-16LE chars
+    uint16_t cluster;
+    uint8_t name3[4];  // 2 UTF-16LE chars
+} fat_lfn_t;
+
+// FAT access provided by a driver. Sector numbers passed to fat_load and
+// fat_store are relative to the start of the FAT.
+typedef struct {
+    uint32_t (*get_entry)(uint32_t cluster);
+    int (*fat_load)(uint32_t rel, uint8_t *sec);        // copy for editing
+    int (*fat_store)(uint32_t rel, const uint8_t *sec); // write every copy
+    int (*disk_read)(uint32_t lba, uint32_t count, void *buf);
+    int (*zero_clusters)(uint32_t first, uint32_t count);
+} fat_vol_ops_t;
+
+typedef struct {
+    const fat_vol_ops_t *ops;
+    uint32_t width;         // bytes per FAT entry: 2 (FAT16) or 4 (FAT32)
+    uint32_t fat_lba;       // FAT scanned by fat_build_free_map/fat_count_free
+    uint32_t cluster_count; // valid cluster numbers are 2..cluster_count+1
+    // Free-cluster accounting. With a free map (one bit per cluster, set =
+    // in use) allocation never reads the FAT; without one it tests entries
+    // through ops->get_entry. Allocation is next-fit from next_free, which
+    // keeps files written back-to-back contiguous on disk.
+    uint32_t *free_map;
+    uint32_t free_count;
+    uint32_t next_free;
+    int free_dirty;         // free_count/next_free changed since last cleared
+} fat_vol_t;
+
+// One contiguous run of a file's cluster chain: file clusters
+// [file_idx, file_idx + count) live on disk at [cluster, cluster + count).
+typedef struct {
+    uint32_t file_idx;
+    uint32_t cluster;
+    uint32_t count;
+} fat_extent_t;
+
+// Per-handle extent cache: ext[] maps a prefix of the chain (clusters
+// 0..end-1) as runs. walk_idx/walk_cluster is the furthest chain position
+// visited, which keeps sequential access O(1) once ext[] is full.
+typedef struct {
+    fat_extent_t ext[FAT_MAX_EXTENTS];
+    uint8_t count;
+    uint32_t end;
+    uint32_t walk_idx;
+    uint32_t walk_cluster; // 0 = nothing walked yet
+} fat_extents_t;
+
+// Reset a volume for a new mount. Drops any free map from a previous one.
+void fat_vol_init(fat_vol_t *v, const fat_vol_ops_t *ops, uint32_t width,
+                  uint32_t fat_lba, uint32_t cluster_count);
+int fat_valid_cluster(const fat_vol_t *v, uint32_t c);
+uint32_t fat_eoc(const fat_vol_t *v);
+
+// Scan the FAT once to set free_count/next_free, building the free map
+// too with fat_build_free_map.
+int fat_build_free_map(fat_vol_t *v);
+int fat_count_free(fat_vol_t *v);
+
+int fat_set_entry(fat_vol_t *v, uint32_t cluster, uint32_t value);
+
+// Allocate up to `want` physically contiguous clusters (at least one),
+// linked as a chain ending in EOC and zeroed when `zero` is set.
+// `*out_count` is shorter than `want` when free space is fragmented.
+int fat_alloc_run(fat_vol_t *v, uint32_t want, int zero, uint32_t *out_first,
+                  uint32_t *out_count);
+int fat_alloc_cluster(fat_vol_t *v, uint32_t *out_cluster);
+// Free a cluster chain, one store per FAT sector touched.
+int fat_free_chain(fat_vol_t *v, uint32_t first);
+
+void fat_extents_reset(fat_extents_t *x);
+// Map file cluster `idx` of the chain starting at `first` to its disk
+// cluster. `want` is how many clusters from idx the caller intends to
+// touch; the chain is walked that far ahead so the returned run can cover
+// a multi-cluster transfer. On success *out_run is the number of
+// contiguous clusters starting at *out_cluster.
+int fat_extents_map(fat_vol_t *v, fat_extents_t *x, uint32_t first,
+                    uint32_t idx, uint32_t want, uint32_t *out_cluster,
+                    uint32_t *out_run);
+// Like fat_extents_map, but grows the chain (updating *first for an empty
+// file) when it is too short. Missing clusters are allocated as contiguous
+// runs, zeroed only when `zero` is set.
+int fat_extents_grow(fat_vol_t *v, fat_extents_t *x, uint32_t *first,
+                     uint32_t idx, uint32_t want, int zero,
+                     uint32_t *out_cluster, uint32_t *out_run);
+
+// Names. fat_name_to_83 returns -1 when `in` needs a long name.
+int fat_name_eq_nocase(const char *a, const char *b);
+int fat_name_to_83(const char *in, uint8_t out[11]);
+void fat_83_to_name(const uint8_t name83[11], char *out);
+uint8_t fat_lfn_checksum(const uint8_t name83[11]);
+// Short alias `suffix_num` (1..FAT_ALIAS_MAX) for a long name. Does not
+// check for collisions; callers probe increasing suffixes.
+void fat_make_short_alias(const char *longname, uint8_t out[11],
+                          int suffix_num);
+// Fold one LFN entry into the long name being assembled in `pending`
+// (FAT_NAME_MAX bytes). *pending_seq > 0 while a name is in progress.
+void fat_lfn_accumulate(const fat_lfn_t *lfn, char *pending,
+                        int *pending_seq);
+// Write `lfn_count` LFN entries for `longname` into `sec` at `start_off`;
+// the short entry goes right after them.
+void fat_lfn_write_entries(uint8_t *sec, int start_off, int lfn_count,
+                           const char *longname, uint8_t checksum);
+
+#endif
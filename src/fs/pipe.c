@@ -1,6 +1,7 @@
 #include "pipe.h"
 #include "vfs.h"
 #include "proc/task.h"
+#include "proc/waitq.h"
 #include "utils/kring.h"
 
 // ---- slot table -------------------------------------------------------
@@ -10,6 +11,7 @@ typedef struct {
     char     name[PIPE_NAME_MAX];
     uint8_t  buf_storage[PIPE_BUF_SIZE];
     kring_u8_t ring;
+    waitq_t  wq;  // readers and writers sleeping on this pipe
 } pipe_slot_t;
 
 static pipe_slot_t pipes[PIPE_MAX];
@@ -62,6 +64,15 @@ static int pipe_alloc_fd(int pipe_idx, int writable) {
     return -1;
 }
 
+// Sleep until the pipe changes (data pushed/popped or pipe destroyed).
+static void pipe_wait(int idx) {
+    unsigned int flags = cpu_irq_save();
+    waitq_add(&pipes[idx].wq);
+    if (waitq_sleep(0) < 0)
+        task_yield(); // multitasking not up yet
+    cpu_irq_restore(flags);
+}
+
 // ---- public API --------------------------------------------------------
 
 void pipe_init(void) {
@@ -99,8 +110,8 @@ int pipe_destroy(const char *name) {
     pipes[idx].in_use = 0;
     pipes[idx].name[0] = '\0';
     kring_u8_reset(&pipes[idx].ring);
-    // Any tasks blocked on this pipe will naturally unblock on next yield
-    // because pipe_read/pipe_write check in_use inside their loop.
+    // Blocked readers/writers recheck in_use when woken and fail.
+    waitq_wake_all(&pipes[idx].wq);
     kprintf("[pipe] destroyed '%s'\n", name);
     return 0;
 }
@@ -139,9 +150,11 @@ int pipe_read(int handle, void *buf, uint32_t len) {
             // Buffer empty — if we already have some bytes, return them
             if (got > 0) break;
             // Otherwise block until a writer pushes data
-            task_yield();
+            pipe_wait(idx);
         }
     }
+    if (got > 0)
+        waitq_wake_all(&pipes[idx].wq); // space for writers
     return (int)got;
 }
 
@@ -160,11 +173,13 @@ int pipe_write(int handle, const void *buf, uint32_t len) {
         if (kring_u8_push(&pipes[idx].ring, in[sent]) == 0) {
             sent++;
         } else {
-            // Buffer full — block (yield) until reader drains some space
+            // Buffer full — block until a reader drains some space
             if (sent > 0) break;
-            task_yield();
+            pipe_wait(idx);
         }
     }
+    if (sent > 0)
+        waitq_wake_all(&pipes[idx].wq); // data for readers
     return (int)sent;
 }
 
@@ -175,6 +190,26 @@ int pipe_close(int handle) {
     return 0;
 }
 
+int pipe_poll(int handle, int wait) {
+    if (handle < 0 || handle >= PIPE_FD_MAX || !pipe_fds[handle].in_use)
+        return POLLNVAL;
+    int idx = pipe_fds[handle].pipe_idx;
+    if (!pipes[idx].in_use)
+        return POLLHUP;
+
+    kring_u8_t *r = &pipes[idx].ring;
+    int revents = 0;
+    if (pipe_fds[handle].writable) {
+        if (kring_u8_used(r) < r->capacity - 1)
+            revents |= POLLOUT;
+    } else if (!kring_u8_empty(r)) {
+        revents |= POLLIN;
+    }
+    if (wait)
+        waitq_add(&pipes[idx].wq);
+    return revents;
+}
+
 int pipe_stat(const char *path, void *st_out) {
     vfs_stat_t *st = (vfs_stat_t *)st_out;
     if (!path || !st) return -1;
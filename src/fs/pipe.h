@@ -39,6 +39,11 @@ int pipe_write(int handle, const void *buf, uint32_t len);
 // Close a pipe fd slot (does not destroy the pipe).
 int pipe_close(int handle);
 
+// Readiness of a pipe fd slot as POLL* bits (see proc/waitq.h): POLLIN for
+// a reader with data, POLLOUT for a writer with space, POLLHUP once the pipe
+// is destroyed. If wait is set the caller is queued for the next change.
+int pipe_poll(int handle, int wait);
+
 // Stat a /pipe path. Returns 0 on success (fills size=used bytes, type=VFS_FILE).
 // Path may be "/pipe" (dir) or "/pipe/<name>" (file).
 int pipe_stat(const char *path, void *st_out);
@@ -2,6 +2,8 @@
 #include "liballoc/liballoc_1_1.h"
 #include "vfs_proc.h"
 #include "pipe.h"
+#include "dirindex.h"
+#include "proc/waitq.h"
 
 static const vfs_fs_ops_t *filesystems[VFS_MAX_FILESYSTEMS];
 static int fs_count = 0;
@@ -13,16 +15,32 @@ static int fs_count = 0;
 // Virtual files: -1001 .. -1000-VFS_MAX_VIRTUAL_FILES
 // Pipes: -2001 .. -2000-PIPE_FD_MAX  (well clear of virtual file range)
 #define VFS_PIPE_BASE_ID (-2000)
+// Directory streams: fs_id = VFS_DIR_BASE_ID - stream handle
+#define VFS_DIR_BASE_ID (-3000)
+#define VFS_MAX_DIRSTREAMS 32
 
 typedef struct {
     const char *name;
     uint32_t (*size_fn)(void);
     int (*read_fn)(uint32_t offset, void *buf, uint32_t len);
+    int (*write_fn)(const void *buf, uint32_t len); // NULL = read-only
 } vfs_virtual_file_t;
 
 static vfs_virtual_file_t virtual_files[VFS_MAX_VIRTUAL_FILES];
 static int virtual_file_count = 0;
 
+// Open directory stream: a reference to a directory index plus the byte
+// offset of the next record to return.
+typedef struct {
+    int in_use;
+    dirindex_t *idx;
+    uint32_t pos;
+} vfs_dirstream_t;
+
+static vfs_dirstream_t dirstreams[VFS_MAX_DIRSTREAMS];
+
+static dirindex_t *vfs_dirindex_for(const char *path);
+
 static void vfs_copy_path(char *dst, const char *src) {
     int i = 0;
     for (; i < VFS_PATH_MAX - 1 && src && src[i]; i++)
@@ -32,6 +50,12 @@ static void vfs_copy_path(char *dst, const char *src) {
 
 int vfs_register_virtual_file(const char *name, uint32_t (*size_fn)(void),
                               int (*read_fn)(uint32_t, void *, uint32_t)) {
+    return vfs_register_virtual_file_rw(name, size_fn, read_fn, NULL);
+}
+
+int vfs_register_virtual_file_rw(const char *name, uint32_t (*size_fn)(void),
+                                 int (*read_fn)(uint32_t, void *, uint32_t),
+                                 int (*write_fn)(const void *, uint32_t)) {
     if (!name || !size_fn || !read_fn)
         return -1;
     if (virtual_file_count >= VFS_MAX_VIRTUAL_FILES) {
@@ -41,6 +65,7 @@ int vfs_register_virtual_file(const char *name, uint32_t (*size_fn)(void),
     virtual_files[virtual_file_count].name = name;
     virtual_files[virtual_file_count].size_fn = size_fn;
     virtual_files[virtual_file_count].read_fn = read_fn;
+    virtual_files[virtual_file_count].write_fn = write_fn;
     kprintf("[vfs] register virtual name=%s\n", name);
     virtual_file_count++;
     return 0;
@@ -111,11 +136,34 @@ static int vfs_pipe_handle_from_fs_id(int fs_id) {
     return h;
 }
 
+static int vfs_dir_handle_from_fs_id(int fs_id) {
+    int h = VFS_DIR_BASE_ID - fs_id;
+    if (h < 0 || h >= VFS_MAX_DIRSTREAMS)
+        return -1;
+    return h;
+}
+
+// A name in `path`'s parent directory was created, removed or resized:
+// drop the parent's cached index.
+static void vfs_dir_changed(const char *path) {
+    char parent[VFS_PATH_MAX];
+    int n = 0;
+    for (; path[n] && n < VFS_PATH_MAX - 1; n++)
+        parent[n] = path[n];
+    while (n > 0 && parent[n - 1] == '/')
+        n--;
+    while (n > 0 && parent[n - 1] != '/')
+        n--;
+    parent[n] = '\0';
+    dirindex_invalidate(parent);
+}
+
 void vfs_init(void) {
     fs_count = 0;
     memset(filesystems, 0, sizeof(filesystems));
     virtual_file_count = 0;
     memset(virtual_files, 0, sizeof(virtual_files));
+    memset(dirstreams, 0, sizeof(dirstreams));
     pipe_init();
     vfs_proc_register_files();
 }
@@ -242,7 +290,7 @@ int vfs_open(vfs_fd_table_t *fdt, const char *path, int flags) {
     int vfi = vfs_find_virtual_file(path);
     if (vfi >= 0) {
         int access = flags & 0x3;
-        if (access != O_RDONLY) {
+        if (access != O_RDONLY && !virtual_files[vfi].write_fn) {
             kprintf("[vfs] open fail path=%s err=%d\n", path, -3);
             return -3;
         }
@@ -259,6 +307,8 @@ int vfs_open(vfs_fd_table_t *fdt, const char *path, int flags) {
             continue;
         int handle = filesystems[fs]->open(path, flags);
         if (handle >= 0) {
+            if (flags & (O_CREAT | O_TRUNC))
+                vfs_dir_changed(path);
             fdt->fds[fd].in_use = 1;
             fdt->fds[fd].fs_id = fs;
             fdt->fds[fd].fs_handle = handle;
@@ -285,6 +335,8 @@ int vfs_read(vfs_fd_table_t *fdt, int fd, void *buf, uint32_t len) {
     int fs = fdt->fds[fd].fs_id;
     if (fs < 0 && fs > VFS_VIRT_BASE_ID)
         return -1; // console fd, not VFS-backed
+    if (vfs_dir_handle_from_fs_id(fs) >= 0)
+        return -1; // directory, read with getdents
 
     // Named pipe read
     int ph = vfs_pipe_handle_from_fs_id(fs);
@@ -327,6 +379,8 @@ int vfs_write(vfs_fd_table_t *fdt, int fd, const void *buf, uint32_t len) {
     int fs = fdt->fds[fd].fs_id;
     if (fs < 0 && fs > VFS_VIRT_BASE_ID)
         return -1; // console fd, not VFS-backed
+    if (vfs_dir_handle_from_fs_id(fs) >= 0)
+        return -1;
 
     // Named pipe write
     int ph = vfs_pipe_handle_from_fs_id(fs);
@@ -335,6 +389,8 @@ int vfs_write(vfs_fd_table_t *fdt, int fd, const void *buf, uint32_t len) {
 
     int vfi = vfs_virtual_index_from_fs_id(fs);
     if (vfi >= 0) {
+        if (virtual_files[vfi].write_fn)
+            return virtual_files[vfi].write_fn(buf, len);
         kprintf("[vfs] write fail path=%s err=%d\n", fdt->fds[fd].debug_path,
                 -1);
         return -1;
@@ -349,6 +405,8 @@ int vfs_write(vfs_fd_table_t *fdt, int fd, const void *buf, uint32_t len) {
     if (rc < 0) {
         kprintf("[vfs] write fail path=%s err=%d\n", fdt->fds[fd].debug_path,
                 rc);
+    } else if (rc > 0) {
+        vfs_dir_changed(fdt->fds[fd].debug_path); // size in the listing
     }
     return rc;
 }
@@ -362,8 +420,13 @@ int vfs_close(vfs_fd_table_t *fdt, int fd) {
     int fs = fdt->fds[fd].fs_id;
     int ret = 0;
     int ph = vfs_pipe_handle_from_fs_id(fs);
+    int dh = vfs_dir_handle_from_fs_id(fs);
     if (ph >= 0) {
         ret = pipe_close(ph);
+    } else if (dh >= 0) {
+        dirindex_put(dirstreams[dh].idx);
+        dirstreams[dh].idx = NULL;
+        dirstreams[dh].in_use = 0;
     } else if (vfs_virtual_index_from_fs_id(fs) < 0) {
         if (fs >= 0 && filesystems[fs]->close) {
             ret = filesystems[fs]->close(fdt->fds[fd].fs_handle);
@@ -387,6 +450,22 @@ int vfs_seek(vfs_fd_table_t *fdt, int fd, int offset, int whence) {
     int fs = fdt->fds[fd].fs_id;
     if (fs < 0 && fs > VFS_VIRT_BASE_ID)
         return -1; // console fd, not seekable
+    int dh = vfs_dir_handle_from_fs_id(fs);
+    if (dh >= 0) {
+        // Directory: only rewind (picking up changes) and tell are allowed.
+        vfs_dirstream_t *ds = &dirstreams[dh];
+        if (whence == SEEK_CUR && offset == 0)
+            return (int)ds->pos;
+        if (whence != SEEK_SET || offset != 0)
+            return -1;
+        dirindex_t *fresh = vfs_dirindex_for(ds->idx->path);
+        if (fresh) {
+            dirindex_put(ds->idx);
+            ds->idx = fresh;
+        }
+        ds->pos = 0;
+        return 0;
+    }
     int vfi = vfs_virtual_index_from_fs_id(fs);
     if (vfi >= 0) {
         int size = (int)virtual_files[vfi].size_fn();
@@ -496,45 +575,156 @@ int vfs_readdir(const char *path, int index, char *buf, uint32_t size) {
     if (vfs_is_pipe_dir(path))
         return pipe_readdir(index, buf, size);
 
-    // Reading root "/": show "mos" and "pipe" virtual directory entries first
-    if (strcmp(path, "/") == 0 || strcmp(path, "") == 0) {
-        if (remaining == 0) {
-            const char *pname = "mos";
-            size_t n = 3;
-            if (n >= size) n = size - 1;
-            memcpy(buf, pname, n);
-            buf[n] = '\0';
-            return (int)(n + 1);
+    // Everything else (including "mos" and "pipe" in the root listing) is
+    // served from the directory index.
+    dirindex_t *idx = vfs_dirindex_for(path);
+    if (!idx)
+        return 0;
+    const vfs_dirent_t *de = dirindex_at(idx, (uint32_t)index);
+    int ret = 0;
+    if (de) {
+        uint32_t n = de->namelen;
+        if (n >= size)
+            n = size - 1;
+        memcpy(buf, de->name, n);
+        buf[n] = '\0';
+        ret = (int)(n + 1);
+    }
+    dirindex_put(idx);
+    return ret;
+}
+
+static int vfs_dir_emit(void *ctx, const char *name, uint32_t size,
+                        uint32_t type) {
+    return dirindex_add((dirindex_t *)ctx, name, size, type) < 0;
+}
+
+static int vfs_is_root_dir(const char *path) {
+    return strcmp(path, "/") == 0 || strcmp(path, "") == 0;
+}
+
+// Index of directory `path` with a reference held, or NULL if no
+// filesystem has it. Backend directories are cached; /mos and /pipe are
+// rebuilt every time since their sizes change without going through here.
+static dirindex_t *vfs_dirindex_for(const char *path) {
+    dirindex_t *idx;
+    if (vfs_is_mos_dir(path)) {
+        idx = dirindex_new(path);
+        for (int i = 0; idx && i < virtual_file_count; i++) {
+            const char *name = virtual_files[i].name;
+            if (name[0] == 'm' && name[1] == 'o' && name[2] == 's' &&
+                name[3] == '/')
+                name += 4;
+            dirindex_add(idx, name, virtual_files[i].size_fn(), VFS_FILE);
         }
-        remaining--;
-        if (remaining == 0) {
-            const char *pname = "pipe";
-            size_t n = 4;
-            if (n >= size) n = size - 1;
-            memcpy(buf, pname, n);
-            buf[n] = '\0';
-            return (int)(n + 1);
+        return idx;
+    }
+    if (vfs_is_pipe_dir(path)) {
+        idx = dirindex_new(path);
+        char name[PIPE_NAME_MAX + 1];
+        char ppath[PIPE_NAME_MAX + 8];
+        for (int i = 0; idx && pipe_readdir(i, name, sizeof(name)) > 0; i++) {
+            vfs_stat_t st = {0, VFS_FILE};
+            memcpy(ppath, "/pipe/", 6);
+            memcpy(ppath + 6, name, strlen(name) + 1);
+            pipe_stat(ppath, &st);
+            dirindex_add(idx, name, st.size, VFS_FILE);
         }
-        remaining--; // account for both "mos" and "pipe" entries
+        return idx;
     }
 
+    idx = dirindex_get(path);
+    if (idx)
+        return idx;
+    idx = dirindex_new(path);
+    if (!idx)
+        return NULL;
+
+    int found = 0;
+    if (vfs_is_root_dir(path)) {
+        dirindex_add(idx, "mos", 0, VFS_DIR);
+        dirindex_add(idx, "pipe", 0, VFS_DIR);
+        found = 1;
+    }
     for (int fs = 0; fs < fs_count; fs++) {
-        if (!filesystems[fs]->readdir)
+        if (!filesystems[fs]->listdir)
             continue;
+        if (filesystems[fs]->listdir(path, vfs_dir_emit, idx) == 0)
+            found = 1;
+    }
+    if (!found) {
+        dirindex_put(idx);
+        return NULL;
+    }
+    dirindex_publish(idx);
+    return idx;
+}
 
-        int local = 0;
-        while (1) {
-            int ret = filesystems[fs]->readdir(path, local, buf, size);
-            if (ret <= 0)
-                break;
-            if (remaining == 0)
-                return ret;
-            remaining--;
-            local++;
+int vfs_opendir(vfs_fd_table_t *fdt, const char *path) {
+    if (!fdt || !path)
+        return -1;
+
+    int fd = -1;
+    for (int i = 0; i < VFS_MAX_FDS_PER_TASK; i++) {
+        if (!fdt->fds[i].in_use) {
+            fd = i;
+            break;
         }
     }
+    if (fd < 0)
+        return -2;
 
-    return 0;
+    int h = -1;
+    for (int i = 0; i < VFS_MAX_DIRSTREAMS; i++) {
+        if (!dirstreams[i].in_use) {
+            h = i;
+            break;
+        }
+    }
+    if (h < 0) {
+        kprintf("[vfs] opendir fail path=%s err=%d\n", path, -3);
+        return -3;
+    }
+
+    dirindex_t *idx = vfs_dirindex_for(path);
+    if (!idx)
+        return -1;
+
+    dirstreams[h].in_use = 1;
+    dirstreams[h].idx = idx;
+    dirstreams[h].pos = 0;
+    fdt->fds[fd].in_use = 1;
+    fdt->fds[fd].fs_id = VFS_DIR_BASE_ID - h;
+    fdt->fds[fd].fs_handle = h;
+    fdt->fds[fd].open_flags = O_RDONLY;
+    vfs_copy_path(fdt->fds[fd].debug_path, path);
+    return fd;
+}
+
+int vfs_getdents(vfs_fd_table_t *fdt, int fd, void *buf, uint32_t size) {
+    if (!fdt || fd < 0 || fd >= VFS_MAX_FDS_PER_TASK || !buf)
+        return -1;
+    if (!fdt->fds[fd].in_use)
+        return -1;
+    int dh = vfs_dir_handle_from_fs_id(fdt->fds[fd].fs_id);
+    if (dh < 0)
+        return -1;
+
+    vfs_dirstream_t *ds = &dirstreams[dh];
+    dirindex_t *idx = ds->idx;
+    uint32_t start = ds->pos;
+    uint32_t end = start;
+    while (end < idx->len) {
+        uint32_t reclen = ((const vfs_dirent_t *)(idx->buf + end))->reclen;
+        if (end + reclen - start > size)
+            break;
+        end += reclen;
+    }
+    if (end == start)
+        return (start < idx->len) ? -1 : 0; // buffer too small, or done
+    memcpy(buf, idx->buf + start, end - start);
+    ds->pos = end;
+    return (int)(end - start);
 }
 
 int vfs_unlink(const char *path) {
@@ -546,8 +736,10 @@ int vfs_unlink(const char *path) {
     for (int fs = 0; fs < fs_count; fs++) {
         if (!filesystems[fs]->unlink)
             continue;
-        if (filesystems[fs]->unlink(path) == 0)
+        if (filesystems[fs]->unlink(path) == 0) {
+            vfs_dir_changed(path);
             return 0;
+        }
     }
     return -1;
 }
@@ -559,8 +751,10 @@ int vfs_mkdir(const char *path) {
     for (int fs = 0; fs < fs_count; fs++) {
         if (!filesystems[fs]->mkdir)
             continue;
-        if (filesystems[fs]->mkdir(path) == 0)
+        if (filesystems[fs]->mkdir(path) == 0) {
+            vfs_dir_changed(path);
             return 0;
+        }
     }
     return -1;
 }
@@ -572,8 +766,10 @@ int vfs_rmdir(const char *path) {
     for (int fs = 0; fs < fs_count; fs++) {
         if (!filesystems[fs]->rmdir)
             continue;
-        if (filesystems[fs]->rmdir(path) == 0)
+        if (filesystems[fs]->rmdir(path) == 0) {
+            dirindex_invalidate_all(); // the directory and anything below
             return 0;
+        }
     }
     return -1;
 }
@@ -631,8 +827,10 @@ int vfs_rename(const char *oldpath, const char *newpath) {
     for (int fs = 0; fs < fs_count; fs++) {
         if (!filesystems[fs]->rename)
             continue;
-        if (filesystems[fs]->rename(oldpath, newpath) == 0)
+        if (filesystems[fs]->rename(oldpath, newpath) == 0) {
+            dirindex_invalidate_all(); // a moved directory takes its subtree
             return 0;
+        }
     }
     return -1;
 }
@@ -655,7 +853,29 @@ int vfs_ftruncate(vfs_fd_table_t *fdt, int fd, uint32_t length) {
         return -1;
     if (!filesystems[fs]->ftruncate)
         return -1;
-    return filesystems[fs]->ftruncate(fdt->fds[fd].fs_handle, length);
+    int rc = filesystems[fs]->ftruncate(fdt->fds[fd].fs_handle, length);
+    if (rc == 0)
+        vfs_dir_changed(fdt->fds[fd].debug_path);
+    return rc;
+}
+
+int vfs_poll(vfs_fd_table_t *fdt, int fd, int wait) {
+    if (!fdt || fd < 0 || fd >= VFS_MAX_FDS_PER_TASK)
+        return POLLNVAL;
+    if (!fdt->fds[fd].in_use)
+        return POLLNVAL;
+
+    int ph = vfs_pipe_handle_from_fs_id(fdt->fds[fd].fs_id);
+    if (ph >= 0)
+        return pipe_poll(ph, wait);
+
+    // Files, directories and virtual files never block
+    int access = fdt->fds[fd].open_flags & 0x3;
+    if (access == O_RDONLY)
+        return POLLIN;
+    if (access == O_WRONLY)
+        return POLLOUT;
+    return POLLIN | POLLOUT;
 }
 
 void vfs_close_all(vfs_fd_table_t *fdt) {
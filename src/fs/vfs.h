@@ -30,6 +30,23 @@ typedef struct {
     uint32_t type; // VFS_FILE or VFS_DIR
 } vfs_stat_t;
 
+// Directory entry record as returned by getdents. Records are packed
+// back to back; reclen (a multiple of 4) is the offset of the next one.
+typedef struct {
+    uint32_t size;
+    uint16_t reclen;
+    uint8_t type;    // VFS_FILE or VFS_DIR
+    uint8_t namelen; // name is also NUL-terminated
+    char name[];
+} vfs_dirent_t;
+
+#define VFS_DIRENT_RECLEN(namelen)                                             \
+    ((uint32_t)(sizeof(vfs_dirent_t) + (namelen) + 1 + 3) & ~3u)
+
+// listdir callback: called once per entry. Return nonzero to stop early.
+typedef int (*vfs_dir_emit_t)(void *ctx, const char *name, uint32_t size,
+                              uint32_t type);
+
 // Filesystem operations - each FS backend implements these
 typedef struct vfs_fs_ops {
     const char *name;
@@ -39,7 +56,9 @@ typedef struct vfs_fs_ops {
     int (*close)(int handle);
     int (*seek)(int handle, int offset, int whence);
     int (*stat)(const char *path, vfs_stat_t *st);
-    int (*readdir)(const char *path, int index, char *buf, uint32_t size);
+    // Emit every entry of directory `path`. Returns 0 if this fs has the
+    // directory, -1 otherwise.
+    int (*listdir)(const char *path, vfs_dir_emit_t emit, void *ctx);
     int (*unlink)(const char *path);
     int (*mkdir)(const char *path);
     int (*rmdir)(const char *path);
@@ -67,6 +86,12 @@ int vfs_register_fs(const vfs_fs_ops_t *ops);
 int vfs_register_virtual_file(const char *name, uint32_t (*size_fn)(void),
                               int (*read_fn)(uint32_t offset, void *buf,
                                              uint32_t len));
+// Same, plus a handler for writes (returns bytes consumed or -1)
+int vfs_register_virtual_file_rw(const char *name, uint32_t (*size_fn)(void),
+                                 int (*read_fn)(uint32_t offset, void *buf,
+                                                uint32_t len),
+                                 int (*write_fn)(const void *buf,
+                                                 uint32_t len));
 int vfs_get_registered_fs_count(void);
 const char *vfs_get_registered_fs_name(int idx);
 int vfs_get_virtual_file_count(void);
@@ -80,11 +105,20 @@ int vfs_close(vfs_fd_table_t *fdt, int fd);
 int vfs_seek(vfs_fd_table_t *fdt, int fd, int offset, int whence);
 int vfs_stat(const char *path, vfs_stat_t *st);
 int vfs_readdir(const char *path, int index, char *buf, uint32_t size);
+// Directory streams: opendir returns an fd in fdt (closed with vfs_close);
+// getdents fills buf with whole vfs_dirent_t records from the fd's cursor
+// and returns the bytes written, 0 at the end, -1 on error or when buf
+// cannot hold the next record. Seeking to 0 rewinds.
+int vfs_opendir(vfs_fd_table_t *fdt, const char *path);
+int vfs_getdents(vfs_fd_table_t *fdt, int fd, void *buf, uint32_t size);
 int vfs_unlink(const char *path);
 int vfs_mkdir(const char *path);
 int vfs_rmdir(const char *path);
 int vfs_rename(const char *oldpath, const char *newpath);
 int vfs_ftruncate(vfs_fd_table_t *fdt, int fd, uint32_t length);
+// Readiness of fd as POLL* bits (proc/waitq.h). Only pipes can block; with
+// wait set the caller is queued on the pipe for the next change.
+int vfs_poll(vfs_fd_table_t *fdt, int fd, int wait);
 
 // Resolve a relative path against a cwd into an absolute path.
 // out must be at least VFS_PATH_MAX bytes.
@@ -1,17 +1,25 @@
 #include "vfs_proc.h"
 
 #include "arch/arch.h"
+#include "fs/dcache.h"
+#include "fs/dirindex.h"
+#include "fs/fat16.h"
+#include "fs/fat32.h"
 #include "io/window.h"
 #include "liballoc/liballoc_hooks.h"
 #include "memlayout.h"
 #include "net/net.h"
 #include "proc/pmm.h"
 #include "proc/task.h"
+#include "ktrace.h"
+#include "prof.h"
+#include "sysstat.h"
 #include "utils/strbuf.h"
 #include "version.h"
 #include "vfs.h"
 
-static char vgen_buf[4096];
+// Sized for /mos/ksyscall: a counter line and a histogram line per syscall
+static char vgen_buf[16384];
 
 typedef uint32_t (*vgen_fn_t)(char *dst, uint32_t cap);
 
@@ -247,6 +255,74 @@ static uint32_t vgen_vfs(char *dst, uint32_t cap) {
         append_cstr(dst, cap, &len, vfs_get_virtual_file_name(i));
         append_cstr(dst, cap, &len, "\n");
     }
+
+    dcache_stats_t dc;
+    dcache_get_stats(&dc);
+    append_cstr(dst, cap, &len, "dcache.entries: ");
+    append_dec_u32(dst, cap, &len, dc.entries);
+    append_cstr(dst, cap, &len, "\ndcache.hits: ");
+    append_dec_u32(dst, cap, &len, dc.hits);
+    append_cstr(dst, cap, &len, "\ndcache.negative_hits: ");
+    append_dec_u32(dst, cap, &len, dc.negative_hits);
+    append_cstr(dst, cap, &len, "\ndcache.misses: ");
+    append_dec_u32(dst, cap, &len, dc.misses);
+    append_cstr(dst, cap, &len, "\ndcache.evictions: ");
+    append_dec_u32(dst, cap, &len, dc.evictions);
+    append_cstr(dst, cap, &len, "\ndcache.invalidations: ");
+    append_dec_u32(dst, cap, &len, dc.invalidations);
+    append_cstr(dst, cap, &len, "\n");
+
+    dirindex_stats_t di;
+    dirindex_get_stats(&di);
+    append_cstr(dst, cap, &len, "dirindex.cached: ");
+    append_dec_u32(dst, cap, &len, di.cached);
+    append_cstr(dst, cap, &len, "\ndirindex.bytes: ");
+    append_dec_u32(dst, cap, &len, di.bytes);
+    append_cstr(dst, cap, &len, "\ndirindex.hits: ");
+    append_dec_u32(dst, cap, &len, di.hits);
+    append_cstr(dst, cap, &len, "\ndirindex.builds: ");
+    append_dec_u32(dst, cap, &len, di.builds);
+    append_cstr(dst, cap, &len, "\ndirindex.invalidations: ");
+    append_dec_u32(dst, cap, &len, di.invalidations);
+    append_cstr(dst, cap, &len, "\n");
+
+    fat16_stats_t fs;
+    fat16_get_stats(&fs);
+    if (fs.mounted) {
+        append_cstr(dst, cap, &len, "fat16.clusters: ");
+        append_dec_u32(dst, cap, &len, fs.cluster_count);
+        append_cstr(dst, cap, &len, "\nfat16.free_clusters: ");
+        append_dec_u32(dst, cap, &len, fs.free_clusters);
+        append_cstr(dst, cap, &len, "\nfat16.cluster_size: ");
+        append_dec_u32(dst, cap, &len, fs.cluster_size);
+        append_cstr(dst, cap, &len, "\nfat16.cache_blocks: ");
+        append_dec_u32(dst, cap, &len, fs.cache_blocks);
+        append_cstr(dst, cap, &len, "\nfat16.cache_hits: ");
+        append_dec_u32(dst, cap, &len, fs.cache_hits);
+        append_cstr(dst, cap, &len, "\nfat16.cache_misses: ");
+        append_dec_u32(dst, cap, &len, fs.cache_misses);
+        append_cstr(dst, cap, &len, "\nfat16.readahead_blocks: ");
+        append_dec_u32(dst, cap, &len, fs.cache_prefetched);
+        append_cstr(dst, cap, &len, "\n");
+    }
+
+    fat32_stats_t f32;
+    fat32_get_stats(&f32);
+    if (f32.mounted) {
+        append_cstr(dst, cap, &len, "fat32.clusters: ");
+        append_dec_u32(dst, cap, &len, f32.cluster_count);
+        append_cstr(dst, cap, &len, "\nfat32.free_clusters: ");
+        append_dec_u32(dst, cap, &len, f32.free_clusters);
+        append_cstr(dst, cap, &len, "\nfat32.cluster_size: ");
+        append_dec_u32(dst, cap, &len, f32.cluster_size);
+        append_cstr(dst, cap, &len, "\nfat32.cache_hits: ");
+        append_dec_u32(dst, cap, &len, f32.cache_hits);
+        append_cstr(dst, cap, &len, "\nfat32.cache_misses: ");
+        append_dec_u32(dst, cap, &len, f32.cache_misses);
+        append_cstr(dst, cap, &len, "\nfat32.readahead_blocks: ");
+        append_dec_u32(dst, cap, &len, f32.cache_prefetched);
+        append_cstr(dst, cap, &len, "\n");
+    }
     return len;
 }
 
@@ -344,7 +420,9 @@ static uint32_t vgen_net(char *dst, uint32_t cap) {
     net_get_config(&ip_be, &mask_be, &gw_be);
     net_get_stats(&rx, &tx);
 
-    append_cstr(dst, cap, &len, "ip   ");
+    append_cstr(dst, cap, &len, "nic  ");
+    append_cstr(dst, cap, &len, net_get_nic_name());
+    append_cstr(dst, cap, &len, "\nip   ");
     append_ip_be(dst, cap, &len, ip_be);
     append_cstr(dst, cap, &len, "\nmask ");
     append_ip_be(dst, cap, &len, mask_be);
@@ -354,6 +432,42 @@ static uint32_t vgen_net(char *dst, uint32_t cap) {
     append_dec_u32(dst, cap, &len, rx);
     append_cstr(dst, cap, &len, "\ntxpk ");
     append_dec_u32(dst, cap, &len, tx);
+
+    net_softirq_stats_t ss;
+    net_get_softirq_stats(&ss);
+    append_cstr(dst, cap, &len, "\nirqs ");
+    append_dec_u32(dst, cap, &len, ss.irqs);
+    append_cstr(dst, cap, &len, "\nwake ");
+    append_dec_u32(dst, cap, &len, ss.wakeups);
+    append_cstr(dst, cap, &len, "\nbats ");
+    append_dec_u32(dst, cap, &len, ss.batches);
+    append_cstr(dst, cap, &len, "\nbpkt ");
+    append_dec_u32(dst, cap, &len, ss.batch_pkts);
+    append_cstr(dst, cap, &len, "\nbmax ");
+    append_dec_u32(dst, cap, &len, ss.batch_max);
+    append_cstr(dst, cap, &len, "\nbful ");
+    append_dec_u32(dst, cap, &len, ss.budget_hits);
+    append_cstr(dst, cap, &len, "\ntmo  ");
+    append_dec_u32(dst, cap, &len, ss.timeout_runs);
+    // Batch size histogram: 0 1 2-3 4-7 8-15 16+
+    append_cstr(dst, cap, &len, "\nbhst");
+    for (int i = 0; i < NET_BATCH_HIST; i++) {
+        append_cstr(dst, cap, &len, " ");
+        append_dec_u32(dst, cap, &len, ss.hist[i]);
+    }
+
+    net_sock_stats_t ks;
+    net_get_sock_stats(&ks);
+    append_cstr(dst, cap, &len, "\nsock ");
+    append_dec_u32(dst, cap, &len, ks.open);
+    append_cstr(dst, cap, &len, "\nspk  ");
+    append_dec_u32(dst, cap, &len, ks.peak);
+    append_cstr(dst, cap, &len, "\nacc  ");
+    append_dec_u32(dst, cap, &len, ks.accepted);
+    append_cstr(dst, cap, &len, "\nrefu ");
+    append_dec_u32(dst, cap, &len, ks.refused);
+    append_cstr(dst, cap, &len, "\nudrp ");
+    append_dec_u32(dst, cap, &len, ks.dgram_drops);
     append_cstr(dst, cap, &len, "\n");
     return len;
 }
@@ -472,6 +586,35 @@ static int vfile_version_read(uint32_t offset, void *buf, uint32_t len) {
     return vfile_read_from_generated(vgen_version, offset, buf, len);
 }
 
+static uint32_t vfile_syscall_size(void) {
+    return vfile_size_from_generated(sysstat_format);
+}
+static int vfile_syscall_read(uint32_t offset, void *buf, uint32_t len) {
+    return vfile_read_from_generated(sysstat_format, offset, buf, len);
+}
+// Any write clears the counters
+static int vfile_syscall_write(const void *buf, uint32_t len) {
+    (void)buf;
+    sysstat_reset();
+    return (int)len;
+}
+
+static uint32_t vfile_prof_size(void) { return prof_size(); }
+static int vfile_prof_read(uint32_t offset, void *buf, uint32_t len) {
+    return prof_read(offset, buf, len);
+}
+static int vfile_prof_write(const void *buf, uint32_t len) {
+    return prof_ctl(buf, len);
+}
+
+static uint32_t vfile_ktrace_size(void) { return ktrace_size(); }
+static int vfile_ktrace_read(uint32_t offset, void *buf, uint32_t len) {
+    return ktrace_read(offset, buf, len);
+}
+static int vfile_ktrace_write(const void *buf, uint32_t len) {
+    return ktrace_ctl(buf, len);
+}
+
 void vfs_proc_register_files(void) {
     // Virtual kernel info files live under /mos/ in the VFS tree
     vfs_register_virtual_file("mos/kdebug", vfile_kdebug_size,
@@ -495,4 +638,10 @@ void vfs_proc_register_files(void) {
     vfs_register_virtual_file("mos/knet", vfile_net_size, vfile_net_read);
     vfs_register_virtual_file("mos/kver", vfile_version_size,
                               vfile_version_read);
+    vfs_register_virtual_file_rw("mos/ksyscall", vfile_syscall_size,
+                                 vfile_syscall_read, vfile_syscall_write);
+    vfs_register_virtual_file_rw("mos/kprof", vfile_prof_size, vfile_prof_read,
+                                 vfile_prof_write);
+    vfs_register_virtual_file_rw("mos/ktrace", vfile_ktrace_size,
+                                 vfile_ktrace_read, vfile_ktrace_write);
 }
@@ -78,6 +78,7 @@ int window_destroy(int wid, uint32_t pid) {
     }
 
     uint16_t gen = win->generation;
+    waitq_wake_all(&win->key_wq);
     if (win->buffer)
         kfree(win->buffer);
     memset(win, 0, sizeof(kernel_window_t));
@@ -147,10 +148,25 @@ int window_sendkey(int wid, uint8_t key) {
         cpu_irq_restore(flags);
         return -1;
     }
+    waitq_wake_all(&win->key_wq);
     cpu_irq_restore(flags);
     return 0;
 }
 
+int window_poll(int wid, uint32_t pid, int wait) {
+    unsigned int flags = cpu_irq_save();
+    kernel_window_t *win = win_get(wid);
+    if (!win || win->owner_pid != pid) {
+        cpu_irq_restore(flags);
+        return POLLNVAL;
+    }
+    int revents = kring_u8_empty(&win->key_ring) ? 0 : POLLIN;
+    if (wait)
+        waitq_add(&win->key_wq);
+    cpu_irq_restore(flags);
+    return revents;
+}
+
 int window_list(win_info_t *out, int max_count) {
     if (!out || max_count <= 0)
         return 0;
@@ -175,6 +191,7 @@ void window_cleanup_pid(uint32_t pid) {
     for (int i = 0; i < MAX_WINDOWS; i++) {
         if (windows[i].active && windows[i].owner_pid == pid) {
             uint16_t gen = windows[i].generation;
+            waitq_wake_all(&windows[i].key_wq);
             if (windows[i].buffer)
                 kfree(windows[i].buffer);
             memset(&windows[i], 0, sizeof(kernel_window_t));
@@ -2,6 +2,7 @@
 #define _WINDOW_H
 
 #include "lib.h"
+#include "proc/waitq.h"
 #include "utils/kring.h"
 
 #define MAX_WINDOWS 8
@@ -26,6 +27,7 @@ typedef struct {
     uint32_t buf_size;
     uint8_t key_buf[WIN_KEY_BUF_SIZE];
     kring_u8_t key_ring;
+    waitq_t key_wq; // owner sleeping in poll for a key
     // Text output ring buffer (for stdout redirection)
     char text_buf[WIN_TEXT_BUF_SIZE];
     kring_u8_t text_ring;
@@ -46,6 +48,8 @@ int window_write(int wid, uint32_t pid, const uint8_t *data, uint32_t len);
 int window_read(int wid, uint8_t *dest, uint32_t len);
 int window_getkey(int wid, uint32_t pid);
 int window_sendkey(int wid, uint8_t key);
+// POLLIN when the key ring is non-empty; wait queues the owner for a key
+int window_poll(int wid, uint32_t pid, int wait);
 int window_list(win_info_t *out, int max_count);
 void window_cleanup_pid(uint32_t pid);
 int window_append_text(int wid, const char *data, int len);
@@ -4,11 +4,13 @@
 #include "arch/arch.h"
 #include "boot/multiboot.h"
 #include "fs/fat16.h"
+#include "fs/fat32.h"
 #include "fs/vfs.h"
 #include "io/console.h"
 #include "io/keyboard.h"
 #include "io/window.h"
 #include "liballoc/liballoc_1_1.h"
+#include "membench.h"
 #include "memlayout.h"
 #include "net/net.h"
 #include "proc/pmm.h"
@@ -80,6 +82,7 @@ static int str_ends_with(const char *s, const char *sfx) {
 
 void kernel_main(uint32_t multiboot_magic, multiboot_info_t *multiboot_info) {
     init_686();
+    memops_init();
     kprintf("[boot] mateOS %s (abi=%d, built=%s)\n", KERNEL_VERSION_FULL,
             KERNEL_VERSION_ABI, KERNEL_BUILD_DATE_UTC);
     kprintf("[boot] paging init ok\n");
@@ -120,7 +123,7 @@ void kernel_main(uint32_t multiboot_magic, multiboot_info_t *multiboot_info) {
     pci_init();
     kprintf("[boot] pci scan ok\n");
 
-    // Initialize network (RTL8139 + minimal ARP/ICMP)
+    // Initialize network (virtio-net, e1000 or RTL8139 + lwIP)
     net_init();
     kprintf("[boot] net init ok\n");
 
@@ -135,11 +138,19 @@ void kernel_main(uint32_t multiboot_magic, multiboot_info_t *multiboot_info) {
     }
     vfs_register_fs(fat16_get_ops());
     kprintf("[boot] fat16 boot disk ok\n");
+    // Optional FAT32 data disk on the primary slave, mounted at /data
+    if (fat32_init() == 0) {
+        vfs_register_fs(fat32_get_ops());
+        kprintf("[boot] fat32 data disk ok\n");
+    }
 
     // Initialize task system
     task_init();
     kprintf("[boot] task init ok\n");
 
+    // Packet processing and lwIP timers run in their own kernel task
+    net_start();
+
     // Initialize syscall handler
     syscall_init();
     kprintf("[boot] syscall init ok\n");
@@ -172,6 +183,10 @@ void kernel_main(uint32_t multiboot_magic, multiboot_info_t *multiboot_info) {
     keyboard_buffer_init();
     keyboard_buffer_enable(1);
 
+    // membench=1: time memcpy/memset/memmove before starting userland
+    if (cmdline_has_token(cmdline, "membench=1"))
+        membench_run();
+
     // Executables live in /bin/ on the FAT16 boot disk
     const char *boot_prog = "bin/init.elf";
     char autorun_name[64];
@@ -203,8 +218,11 @@ void kernel_main(uint32_t multiboot_magic, multiboot_info_t *multiboot_info) {
         printf("No boot program available. System halted.\n");
     }
 
-    // Main loop - just halt and wait for interrupts
+    // Idle loop - halt until an interrupt, then hand the CPU to any task it
+    // woke (e.g. the net task) instead of idling out the rest of the tick.
     while (1) {
         halt_and_catch_fire();
+        if (task_is_enabled())
+            task_yield();
     }
 }
@@ -0,0 +1,95 @@
+#include "ktrace.h"
+#include "arch/arch.h"
+#include "proc/task.h"
+
+volatile int ktrace_enabled = 0;
+
+static ktrace_rec_t ring[KTRACE_RECORDS];
+static uint32_t head = 0; // records ever written since the last start
+
+void ktrace_emit(uint32_t event, uint32_t a0, uint32_t a1, uint32_t a2) {
+    uint32_t lo, hi;
+    task_t *cur = task_current();
+
+    // Tracepoints fire from IRQs too; one CPU, so masking them is enough
+    uint32_t irq = cpu_irq_save();
+    ktrace_rec_t *r = &ring[head & (KTRACE_RECORDS - 1)];
+    head++;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    r->tsc = ((uint64_t)hi << 32) | lo;
+    r->cpu = 0;
+    r->event = (uint8_t)event;
+    r->pid = cur ? (uint16_t)cur->id : 0;
+    r->args[0] = a0;
+    r->args[1] = a1;
+    r->args[2] = a2;
+    cpu_irq_restore(irq);
+}
+
+static uint32_t ktrace_count(void) {
+    return head < KTRACE_RECORDS ? head : KTRACE_RECORDS;
+}
+
+uint32_t ktrace_size(void) {
+    return sizeof(ktrace_header_t) + ktrace_count() * sizeof(ktrace_rec_t);
+}
+
+int ktrace_read(uint32_t offset, void *buf, uint32_t len) {
+    if (!buf || len == 0)
+        return 0;
+    ktrace_header_t hdr;
+    hdr.magic = KTRACE_MAGIC;
+    hdr.version = KTRACE_VERSION;
+    hdr.rec_size = sizeof(ktrace_rec_t);
+    hdr.tsc_per_ms = vdso_tsc_per_ms();
+    hdr.count = ktrace_count();
+    hdr.lost = head - hdr.count;
+    hdr.running = (uint32_t)ktrace_enabled;
+
+    uint32_t total = sizeof(hdr) + hdr.count * sizeof(ktrace_rec_t);
+    if (offset >= total)
+        return 0;
+    if (len > total - offset)
+        len = total - offset;
+
+    uint8_t *dst = (uint8_t *)buf;
+    uint32_t done = 0;
+    if (offset < sizeof(hdr)) {
+        done = sizeof(hdr) - offset;
+        if (done > len)
+            done = len;
+        memcpy(dst, (const uint8_t *)&hdr + offset, done);
+    }
+    // Byte offsets past the header index records oldest first
+    uint32_t oldest = head - hdr.count;
+    while (done < len) {
+        uint32_t pos = offset + done - sizeof(hdr);
+        uint32_t rec = pos / sizeof(ktrace_rec_t);
+        uint32_t in = pos % sizeof(ktrace_rec_t);
+        uint32_t n = sizeof(ktrace_rec_t) - in;
+        if (n > len - done)
+            n = len - done;
+        const ktrace_rec_t *r = &ring[(oldest + rec) & (KTRACE_RECORDS - 1)];
+        memcpy(dst + done, (const uint8_t *)r + in, n);
+        done += n;
+    }
+    return (int)len;
+}
+
+int ktrace_ctl(const void *buf, uint32_t len) {
+    const char *p = (const char *)buf;
+    if (len == 0)
+        return 0;
+    if (p[0] == '1') {
+        uint32_t irq = cpu_irq_save();
+        head = 0;
+        ktrace_enabled = 1;
+        cpu_irq_restore(irq);
+    } else if (p[0] == '0') {
+        ktrace_enabled = 0;
+    } else {
+        return -1;
+    }
+    kprintf("[ktrace] tracing %s\n", ktrace_enabled ? "started" : "stopped");
+    return (int)len;
+}
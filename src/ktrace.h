@@ -0,0 +1,65 @@
+#ifndef _KTRACE_H
+#define _KTRACE_H
+
+#include "lib.h"
+
+// Kernel event tracing: static tracepoints append fixed-size binary records
+// (TSC timestamp, CPU, event id, pid, three args) to an in-memory ring that
+// overwrites its oldest entries. Off by default and a single flag test when
+// off. Read as /mos/ktrace (header, then records oldest first); write "1"
+// to clear and start, "0" to stop. Stop before reading: records are not
+// snapshotted. tools/ktrace2json.py turns a dump into a Perfetto timeline.
+#define KTRACE_MAGIC 0x4352544Bu // "KTRC"
+#define KTRACE_VERSION 1
+#define KTRACE_RECORDS 4096 // power of two
+
+// Event ids and their args
+enum {
+    KT_SCHED_SWITCH = 1, // prev pid, next pid, prev state
+    KT_TASK_SPAWN,       // pid, parent pid, ring
+    KT_TASK_EXIT,        // pid, exit code
+    KT_IRQ_ENTER,        // irq
+    KT_IRQ_EXIT,         // irq
+    KT_SYSCALL_ENTER,    // nr, ebx, ecx
+    KT_SYSCALL_EXIT,     // nr, return value
+    KT_PAGE_FAULT,       // fault address, eip, error code
+    KT_DISK_START,       // lba, sectors, drive | write << 1
+    KT_DISK_DONE,        // lba, status (0 or -1), drive | write << 1
+    KT_NIC_RX,           // frames delivered, budget
+    KT_NIC_TX_DONE,      // TX descriptors reclaimed
+};
+
+typedef struct {
+    uint64_t tsc;
+    uint8_t cpu;
+    uint8_t event;
+    uint16_t pid; // task running when the event fired
+    uint32_t args[3];
+} ktrace_rec_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_size;   // sizeof(ktrace_rec_t)
+    uint32_t tsc_per_ms; // 0 if the TSC was not calibrated
+    uint32_t count;      // records that follow
+    uint32_t lost;       // older records overwritten by the ring
+    uint32_t running;
+} ktrace_header_t;
+
+extern volatile int ktrace_enabled;
+void ktrace_emit(uint32_t event, uint32_t a0, uint32_t a1, uint32_t a2);
+
+#define KTRACE(ev, a0, a1, a2)                                                 \
+    do {                                                                       \
+        if (ktrace_enabled)                                                    \
+            ktrace_emit((ev), (uint32_t)(a0), (uint32_t)(a1),                  \
+                        (uint32_t)(a2));                                       \
+    } while (0)
+
+// /mos/ktrace backing
+uint32_t ktrace_size(void);
+int ktrace_read(uint32_t offset, void *buf, uint32_t len);
+int ktrace_ctl(const void *buf, uint32_t len);
+
+#endif
@@ -27,23 +27,87 @@ int strcmp(const char *s1, const char *s2) {
     return *(unsigned char *)s1 - *(unsigned char *)s2;
 }
 
+// String instructions do the bulk work: the destination is dword aligned
+// with a few byte moves, then rep movsd/stosd, then the 0-3 byte tail. On
+// CPUs with ERMS (enhanced rep movsb/stosb) the microcode does that itself,
+// so larger blocks go straight to rep movsb/stosb.
+#define MEM_ERMS_MIN 128
+#define MEM_WORDS_MIN 16
+
+static int mem_erms = 0;
+
+void memops_init(void) {
+    cpu_info_t info;
+    cpu_get_info(&info);
+    mem_erms = (info.feature7_ebx & CPUID7_EBX_ERMS) != 0;
+    kprintf("[boot] memcpy/memset: %s\n",
+            mem_erms ? "rep movsb/stosb (ERMS)" : "rep movsd/stosd");
+}
+
+static inline void rep_movsb(void **d, const void **s, size_t n) {
+    __asm__ volatile("rep movsb"
+                     : "+D"(*d), "+S"(*s), "+c"(n)
+                     :
+                     : "memory");
+}
+
+static inline void rep_movsd(void **d, const void **s, size_t n) {
+    __asm__ volatile("rep movsl"
+                     : "+D"(*d), "+S"(*s), "+c"(n)
+                     :
+                     : "memory");
+}
+
+static inline void rep_stosb(void **d, uint32_t v, size_t n) {
+    __asm__ volatile("rep stosb" : "+D"(*d), "+c"(n) : "a"(v) : "memory");
+}
+
+static inline void rep_stosd(void **d, uint32_t v, size_t n) {
+    __asm__ volatile("rep stosl" : "+D"(*d), "+c"(n) : "a"(v) : "memory");
+}
+
 void *memset(void *ptr, int value, size_t num) {
-    unsigned char *p = ptr;
-    while (num--) {
-        *p++ = (unsigned char)value;
+    void *d = ptr;
+    uint32_t v = (uint8_t)value * 0x01010101u;
+    if (num >= MEM_WORDS_MIN && !(mem_erms && num >= MEM_ERMS_MIN)) {
+        size_t head = (0u - (uint32_t)d) & 3;
+        rep_stosb(&d, v, head);
+        num -= head;
+        rep_stosd(&d, v, num >> 2);
+        num &= 3;
     }
+    rep_stosb(&d, v, num);
     return ptr;
 }
 
 void *memcpy(void *dest, const void *src, size_t num) {
-    unsigned char *d = dest;
-    const unsigned char *s = src;
-    while (num--) {
-        *d++ = *s++;
+    void *d = dest;
+    const void *s = src;
+    if (num >= MEM_WORDS_MIN && !(mem_erms && num >= MEM_ERMS_MIN)) {
+        size_t head = (0u - (uint32_t)d) & 3;
+        rep_movsb(&d, &s, head);
+        num -= head;
+        rep_movsd(&d, &s, num >> 2);
+        num &= 3;
     }
+    rep_movsb(&d, &s, num);
     return dest;
 }
 
+void zero_page(void *page) { rep_stosd(&page, 0, 1024); }
+
+void copy_page(void *dst, const void *src) { rep_movsd(&dst, &src, 1024); }
+
+// 64/32 divide with divl (no libgcc in the kernel); saturates
+uint32_t div64_32(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n;
+    if (!d || hi >= d)
+        return 0xFFFFFFFFu;
+    uint32_t q;
+    __asm__("divl %2" : "=a"(q), "+d"(hi) : "rm"(d), "a"(lo));
+    return q;
+}
+
 int strncmp(const char *s1, const char *s2, size_t n) {
     for (size_t i = 0; i < n; i++) {
         if (s1[i] != s2[i] || s1[i] == '\0') {
@@ -74,18 +138,22 @@ int memcmp(const void *s1, const void *s2, size_t n) {
     return 0;
 }
 
+typedef uint32_t __attribute__((may_alias)) mem_word_t;
+
 void *memmove(void *dest, const void *src, size_t n) {
     unsigned char *d = dest;
     const unsigned char *s = src;
-    if (d < s) {
-        while (n--)
-            *d++ = *s++;
-    } else {
-        d += n;
-        s += n;
-        while (n--)
-            *--d = *--s;
+    // rep movs is architecturally a forward loop (fast-string microcode
+    // falls back on overlap), so memcpy is safe unless dest starts inside src
+    if (d <= s || d >= s + n)
+        return memcpy(dest, src, n);
+    // dest overlaps the end of src: copy backwards a dword at a time
+    while (n >= 4) {
+        n -= 4;
+        *(mem_word_t *)(d + n) = *(const mem_word_t *)(s + n);
     }
+    while (n--)
+        d[n] = s[n];
     return dest;
 }
 
@@ -12,6 +12,12 @@ void *memset(void *ptr, int value, size_t num);
 void *memcpy(void *dest, const void *src, size_t num);
 int memcmp(const void *s1, const void *s2, size_t n);
 void *memmove(void *dest, const void *src, size_t n);
+// Pick the fastest memcpy/memset strategy for this CPU (call once at boot)
+void memops_init(void);
+// Clear / copy one 4KB page (page aligned)
+void zero_page(void *page);
+void copy_page(void *dst, const void *src);
+uint32_t div64_32(uint64_t n, uint32_t d);
 int strncmp(const char *s1, const char *s2, size_t n);
 char *strncpy(char *dest, const char *src, size_t n);
 void printf(const char *format, ...);
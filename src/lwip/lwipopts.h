@@ -8,13 +8,17 @@
 
 /* --- Memory --- */
 #define MEM_ALIGNMENT           4
-#define MEM_SIZE                (32 * 1024)
-#define MEMP_NUM_PBUF           16
-#define MEMP_NUM_TCP_PCB        4
-#define MEMP_NUM_TCP_PCB_LISTEN 2
-#define MEMP_NUM_UDP_PCB        4
-#define PBUF_POOL_SIZE          16
+#define MEM_SIZE                (64 * 1024)
+#define MEMP_NUM_PBUF           32
+/* Sized for concurrent connections; net.c allows up to 64 sockets */
+#define MEMP_NUM_TCP_PCB        32
+#define MEMP_NUM_TCP_PCB_LISTEN 8
+#define MEMP_NUM_TCP_SEG        64
+#define MEMP_NUM_UDP_PCB        8
+#define PBUF_POOL_SIZE          32
 #define PBUF_POOL_BUFSIZE       1600
+/* Zero-copy RX: drivers wrap their own DMA buffers in custom pbufs */
+#define LWIP_SUPPORT_CUSTOM_PBUF 1
 
 /* --- Protocols --- */
 #define LWIP_ARP                1
@@ -27,14 +31,18 @@
 #define LWIP_RAW                1
 #define LWIP_AUTOIP             0
 #define LWIP_IGMP               0
+/* A "lo" netif (127.0.0.1) exists even without a NIC, and packets to the
+   NIC's own address loop back on it; the net task drains both queues with
+   netif_poll_all() */
+#define LWIP_NETIF_LOOPBACK     1
+#define LWIP_HAVE_LOOPIF        1
 
 /* --- TCP tuning --- */
 #define TCP_MSS                 1460
 #define TCP_WND                 (4 * TCP_MSS)
-#define TCP_SND_BUF             (4 * TCP_MSS)
-
-/* Simplify TX: single contiguous pbuf per outgoing frame */
-#define LWIP_NETIF_TX_SINGLE_PBUF 1
+#define TCP_SND_BUF             (8 * TCP_MSS)
+/* Drop SYNs beyond a listener's backlog instead of resetting them */
+#define TCP_LISTEN_BACKLOG      1
 
 /* PRNG for TCP ISN */
 extern unsigned int get_tick_count(void);
@@ -48,6 +56,16 @@ extern unsigned int get_tick_count(void);
 #define CHECKSUM_CHECK_UDP      1
 #define CHECKSUM_CHECK_TCP      1
 
+/* i686 checksum routines (src/arch/i686/chksum.c): 32-bit add-with-carry
+   instead of lwIP's generic 16-bit loop, and a fused copy+checksum used
+   wherever lwIP copies payload it is about to checksum */
+extern unsigned short net_chksum(const void *data, int len);
+extern unsigned short net_chksum_copy(void *dst, const void *src,
+                                      unsigned short len);
+#define LWIP_CHKSUM             net_chksum
+#define LWIP_CHECKSUM_ON_COPY   1
+#define LWIP_CHKSUM_COPY(dst, src, len) net_chksum_copy(dst, src, len)
+
 /* --- Interrupt protection --- */
 #define SYS_LIGHTWEIGHT_PROT    1
 typedef int sys_prot_t;
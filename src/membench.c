@@ -0,0 +1,128 @@
+#include "membench.h"
+#include "arch/arch.h"
+#include "lib.h"
+#include "memlayout.h"
+#include "proc/pmm.h"
+
+// Each case moves about this many bytes in total, so the small sizes loop
+// many times and the TSC read overhead disappears
+#define BENCH_BYTES (8u * 1024 * 1024)
+#define BENCH_MAX_SIZE (256u * 1024) // one 256x256x32bpp window buffer
+// Room for the largest size plus the misalignment and memmove offsets
+#define BENCH_PAGES (BENCH_MAX_SIZE / 0x1000 + 1)
+// Give the TSC calibration (vdso.c, 64 ticks) time to finish
+#define BENCH_CAL_WAIT_TICKS 200
+
+enum { OP_MEMCPY, OP_MEMSET, OP_MEMMOVE, OP_COPY_PAGE, OP_ZERO_PAGE };
+
+typedef struct {
+    const char *name;
+    int op;
+    uint32_t dst_off;
+    uint32_t src_off;
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    {"memcpy aligned", OP_MEMCPY, 0, 0},
+    {"memcpy dst+1", OP_MEMCPY, 1, 0},
+    {"memcpy src+3 dst+1", OP_MEMCPY, 1, 3},
+    {"memset aligned", OP_MEMSET, 0, 0},
+    {"memset dst+1", OP_MEMSET, 1, 0},
+    {"memmove overlap fwd", OP_MEMMOVE, 0, 8},
+    {"memmove overlap back", OP_MEMMOVE, 8, 0},
+};
+
+static const bench_case_t page_cases[] = {
+    {"copy_page", OP_COPY_PAGE, 0, 0},
+    {"zero_page", OP_ZERO_PAGE, 0, 0},
+};
+
+static const uint32_t sizes[] = {64, 512, 4096, 65536, BENCH_MAX_SIZE};
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static void run_once(const bench_case_t *c, uint8_t *dst, uint8_t *src,
+                     uint32_t size) {
+    switch (c->op) {
+    case OP_MEMCPY:
+        memcpy(dst + c->dst_off, src + c->src_off, size);
+        break;
+    case OP_MEMSET:
+        memset(dst + c->dst_off, 0x5A, size);
+        break;
+    case OP_MEMMOVE:
+        // Both ends inside one buffer, 8 bytes apart
+        memmove(src + c->dst_off, src + c->src_off, size);
+        break;
+    case OP_COPY_PAGE:
+        copy_page(dst, src);
+        break;
+    case OP_ZERO_PAGE:
+        zero_page(dst);
+        break;
+    }
+}
+
+// MB/s (10^6 bytes) for one case at one size, or 0 if the TSC is unusable
+static uint32_t bench(const bench_case_t *c, uint32_t size, uint8_t *dst,
+                      uint8_t *src, uint32_t tsc_per_ms) {
+    uint32_t iters = BENCH_BYTES / size;
+    run_once(c, dst, src, size); // warm the caches and TLB
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < iters; i++) {
+        run_once(c, dst, src, size);
+        __asm__ volatile("" ::: "memory");
+    }
+    uint64_t cycles = rdtsc() - start;
+    uint32_t us = div64_32(cycles * 1000, tsc_per_ms);
+    if (!us || us == 0xFFFFFFFFu)
+        return 0;
+    return iters * size / us;
+}
+
+static void report(const char *name, uint32_t size, uint32_t mbps) {
+    kprintf("[membench] %s %d B: %d.%d%d GB/s\n", name, size, mbps / 1000,
+            (mbps / 100) % 10, (mbps / 10) % 10);
+}
+
+void membench_run(void) {
+    uint32_t start_tick = get_tick_count();
+    while (!vdso_tsc_per_ms() &&
+           get_tick_count() - start_tick < BENCH_CAL_WAIT_TICKS)
+        halt_and_catch_fire();
+    uint32_t tsc_per_ms = vdso_tsc_per_ms();
+    if (!tsc_per_ms) {
+        kprintf("[membench] TSC not calibrated, skipping\n");
+        return;
+    }
+
+    uint32_t src_phys = pmm_alloc_frames(BENCH_PAGES);
+    uint32_t dst_phys = pmm_alloc_frames(BENCH_PAGES);
+    if (!src_phys || !dst_phys) {
+        kprintf("[membench] out of frames, skipping\n");
+        if (src_phys)
+            pmm_free_frames(src_phys, BENCH_PAGES);
+        return;
+    }
+    uint8_t *src = (uint8_t *)PHYS_TO_KVIRT(src_phys);
+    uint8_t *dst = (uint8_t *)PHYS_TO_KVIRT(dst_phys);
+    memset(src, 0xA5, BENCH_PAGES * 0x1000);
+
+    kprintf("[membench] %d MB per case, TSC %d kHz\n", BENCH_BYTES >> 20,
+            tsc_per_ms);
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (uint32_t j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+            report(cases[i].name, sizes[j],
+                   bench(&cases[i], sizes[j], dst, src, tsc_per_ms));
+    }
+    for (uint32_t i = 0; i < sizeof(page_cases) / sizeof(page_cases[0]); i++)
+        report(page_cases[i].name, 0x1000,
+               bench(&page_cases[i], 0x1000, dst, src, tsc_per_ms));
+
+    pmm_free_frames(src_phys, BENCH_PAGES);
+    pmm_free_frames(dst_phys, BENCH_PAGES);
+}
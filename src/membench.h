@@ -0,0 +1,9 @@
+#ifndef _MEMBENCH_H
+#define _MEMBENCH_H
+
+// Boot-time self-benchmark of memcpy/memset/memmove/copy_page/zero_page,
+// run when the kernel command line carries membench=1. Prints MB/s per
+// size and alignment through kprintf (and so the serial mirror).
+void membench_run(void);
+
+#endif
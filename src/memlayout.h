@@ -17,7 +17,17 @@
 #define KERNEL_HEAP_START 0xC0500000u
 #define KERNEL_HEAP_END 0xC0700000u
 
+// Device MMIO window: the last 4MB of the higher half. The RAM it would
+// alias is kept out of the PMM (see PMM_MAX_END), so these kernel PTEs can
+// point at PCI BARs instead. Kernel page tables are shared by every address
+// space, so a mapping made here is visible everywhere.
+#define KERNEL_MMIO_START 0xFFC00000u
+#define KERNEL_MMIO_END 0xFFFFF000u
+
 #define USER_REGION_START 0x00400000u
+// Read-only kernel data page (vdso.h), just below the user region so
+// user_range_ok() rejects it and no syscall can be aimed at it
+#define USER_VDSO_VADDR 0x003FF000u
 #define USER_REGION_END 0xC0000000u
 
 #define USER_STACK_TOP_PAGE_VADDR 0xBFFFF000u
@@ -1,12 +1,18 @@
 #include "net.h"
 #include "arch/arch.h"
+#include "drivers/e1000.h"
 #include "drivers/rtl8139.h"
+#include "drivers/virtio_net.h"
+#include "ktrace.h"
 #include "lib.h"
+#include "liballoc/liballoc_1_1.h"
+#include "memlayout.h"
+#include "proc/pmm.h"
 #include "proc/task.h"
+#include "proc/waitq.h"
 #include "utils/kring.h"
-#include "utils/slot_table.h"
-#include <stddef.h>
 
+#include "lwip/apps/lwiperf.h"
 #include "lwip/dhcp.h"
 #include "lwip/etharp.h"
 #include "lwip/init.h"
@@ -18,28 +24,73 @@
 #include "lwip/raw.h"
 #include "lwip/tcp.h"
 #include "lwip/timeouts.h"
+#include "lwip/udp.h"
 #include "netif/ethernet.h"
 
+// ---- NIC drivers, in order of preference ----
+typedef const nic_ops_t *(*nic_get_ops_t)(void);
+static const nic_get_ops_t nic_drivers[] = {
+    virtio_net_get_ops,
+    e1000_get_ops,
+    rtl8139_get_ops,
+};
+#define NUM_NIC_DRIVERS (int)(sizeof(nic_drivers) / sizeof(nic_drivers[0]))
+
+static const nic_ops_t *nic = NULL; // the card in use
+
 // ---- lwIP netif ----
-static struct netif rtl_netif;
+static struct netif nic_netif;
 static int lwip_ready = 0;
 static uint32_t last_logged_ip_be = 0;
 static int last_link_up = -1;
 static uint32_t last_lease_log_tick = 0;
 
+// ---- Network softirq task ----
+// Packet processing runs in a dedicated kernel task rather than in IRQ or
+// timer context. The NIC IRQ only masks the card and wakes the task; the
+// task drains RX in budgeted batches (NAPI-style), runs lwIP timeouts when
+// their deadline passes, and unmasks the NIC once the ring is empty. lwIP
+// itself is always entered with interrupts off (syscalls run that way too),
+// which keeps NO_SYS lwIP single-threaded.
+#define NET_RX_BUDGET 16
+#define NET_MAX_SLEEP_TICKS 100 // recheck timeouts at least once a second
+
+static task_t *net_task = NULL;
+static volatile int net_rx_pending = 0;
+static volatile uint32_t net_deadline = 0; // tick of the next lwIP timeout
+static net_softirq_stats_t sirq_stats;
+
 // ---- Feed received frame to lwIP ----
-static void net_rx_to_lwip(uint8_t *data, uint16_t len) {
-    if (!lwip_ready)
-        return;
-    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
-    if (!p)
+static void net_rx_to_lwip(struct pbuf *p) {
+    if (!lwip_ready) {
+        pbuf_free(p);
         return;
-    memcpy(p->payload, data, len);
-    if (rtl_netif.input(p, &rtl_netif) != ERR_OK) {
+    }
+    if (nic_netif.input(p, &nic_netif) != ERR_OK) {
         pbuf_free(p);
     }
 }
 
+// Make the net task runnable. Called with interrupts off.
+static void net_softirq_wake(void) {
+    if (net_task && net_task->state == TASK_BLOCKED)
+        net_task->state = TASK_READY;
+}
+
+// lwIP API calls from syscalls may arm timers earlier than the deadline the
+// net task is sleeping on; wake it so it recomputes.
+static void net_softirq_kick(void) {
+    net_deadline = get_tick_count();
+    net_softirq_wake();
+}
+
+// NIC IRQ: RX interrupts are already masked by the driver.
+static void net_nic_irq(void) {
+    sirq_stats.irqs++;
+    net_rx_pending = 1;
+    net_softirq_wake();
+}
+
 // ---- lwIP sys_now() — required for timeouts ----
 uint32_t sys_now(void) {
     return get_tick_count() * 10; // 100Hz -> milliseconds
@@ -48,17 +99,13 @@ uint32_t sys_now(void) {
 // sys_arch_protect/unprotect defined inline in lwipopts.h
 
 // ---- lwIP netif TX callback ----
-// lwIP pbufs may be chained (p->next); we must flatten into a contiguous
-// buffer before handing to the NIC driver.
-static uint8_t tx_buf[1536]; // Max Ethernet frame size
+// lwIP pbufs may be chained (p->next); the driver either flattens the chain
+// or maps each pbuf to its own TX descriptor.
 static err_t net_linkoutput(struct netif *netif __attribute__((unused)),
                             struct pbuf *p) {
-    uint16_t len = p->tot_len;
-    if (len > sizeof(tx_buf))
-        len = sizeof(tx_buf);
-    pbuf_copy_partial(p, tx_buf, len, 0);
-    rtl8139_send(tx_buf, len);
-    return ERR_OK;
+    if (p->tot_len > 1514)
+        return ERR_BUF;
+    return nic->send(p) == 0 ? ERR_OK : ERR_MEM;
 }
 
 // ---- lwIP netif init callback ----
@@ -69,7 +116,7 @@ static err_t net_netif_init(struct netif *netif) {
     netif->flags =
         NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
     netif->hwaddr_len = 6;
-    rtl8139_get_mac(netif->hwaddr);
+    nic->get_mac(netif->hwaddr);
     netif->name[0] = 'e';
     netif->name[1] = 'n';
     return ERR_OK;
@@ -98,39 +145,42 @@ static uint8_t ping_recv_cb(void *arg __attribute__((unused)),
 // ---- Public API ----
 
 void net_init(void) {
-    rtl8139_init(net_rx_to_lwip);
-    if (!rtl8139_available())
+    for (int i = 0; i < NUM_NIC_DRIVERS && !nic; i++) {
+        const nic_ops_t *ops = nic_drivers[i]();
+        if (ops->probe(net_rx_to_lwip, net_nic_irq) == 0)
+            nic = ops;
+    }
+    lwip_init(); // also brings up the loopback netif
+    lwip_ready = 1;
+    if (!nic) {
+        kprintf("[net] no NIC, loopback only\n");
         return;
-
-    lwip_init();
+    }
 
     ip4_addr_t ip, mask, gw;
     IP4_ADDR(&ip, 0, 0, 0, 0);
     IP4_ADDR(&mask, 0, 0, 0, 0);
     IP4_ADDR(&gw, 0, 0, 0, 0);
-    netif_add(&rtl_netif, &ip, &mask, &gw, NULL, net_netif_init,
+    netif_add(&nic_netif, &ip, &mask, &gw, NULL, net_netif_init,
               ethernet_input);
-    netif_set_default(&rtl_netif);
-    netif_set_up(&rtl_netif);
+    netif_set_default(&nic_netif);
+    netif_set_up(&nic_netif);
 
-    lwip_ready = 1;
-    dhcp_start(&rtl_netif);
+    dhcp_start(&nic_netif);
     kprintf("[net] lwIP initialized, DHCP started\n");
 }
 
-void net_poll(void) {
-    if (!lwip_ready)
+// Log link and DHCP lease transitions.
+static void net_report_state(void) {
+    if (!nic)
         return;
-    rtl8139_rx_poll();
-    sys_check_timeouts();
-
-    int up = netif_is_link_up(&rtl_netif) ? 1 : 0;
+    int up = netif_is_link_up(&nic_netif) ? 1 : 0;
     if (up != last_link_up) {
         last_link_up = up;
         kprintf("[net] link %s\n", up ? "up" : "down");
     }
 
-    const ip4_addr_t *ip = netif_ip4_addr(&rtl_netif);
+    const ip4_addr_t *ip = netif_ip4_addr(&nic_netif);
     uint32_t a = ip4_addr_get_u32(ip);
     uint32_t ip_be = ((a & 0xFF) << 24) | (((a >> 8) & 0xFF) << 16) |
                      (((a >> 16) & 0xFF) << 8) | ((a >> 24) & 0xFF);
@@ -166,6 +216,98 @@ void net_poll(void) {
     last_logged_ip_be = ip_be;
 }
 
+static void net_count_batch(uint32_t n) {
+    uint32_t b = 0;
+    while (b < NET_BATCH_HIST - 1 && n >= (1u << b))
+        b++;
+    sirq_stats.batches++;
+    sirq_stats.batch_pkts += n;
+    sirq_stats.hist[b]++;
+    if (n > sirq_stats.batch_max)
+        sirq_stats.batch_max = n;
+    if (n == NET_RX_BUDGET)
+        sirq_stats.budget_hits++;
+}
+
+// Nonzero if a netif has looped-back packets for netif_poll_all()
+static int net_loop_pending(void) {
+    struct netif *n;
+    NETIF_FOREACH(n) {
+        if (n->loop_first)
+            return 1;
+    }
+    return 0;
+}
+
+static void net_task_entry(void) {
+    while (1) {
+        cpu_disable_interrupts();
+        if (!net_rx_pending && !net_loop_pending() &&
+            (int32_t)(get_tick_count() - net_deadline) < 0) {
+            net_task->state = TASK_BLOCKED;
+            task_yield(); // resumes with interrupts still off
+            sirq_stats.wakeups++;
+        }
+
+        if (net_rx_pending) {
+            net_rx_pending = 0;
+            int n = nic->rx_poll(NET_RX_BUDGET);
+            KTRACE(KT_NIC_RX, n, NET_RX_BUDGET, 0);
+            net_count_batch((uint32_t)n);
+            if (n == NET_RX_BUDGET) {
+                // Ring may hold more: come back after other tasks had a turn.
+                net_rx_pending = 1;
+            } else if (nic->irq_wired()) {
+                nic->irq_enable();
+            }
+        }
+
+        // Deliver packets sent to 127.0.0.1 or our own address
+        netif_poll_all();
+
+        uint32_t now = get_tick_count();
+        if ((int32_t)(now - net_deadline) >= 0) {
+            sys_check_timeouts();
+            sirq_stats.timeout_runs++;
+            net_report_state();
+        }
+        uint32_t ms = sys_timeouts_sleeptime();
+        uint32_t ticks = NET_MAX_SLEEP_TICKS;
+        if (ms / 10 < NET_MAX_SLEEP_TICKS)
+            ticks = (ms + 9) / 10;
+        if (ticks == 0)
+            ticks = 1;
+        net_deadline = now + ticks;
+
+        cpu_enable_interrupts();
+        if (net_rx_pending || net_loop_pending())
+            task_yield();
+    }
+}
+
+void net_start(void) {
+    if (!lwip_ready || net_task)
+        return;
+    net_task = task_create("net", net_task_entry);
+    if (!net_task)
+        kprintf("[net] failed to start net task\n");
+}
+
+// Called from the timer IRQ: wake the net task when its deadline passes, or
+// every tick when the NIC has no IRQ line and must be polled.
+void net_timer_tick(void) {
+    if (!net_task)
+        return;
+    if (nic && !nic->irq_wired())
+        net_rx_pending = 1;
+    if (net_rx_pending || (int32_t)(get_tick_count() - net_deadline) >= 0)
+        net_softirq_wake();
+}
+
+void net_get_softirq_stats(net_softirq_stats_t *out) { *out = sirq_stats; }
+
+const char *net_get_nic_name(void) { return nic ? nic->name : "none"; }
+
 int net_ping(uint32_t ip_be, uint32_t timeout_ms) {
     if (!lwip_ready)
         return -1;
@@ -174,8 +316,6 @@ int net_ping(uint32_t ip_be, uint32_t timeout_ms) {
         return -1;
     ping_in_progress = 1;
 
-    cpu_enable_interrupts();
-
     // Create raw ICMP PCB
     struct raw_pcb *pcb = raw_new(IP_PROTO_ICMP);
     if (!pcb)
@@ -225,19 +365,24 @@ int net_ping(uint32_t ip_be, uint32_t timeout_ms) {
     ping_reply_received = 0;
     raw_sendto(pcb, p, &dst);
     pbuf_free(p);
+    net_softirq_kick();
 
-    // Wait for reply
+    // Wait for reply; the net task delivers it. Yield after each interrupt
+    // so a freshly woken net task runs without waiting for the next tick.
     uint32_t start = get_tick_count();
     uint32_t timeout_ticks = (timeout_ms + 9) / 10;
+    cpu_enable_interrupts();
     while (!ping_reply_received) {
-        net_poll();
         if ((get_tick_count() - start) > timeout_ticks) {
+            cpu_disable_interrupts();
             raw_remove(pcb);
             ping_in_progress = 0;
             return -1;
         }
         cpu_halt();
+        task_yield();
     }
+    cpu_disable_interrupts();
 
     raw_remove(pcb);
     ping_in_progress = 0;
@@ -245,15 +390,16 @@ int net_ping(uint32_t ip_be, uint32_t timeout_ms) {
 }
 
 void net_set_config(uint32_t ip_be, uint32_t mask_be, uint32_t gw_be) {
-    if (!lwip_ready)
+    if (!nic)
         return;
     if (ip_be == 0 && mask_be == 0 && gw_be == 0) {
-        dhcp_start(&rtl_netif);
+        dhcp_start(&nic_netif);
+        net_softirq_kick();
         kprintf("[net] DHCP started\n");
         return;
     }
 
-    dhcp_stop(&rtl_netif);
+    dhcp_stop(&nic_netif);
     ip4_addr_t ip, mask, gw;
     IP4_ADDR(&ip, (ip_be >> 24) & 0xFF, (ip_be >> 16) & 0xFF,
              (ip_be >> 8) & 0xFF, ip_be & 0xFF);
@@ -261,13 +407,14 @@ void net_set_config(uint32_t ip_be, uint32_t mask_be, uint32_t gw_be) {
              (mask_be >> 8) & 0xFF, mask_be & 0xFF);
     IP4_ADDR(&gw, (gw_be >> 24) & 0xFF, (gw_be >> 16) & 0xFF,
              (gw_be >> 8) & 0xFF, gw_be & 0xFF);
-    netif_set_addr(&rtl_netif, &ip, &mask, &gw);
+    netif_set_addr(&nic_netif, &ip, &mask, &gw);
+    net_softirq_kick();
     kprintf("[net] cfg ip=%d.%d.%d.%d\n", (ip_be >> 24) & 0xFF,
             (ip_be >> 16) & 0xFF, (ip_be >> 8) & 0xFF, ip_be & 0xFF);
 }
 
 void net_get_config(uint32_t *ip_be, uint32_t *mask_be, uint32_t *gw_be) {
-    if (!lwip_ready) {
+    if (!nic) {
         if (ip_be)
             *ip_be = 0;
         if (mask_be)
@@ -276,9 +423,9 @@ void net_get_config(uint32_t *ip_be, uint32_t *mask_be, uint32_t *gw_be) {
             *gw_be = 0;
         return;
     }
-    const ip4_addr_t *ip = netif_ip4_addr(&rtl_netif);
-    const ip4_addr_t *mask = netif_ip4_netmask(&rtl_netif);
-    const ip4_addr_t *gw = netif_ip4_gw(&rtl_netif);
+    const ip4_addr_t *ip = netif_ip4_addr(&nic_netif);
+    const ip4_addr_t *mask = netif_ip4_netmask(&nic_netif);
+    const ip4_addr_t *gw = netif_ip4_gw(&nic_netif);
     if (ip_be) {
         uint32_t a = ip4_addr_get_u32(ip);
         *ip_be = ((a & 0xFF) << 24) | (((a >> 8) & 0xFF) << 16) |
@@ -296,88 +443,350 @@ void net_get_config(uint32_t *ip_be, uint32_t *mask_be, uint32_t *gw_be) {
     }
 }
 
+// ---- lwiperf throughput tests ----
+#define IPERF_CLIENT_TIMEOUT_TICKS 1500 // lwiperf clients run for 10s
+
+static void *iperf_server = NULL;
+static int iperf_client_busy = 0;  // client session live (until its report)
+static int iperf_client_waiter = 0; // a syscall is waiting for the report
+static volatile int iperf_client_done = 0;
+static netbench_result_t iperf_result;
+static waitq_t iperf_wq;
+
+// lwiperf report: arg is NULL for server sessions, &iperf_result for ours
+static void iperf_report_cb(void *arg, enum lwiperf_report_type type,
+                            const ip_addr_t *local_addr, u16_t local_port,
+                            const ip_addr_t *remote_addr, u16_t remote_port,
+                            u32_t bytes, u32_t ms, u32_t kbps) {
+    (void)local_addr;
+    (void)local_port;
+    (void)remote_addr;
+    (void)remote_port;
+    int ok = type == LWIPERF_TCP_DONE_SERVER || type == LWIPERF_TCP_DONE_CLIENT;
+    kprintf("[iperf] %s %s: %d bytes in %d ms, %d kbit/s\n",
+            arg ? "client" : "server", ok ? "done" : "aborted", (int)bytes,
+            (int)ms, (int)kbps);
+    if (!arg)
+        return;
+    iperf_result.bytes = bytes;
+    iperf_result.ms = ms;
+    iperf_result.kbps = kbps;
+    iperf_result.status = ok ? 0 : -1;
+    iperf_client_done = 1;
+    if (!iperf_client_waiter)
+        iperf_client_busy = 0; // the caller already gave up
+    waitq_wake_all(&iperf_wq);
+}
+
+int net_bench(int op, uint32_t ip_be, netbench_result_t *out) {
+    if (!lwip_ready)
+        return -1;
+    if (!iperf_server) {
+        iperf_server = lwiperf_start_tcp_server_default(iperf_report_cb, NULL);
+        if (!iperf_server)
+            return -1;
+        kprintf("[iperf] server listening on port %d\n",
+                LWIPERF_TCP_PORT_DEFAULT);
+    }
+    if (op == NETBENCH_SERVER)
+        return 0;
+    if (op != NETBENCH_CLIENT || !out || iperf_client_busy)
+        return -1;
+
+    ip_addr_t dst;
+    ip_addr_set_ip4_u32(&dst, lwip_htonl(ip_be ? ip_be : 0x7F000001u));
+    iperf_client_busy = 1;
+    iperf_client_waiter = 1;
+    iperf_client_done = 0;
+    if (!lwiperf_start_tcp_client_default(&dst, iperf_report_cb,
+                                          &iperf_result)) {
+        iperf_client_busy = 0;
+        iperf_client_waiter = 0;
+        return -1;
+    }
+    net_softirq_kick();
+
+    // lwiperf_abort() frees sessions without closing their pcbs, so a
+    // stuck test is left to lwiperf's own idle timeout instead
+    uint32_t deadline = get_tick_count() + IPERF_CLIENT_TIMEOUT_TICKS;
+    while (!iperf_client_done) {
+        waitq_add(&iperf_wq);
+        if (waitq_sleep(deadline) < 0 && !iperf_client_done) {
+            iperf_client_waiter = 0;
+            return -1;
+        }
+    }
+    *out = iperf_result;
+    iperf_client_waiter = 0;
+    iperf_client_busy = 0;
+    return iperf_result.status;
+}
+
 void net_get_stats(uint32_t *rx_packets, uint32_t *tx_packets) {
-    rtl8139_get_stats(rx_packets, tx_packets);
+    if (!nic) {
+        if (rx_packets)
+            *rx_packets = 0;
+        if (tx_packets)
+            *tx_packets = 0;
+        return;
+    }
+    nic->get_stats(rx_packets, tx_packets);
 }
 
 // ==== TCP Socket Table ====
-
-#define MAX_SOCKETS 8
-#define SOCK_RX_BUF 4096
+// Sockets are kmalloc'd on demand; the table only holds pointers, so idle
+// slots cost 4 bytes. Each socket's RX ring is sized by SOCK_OPT_RCVBUF.
 
 #define SOCK_UNUSED 0
 #define SOCK_LISTEN 1
 #define SOCK_STREAM 2
+#define SOCK_DGRAM 3
+
+// UDP datagrams are queued in the RX ring as a header plus payload
+typedef struct {
+    uint32_t ip_be;
+    uint16_t port;
+    uint16_t len;
+} dgram_hdr_t;
 
 typedef struct {
-    int in_use;
-    int type; // SOCK_LISTEN or SOCK_STREAM
+    int type; // SOCK_LISTEN, SOCK_STREAM or SOCK_DGRAM
     struct tcp_pcb *pcb;
+    struct udp_pcb *upcb; // SOCK_DGRAM
+    int connecting;       // outbound connect not yet established
     uint32_t owner_pid; // Creator/owner task ID
-    int accepted_fd;    // For listeners: fd of newly accepted connection (-1 if
-                        // none)
-    uint8_t rx_buf[SOCK_RX_BUF];
+    // Listener: established connections not yet accepted (socket fds)
+    int acceptq[SOCK_BACKLOG_MAX];
+    int acceptq_head;
+    int acceptq_count;
+    int backlog;
+    int in_acceptq; // queued on its listener, not yet accepted
+    // Buffer sizes; listeners pass theirs on to accepted sockets
+    uint32_t rcvbuf;
+    uint32_t sndbuf;
+    uint8_t *rx_buf;
     kring_u8_t rx_ring;
-    int rx_closed; // Remote sent FIN
-    int err;       // Error flag
+    uint32_t rx_unacked; // bytes received but not yet reopened in the window
+    // TX ring in PMM frames (allocated on first send). lwIP segments point
+    // straight into it (no-copy tcp_write); ACKs advance tx_tail.
+    uint8_t *tx_ring;
+    uint32_t tx_size;
+    uint32_t tx_head; // free-running byte counters
+    uint32_t tx_tail;
+    int orphan; // closed while lwIP still held unacked TX data
+    int rx_closed;       // Remote sent FIN
+    int err;             // Error flag
+    waitq_t wq;          // tasks polling this socket
 } ksocket_t;
 
-static ksocket_t sockets[MAX_SOCKETS];
+static ksocket_t *sockets[MAX_SOCKETS];
+static net_sock_stats_t sock_stats;
 
 static uint32_t socket_current_pid(void) {
     task_t *t = task_current();
     return t ? t->id : 0;
 }
 
-static int alloc_socket(void) {
-    int fd =
-        slot_table_find_free_by_flag(sockets, MAX_SOCKETS, sizeof(ksocket_t),
-                                     (uint32_t)offsetof(ksocket_t, in_use));
+static ksocket_t *sock_get(int fd) {
+    if (fd < 0 || fd >= MAX_SOCKETS)
+        return NULL;
+    return sockets[fd];
+}
+
+static int sock_set_rcvbuf(ksocket_t *s, uint32_t size) {
+    uint8_t *buf = (uint8_t *)kmalloc(size);
+    if (!buf)
+        return -1;
+    // Carry over anything already queued
+    uint32_t n = 0;
+    uint8_t b;
+    if (s->rx_buf) {
+        while (n < size - 1 && kring_u8_pop(&s->rx_ring, &b) == 0)
+            buf[n++] = b;
+        kfree(s->rx_buf);
+    }
+    s->rx_buf = buf;
+    s->rcvbuf = size;
+    kring_u8_init(&s->rx_ring, buf, size);
+    s->rx_ring.head = n;
+    return 0;
+}
+
+static int alloc_socket(uint32_t rcvbuf, uint32_t sndbuf) {
+    int fd = -1;
+    for (int i = 0; i < MAX_SOCKETS; i++) {
+        if (!sockets[i]) {
+            fd = i;
+            break;
+        }
+    }
     if (fd < 0)
         return -1;
 
-    memset(&sockets[fd], 0, sizeof(ksocket_t));
-    slot_table_set_flag_by_index(sockets, sizeof(ksocket_t),
-                                 (uint32_t)offsetof(ksocket_t, in_use),
-                                 (uint32_t)fd, 1);
-    sockets[fd].accepted_fd = -1;
-    kring_u8_init(&sockets[fd].rx_ring, sockets[fd].rx_buf, SOCK_RX_BUF);
+    ksocket_t *s = (ksocket_t *)kmalloc(sizeof(ksocket_t));
+    if (!s)
+        return -1;
+    memset(s, 0, sizeof(ksocket_t));
+    if (sock_set_rcvbuf(s, rcvbuf) < 0) {
+        kfree(s);
+        return -1;
+    }
+    s->sndbuf = sndbuf;
+    sockets[fd] = s;
+
+    sock_stats.open++;
+    if (sock_stats.open > sock_stats.peak)
+        sock_stats.peak = sock_stats.open;
     return fd;
 }
 
+static void sock_free_tx(ksocket_t *s) {
+    if (!s->tx_ring)
+        return;
+    pmm_free_frames(KVIRT_TO_PHYS((uint32_t)s->tx_ring),
+                    s->tx_size / PMM_FRAME_SIZE);
+    s->tx_ring = NULL;
+    s->tx_size = 0;
+}
+
+static void sock_destroy(ksocket_t *s) {
+    sock_free_tx(s);
+    kfree(s->rx_buf);
+    kfree(s);
+}
+
+static void free_socket(int fd) {
+    ksocket_t *s = sockets[fd];
+    sockets[fd] = NULL;
+    sock_destroy(s);
+    sock_stats.open--;
+}
+
+static uint32_t sock_tx_queued(ksocket_t *s) { return s->tx_head - s->tx_tail; }
+
+// Contiguous free span at the TX ring head, at most len bytes and within
+// the socket's send buffer and lwIP's send window. Returns its length.
+static uint32_t sock_tx_span(ksocket_t *s, uint32_t len, uint8_t **out) {
+    if (!s->tx_ring) {
+        uint32_t frames = (s->sndbuf + PMM_FRAME_SIZE - 1) / PMM_FRAME_SIZE;
+        uint32_t phys = pmm_alloc_frames(frames);
+        if (!phys)
+            return 0;
+        s->tx_ring = (uint8_t *)PHYS_TO_KVIRT(phys);
+        s->tx_size = frames * PMM_FRAME_SIZE;
+        s->tx_head = s->tx_tail = 0;
+    }
+    uint32_t queued = sock_tx_queued(s);
+    if (queued >= s->sndbuf)
+        return 0;
+    uint32_t off = s->tx_head % s->tx_size;
+    uint32_t n = s->sndbuf - queued;
+    if (n > s->tx_size - off)
+        n = s->tx_size - off; // stop at the wrap
+    if (n > tcp_sndbuf(s->pcb))
+        n = tcp_sndbuf(s->pcb);
+    if (n > len)
+        n = len;
+    *out = s->tx_ring + off;
+    return n;
+}
+
+// Hand n bytes just written at the ring head to lwIP by reference
+static err_t sock_tx_commit(ksocket_t *s, uint32_t n, int more) {
+    err_t e = tcp_write(s->pcb, s->tx_ring + s->tx_head % s->tx_size,
+                        (u16_t)n, more ? TCP_WRITE_FLAG_MORE : 0);
+    if (e == ERR_OK)
+        s->tx_head += n;
+    return e;
+}
+
 // Ring buffer helpers
 static int rx_buf_used(ksocket_t *s) { return (int)kring_u8_used(&s->rx_ring); }
 
+static uint32_t rx_buf_free(ksocket_t *s) {
+    return s->rcvbuf - 1 - kring_u8_used(&s->rx_ring);
+}
+
+static void ring_write(kring_u8_t *r, const void *src, uint32_t n) {
+    const uint8_t *b = (const uint8_t *)src;
+    for (uint32_t i = 0; i < n; i++)
+        kring_u8_push(r, b[i]);
+}
+
+// Pop n bytes into dst, or discard them if dst is NULL
+static void ring_read(kring_u8_t *r, void *dst, uint32_t n) {
+    uint8_t *b = (uint8_t *)dst;
+    uint8_t tmp;
+    for (uint32_t i = 0; i < n; i++)
+        kring_u8_pop(r, b ? &b[i] : &tmp);
+}
+
+// Reopen the receive window for consumed data, but never advertise more
+// than the RX ring can still hold: with W = TCP_WND the peer may have
+// W - rx_unacked bytes in flight, which must fit in the free space.
+static void sock_rx_credit(ksocket_t *s) {
+    if (!s->pcb || s->rx_unacked == 0)
+        return;
+    uint32_t free = rx_buf_free(s);
+    if (free + s->rx_unacked <= TCP_WND)
+        return;
+    uint32_t credit = free + s->rx_unacked - TCP_WND;
+    if (credit > s->rx_unacked)
+        credit = s->rx_unacked;
+    while (credit > 0) {
+        u16_t n = credit > 0xFFFF ? 0xFFFF : (u16_t)credit;
+        tcp_recved(s->pcb, n);
+        s->rx_unacked -= n;
+        credit -= n;
+    }
+}
+
 // lwIP callback: data received on a connected socket
 static err_t sock_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
                           err_t err) {
     ksocket_t *s = (ksocket_t *)arg;
+    (void)tpcb;
     (void)err;
 
     if (!p) {
         s->rx_closed = 1;
+        waitq_wake_all(&s->wq);
         return ERR_OK;
     }
 
-    // Copy pbuf chain into rx ring buffer, tracking actual bytes consumed
-    // so we only acknowledge what was actually stored (not dropped data).
-    uint16_t total_pushed = 0;
-    struct pbuf *q;
-    for (q = p; q != NULL; q = q->next) {
-        uint16_t copy_len = q->len;
+    // The window never exceeds the ring's free space, so this only trips
+    // on a misbehaving peer; refuse and let lwIP redeliver it later.
+    if (p->tot_len > rx_buf_free(s))
+        return ERR_MEM;
+
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
         uint8_t *src = (uint8_t *)q->payload;
-        for (uint16_t i = 0; i < copy_len; i++) {
-            if (kring_u8_push(&s->rx_ring, src[i]) < 0)
-                goto rx_done;
-            total_pushed++;
-        }
+        for (uint16_t i = 0; i < q->len; i++)
+            kring_u8_push(&s->rx_ring, src[i]);
     }
-rx_done:
-
-    // Only acknowledge bytes we actually stored; lwIP will retransmit the rest.
-    if (total_pushed > 0)
-        tcp_recved(tpcb, total_pushed);
+    s->rx_unacked += p->tot_len;
+    sock_rx_credit(s);
     pbuf_free(p);
+    waitq_wake_all(&s->wq);
+    return ERR_OK;
+}
+
+// lwIP callback: sent data was ACKed, so send buffer space opened up
+static err_t sock_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    ksocket_t *s = (ksocket_t *)arg;
+    // ACKs arrive in order: release the oldest TX ring bytes
+    uint32_t queued = sock_tx_queued(s);
+    s->tx_tail += len < queued ? len : queued;
+    if (s->orphan) {
+        if (sock_tx_queued(s) == 0) {
+            tcp_arg(tpcb, NULL);
+            tcp_sent(tpcb, NULL);
+            tcp_err(tpcb, NULL);
+            sock_destroy(s);
+        }
+        return ERR_OK;
+    }
+    waitq_wake_all(&s->wq);
     return ERR_OK;
 }
 
@@ -385,52 +794,113 @@ rx_done:
 static void sock_err_cb(void *arg, err_t err) {
     ksocket_t *s = (ksocket_t *)arg;
     (void)err;
+    if (s->orphan) {
+        sock_destroy(s); // pcb is gone, and with it all refs to tx_ring
+        return;
+    }
     s->err = 1;
     s->pcb = NULL;
+    waitq_wake_all(&s->wq);
+}
+
+// lwIP callback: outbound connection established (failures arrive
+// through sock_err_cb instead)
+static err_t sock_connected_cb(void *arg, struct tcp_pcb *tpcb, err_t err) {
+    ksocket_t *s = (ksocket_t *)arg;
+    (void)tpcb;
+    (void)err;
+    s->connecting = 0;
+    waitq_wake_all(&s->wq);
+    return ERR_OK;
 }
 
-// lwIP callback: new connection accepted on listener
+static void sock_stream_init(ksocket_t *s, struct tcp_pcb *pcb,
+                             uint32_t owner_pid) {
+    s->type = SOCK_STREAM;
+    s->pcb = pcb;
+    s->owner_pid = owner_pid;
+    tcp_arg(pcb, s);
+    tcp_recv(pcb, sock_recv_cb);
+    tcp_sent(pcb, sock_sent_cb);
+    tcp_err(pcb, sock_err_cb);
+}
+
+// lwIP callback: UDP datagram for a bound socket. Datagrams that do not
+// fit in the RX ring are dropped, as UDP allows.
+static void sock_udp_recv_cb(void *arg, struct udp_pcb *upcb, struct pbuf *p,
+                             const ip_addr_t *addr, u16_t port) {
+    ksocket_t *s = (ksocket_t *)arg;
+    (void)upcb;
+
+    if (p->tot_len > SOCK_DGRAM_MAX ||
+        sizeof(dgram_hdr_t) + p->tot_len > rx_buf_free(s)) {
+        sock_stats.dgram_drops++;
+        pbuf_free(p);
+        return;
+    }
+
+    dgram_hdr_t h;
+    h.ip_be = lwip_ntohl(ip4_addr_get_u32(ip_2_ip4(addr)));
+    h.port = port;
+    h.len = p->tot_len;
+    ring_write(&s->rx_ring, &h, sizeof(h));
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+        ring_write(&s->rx_ring, q->payload, q->len);
+    pbuf_free(p);
+    waitq_wake_all(&s->wq);
+}
+
+// lwIP callback: new connection established on a listener. lwIP counts it
+// against the listen backlog until sock_accept hands it out, so SYNs beyond
+// the backlog are dropped (and retried by the client) rather than reset.
 static err_t sock_accept_cb(void *arg, struct tcp_pcb *newpcb, err_t err) {
     ksocket_t *ls = (ksocket_t *)arg;
-    (void)err;
 
-    if (ls->accepted_fd >= 0) {
+    if (!newpcb || err != ERR_OK)
+        return ERR_VAL; // out of PCBs; the client will retry the SYN
+
+    if (ls->acceptq_count >= ls->backlog) {
+        sock_stats.refused++;
         tcp_abort(newpcb);
         return ERR_ABRT;
     }
 
-    int fd = alloc_socket();
+    int fd = alloc_socket(ls->rcvbuf, ls->sndbuf);
     if (fd < 0) {
+        sock_stats.refused++;
         tcp_abort(newpcb);
         return ERR_ABRT;
     }
 
-    sockets[fd].type = SOCK_STREAM;
-    sockets[fd].pcb = newpcb;
-    sockets[fd].owner_pid = ls->owner_pid;
-    tcp_arg(newpcb, &sockets[fd]);
-    tcp_recv(newpcb, sock_recv_cb);
-    tcp_err(newpcb, sock_err_cb);
+    ksocket_t *s = sockets[fd];
+    sock_stream_init(s, newpcb, ls->owner_pid);
+    tcp_backlog_delayed(newpcb);
+    s->in_acceptq = 1;
 
-    ls->accepted_fd = fd;
+    int tail = (ls->acceptq_head + ls->acceptq_count) % SOCK_BACKLOG_MAX;
+    ls->acceptq[tail] = fd;
+    ls->acceptq_count++;
+    waitq_wake_all(&ls->wq);
     return ERR_OK;
 }
 
 // ---- Public TCP socket API ----
 
-int net_sock_listen(uint16_t port) {
+int net_sock_listen(uint16_t port, int backlog) {
     if (!lwip_ready)
         return -1;
+    if (backlog <= 0)
+        backlog = SOCK_BACKLOG_DEFAULT;
+    if (backlog > SOCK_BACKLOG_MAX)
+        backlog = SOCK_BACKLOG_MAX;
 
-    int fd = alloc_socket();
+    int fd = alloc_socket(SOCK_RCVBUF_DEFAULT, TCP_SND_BUF);
     if (fd < 0)
         return -1;
 
     struct tcp_pcb *pcb = tcp_new();
     if (!pcb) {
-        slot_table_set_flag_by_index(sockets, sizeof(ksocket_t),
-                                     (uint32_t)offsetof(ksocket_t, in_use),
-                                     (uint32_t)fd, 0);
+        free_socket(fd);
         return -1;
     }
 
@@ -438,76 +908,256 @@ int net_sock_listen(uint16_t port) {
     err_t e = tcp_bind(pcb, IP_ADDR_ANY, port);
     if (e != ERR_OK) {
         tcp_close(pcb);
-        slot_table_set_flag_by_index(sockets, sizeof(ksocket_t),
-                                     (uint32_t)offsetof(ksocket_t, in_use),
-                                     (uint32_t)fd, 0);
+        free_socket(fd);
         return -1;
     }
 
-    struct tcp_pcb *lpcb = tcp_listen(pcb);
+    struct tcp_pcb *lpcb = tcp_listen_with_backlog(pcb, (u8_t)backlog);
     if (!lpcb) {
         tcp_close(pcb);
-        slot_table_set_flag_by_index(sockets, sizeof(ksocket_t),
-                                     (uint32_t)offsetof(ksocket_t, in_use),
-                                     (uint32_t)fd, 0);
+        free_socket(fd);
         return -1;
     }
 
-    sockets[fd].type = SOCK_LISTEN;
-    sockets[fd].pcb = lpcb;
-    sockets[fd].owner_pid = socket_current_pid();
-    tcp_arg(lpcb, &sockets[fd]);
+    ksocket_t *s = sockets[fd];
+    s->type = SOCK_LISTEN;
+    s->pcb = lpcb;
+    s->owner_pid = socket_current_pid();
+    s->backlog = backlog;
+    tcp_arg(lpcb, s);
     tcp_accept(lpcb, sock_accept_cb);
 
     return fd;
 }
 
 int net_sock_accept(int fd) {
-    if (fd < 0 || fd >= MAX_SOCKETS)
-        return -1;
-    ksocket_t *s = &sockets[fd];
-    if (!s->in_use || s->type != SOCK_LISTEN)
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_LISTEN)
         return -1;
     if (s->owner_pid != socket_current_pid())
         return -1;
 
-    if (s->accepted_fd >= 0) {
-        int newfd = s->accepted_fd;
-        s->accepted_fd = -1;
+    while (s->acceptq_count > 0) {
+        int newfd = s->acceptq[s->acceptq_head];
+        s->acceptq_head = (s->acceptq_head + 1) % SOCK_BACKLOG_MAX;
+        s->acceptq_count--;
+        ksocket_t *ns = sockets[newfd];
+        ns->in_acceptq = 0;
+        if (ns->pcb)
+            tcp_backlog_accepted(ns->pcb);
+        sock_stats.accepted++;
         return newfd;
     }
 
     return -1;
 }
 
-int net_sock_send(int fd, const void *buf, uint32_t len) {
-    if (fd < 0 || fd >= MAX_SOCKETS)
+int net_sock_connect(uint32_t ip_be, uint16_t port) {
+    if (!lwip_ready)
         return -1;
-    ksocket_t *s = &sockets[fd];
-    if (!s->in_use || s->type != SOCK_STREAM || !s->pcb)
+
+    int fd = alloc_socket(SOCK_RCVBUF_DEFAULT, TCP_SND_BUF);
+    if (fd < 0)
+        return -1;
+
+    struct tcp_pcb *pcb = tcp_new();
+    if (!pcb) {
+        free_socket(fd);
+        return -1;
+    }
+
+    ksocket_t *s = sockets[fd];
+    sock_stream_init(s, pcb, socket_current_pid());
+    s->connecting = 1;
+
+    ip_addr_t dst;
+    ip_addr_set_ip4_u32(&dst, lwip_htonl(ip_be));
+    if (tcp_connect(pcb, &dst, port, sock_connected_cb) != ERR_OK) {
+        tcp_arg(pcb, NULL);
+        tcp_err(pcb, NULL);
+        tcp_abort(pcb);
+        free_socket(fd);
+        return -1;
+    }
+    net_softirq_kick();
+    return fd;
+}
+
+int net_sock_udp_bind(uint16_t port) {
+    if (!lwip_ready)
+        return -1;
+
+    int fd = alloc_socket(SOCK_RCVBUF_DEFAULT, 0);
+    if (fd < 0)
+        return -1;
+
+    struct udp_pcb *upcb = udp_new();
+    if (!upcb) {
+        free_socket(fd);
+        return -1;
+    }
+    if (udp_bind(upcb, IP_ADDR_ANY, port) != ERR_OK) {
+        udp_remove(upcb);
+        free_socket(fd);
+        return -1;
+    }
+
+    ksocket_t *s = sockets[fd];
+    s->type = SOCK_DGRAM;
+    s->upcb = upcb;
+    s->owner_pid = socket_current_pid();
+    udp_recv(upcb, sock_udp_recv_cb, s);
+    return fd;
+}
+
+int net_sock_sendmsgs(int fd, const sock_msg_t *msgs, uint32_t count) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_DGRAM)
         return -1;
     if (s->owner_pid != socket_current_pid())
         return -1;
 
-    uint16_t sndbuf = tcp_sndbuf(s->pcb);
-    if (sndbuf == 0)
-        return 0;
-    if (len > sndbuf)
-        len = sndbuf;
+    uint32_t sent = 0;
+    while (sent < count) {
+        const sock_msg_t *m = &msgs[sent];
+        if (m->len > SOCK_DGRAM_MAX)
+            return sent ? (int)sent : -1;
+        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, m->len, PBUF_RAM);
+        if (!p)
+            break; // out of memory: report the partial batch
+        // Copy and checksum the payload in one pass; lwIP then only sums
+        // the UDP and pseudo headers
+        u16_t sum = LWIP_CHKSUM_COPY(p->payload, m->buf, m->len);
+        ip_addr_t dst;
+        ip_addr_set_ip4_u32(&dst, lwip_htonl(m->ip_be));
+        err_t e = udp_sendto_chksum(s->upcb, p, &dst, m->port, 1, sum);
+        pbuf_free(p);
+        if (e != ERR_OK)
+            break;
+        sent++;
+    }
+    if (sent)
+        net_softirq_kick();
+    return (int)sent;
+}
 
-    err_t e = tcp_write(s->pcb, buf, (uint16_t)len, TCP_WRITE_FLAG_COPY);
-    if (e != ERR_OK)
+int net_sock_recvmsgs(int fd, sock_msg_t *msgs, uint32_t count) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_DGRAM)
+        return -1;
+    if (s->owner_pid != socket_current_pid())
         return -1;
 
+    uint32_t got = 0;
+    while (got < count && !kring_u8_empty(&s->rx_ring)) {
+        sock_msg_t *m = &msgs[got];
+        dgram_hdr_t h;
+        ring_read(&s->rx_ring, &h, sizeof(h));
+        uint16_t n = h.len < m->len ? h.len : m->len;
+        ring_read(&s->rx_ring, m->buf, n);
+        ring_read(&s->rx_ring, NULL, (uint32_t)(h.len - n));
+        m->ip_be = h.ip_be;
+        m->port = h.port;
+        m->flags = n < h.len ? SOCK_MSG_TRUNC : 0;
+        m->len = n;
+        got++;
+    }
+    return got ? (int)got : -1;
+}
+
+int net_sock_send(int fd, const void *buf, uint32_t len) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_STREAM || !s->pcb)
+        return -1;
+    if (s->owner_pid != socket_current_pid())
+        return -1;
+    if (s->connecting)
+        return 0; // poll for POLLOUT to learn when the connect completes
+
+    // One copy, into the socket's TX ring; lwIP and the NIC use it in place
+    const uint8_t *src = (const uint8_t *)buf;
+    uint32_t done = 0;
+    err_t e = ERR_OK;
+    while (done < len) {
+        uint8_t *dst;
+        uint32_t n = sock_tx_span(s, len - done, &dst);
+        if (n == 0)
+            break;
+        memcpy(dst, src + done, n);
+        e = sock_tx_commit(s, n, done + n < len);
+        if (e != ERR_OK)
+            break;
+        done += n;
+    }
+    if (done == 0)
+        return (e == ERR_OK || e == ERR_MEM) ? 0 : -1; // 0: poll for POLLOUT
+
     tcp_output(s->pcb);
-    return (int)len;
+    net_softirq_kick();
+    return (int)done;
 }
 
-int net_sock_recv(int fd, void *buf, uint32_t len) {
-    if (fd < 0 || fd >= MAX_SOCKETS)
+// A sendfile making no progress for this long gives up (peer not reading)
+#define SENDFILE_STALL_TICKS 1000 // 10s
+
+int net_sock_sendfile(int fd, net_src_read_t read_fn, void *ctx,
+                      uint32_t len) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_STREAM || !s->pcb || !read_fn)
         return -1;
-    ksocket_t *s = &sockets[fd];
-    if (!s->in_use || s->type != SOCK_STREAM)
+    if (s->owner_pid != socket_current_pid())
+        return -1;
+
+    uint32_t done = 0;
+    uint32_t pending = 0; // read into the ring, not yet accepted by lwIP
+    int eof = 0;
+    while (done < len && !eof) {
+        if (!s->pcb || s->err)
+            break;
+        err_t e = ERR_MEM;
+        if (pending) {
+            e = sock_tx_commit(s, pending, done + pending < len);
+            if (e == ERR_OK) {
+                done += pending;
+                pending = 0;
+                continue;
+            }
+        } else if (!s->connecting) {
+            uint8_t *dst;
+            uint32_t n = sock_tx_span(s, len - done, &dst);
+            if (n > 0) {
+                int r = read_fn(ctx, dst, n);
+                if (r <= 0)
+                    eof = 1;
+                else
+                    pending = (uint32_t)r;
+                continue;
+            }
+        }
+        if (e != ERR_MEM)
+            break;
+
+        // Ring or lwIP queue full: flush and sleep until sock_sent_cb
+        // (or an error) wakes us
+        tcp_output(s->pcb);
+        net_softirq_kick();
+        waitq_add(&s->wq);
+        if (waitq_sleep(get_tick_count() + SENDFILE_STALL_TICKS) < 0)
+            break;
+    }
+
+    if (done > 0 && s->pcb) {
+        tcp_output(s->pcb);
+        net_softirq_kick();
+    }
+    if (done == 0 && !eof)
+        return -1;
+    return (int)done;
+}
+
+int net_sock_recv(int fd, void *buf, uint32_t len) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_STREAM)
         return -1;
     if (s->owner_pid != socket_current_pid())
         return -1;
@@ -523,34 +1173,90 @@ int net_sock_recv(int fd, void *buf, uint32_t len) {
         avail = (int)len;
 
     uint8_t *dst = (uint8_t *)buf;
-    for (int i = 0; i < avail; i++) {
-        if (kring_u8_pop(&s->rx_ring, &dst[i]) < 0)
-            return i;
-    }
+    int got = 0;
+    while (got < avail && kring_u8_pop(&s->rx_ring, &dst[got]) == 0)
+        got++;
+
+    sock_rx_credit(s);
+    return got;
+}
+
+int net_sock_setopt(int fd, int opt, uint32_t value) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->owner_pid != socket_current_pid())
+        return -1;
 
-    return avail;
+    switch (opt) {
+    case SOCK_OPT_RCVBUF: {
+        // The ring must hold a full window (kring keeps one slot free), or
+        // for UDP one maximum-size datagram
+        uint32_t min = s->type == SOCK_DGRAM
+                           ? sizeof(dgram_hdr_t) + SOCK_DGRAM_MAX + 1
+                           : TCP_WND + 1;
+        if (value < min)
+            value = min;
+        if (value > SOCK_RCVBUF_MAX)
+            value = SOCK_RCVBUF_MAX;
+        if (value < (uint32_t)rx_buf_used(s) + 1)
+            return -1;
+        if (sock_set_rcvbuf(s, value) < 0)
+            return -1;
+        sock_rx_credit(s);
+        return 0;
+    }
+    case SOCK_OPT_SNDBUF:
+        if (value < TCP_MSS)
+            value = TCP_MSS;
+        if (value > TCP_SND_BUF)
+            value = TCP_SND_BUF;
+        if (sock_tx_queued(s))
+            return -1; // lwIP still points into the current ring
+        sock_free_tx(s); // reallocated at the new size on the next send
+        s->sndbuf = value;
+        return 0;
+    default:
+        return -1;
+    }
 }
 
 static int net_sock_close_internal(int fd, uint32_t caller_pid,
                                    int force_owner) {
-    if (fd < 0 || fd >= MAX_SOCKETS)
+    ksocket_t *s = sock_get(fd);
+    if (!s)
         return -1;
-    ksocket_t *s = &sockets[fd];
-    if (!s->in_use)
-        return -1;
-    if (!force_owner && s->owner_pid != caller_pid)
+    if (!force_owner && (s->owner_pid != caller_pid || s->in_acceptq))
         return -1;
 
-    if (s->type == SOCK_LISTEN && s->accepted_fd >= 0) {
-        int child_fd = s->accepted_fd;
-        s->accepted_fd = -1;
-        net_sock_close_internal(child_fd, caller_pid, force_owner);
+    if (s->type == SOCK_LISTEN) {
+        // Queued connections were never handed out: close them too
+        while (s->acceptq_count > 0) {
+            int child_fd = s->acceptq[s->acceptq_head];
+            s->acceptq_head = (s->acceptq_head + 1) % SOCK_BACKLOG_MAX;
+            s->acceptq_count--;
+            net_sock_close_internal(child_fd, caller_pid, 1);
+        }
+    }
+
+    if (s->type == SOCK_STREAM && s->pcb && sock_tx_queued(s)) {
+        // lwIP still references unacked data in tx_ring: give up the fd
+        // but keep the socket until the data is ACKed or the pcb dies.
+        struct tcp_pcb *pcb = s->pcb;
+        tcp_recv(pcb, NULL);
+        s->orphan = 1;
+        sockets[fd] = NULL;
+        sock_stats.open--;
+        waitq_wake_all(&s->wq);
+        if (tcp_close(pcb) != ERR_OK)
+            tcp_abort(pcb); // sock_err_cb frees the socket
+        net_softirq_kick();
+        return 0;
     }
 
     if (s->pcb) {
         if (s->type == SOCK_STREAM) {
             tcp_arg(s->pcb, NULL);
             tcp_recv(s->pcb, NULL);
+            tcp_sent(s->pcb, NULL);
             tcp_err(s->pcb, NULL);
         } else if (s->type == SOCK_LISTEN) {
             tcp_arg(s->pcb, NULL);
@@ -561,17 +1267,15 @@ static int net_sock_close_internal(int fd, uint32_t caller_pid,
             tcp_abort(s->pcb);
         }
         s->pcb = NULL;
+        net_softirq_kick();
+    }
+    if (s->upcb) {
+        udp_remove(s->upcb);
+        s->upcb = NULL;
     }
 
-    slot_table_set_flag_by_index(sockets, sizeof(ksocket_t),
-                                 (uint32_t)offsetof(ksocket_t, in_use),
-                                 (uint32_t)fd, 0);
-    s->type = SOCK_UNUSED;
-    s->owner_pid = 0;
-    s->accepted_fd = -1;
-    kring_u8_reset(&s->rx_ring);
-    s->rx_closed = 0;
-    s->err = 0;
+    waitq_wake_all(&s->wq);
+    free_socket(fd);
     return 0;
 }
 
@@ -581,8 +1285,42 @@ int net_sock_close(int fd) {
 
 void net_sock_close_all_for_pid(uint32_t pid) {
     for (int i = 0; i < MAX_SOCKETS; i++) {
-        if (sockets[i].in_use && sockets[i].owner_pid == pid) {
+        // Queued connections go with their listener
+        if (sockets[i] && sockets[i]->owner_pid == pid &&
+            !sockets[i]->in_acceptq) {
             net_sock_close_internal(i, pid, 1);
         }
     }
 }
+
+int net_sock_poll(int fd, int wait) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->owner_pid != socket_current_pid())
+        return POLLNVAL;
+
+    int revents = 0;
+    if (s->type == SOCK_LISTEN) {
+        if (s->acceptq_count > 0)
+            revents |= POLLIN;
+    } else if (s->type == SOCK_DGRAM) {
+        if (rx_buf_used(s) > 0)
+            revents |= POLLIN;
+        revents |= POLLOUT;
+    } else {
+        if (rx_buf_used(s) > 0 || s->rx_closed)
+            revents |= POLLIN;
+        if (s->err)
+            revents |= POLLERR;
+        if (s->rx_closed || !s->pcb)
+            revents |= POLLHUP;
+        else if (!s->connecting && sock_tx_queued(s) < s->sndbuf &&
+                 tcp_sndbuf(s->pcb) > 0 &&
+                 tcp_sndqueuelen(s->pcb) < TCP_SND_QUEUELEN)
+            revents |= POLLOUT;
+    }
+    if (wait)
+        waitq_add(&s->wq);
+    return revents;
+}
+
+void net_get_sock_stats(net_sock_stats_t *out) { *out = sock_stats; }
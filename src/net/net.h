@@ -2,20 +2,84 @@
 #define _NET_H
 
 #include "lib.h"
+#include "syscall.h" // sock_msg_t
+
+// Network softirq task counters (reported in /mos/knet)
+#define NET_BATCH_HIST 6 // batch sizes 0, 1, 2-3, 4-7, 8-15, 16+
+
+typedef struct {
+    uint32_t irqs;         // NIC interrupts taken
+    uint32_t wakeups;      // net task woken from sleep
+    uint32_t batches;      // RX drain passes
+    uint32_t batch_pkts;   // frames delivered by those passes
+    uint32_t batch_max;
+    uint32_t budget_hits;  // passes that used the whole RX budget
+    uint32_t timeout_runs; // sys_check_timeouts() calls
+    uint32_t hist[NET_BATCH_HIST];
+} net_softirq_stats_t;
 
 void net_init(void);
-void net_poll(void);
+void net_start(void); // spawn the net task; needs the task system
+void net_timer_tick(void);
+void net_get_softirq_stats(net_softirq_stats_t *out);
 int net_ping(uint32_t ip_be, uint32_t timeout_ms);
 void net_set_config(uint32_t ip_be, uint32_t mask_be, uint32_t gw_be);
 void net_get_config(uint32_t *ip_be, uint32_t *mask_be, uint32_t *gw_be);
 void net_get_stats(uint32_t *rx_packets, uint32_t *tx_packets);
+const char *net_get_nic_name(void);
+
+// TCP sockets: fds index a table of kmalloc'd sockets
+#define MAX_SOCKETS 64
+#define SOCK_BACKLOG_DEFAULT 8 // sock_listen backlog 0
+#define SOCK_BACKLOG_MAX 32
+#define SOCK_RCVBUF_DEFAULT 8192
+#define SOCK_RCVBUF_MAX 65536
+#define SOCK_DGRAM_MAX 1472 // UDP payload that fits one Ethernet frame
+
+// net_sock_setopt options. RCVBUF is clamped to [TCP_WND + 1,
+// SOCK_RCVBUF_MAX]; SNDBUF (unacked bytes queued) to [TCP_MSS, TCP_SND_BUF].
+// Set on a listener, they are inherited by accepted sockets.
+#define SOCK_OPT_RCVBUF 1
+#define SOCK_OPT_SNDBUF 2
+
+typedef struct {
+    uint32_t open;     // sockets currently allocated
+    uint32_t peak;     // most sockets allocated at once
+    uint32_t accepted; // connections handed out by sock_accept
+    uint32_t refused;  // connections aborted: accept queue or table full
+    uint32_t dgram_drops; // UDP datagrams dropped: RX ring full
+} net_sock_stats_t;
 
 // TCP socket API (kernel-side, called from syscall handler)
-int net_sock_listen(uint16_t port);
+int net_sock_listen(uint16_t port, int backlog);
 int net_sock_accept(int fd);
+// Start a TCP connect and return its fd at once; POLLOUT signals that it
+// is established, POLLERR|POLLHUP that it failed
+int net_sock_connect(uint32_t ip_be, uint16_t port);
+// UDP socket bound to port (0 = ephemeral). The msgs variants move up to
+// count datagrams and return how many were sent/received (recv: -1 if none
+// are queued).
+int net_sock_udp_bind(uint16_t port);
+int net_sock_sendmsgs(int fd, const sock_msg_t *msgs, uint32_t count);
+int net_sock_recvmsgs(int fd, sock_msg_t *msgs, uint32_t count);
 int net_sock_send(int fd, const void *buf, uint32_t len);
+// Stream up to len bytes from read_fn (a file) into a TCP socket. Data is
+// read straight into the socket's TX ring; while it is full the caller
+// sleeps until ACKs free space. Returns bytes queued (0 at EOF), -1 if
+// nothing could be queued.
+typedef int (*net_src_read_t)(void *ctx, void *buf, uint32_t len);
+int net_sock_sendfile(int fd, net_src_read_t read_fn, void *ctx,
+                      uint32_t len);
 int net_sock_recv(int fd, void *buf, uint32_t len);
 int net_sock_close(int fd);
+int net_sock_setopt(int fd, int opt, uint32_t value);
+// Readiness as POLL* bits (proc/waitq.h); wait queues the caller on the
+// socket until data, a connection, send space or an error arrives
+int net_sock_poll(int fd, int wait);
 void net_sock_close_all_for_pid(uint32_t pid);
+// lwiperf throughput test (SYS_NETBENCH). NETBENCH_CLIENT blocks until the
+// test ends and fills *out.
+int net_bench(int op, uint32_t ip_be, netbench_result_t *out);
+void net_get_sock_stats(net_sock_stats_t *out);
 
 #endif
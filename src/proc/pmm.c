@@ -5,8 +5,9 @@ uint32_t PMM_END = 0x2000000u;   // Default 32MB
 uint32_t PMM_FRAME_COUNT = 6144; // Default (32MB - 8MB) / 4KB
 
 // Bitmap: 1 bit per frame, 1 = used, 0 = free
-// Sized for maximum 1GB: 261120 frames / 8 = 32640 bytes
+// Sized for maximum 1GB - 4MB: 260096 frames / 8 = 32512 bytes
 static uint8_t frame_bitmap[PMM_MAX_FRAME_COUNT / 8];
+static uint32_t used_frames = 0;
 
 static inline uint32_t frame_index(uint32_t physical_addr) {
     return (physical_addr - PMM_START) / PMM_FRAME_SIZE;
@@ -21,10 +22,14 @@ static inline int bitmap_test(uint32_t index) {
 }
 
 static inline void bitmap_set(uint32_t index) {
+    if (!bitmap_test(index))
+        used_frames++;
     frame_bitmap[index / 8] |= (1 << (index % 8));
 }
 
 static inline void bitmap_clear(uint32_t index) {
+    if (bitmap_test(index))
+        used_frames--;
     frame_bitmap[index / 8] &= ~(1 << (index % 8));
 }
 
@@ -43,6 +48,7 @@ void pmm_init(uint32_t ram_top) {
 
     // Mark all frames as free
     memset(frame_bitmap, 0, sizeof(frame_bitmap));
+    used_frames = 0;
     printf("PMM initialized: %d frames (%dMB) from 0x%x to 0x%x\n",
            PMM_FRAME_COUNT, (PMM_FRAME_COUNT * PMM_FRAME_SIZE) / (1024 * 1024),
            PMM_START, PMM_END);
@@ -124,15 +130,12 @@ void pmm_free_frames(uint32_t physical_addr, uint32_t count) {
 }
 
 void pmm_get_stats(uint32_t *total, uint32_t *used, uint32_t *free_frames) {
-    uint32_t used_count = 0;
-    for (uint32_t i = 0; i < PMM_FRAME_COUNT; i++) {
-        if (bitmap_test(i))
-            used_count++;
-    }
     if (total)
         *total = PMM_FRAME_COUNT;
     if (used)
-        *used = used_count;
+        *used = used_frames;
     if (free_frames)
-        *free_frames = PMM_FRAME_COUNT - used_count;
+        *free_frames = PMM_FRAME_COUNT - used_frames;
 }
+
+uint32_t pmm_free_count(void) { return PMM_FRAME_COUNT - used_frames; }
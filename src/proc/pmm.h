@@ -5,15 +5,16 @@
 
 // Physical frame allocator
 // Manages 4KB frames from PMM_START up to a dynamically detected end.
-// Maximum supported: 1GB (PMM_MAX_END) — limited by higher-half VA space.
-// The kernel higher-half (0xC0000000-0xFFFFFFFF) can map at most 1GB of
-// physical RAM via the PHYS_TO_KVIRT linear offset.
+// Maximum supported: 1GB - 4MB (PMM_MAX_END) — limited by higher-half VA
+// space. The kernel higher-half (0xC0000000-0xFFFFFFFF) can map at most 1GB
+// of physical RAM via the PHYS_TO_KVIRT linear offset; its last 4MB is the
+// MMIO window (KERNEL_MMIO_START).
 #define PMM_START 0x800000u        // 8MB - below is kernel/heap/boot
-#define PMM_MAX_END 0x40000000u    // 1GB cap (higher-half VA limit)
+#define PMM_MAX_END 0x3FC00000u    // 1GB - 4MB cap (higher-half VA limit)
 #define PMM_FRAME_SIZE 0x1000u     // 4KB
 
 // Maximum possible frames (used to size the static bitmap)
-// (1GB - 8MB) / 4KB = 261120 frames, bitmap = 32640 bytes
+// (1GB - 12MB) / 4KB = 260096 frames, bitmap = 32512 bytes
 #define PMM_MAX_FRAME_COUNT ((PMM_MAX_END - PMM_START) / PMM_FRAME_SIZE)
 
 // Actual end address (set at init time)
@@ -37,5 +38,7 @@ uint32_t pmm_alloc_frames(uint32_t count);
 void pmm_free_frames(uint32_t physical_addr, uint32_t count);
 
 void pmm_get_stats(uint32_t *total, uint32_t *used, uint32_t *free_frames);
+// Free frames, O(1) (kept as a running count)
+uint32_t pmm_free_count(void);
 
 #endif
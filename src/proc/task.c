@@ -2,12 +2,14 @@
 #include "arch/arch.h"
 #include "fs/vfs.h"
 #include "io/window.h"
+#include "ktrace.h"
 #include "lib.h"
 #include "liballoc/liballoc_1_1.h"
 #include "memlayout.h"
 #include "net/net.h"
 #include "pmm.h"
 #include "syscall.h" // for load_elf_into
+#include "waitq.h"
 
 // Task array and management
 static task_t tasks[MAX_TASKS];
@@ -151,7 +153,11 @@ task_t *task_create(const char *name, void (*entry)(void)) {
     task->user_brk = 0;
     task->stdout_wid = -1;
     task->detached = 0;
+    task->wq_sleeping = 0;
+    task->wake_tick = 0;
     task->runtime_ticks = 0;
+    task->sc_calls = 0;
+    task->sc_cycles = 0;
     task->start_ticks = get_tick_count();
     memcpy(task->cwd, "/", 2); // Default cwd for kernel tasks
 
@@ -166,6 +172,7 @@ task_t *task_create(const char *name, void (*entry)(void)) {
         }
     }
 
+    KTRACE(KT_TASK_SPAWN, task->id, task->parent_id, 0);
     kprintf("[task] spawn pid=%d ppid=%d ring=0 name=%s\n", task->id,
             task->parent_id, task->name);
 
@@ -347,7 +354,11 @@ task_t *task_create_user_elf(const char *filename, const char **argv,
     task->stack_top = sp;
     task->stdout_wid = -1;
     task->detached = 0;
+    task->wq_sleeping = 0;
+    task->wake_tick = 0;
     task->runtime_ticks = 0;
+    task->sc_calls = 0;
+    task->sc_cycles = 0;
     task->start_ticks = get_tick_count();
 
     // Inherit parent's cwd, or default to "/"
@@ -388,6 +399,7 @@ task_t *task_create_user_elf(const char *filename, const char **argv,
         }
     }
 
+    KTRACE(KT_TASK_SPAWN, task->id, task->parent_id, 3);
     kprintf("[task] spawn pid=%d ppid=%d ring=3 name=%s\n", task->id,
             task->parent_id, task->name);
 
@@ -410,6 +422,8 @@ uint32_t *schedule(uint32_t *current_esp, uint32_t is_hw_tick) {
     if (is_hw_tick && current_task->state == TASK_RUNNING) {
         current_task->runtime_ticks++;
     }
+    if (is_hw_tick)
+        waitq_timer_tick(get_tick_count());
 
     // Save current task's stack pointer
     current_task->stack_top = current_esp;
@@ -437,8 +451,12 @@ uint32_t *schedule(uint32_t *current_esp, uint32_t is_hw_tick) {
     }
 
     // Switch to next task
+    if (next != current_task)
+        KTRACE(KT_SCHED_SWITCH, current_task->id, next->id,
+               current_task->state);
     current_task = next;
     current_task->state = TASK_RUNNING;
+    vdso_set_pid(current_task->id);
 
     // Update TSS with new task's kernel stack for user mode tasks
     if (!current_task->is_kernel && current_task->kernel_stack_top) {
@@ -471,6 +489,7 @@ static void task_terminate(task_t *task, int code) {
 
     task->state = TASK_TERMINATED;
     task->exit_code = code;
+    KTRACE(KT_TASK_EXIT, tid, code, 0);
 
     // Wake up any task waiting for this task.
     for (int i = 0; i < MAX_TASKS; i++) {
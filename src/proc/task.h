@@ -48,9 +48,18 @@ typedef struct task {
     // Detach flag: process has detached from parent's wait
     int detached;
 
+    // Wait-queue sleep (see waitq.h): set while blocked in waitq_sleep,
+    // woken by waitq_wake_all or when wake_tick (0 = none) passes
+    int wq_sleeping;
+    uint32_t wake_tick;
+
     // Tick count at spawn time (for calculating task age)
     uint32_t start_ticks;
 
+    // Syscall accounting (sysstat.h): calls and TSC cycles spent in them
+    uint32_t sc_calls;
+    uint64_t sc_cycles;
+
     // Per-process address space
     page_directory_t
         *page_dir; // Per-process page directory (NULL for kernel tasks)
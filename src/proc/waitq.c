@@ -0,0 +1,57 @@
+#include "waitq.h"
+#include "arch/arch.h"
+#include "task.h"
+
+static int task_slot(const task_t *t) {
+    return (int)(t - task_get_by_index(0));
+}
+
+static void waitq_wake_task(task_t *t) {
+    if (t->state == TASK_BLOCKED && t->wq_sleeping) {
+        t->wq_sleeping = 0;
+        t->state = TASK_READY;
+    }
+}
+
+void waitq_add(waitq_t *q) {
+    task_t *t = task_current();
+    if (t)
+        q->waiters |= 1u << task_slot(t);
+}
+
+void waitq_wake_all(waitq_t *q) {
+    unsigned int flags = cpu_irq_save();
+    uint32_t w = q->waiters;
+    q->waiters = 0;
+    for (int i = 0; w && i < MAX_TASKS; i++, w >>= 1) {
+        if (w & 1)
+            waitq_wake_task(task_get_by_index(i));
+    }
+    cpu_irq_restore(flags);
+}
+
+int waitq_sleep(uint32_t deadline) {
+    task_t *t = task_current();
+    if (!t || !task_is_enabled())
+        return -1;
+    t->wake_tick = deadline;
+    t->wq_sleeping = 1;
+    t->state = TASK_BLOCKED;
+    task_yield(); // resumes with interrupts still off
+    int timed_out = t->wq_sleeping;
+    t->wq_sleeping = 0;
+    t->wake_tick = 0;
+    return timed_out ? -1 : 0;
+}
+
+void waitq_timer_tick(uint32_t now) {
+    for (int i = 0; i < MAX_TASKS; i++) {
+        task_t *t = task_get_by_index(i);
+        if (t->wq_sleeping && t->wake_tick &&
+            (int32_t)(now - t->wake_tick) >= 0) {
+            // Leave wq_sleeping set so waitq_sleep reports the timeout
+            if (t->state == TASK_BLOCKED)
+                t->state = TASK_READY;
+        }
+    }
+}
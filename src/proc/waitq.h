@@ -0,0 +1,34 @@
+#ifndef _WAITQ_H
+#define _WAITQ_H
+
+#include "lib.h"
+
+// Readiness bits reported by the per-object *_poll() helpers and SYS_POLL
+#define POLLIN 0x1   // data (or a connection) can be read without blocking
+#define POLLOUT 0x2  // a write would not block
+#define POLLERR 0x8  // error pending
+#define POLLHUP 0x10 // peer closed / object destroyed
+#define POLLNVAL 0x20 // not an open descriptor
+
+// Wait queue: bitmask of task slots sleeping on an object (MAX_TASKS <= 32).
+// Registration is lazy — a task is never removed from queues it did not get
+// woken through, so waiters must recheck their condition after waking.
+typedef struct {
+    uint32_t waiters;
+} waitq_t;
+
+// Register the current task on q. Call with interrupts off, then sleep.
+void waitq_add(waitq_t *q);
+
+// Wake every task sleeping on q and empty it.
+void waitq_wake_all(waitq_t *q);
+
+// Block the current task until a wait queue it joined is woken or the
+// `deadline` tick passes (0 = no timeout). Call with interrupts off.
+// Returns 0 when woken, -1 on timeout.
+int waitq_sleep(uint32_t deadline);
+
+// Timer tick: wake sleepers whose deadline has passed.
+void waitq_timer_tick(uint32_t now);
+
+#endif
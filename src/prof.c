@@ -0,0 +1,124 @@
+#include "prof.h"
+#include "arch/arch.h"
+#include "memlayout.h"
+#include "proc/task.h"
+
+// Single producer (the timer IRQ) and readers that only look below
+// sample_count: a slot is filled before the count that publishes it is
+// bumped, so no lock is needed and published samples never change.
+static prof_sample_t samples[PROF_MAX_SAMPLES];
+static volatile uint32_t sample_count = 0;
+static volatile uint32_t dropped = 0;
+static volatile int running = 0;
+
+// Follow saved-EBP links while they stay inside [lo, hi), move strictly
+// upwards and are word aligned, so a garbage EBP (code built without frame
+// pointers) ends the walk instead of faulting
+static uint8_t walk_frames(uint32_t ebp, uint32_t lo, uint32_t hi,
+                           uint32_t *out) {
+    uint8_t n = 0;
+    while (n < PROF_STACK_DEPTH && !(ebp & 3) && ebp >= lo && ebp + 8 <= hi) {
+        const uint32_t *frame = (const uint32_t *)ebp;
+        uint32_t ret = frame[1];
+        if (!ret)
+            break;
+        out[n++] = ret;
+        if (frame[0] <= ebp)
+            break;
+        ebp = frame[0];
+    }
+    return n;
+}
+
+void prof_sample(uint32_t eip, uint32_t ring, uint32_t ebp) {
+    if (!running)
+        return;
+    uint32_t idx = sample_count;
+    if (idx >= PROF_MAX_SAMPLES) {
+        dropped++;
+        return;
+    }
+
+    task_t *cur = task_current();
+    prof_sample_t *s = &samples[idx];
+    s->eip = eip;
+    s->pid = cur ? (uint16_t)cur->id : 0;
+    s->ring = (uint8_t)ring;
+    s->depth = 0;
+    if (ring == 3) {
+        // The interrupted task's address space is still loaded, and its
+        // stack pages are mapped up front by exec
+        s->depth = walk_frames(ebp, USER_STACK_BASE_VADDR,
+                               USER_STACK_TOP_PAGE_VADDR + 0x1000u, s->stack);
+    } else if (cur) {
+        uint32_t base = cur->is_kernel ? (uint32_t)cur->stack
+                                       : (uint32_t)cur->kernel_stack;
+        if (base)
+            s->depth =
+                walk_frames(ebp, base, base + TASK_STACK_SIZE, s->stack);
+    }
+    __asm__ volatile("" ::: "memory");
+    sample_count = idx + 1;
+}
+
+void prof_start(void) {
+    uint32_t irq = cpu_irq_save();
+    sample_count = 0;
+    dropped = 0;
+    running = 1;
+    cpu_irq_restore(irq);
+}
+
+void prof_stop(void) { running = 0; }
+
+uint32_t prof_size(void) {
+    return sizeof(prof_header_t) + sample_count * sizeof(prof_sample_t);
+}
+
+int prof_read(uint32_t offset, void *buf, uint32_t len) {
+    if (!buf || len == 0)
+        return 0;
+    prof_header_t hdr;
+    hdr.magic = PROF_MAGIC;
+    hdr.version = PROF_VERSION;
+    hdr.sample_size = sizeof(prof_sample_t);
+    hdr.hz = get_timer_frequency();
+    hdr.count = sample_count;
+    hdr.dropped = dropped;
+    hdr.running = (uint32_t)running;
+
+    uint32_t total = sizeof(hdr) + hdr.count * sizeof(prof_sample_t);
+    if (offset >= total)
+        return 0;
+    if (len > total - offset)
+        len = total - offset;
+
+    uint8_t *dst = (uint8_t *)buf;
+    uint32_t done = 0;
+    if (offset < sizeof(hdr)) {
+        uint32_t n = sizeof(hdr) - offset;
+        if (n > len)
+            n = len;
+        memcpy(dst, (const uint8_t *)&hdr + offset, n);
+        done = n;
+        offset += n;
+    }
+    if (done < len)
+        memcpy(dst + done, (const uint8_t *)samples + (offset - sizeof(hdr)),
+               len - done);
+    return (int)len;
+}
+
+int prof_ctl(const void *buf, uint32_t len) {
+    const char *p = (const char *)buf;
+    if (len == 0)
+        return 0;
+    if (p[0] == '1')
+        prof_start();
+    else if (p[0] == '0')
+        prof_stop();
+    else
+        return -1;
+    kprintf("[prof] sampling %s\n", running ? "started" : "stopped");
+    return (int)len;
+}
@@ -0,0 +1,45 @@
+#ifndef _PROF_H
+#define _PROF_H
+
+#include "lib.h"
+
+// Statistical profiler: while running, every timer tick records where the
+// interrupted code was (EIP, ring, task) plus a short frame-pointer stack
+// walk. Samples fill a fixed buffer that is read, header first, as the
+// binary file /mos/kprof. Writing "1" to that file clears the buffer and
+// starts sampling; writing "0" stops it. Walks need frame pointers: build
+// with `make PROFILE=1` for useful call graphs.
+#define PROF_MAGIC 0x464F5250u // "PROF"
+#define PROF_VERSION 1
+#define PROF_STACK_DEPTH 6
+#define PROF_MAX_SAMPLES 4096 // ~40s at 100Hz
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sample_size; // sizeof(prof_sample_t)
+    uint32_t hz;          // samples per second while running
+    uint32_t count;       // samples that follow the header
+    uint32_t dropped;     // ticks lost because the buffer was full
+    uint32_t running;
+} prof_header_t;
+
+typedef struct {
+    uint32_t eip;
+    uint16_t pid;
+    uint8_t ring;  // privilege level of the interrupted code (0 or 3)
+    uint8_t depth; // valid entries in stack[]
+    uint32_t stack[PROF_STACK_DEPTH]; // return addresses, innermost first
+} prof_sample_t;
+
+// Called from the timer IRQ with the interrupted context
+void prof_sample(uint32_t eip, uint32_t ring, uint32_t ebp);
+void prof_start(void);
+void prof_stop(void);
+
+// /mos/kprof backing: snapshot size, offset reads and the control write
+uint32_t prof_size(void);
+int prof_read(uint32_t offset, void *buf, uint32_t len);
+int prof_ctl(const void *buf, uint32_t len);
+
+#endif
@@ -5,6 +5,7 @@
 #include "io/keyboard.h"
 #include "io/window.h"
 #include "lib.h"
+#include "ktrace.h"
 #include "liballoc/liballoc_1_1.h"
 #include "liballoc/liballoc_hooks.h"
 #include "memlayout.h"
@@ -12,39 +13,27 @@
 #include "proc/elf.h"
 #include "proc/pmm.h"
 #include "proc/task.h"
-
-// ---- User pointer validation helpers ----
-// Validate that a user-supplied buffer [ptr, ptr+size) falls entirely within
-// the user-accessible address range. Returns 1 if valid, 0 if not.
-static inline int validate_user_ptr(uint32_t ptr, uint32_t size) {
-    if (ptr == 0)
-        return 0; // NULL pointer
-    if (ptr < USER_REGION_START)
-        return 0; // below user region
-    if (size > USER_REGION_END - USER_REGION_START)
-        return 0; // impossibly large
-    if (ptr + size < ptr)
-        return 0; // overflow
-    if (ptr + size > USER_REGION_END)
-        return 0; // exceeds user region
-    return 1;
+#include "proc/waitq.h"
+#include "sysstat.h"
+
+// ---- User memory access helpers ----
+// Arguments are copied in and out with the arch uaccess primitives, so each
+// one is read once and a bad pointer fails the call instead of faulting.
+// Bulk data buffers that the VFS, socket and window code fill in place are
+// probed page by page first rather than bounced through a kernel copy.
+
+// Copy a user path into a VFS_PATH_MAX kernel buffer. Fails on a bad
+// pointer or a path that does not fit.
+static int copy_path_from_user(char *kpath, uint32_t upath) {
+    int len = strncpy_from_user(kpath, (const char *)upath, VFS_PATH_MAX);
+    return (len < 0 || len >= VFS_PATH_MAX) ? -1 : 0;
 }
 
-// Validate a null-terminated string pointer. Walks until NUL or bounds
-// exceeded. Returns 1 if a NUL terminator is found within the user region, 0
-// otherwise.
-static inline int validate_user_string(uint32_t ptr) {
-    if (ptr == 0)
+// Buffer the kernel reads from (write = 0) or fills (write = 1) directly
+static int user_buf_ok(uint32_t ptr, uint32_t size, int write) {
+    if (!user_range_ok(ptr, size))
         return 0;
-    if (ptr < USER_REGION_START || ptr >= USER_REGION_END)
-        return 0;
-    const char *s = (const char *)ptr;
-    uint32_t max_len = USER_REGION_END - ptr;
-    for (uint32_t i = 0; i < max_len; i++) {
-        if (s[i] == '\0')
-            return 1;
-    }
-    return 0; // no NUL found within bounds
+    return probe_user((const void *)ptr, size, write) == 0;
 }
 
 // Track whether a user program is in graphics mode
@@ -81,6 +70,8 @@ static int sys_do_write(int fd, const char *buf, size_t len) {
     return (int)len;
 }
 
+static uint32_t sys_do_gfx_info(void);
+
 // Exit current task
 static void sys_do_exit(int code) {
     // Only tear down graphics if the exiting task owns it
@@ -95,6 +86,7 @@ static void sys_do_exit(int code) {
         user_gfx_active = 0;
         user_gfx_bga = 0;
         gfx_owner_pid = 0;
+        vdso_set_gfx_info(sys_do_gfx_info());
     }
     task_exit_with_code(code);
     // Should never return
@@ -103,18 +95,90 @@ static void sys_do_exit(int code) {
 // Yield to scheduler
 static void sys_do_yield(void) { task_yield(); }
 
-// Sleep current task for at least ms milliseconds.
-static int sys_do_sleepms(uint32_t ms) {
-    uint32_t start = get_tick_count();
+// Copy in a sock_msg_t array and check every buffer it points at
+static int copy_sock_msgs(sock_msg_t *kmsgs, uint32_t msgs, uint32_t count,
+                          int write) {
+    if (count == 0 || count > SOCK_MSG_BATCH_MAX)
+        return 0;
+    if (copy_from_user(kmsgs, (const void *)msgs, count * sizeof(sock_msg_t)))
+        return 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (kmsgs[i].len &&
+            !user_buf_ok((uint32_t)kmsgs[i].buf, kmsgs[i].len, write))
+            return 0;
+    }
+    return 1;
+}
+
+// Tick at which a sleep of ms milliseconds ends (never 0, which means "no
+// timeout" to waitq_sleep).
+static uint32_t deadline_after_ms(uint32_t ms) {
     uint32_t ticks = (ms + 9) / 10; // 100Hz timer => 10ms ticks
     if (ticks == 0)
         ticks = 1;
-    while ((get_tick_count() - start) < ticks) {
-        task_yield();
+    uint32_t deadline = get_tick_count() + ticks;
+    return deadline ? deadline : 1;
+}
+
+// Sleep current task for at least ms milliseconds.
+static int sys_do_sleepms(uint32_t ms) {
+    uint32_t deadline = deadline_after_ms(ms);
+    while ((int32_t)(get_tick_count() - deadline) < 0) {
+        if (waitq_sleep(deadline) < 0 && !task_is_enabled())
+            break;
     }
     return 0;
 }
 
+// Readiness of one pollfd entry; wait queues the caller on the object.
+static int poll_one(task_t *cur, const pollfd_t *p, int wait) {
+    switch (p->kind) {
+    case POLL_KIND_FILE:
+        return vfs_poll(cur->fd_table, p->fd, wait);
+    case POLL_KIND_SOCK:
+        return net_sock_poll(p->fd, wait);
+    case POLL_KIND_WIN:
+        return window_poll(p->fd, cur->id, wait);
+    default:
+        return POLLNVAL;
+    }
+}
+
+// Wait until at least one entry is ready or timeout_ms passes (-1 = forever,
+// 0 = just check). Returns the number of entries with revents set.
+static int sys_do_poll(uint32_t ufds, uint32_t nfds, int32_t timeout_ms) {
+    task_t *cur = task_current();
+    if (!cur || !cur->fd_table)
+        return -1;
+    pollfd_t fds[POLL_MAX_FDS];
+    if (copy_from_user(fds, (const void *)ufds, nfds * sizeof(pollfd_t)))
+        return -1;
+    uint32_t deadline = 0;
+    if (timeout_ms > 0)
+        deadline = deadline_after_ms((uint32_t)timeout_ms);
+
+    int ready;
+    for (;;) {
+        // Queue on every object while scanning: an event that lands after
+        // its entry was checked still wakes us. Syscalls run with IF=0, so
+        // nothing can slip in between the scan and the sleep.
+        int wait = timeout_ms != 0;
+        ready = 0;
+        for (uint32_t i = 0; i < nfds; i++) {
+            int ev = poll_one(cur, &fds[i], wait);
+            ev &= fds[i].events | POLLERR | POLLHUP | POLLNVAL;
+            fds[i].revents = (uint16_t)ev;
+            if (ev)
+                ready++;
+        }
+        if (ready || !wait || waitq_sleep(deadline) < 0)
+            break;
+    }
+    if (copy_to_user((void *)ufds, fds, nfds * sizeof(pollfd_t)))
+        return -1;
+    return ready;
+}
+
 // Load ELF segments into a page directory. Returns entry point, or 0 on error.
 // If stack_phys_out is non-NULL, stores the physical address of the user stack
 // page.
@@ -247,7 +311,7 @@ uint32_t load_elf_into(struct page_directory *page_dir, const char *filename,
                     pmm_free_frames(temp_frames_base, temp_frames_count);
                     return 0;
                 }
-                memset((void *)PHYS_TO_KVIRT(phys), 0, 0x1000);
+                zero_page((void *)PHYS_TO_KVIRT(phys));
                 if (paging_map_page(page_dir, page_vaddr, phys,
                                     PAGE_PRESENT | PAGE_WRITE | PAGE_USER) <
                     0) {
@@ -281,7 +345,7 @@ uint32_t load_elf_into(struct page_directory *page_dir, const char *filename,
             pmm_free_frames(temp_frames_base, temp_frames_count);
             return 0;
         }
-        memset((void *)PHYS_TO_KVIRT(phys), 0, 0x1000);
+        zero_page((void *)PHYS_TO_KVIRT(phys));
         if (paging_map_page(page_dir, stack_base + (i * 0x1000u), phys,
                             PAGE_PRESENT | PAGE_WRITE | PAGE_USER) < 0) {
             printf("[exec] failed to map stack page %d\n", (int)i);
@@ -311,22 +375,13 @@ uint32_t load_elf_into(struct page_directory *page_dir, const char *filename,
 }
 
 // Execute ELF binary from VFS - replaces current process
-static int sys_do_exec(const char *filename, iret_frame_t *frame) {
-    if (!filename)
-        return -1;
-
+// kfilename is a kernel copy of the path.
+static int sys_do_exec(const char *kfilename, iret_frame_t *frame) {
     task_t *current = task_current();
     if (!current || current->is_kernel || !current->page_dir) {
         return -1;
     }
 
-    char kfilename[VFS_PATH_MAX];
-    size_t flen = strlen(filename);
-    if (flen >= sizeof(kfilename))
-        flen = sizeof(kfilename) - 1;
-    memcpy(kfilename, filename, flen);
-    kfilename[flen] = '\0';
-
     page_directory_t *kernel_dir = paging_get_kernel_dir();
     paging_switch(kernel_dir);
 
@@ -476,21 +531,10 @@ static uint32_t sys_do_getkey(uint32_t flags __attribute__((unused))) {
 // Spawn: create a child process from an ELF via VFS.
 // If argv/argc are provided (argv != NULL, argc > 0), they are placed on
 // the child's stack. Otherwise defaults to argv={filename}, argc=1.
-// argv strings must be in the calling process's address space — they are
-// copied into kernel buffers before the child's address space is created.
-static int sys_do_spawn(const char *filename, const char **argv, int argc) {
-    if (!filename) {
-        kprintf("[task] spawn fail file=(null) err=%d\n", -1);
-        return -1;
-    }
-
-    char kfilename[VFS_PATH_MAX];
-    size_t flen = strlen(filename);
-    if (flen >= sizeof(kfilename))
-        flen = sizeof(kfilename) - 1;
-    memcpy(kfilename, filename, flen);
-    kfilename[flen] = '\0';
-
+// kfilename is a kernel copy of the path; argv is the user's array, whose
+// strings are copied into kernel buffers before the child's address space
+// is created.
+static int sys_do_spawn(const char *kfilename, uint32_t argv, int argc) {
     // Copy argv strings into kernel buffers (they're in parent's address space
     // which will not be accessible after we switch to the child's page dir).
     const char *kargv[16];
@@ -500,16 +544,22 @@ static int sys_do_spawn(const char *filename, const char **argv, int argc) {
     if (argv && argc > 0) {
         if (argc > 16)
             argc = 16;
+        uint32_t uargv[16];
+        if (copy_from_user(uargv, (const void *)argv,
+                           (uint32_t)argc * sizeof(uint32_t)))
+            return -1;
         uint32_t off = 0;
         for (int i = 0; i < argc; i++) {
-            if (!argv[i])
+            if (!uargv[i])
                 break;
-            size_t slen = strlen(argv[i]) + 1;
-            if (off + slen > sizeof(kargbuf))
+            int slen = strncpy_from_user(kargbuf + off, (const char *)uargv[i],
+                                         sizeof(kargbuf) - off);
+            if (slen < 0)
+                return -1;
+            if (off + (uint32_t)slen >= sizeof(kargbuf))
                 break;
-            memcpy(kargbuf + off, argv[i], slen);
             kargv[i] = kargbuf + off;
-            off += slen;
+            off += (uint32_t)slen + 1;
             kargc++;
         }
     }
@@ -633,7 +683,8 @@ static int sys_do_getpid(void) {
     return current ? (int)current->id : -1;
 }
 
-// sbrk: move user program break and map pages on demand.
+// sbrk: move user program break, mapping pages on demand as it grows and
+// unmapping (and freeing) whole pages past the new break as it shrinks.
 // Returns previous break on success, (void*)-1 on failure.
 static uint32_t sys_do_sbrk(int32_t increment) {
     task_t *current = task_current();
@@ -650,8 +701,10 @@ static uint32_t sys_do_sbrk(int32_t increment) {
         if (new_brk < old_brk)
             return (uint32_t)-1; // overflow
     } else if (increment < 0) {
-        // Keep it simple for now: no shrinking.
-        return (uint32_t)-1;
+        uint32_t dec = 0u - (uint32_t)increment;
+        if (dec > old_brk - current->user_brk_min)
+            return (uint32_t)-1;
+        new_brk = old_brk - dec;
     }
 
     if (new_brk < current->user_brk_min)
@@ -659,13 +712,24 @@ static uint32_t sys_do_sbrk(int32_t increment) {
     if (new_brk >= USER_STACK_BASE_VADDR)
         return (uint32_t)-1;
 
+    if (new_brk < old_brk) {
+        // The page holding the new break stays mapped; the ones wholly
+        // past it go back to the PMM
+        uint32_t unmap_start = (new_brk + 0xFFFu) & ~0xFFFu;
+        uint32_t unmap_end = (old_brk + 0xFFFu) & ~0xFFFu;
+        for (uint32_t va = unmap_start; va < unmap_end; va += 0x1000u)
+            paging_free_user_page(current->page_dir, va);
+        current->user_brk = new_brk;
+        return old_brk;
+    }
+
     uint32_t map_start = (old_brk + 0xFFFu) & ~0xFFFu;
     uint32_t map_end = (new_brk + 0xFFFu) & ~0xFFFu;
     for (uint32_t va = map_start; va < map_end; va += 0x1000u) {
         uint32_t phys = pmm_alloc_frame();
         if (!phys)
             return (uint32_t)-1;
-        memset((void *)PHYS_TO_KVIRT(phys), 0, 0x1000u);
+        zero_page((void *)PHYS_TO_KVIRT(phys));
         if (paging_map_page(current->page_dir, va, phys,
                             PAGE_PRESENT | PAGE_WRITE | PAGE_USER) < 0) {
             pmm_free_frame(phys);
@@ -687,13 +751,154 @@ static int sys_do_debug_exit(uint32_t code) {
 // Kill a task by task id.
 static int sys_do_kill(uint32_t task_id) { return task_kill(task_id, -9); }
 
-// Main syscall dispatcher - called from assembly
+// SYS_SENDFILE: file data goes from the block cache into the socket's TX
+// ring without a user copy. Reads start at the file position, which is
+// left just past the bytes actually queued.
+typedef struct {
+    vfs_fd_table_t *fdt;
+    int fd;
+} sendfile_src_t;
+
+static int sendfile_read(void *ctx, void *buf, uint32_t len) {
+    sendfile_src_t *src = (sendfile_src_t *)ctx;
+    return vfs_read(src->fdt, src->fd, buf, len);
+}
+
+static int sys_do_sendfile(int sock, int fd, uint32_t len) {
+    task_t *cur = task_current();
+    if (!cur || !cur->fd_table)
+        return -1;
+    int start = vfs_seek(cur->fd_table, fd, 0, SEEK_CUR);
+    if (start < 0)
+        return -1;
+    sendfile_src_t src = {cur->fd_table, fd};
+    int n = net_sock_sendfile(sock, sendfile_read, &src, len);
+    vfs_seek(cur->fd_table, fd, start + (n > 0 ? n : 0), SEEK_SET);
+    return n;
+}
+
+// SYS_RING_ENTER: run queued syscalls from a user ring in one trap. Each
+// entry goes through syscall_handler(), so it is validated exactly as if it
+// had been trapped on its own.
+static int ring_op_allowed(uint32_t op) {
+    switch (op) {
+    case SYS_WRITE:
+    case SYS_OPEN:
+    case SYS_FREAD:
+    case SYS_FWRITE:
+    case SYS_CLOSE:
+    case SYS_SEEK:
+    case SYS_STAT:
+    case SYS_UNLINK:
+    case SYS_MKDIR:
+    case SYS_RMDIR:
+    case SYS_RENAME:
+    case SYS_FTRUNCATE:
+    case SYS_OPENDIR:
+    case SYS_GETDENTS:
+    case SYS_PIPE_CREATE:
+    case SYS_PIPE_DESTROY:
+    case SYS_SOCK_ACCEPT:
+    case SYS_SOCK_SEND:
+    case SYS_SOCK_RECV:
+    case SYS_SOCK_CLOSE:
+    case SYS_SOCK_SETOPT:
+    case SYS_SOCK_SENDMSGS:
+    case SYS_SOCK_RECVMSGS:
+    case SYS_SENDFILE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// A link holds only if the entry succeeded; I/O must also move every byte
+static int ring_op_ok(const ring_sqe_t *sqe, int32_t res) {
+    if (res < 0)
+        return 0;
+    switch (sqe->op) {
+    case SYS_WRITE:
+    case SYS_FREAD:
+    case SYS_FWRITE:
+    case SYS_SOCK_SEND:
+    case SYS_SENDFILE:
+        return (uint32_t)res == sqe->args[2];
+    default:
+        return 1;
+    }
+}
+
+static int sys_do_ring_enter(uint32_t ring_ptr, uint32_t to_submit) {
+    // Work on a kernel copy of the header, so a queued call that rewrites
+    // it (an fread into the ring, say) cannot redirect the sqe/cqe arrays;
+    // only the indices the kernel advances are written back
+    ring_t r;
+    ring_t *ur = (ring_t *)ring_ptr;
+    if (copy_from_user(&r, ur, sizeof(r)))
+        return -1;
+    uint32_t entries = r.entries;
+    if (!entries || entries > RING_MAX_ENTRIES || (entries & (entries - 1)))
+        return -1;
+    if (!user_range_ok((uint32_t)r.sqes, entries * sizeof(ring_sqe_t)) ||
+        !user_range_ok((uint32_t)r.cqes, entries * sizeof(ring_cqe_t)))
+        return -1;
+
+    uint32_t mask = entries - 1;
+    int done = 0, skip = 0;
+    if (to_submit > entries)
+        to_submit = entries;
+    while ((uint32_t)done < to_submit && r.sq_head != r.sq_tail &&
+           r.cq_tail - r.cq_head < entries) {
+        // Copy the entry first: its user slot may be reused once sq_head moves
+        ring_sqe_t sqe;
+        if (copy_from_user(&sqe, &r.sqes[r.sq_head & mask], sizeof(sqe)))
+            return -1;
+        r.sq_head++;
+        if (copy_to_user(&ur->sq_head, &r.sq_head, sizeof(r.sq_head)))
+            return -1;
+
+        int32_t res = -1;
+        if (!skip && ring_op_allowed(sqe.op))
+            res = (int32_t)syscall_handler(sqe.op, sqe.args[0], sqe.args[1],
+                                           sqe.args[2], NULL);
+        skip = (sqe.flags & RING_F_LINK) && (skip || !ring_op_ok(&sqe, res));
+
+        ring_cqe_t cqe;
+        cqe.user_data = sqe.user_data;
+        cqe.res = res;
+        if (copy_to_user(&r.cqes[r.cq_tail & mask], &cqe, sizeof(cqe)))
+            return -1;
+        r.cq_tail++;
+        if (copy_to_user(&ur->cq_tail, &r.cq_tail, sizeof(r.cq_tail)))
+            return -1;
+        done++;
+    }
+    return done;
+}
+
+static uint32_t syscall_dispatch(uint32_t eax, uint32_t ebx, uint32_t ecx,
+                                 uint32_t edx, void *frame);
+
+// Main syscall entry - called from assembly (and per SYS_RING_ENTER entry).
 // frame_ptr points to the iret frame on the kernel stack
 uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
                          void *frame) {
+    uint64_t start = sysstat_now();
+    KTRACE(KT_SYSCALL_ENTER, eax, ebx, ecx);
+    // exit never returns, so it is accounted up front
+    if (eax == SYS_EXIT)
+        sysstat_record(eax, ebx, ecx, edx, 0, start);
+    uint32_t ret = syscall_dispatch(eax, ebx, ecx, edx, frame);
+    sysstat_record(eax, ebx, ecx, edx, ret, start);
+    KTRACE(KT_SYSCALL_EXIT, eax, ret, 0);
+    return ret;
+}
+
+static uint32_t syscall_dispatch(uint32_t eax, uint32_t ebx, uint32_t ecx,
+                                 uint32_t edx, void *frame) {
     switch (eax) {
     case SYS_WRITE:
-        if (edx > 0 && !validate_user_ptr(ecx, edx))
+        if (edx > 0 && !user_buf_ok(ecx, edx, 0))
             return (uint32_t)-1;
         return (uint32_t)sys_do_write((int)ebx, (const char *)ecx, (size_t)edx);
 
@@ -705,46 +910,56 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
         sys_do_yield();
         return 0;
 
-    case SYS_EXEC:
-        if (!validate_user_string(ebx))
+    case SYS_EXEC: {
+        char epath[VFS_PATH_MAX];
+        if (copy_path_from_user(epath, ebx))
             return (uint32_t)-1;
-        return (uint32_t)sys_do_exec((const char *)ebx, (iret_frame_t *)frame);
+        return (uint32_t)sys_do_exec(epath, (iret_frame_t *)frame);
+    }
 
-    case SYS_GFX_INIT:
-        return sys_do_gfx_init();
+    case SYS_GFX_INIT: {
+        uint32_t fb = sys_do_gfx_init();
+        vdso_set_gfx_info(sys_do_gfx_info());
+        return fb;
+    }
 
     case SYS_GFX_EXIT:
         sys_do_gfx_exit();
+        vdso_set_gfx_info(sys_do_gfx_info());
         return 0;
 
     case SYS_GETKEY:
         return sys_do_getkey(ebx);
 
-    case SYS_SPAWN:
+    case SYS_SPAWN: {
         // Spawn uses filename as-is — shell prepends bin/ and appends .elf/.wlf.
-        if (!validate_user_string(ebx))
+        // argv (ecx=argv, edx=argc) is copied in by sys_do_spawn
+        char spath[VFS_PATH_MAX];
+        if (copy_path_from_user(spath, ebx)) {
+            kprintf("[task] spawn fail file=(bad) err=%d\n", -1);
             return (uint32_t)-1;
-        // Validate argv array if provided (ecx=argv, edx=argc)
-        if (ecx && edx > 0) {
-            if (!validate_user_ptr(ecx, (uint32_t)edx * sizeof(uint32_t)))
-                return (uint32_t)-1;
         }
-        return (uint32_t)sys_do_spawn((const char *)ebx, (const char **)ecx,
-                                      (int)edx);
+        return (uint32_t)sys_do_spawn(spath, ecx, (int)edx);
+    }
 
     case SYS_WAIT:
         return (uint32_t)sys_do_wait(ebx);
 
-    case SYS_READDIR:
+    case SYS_READDIR: {
         // readdir(path, index, buf) — ebx=path (NULL=cwd), ecx=index, edx=buf
         // Buffer size fixed at 32 (matches FAT16 8.3 names and typical user
         // buffers)
-        if (ebx && !validate_user_string(ebx))
+        char rdpath[VFS_PATH_MAX], rdname[32];
+        if (ebx && copy_path_from_user(rdpath, ebx))
             return (uint32_t)-1;
-        if (!validate_user_ptr(edx, 32))
+        if (!user_range_ok(edx, sizeof(rdname)))
             return (uint32_t)-1;
-        return (uint32_t)sys_do_readdir((const char *)ebx, ecx, (char *)edx,
-                                        32);
+        int rdlen = sys_do_readdir(ebx ? rdpath : NULL, ecx, rdname,
+                                   sizeof(rdname));
+        if (rdlen > 0 && copy_to_user((void *)edx, rdname, (uint32_t)rdlen))
+            return (uint32_t)-1;
+        return (uint32_t)rdlen;
+    }
 
     case SYS_GETPID:
         return (uint32_t)sys_do_getpid();
@@ -759,12 +974,16 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
         return 0;
 
     case SYS_WIN_CREATE: {
-        if (ecx && !validate_user_string(ecx))
+        // Long titles are truncated, as window_create() would
+        char title[WIN_TITLE_MAX];
+        if (ecx &&
+            strncpy_from_user(title, (const char *)ecx, sizeof(title)) < 0)
             return (uint32_t)-1;
+        title[sizeof(title) - 1] = '\0';
         int w = (int)(ebx >> 16);
         int h = (int)(ebx & 0xFFFF);
         task_t *cur = task_current();
-        return cur ? (uint32_t)window_create(cur->id, w, h, (const char *)ecx)
+        return cur ? (uint32_t)window_create(cur->id, w, h, ecx ? title : NULL)
                    : (uint32_t)-1;
     }
 
@@ -774,7 +993,7 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
     }
 
     case SYS_WIN_WRITE: {
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 0))
             return (uint32_t)-1;
         task_t *cur = task_current();
         return cur ? (uint32_t)window_write((int)ebx, cur->id,
@@ -783,7 +1002,7 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
     }
 
     case SYS_WIN_READ:
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 1))
             return (uint32_t)-1;
         return (uint32_t)window_read((int)ebx, (uint8_t *)ecx, edx);
 
@@ -796,8 +1015,7 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
         return (uint32_t)window_sendkey((int)ebx, (uint8_t)ecx);
 
     case SYS_WIN_LIST:
-        if (ecx > 0 &&
-            !validate_user_ptr(ebx, (uint32_t)ecx * sizeof(win_info_t)))
+        if (ecx > 0 && !user_buf_ok(ebx, (uint32_t)ecx * sizeof(win_info_t), 1))
             return (uint32_t)-1;
         return (uint32_t)window_list((win_info_t *)ebx, (int)ecx);
 
@@ -806,7 +1024,7 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
 
     case SYS_TASKLIST:
         if (ecx > 0 &&
-            !validate_user_ptr(ebx, (uint32_t)ecx * sizeof(taskinfo_entry_t)))
+            !user_buf_ok(ebx, (uint32_t)ecx * sizeof(taskinfo_entry_t), 1))
             return (uint32_t)-1;
         return (uint32_t)task_list_info((void *)ebx, (int)ecx);
 
@@ -821,24 +1039,21 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
         return 0;
 
     case SYS_NETGET: {
-        if (!validate_user_ptr(ebx, 4) || !validate_user_ptr(ecx, 4) ||
-            !validate_user_ptr(edx, 4))
-            return (uint32_t)-1;
         uint32_t ip_be = 0, mask_be = 0, gw_be = 0;
         net_get_config(&ip_be, &mask_be, &gw_be);
-        *(uint32_t *)ebx = ip_be;
-        *(uint32_t *)ecx = mask_be;
-        *(uint32_t *)edx = gw_be;
+        if (copy_to_user((void *)ebx, &ip_be, 4) ||
+            copy_to_user((void *)ecx, &mask_be, 4) ||
+            copy_to_user((void *)edx, &gw_be, 4))
+            return (uint32_t)-1;
         return 0;
     }
 
     case SYS_NETSTATS: {
-        if (!validate_user_ptr(ebx, 4) || !validate_user_ptr(ecx, 4))
-            return (uint32_t)-1;
         uint32_t rx = 0, tx = 0;
         net_get_stats(&rx, &tx);
-        *(uint32_t *)ebx = rx;
-        *(uint32_t *)ecx = tx;
+        if (copy_to_user((void *)ebx, &rx, 4) ||
+            copy_to_user((void *)ecx, &tx, 4))
+            return (uint32_t)-1;
         return 0;
     }
 
@@ -846,26 +1061,87 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
         return (uint32_t)sys_do_sleepms(ebx);
 
     case SYS_SOCK_LISTEN:
-        return (uint32_t)net_sock_listen((uint16_t)ebx);
+        // ecx = accept backlog (0 = default)
+        return (uint32_t)net_sock_listen((uint16_t)ebx, (int)ecx);
 
     case SYS_SOCK_ACCEPT:
         return (uint32_t)net_sock_accept((int)ebx);
 
     case SYS_SOCK_SEND:
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 0))
             return (uint32_t)-1;
         return (uint32_t)net_sock_send((int)ebx, (const void *)ecx, edx);
 
     case SYS_SOCK_RECV:
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 1))
             return (uint32_t)-1;
         return (uint32_t)net_sock_recv((int)ebx, (void *)ecx, edx);
 
     case SYS_SOCK_CLOSE:
         return (uint32_t)net_sock_close((int)ebx);
 
+    case SYS_SOCK_SETOPT:
+        return (uint32_t)net_sock_setopt((int)ebx, (int)ecx, edx);
+
+    case SYS_SOCK_CONNECT:
+        return (uint32_t)net_sock_connect(ebx, (uint16_t)ecx);
+
+    case SYS_UDP_BIND:
+        return (uint32_t)net_sock_udp_bind((uint16_t)ebx);
+
+    case SYS_SOCK_SENDMSGS: {
+        sock_msg_t smsgs[SOCK_MSG_BATCH_MAX];
+        if (!copy_sock_msgs(smsgs, ecx, edx, 0))
+            return (uint32_t)-1;
+        return (uint32_t)net_sock_sendmsgs((int)ebx, smsgs, edx);
+    }
+
+    case SYS_SOCK_RECVMSGS: {
+        // Lengths and peer addresses come back in the array
+        sock_msg_t rmsgs[SOCK_MSG_BATCH_MAX];
+        if (!copy_sock_msgs(rmsgs, ecx, edx, 1))
+            return (uint32_t)-1;
+        int rn = net_sock_recvmsgs((int)ebx, rmsgs, edx);
+        if (rn > 0 &&
+            copy_to_user((void *)ecx, rmsgs, (uint32_t)rn * sizeof(sock_msg_t)))
+            return (uint32_t)-1;
+        return (uint32_t)rn;
+    }
+
+    case SYS_SENDFILE:
+        return (uint32_t)sys_do_sendfile((int)ebx, (int)ecx, edx);
+
+    case SYS_SYSENTER:
+        return (uint32_t)sysenter_enabled();
+
+    case SYS_RING_ENTER:
+        return (uint32_t)sys_do_ring_enter(ebx, ecx);
+
+    case SYS_STRACE:
+        return (uint32_t)sysstat_trace_ctl(ebx, (int)ecx);
+
+    case SYS_STRACE_READ:
+        if ((int)edx <= 0)
+            return (uint32_t)-1;
+        if (edx > STRACE_RING_EVENTS)
+            edx = STRACE_RING_EVENTS;
+        if (!user_buf_ok(ecx, edx * sizeof(strace_event_t), 1))
+            return (uint32_t)-1;
+        return (uint32_t)sysstat_trace_read(ebx, (strace_event_t *)ecx,
+                                            (int)edx);
+
+    case SYS_NETBENCH: {
+        netbench_result_t nb = {0, 0, 0, 0};
+        if (edx && !user_range_ok(edx, sizeof(nb)))
+            return (uint32_t)-1;
+        int nbret = net_bench((int)ebx, ecx, edx ? &nb : NULL);
+        if (edx && copy_to_user((void *)edx, &nb, sizeof(nb)))
+            return (uint32_t)-1;
+        return (uint32_t)nbret;
+    }
+
     case SYS_WIN_READ_TEXT: {
-        if (edx > 0 && !validate_user_ptr(ecx, edx))
+        if (edx > 0 && !user_buf_ok(ecx, edx, 1))
             return (uint32_t)-1;
         task_t *cur = task_current();
         return cur ? (uint32_t)window_read_text((int)ebx, cur->id, (char *)ecx,
@@ -882,35 +1158,30 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
     }
 
     case SYS_GETMOUSE: {
-        if (ebx && !validate_user_ptr(ebx, 4))
+        mouse_state_t ms = mouse_get_state();
+        if (ebx && copy_to_user((void *)ebx, &ms.x, 4))
             return (uint32_t)-1;
-        if (ecx && !validate_user_ptr(ecx, 4))
+        if (ecx && copy_to_user((void *)ecx, &ms.y, 4))
             return (uint32_t)-1;
-        if (edx && !validate_user_ptr(edx, 1))
+        if (edx && copy_to_user((void *)edx, &ms.buttons, 1))
             return (uint32_t)-1;
-        mouse_state_t ms = mouse_get_state();
-        if (ebx)
-            *(int *)ebx = ms.x;
-        if (ecx)
-            *(int *)ecx = ms.y;
-        if (edx)
-            *(uint8_t *)edx = ms.buttons;
         return 0;
     }
 
     case SYS_OPEN: {
-        if (!validate_user_string(ebx))
+        char oname[VFS_PATH_MAX];
+        if (copy_path_from_user(oname, ebx))
             return (uint32_t)-1;
         task_t *cur = task_current();
         if (!cur || !cur->fd_table)
             return (uint32_t)-1;
         char opath[VFS_PATH_MAX];
-        vfs_resolve_path(cur->cwd, (const char *)ebx, opath);
+        vfs_resolve_path(cur->cwd, oname, opath);
         return (uint32_t)vfs_open(cur->fd_table, opath, (int)ecx);
     }
 
     case SYS_FREAD: {
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 1))
             return (uint32_t)-1;
         task_t *cur = task_current();
         if (!cur || !cur->fd_table)
@@ -919,7 +1190,7 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
     }
 
     case SYS_FWRITE: {
-        if (!validate_user_ptr(ecx, edx))
+        if (!user_buf_ok(ecx, edx, 0))
             return (uint32_t)-1;
         task_t *cur = task_current();
         if (!cur || !cur->fd_table)
@@ -949,25 +1220,31 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
     }
 
     case SYS_STAT: {
-        if (!validate_user_string(ebx))
+        char sname[VFS_PATH_MAX];
+        if (copy_path_from_user(sname, ebx))
             return (uint32_t)-1;
-        if (!validate_user_ptr(ecx, sizeof(vfs_stat_t)))
+        if (!user_range_ok(ecx, sizeof(vfs_stat_t)))
             return (uint32_t)-1;
         task_t *scur = task_current();
         char spath[VFS_PATH_MAX];
-        vfs_resolve_path(scur ? scur->cwd : "/", (const char *)ebx, spath);
-        return (uint32_t)vfs_stat(spath, (vfs_stat_t *)ecx);
+        vfs_resolve_path(scur ? scur->cwd : "/", sname, spath);
+        vfs_stat_t st;
+        int sret = vfs_stat(spath, &st);
+        if (sret == 0 && copy_to_user((void *)ecx, &st, sizeof(st)))
+            return (uint32_t)-1;
+        return (uint32_t)sret;
     }
 
     case SYS_DETACH:
         return (uint32_t)sys_do_detach();
 
     case SYS_UNLINK: {
-        if (!validate_user_string(ebx))
+        char uname[VFS_PATH_MAX];
+        if (copy_path_from_user(uname, ebx))
             return (uint32_t)-1;
         task_t *ucur = task_current();
         char upath[VFS_PATH_MAX];
-        vfs_resolve_path(ucur ? ucur->cwd : "/", (const char *)ebx, upath);
+        vfs_resolve_path(ucur ? ucur->cwd : "/", uname, upath);
         return (uint32_t)vfs_unlink(upath);
     }
 
@@ -985,23 +1262,25 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
 
     case SYS_MKDIR: {
         // mkdir(path) -> 0 or -1
-        if (!validate_user_string(ebx))
+        char mname[VFS_PATH_MAX];
+        if (copy_path_from_user(mname, ebx))
             return (uint32_t)-1;
         task_t *mcur = task_current();
         char mpath[VFS_PATH_MAX];
-        vfs_resolve_path(mcur ? mcur->cwd : "/", (const char *)ebx, mpath);
+        vfs_resolve_path(mcur ? mcur->cwd : "/", mname, mpath);
         return (uint32_t)vfs_mkdir(mpath);
     }
 
     case SYS_CHDIR: {
         // chdir(path) -> 0 or -1
-        if (!validate_user_string(ebx))
+        char cname[VFS_PATH_MAX];
+        if (copy_path_from_user(cname, ebx))
             return (uint32_t)-1;
         task_t *ccur = task_current();
         if (!ccur)
             return (uint32_t)-1;
         char cpath[VFS_PATH_MAX];
-        vfs_resolve_path(ccur->cwd, (const char *)ebx, cpath);
+        vfs_resolve_path(ccur->cwd, cname, cpath);
         // Validate that path exists and is a directory
         vfs_stat_t cst;
         if (vfs_stat(cpath, &cst) < 0)
@@ -1018,22 +1297,25 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
 
     case SYS_RMDIR: {
         // rmdir(path) -> 0 or -1
-        if (!validate_user_string(ebx))
+        char rname[VFS_PATH_MAX];
+        if (copy_path_from_user(rname, ebx))
             return (uint32_t)-1;
         task_t *rcur = task_current();
         char rpath[VFS_PATH_MAX];
-        vfs_resolve_path(rcur ? rcur->cwd : "/", (const char *)ebx, rpath);
+        vfs_resolve_path(rcur ? rcur->cwd : "/", rname, rpath);
         return (uint32_t)vfs_rmdir(rpath);
     }
 
     case SYS_RENAME: {
         // rename(oldpath, newpath) -> 0 or -1 (ebx=oldpath, ecx=newpath)
-        if (!validate_user_string(ebx) || !validate_user_string(ecx))
+        char rn_uold[VFS_PATH_MAX], rn_unew[VFS_PATH_MAX];
+        if (copy_path_from_user(rn_uold, ebx) ||
+            copy_path_from_user(rn_unew, ecx))
             return (uint32_t)-1;
         task_t *rncur = task_current();
         char rn_old[VFS_PATH_MAX], rn_new[VFS_PATH_MAX];
-        vfs_resolve_path(rncur ? rncur->cwd : "/", (const char *)ebx, rn_old);
-        vfs_resolve_path(rncur ? rncur->cwd : "/", (const char *)ecx, rn_new);
+        vfs_resolve_path(rncur ? rncur->cwd : "/", rn_uold, rn_old);
+        vfs_resolve_path(rncur ? rncur->cwd : "/", rn_unew, rn_new);
         return (uint32_t)vfs_rename(rn_old, rn_new);
     }
 
@@ -1047,32 +1329,63 @@ uint32_t syscall_handler(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx,
 
     case SYS_GETCWD: {
         // getcwd(buf, size) -> 0 or -1
-        if (!validate_user_ptr(ebx, ecx))
-            return (uint32_t)-1;
         task_t *gcur = task_current();
         if (!gcur)
             return (uint32_t)-1;
-        char *gbuf = (char *)ebx;
-        uint32_t gsize = ecx;
-        int glen = strlen(gcur->cwd);
-        if ((uint32_t)(glen + 1) > gsize)
+        uint32_t glen = strlen(gcur->cwd);
+        if (glen + 1 > ecx)
+            return (uint32_t)-1;
+        if (copy_to_user((void *)ebx, gcur->cwd, glen + 1))
             return (uint32_t)-1;
-        memcpy(gbuf, gcur->cwd, glen + 1);
         return 0;
     }
 
     case SYS_PIPE_CREATE: {
         // pipe_create(name) -> 0 or -1 (ebx=name ptr)
-        if (!validate_user_string(ebx))
+        char pcname[VFS_PATH_MAX];
+        if (copy_path_from_user(pcname, ebx))
             return (uint32_t)-1;
-        return (uint32_t)pipe_create((const char *)ebx);
+        return (uint32_t)pipe_create(pcname);
     }
 
     case SYS_PIPE_DESTROY: {
         // pipe_destroy(name) -> 0 or -1 (ebx=name ptr)
-        if (!validate_user_string(ebx))
+        char pdname[VFS_PATH_MAX];
+        if (copy_path_from_user(pdname, ebx))
+            return (uint32_t)-1;
+        return (uint32_t)pipe_destroy(pdname);
+    }
+
+    case SYS_OPENDIR: {
+        // opendir(path) -> fd (ebx=path, NULL or "" = cwd)
+        char odname[VFS_PATH_MAX];
+        odname[0] = '\0';
+        if (ebx && copy_path_from_user(odname, ebx))
+            return (uint32_t)-1;
+        task_t *odcur = task_current();
+        if (!odcur || !odcur->fd_table)
+            return (uint32_t)-1;
+        char odpath[VFS_PATH_MAX];
+        vfs_resolve_path(odcur->cwd, odname[0] ? odname : ".", odpath);
+        return (uint32_t)vfs_opendir(odcur->fd_table, odpath);
+    }
+
+    case SYS_GETDENTS: {
+        // getdents(fd, buf, size) -> bytes of vfs_dirent_t records
+        if (!user_buf_ok(ecx, edx, 1))
+            return (uint32_t)-1;
+        task_t *gdcur = task_current();
+        if (!gdcur || !gdcur->fd_table)
+            return (uint32_t)-1;
+        return (uint32_t)vfs_getdents(gdcur->fd_table, (int)ebx, (void *)ecx,
+                                      edx);
+    }
+
+    case SYS_POLL: {
+        // poll(fds, nfds, timeout_ms) -> ready count, 0 on timeout
+        if (ecx > POLL_MAX_FDS)
             return (uint32_t)-1;
-        return (uint32_t)pipe_destroy((const char *)ebx);
+        return (uint32_t)sys_do_poll(ebx, ecx, (int32_t)edx);
     }
 
     default:
@@ -31,7 +31,7 @@
 #define SYS_NETCFG 25  // netcfg(ip_be, mask_be, gw_be)
 #define SYS_NETGET 26  // netget(out_ip, out_mask, out_gw) -> 0
 #define SYS_SLEEPMS 27 // sleepms(ms) -> 0
-#define SYS_SOCK_LISTEN 28 // sock_listen(port) -> fd
+#define SYS_SOCK_LISTEN 28 // sock_listen(port, backlog) -> fd
 #define SYS_SOCK_ACCEPT 29 // sock_accept(fd) -> new_fd or -1
 #define SYS_SOCK_SEND 30   // sock_send(fd, buf, len) -> bytes
 #define SYS_SOCK_RECV                                                          \
@@ -62,6 +62,92 @@
 #define SYS_FTRUNCATE    54  // ftruncate(fd, length) -> 0 or -1
 #define SYS_PIPE_CREATE  55  // pipe_create(name) -> 0 or -1
 #define SYS_PIPE_DESTROY 56  // pipe_destroy(name) -> 0 or -1
+#define SYS_OPENDIR      57  // opendir(path) -> fd (path NULL = cwd)
+#define SYS_GETDENTS     58  // getdents(fd, buf, size) -> bytes, 0 at end
+#define SYS_POLL         59  // poll(fds, nfds, timeout_ms) -> ready count
+#define SYS_SOCK_SETOPT  60  // sock_setopt(fd, opt, value) -> 0 or -1
+#define SYS_SOCK_CONNECT 61  // sock_connect(ip_be, port) -> fd (in progress)
+#define SYS_UDP_BIND     62  // udp_bind(port) -> fd (port 0 = ephemeral)
+#define SYS_SOCK_SENDMSGS 63 // sendmsgs(fd, msgs, n) -> datagrams sent
+#define SYS_SOCK_RECVMSGS 64 // recvmsgs(fd, msgs, n) -> datagrams, -1 if none
+#define SYS_SENDFILE     65  // sendfile(sock, file_fd, len) -> bytes queued
+#define SYS_NETBENCH     66  // netbench(op, ip_be, result) -> 0 or -1
+#define SYS_SYSENTER     67  // sysenter_available() -> 1 if SYSENTER is set up
+#define SYS_RING_ENTER   68  // ring_enter(ring, to_submit) -> entries consumed
+#define SYS_STRACE       69  // strace(pid, enable) -> 0 or -1
+#define SYS_STRACE_READ  70  // strace_read(pid, events, max) -> events copied
+
+// SYS_POLL entry. fd is interpreted according to kind (sockets and windows
+// have their own id spaces). events/revents use the POLL* bits from
+// proc/waitq.h; POLLERR/POLLHUP/POLLNVAL are always reported.
+#define POLL_KIND_FILE 0 // VFS fd (pipes block; files are always ready)
+#define POLL_KIND_SOCK 1 // socket fd from sock_listen/sock_accept
+#define POLL_KIND_WIN  2 // window id (POLLIN = key waiting)
+#define POLL_MAX_FDS   32
+
+typedef struct {
+    int32_t fd;
+    uint16_t kind;
+    uint16_t events;
+    uint16_t revents;
+    uint16_t pad;
+} pollfd_t;
+
+// One UDP datagram for SYS_SOCK_SENDMSGS / SYS_SOCK_RECVMSGS. On receive,
+// len is the buffer size going in and the bytes stored coming out.
+#define SOCK_MSG_BATCH_MAX 64
+#define SOCK_MSG_TRUNC 0x1 // datagram was longer than the buffer
+
+typedef struct {
+    uint32_t ip_be; // peer address, first octet in the high byte
+    uint16_t port;  // peer port
+    uint16_t len;
+    void *buf;
+    uint16_t flags; // SOCK_MSG_* (receive only)
+    uint16_t pad;
+} sock_msg_t;
+
+// SYS_NETBENCH operations (lwIP's lwiperf, an iperf 2 compatible TCP test)
+#define NETBENCH_SERVER 0 // start the iperf server on port 5001 (idempotent)
+#define NETBENCH_CLIENT 1 // 10s TCP send test to ip_be (0 = 127.0.0.1); blocks
+
+typedef struct {
+    uint32_t bytes; // payload bytes transferred
+    uint32_t ms;    // test duration
+    uint32_t kbps;  // average throughput, kbit/s
+    int32_t status; // 0 = completed, -1 = aborted
+} netbench_result_t;
+
+// SYS_RING_ENTER: a ring of queued syscalls in user memory. Userland fills
+// sqes[sq_tail & (entries - 1)] and advances sq_tail; the kernel runs
+// entries in order from sq_head and posts one completion per entry at
+// cq_tail, stopping early if the completion queue is full. Only file,
+// pipe and socket syscalls may be queued; others complete with -1.
+#define RING_MAX_ENTRIES 256
+#define RING_F_LINK 0x1 // next entry completes with -1 unless this one
+                        // succeeded (>= 0, and a full transfer for I/O)
+
+typedef struct {
+    uint32_t op;        // SYS_* number
+    uint32_t args[3];   // ebx, ecx, edx as for the trap
+    uint32_t user_data; // copied to the completion
+    uint32_t flags;     // RING_F_*
+} ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t res;
+} ring_cqe_t;
+
+typedef struct {
+    uint32_t sq_head; // advanced by the kernel
+    uint32_t sq_tail; // advanced by userland
+    uint32_t cq_head; // advanced by userland
+    uint32_t cq_tail; // advanced by the kernel
+    uint32_t entries; // power of two, <= RING_MAX_ENTRIES
+    ring_sqe_t *sqes;
+    ring_cqe_t *cqes;
+} ring_t;
 
 // Task info returned by SYS_TASKLIST
 typedef struct {
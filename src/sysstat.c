@@ -0,0 +1,258 @@
+#include "sysstat.h"
+#include "arch/arch.h"
+#include "proc/task.h"
+#include "syscall.h"
+#include "utils/strbuf.h"
+
+typedef struct {
+    uint32_t calls;
+    uint32_t max_cycles;
+    uint64_t cycles;
+    uint32_t hist[SYSSTAT_BUCKETS];
+} sysstat_entry_t;
+
+typedef struct {
+    uint32_t pid; // 0 = free slot
+    uint32_t seq;
+    uint32_t head;
+    uint32_t tail;
+    strace_event_t events[STRACE_RING_EVENTS];
+} strace_ring_t;
+
+static sysstat_entry_t stats[SYSSTAT_NR_MAX];
+static strace_ring_t traces[STRACE_MAX_TRACES];
+static int traces_active = 0;
+
+static const char *const names[SYSSTAT_NR_MAX] = {
+    [SYS_WRITE] = "write",
+    [SYS_EXIT] = "exit",
+    [SYS_YIELD] = "yield",
+    [SYS_EXEC] = "exec",
+    [SYS_GFX_INIT] = "gfx_init",
+    [SYS_GFX_EXIT] = "gfx_exit",
+    [SYS_GETKEY] = "getkey",
+    [SYS_SPAWN] = "spawn",
+    [SYS_WAIT] = "wait",
+    [SYS_READDIR] = "readdir",
+    [SYS_GETPID] = "getpid",
+    [SYS_TASKINFO] = "taskinfo",
+    [SYS_SHUTDOWN] = "shutdown",
+    [SYS_WIN_CREATE] = "win_create",
+    [SYS_WIN_DESTROY] = "win_destroy",
+    [SYS_WIN_WRITE] = "win_write",
+    [SYS_WIN_READ] = "win_read",
+    [SYS_WIN_GETKEY] = "win_getkey",
+    [SYS_WIN_SENDKEY] = "win_sendkey",
+    [SYS_WIN_LIST] = "win_list",
+    [SYS_GFX_INFO] = "gfx_info",
+    [SYS_TASKLIST] = "tasklist",
+    [SYS_WAIT_NB] = "wait_nb",
+    [SYS_PING] = "ping",
+    [SYS_NETCFG] = "netcfg",
+    [SYS_NETGET] = "netget",
+    [SYS_SLEEPMS] = "sleep_ms",
+    [SYS_SOCK_LISTEN] = "sock_listen",
+    [SYS_SOCK_ACCEPT] = "sock_accept",
+    [SYS_SOCK_SEND] = "sock_send",
+    [SYS_SOCK_RECV] = "sock_recv",
+    [SYS_SOCK_CLOSE] = "sock_close",
+    [SYS_WIN_READ_TEXT] = "win_read_text",
+    [SYS_WIN_SET_STDOUT] = "win_set_stdout",
+    [SYS_GETMOUSE] = "getmouse",
+    [SYS_OPEN] = "open",
+    [SYS_FREAD] = "fread",
+    [SYS_FWRITE] = "fwrite",
+    [SYS_CLOSE] = "close",
+    [SYS_SEEK] = "seek",
+    [SYS_STAT] = "stat",
+    [SYS_DETACH] = "detach",
+    [SYS_UNLINK] = "unlink",
+    [SYS_KILL] = "kill",
+    [SYS_GETTICKS] = "getticks",
+    [SYS_MKDIR] = "mkdir",
+    [SYS_CHDIR] = "chdir",
+    [SYS_GETCWD] = "getcwd",
+    [SYS_RMDIR] = "rmdir",
+    [SYS_NETSTATS] = "netstats",
+    [SYS_SBRK] = "sbrk",
+    [SYS_DEBUG_EXIT] = "debug_exit",
+    [SYS_RENAME] = "rename",
+    [SYS_FTRUNCATE] = "ftruncate",
+    [SYS_PIPE_CREATE] = "pipe_create",
+    [SYS_PIPE_DESTROY] = "pipe_destroy",
+    [SYS_OPENDIR] = "opendir",
+    [SYS_GETDENTS] = "getdents",
+    [SYS_POLL] = "poll",
+    [SYS_SOCK_SETOPT] = "sock_setopt",
+    [SYS_SOCK_CONNECT] = "sock_connect",
+    [SYS_UDP_BIND] = "udp_bind",
+    [SYS_SOCK_SENDMSGS] = "sock_sendmsgs",
+    [SYS_SOCK_RECVMSGS] = "sock_recvmsgs",
+    [SYS_SENDFILE] = "sendfile",
+    [SYS_NETBENCH] = "netbench",
+    [SYS_SYSENTER] = "sysenter",
+    [SYS_RING_ENTER] = "ring_enter",
+    [SYS_STRACE] = "strace",
+    [SYS_STRACE_READ] = "strace_read",
+};
+
+const char *sysstat_name(uint32_t nr) {
+    if (nr < SYSSTAT_NR_MAX && names[nr])
+        return names[nr];
+    return "?";
+}
+
+static strace_ring_t *find_trace(uint32_t pid) {
+    for (int i = 0; i < STRACE_MAX_TRACES; i++) {
+        if (traces[i].pid == pid)
+            return &traces[i];
+    }
+    return NULL;
+}
+
+static void trace_push(uint32_t pid, uint32_t nr, uint32_t ebx, uint32_t ecx,
+                       uint32_t edx, uint32_t ret, uint32_t cycles) {
+    strace_ring_t *t = find_trace(pid);
+    if (!t)
+        return;
+    uint32_t seq = t->seq++;
+    if (t->tail - t->head >= STRACE_RING_EVENTS)
+        return; // full: dropped, the seq gap tells the reader
+    strace_event_t *e = &t->events[t->tail % STRACE_RING_EVENTS];
+    e->seq = seq;
+    e->nr = nr;
+    e->args[0] = ebx;
+    e->args[1] = ecx;
+    e->args[2] = edx;
+    e->ret = (int32_t)ret;
+    e->cycles = cycles;
+    t->tail++;
+}
+
+void sysstat_record(uint32_t nr, uint32_t ebx, uint32_t ecx, uint32_t edx,
+                    uint32_t ret, uint64_t start) {
+    uint64_t delta = sysstat_now() - start;
+    uint32_t cycles = (delta >> 32) ? 0xFFFFFFFFu : (uint32_t)delta;
+    task_t *cur = task_current();
+
+    // Blocking syscalls run with interrupts on; keep the update atomic
+    uint32_t irq = cpu_irq_save();
+    if (nr < SYSSTAT_NR_MAX) {
+        sysstat_entry_t *s = &stats[nr];
+        s->calls++;
+        s->cycles += delta;
+        if (cycles > s->max_cycles)
+            s->max_cycles = cycles;
+        s->hist[cycles ? 31 - __builtin_clz(cycles) : 0]++;
+    }
+    if (cur) {
+        cur->sc_calls++;
+        cur->sc_cycles += delta;
+        if (traces_active)
+            trace_push(cur->id, nr, ebx, ecx, edx, ret, cycles);
+    }
+    cpu_irq_restore(irq);
+}
+
+void sysstat_reset(void) {
+    uint32_t irq = cpu_irq_save();
+    memset(stats, 0, sizeof(stats));
+    for (int i = 0; i < MAX_TASKS; i++) {
+        task_t *t = task_get_by_index(i);
+        t->sc_calls = 0;
+        t->sc_cycles = 0;
+    }
+    cpu_irq_restore(irq);
+}
+
+uint32_t sysstat_format(char *dst, uint32_t cap) {
+    uint32_t len = 0;
+    strbuf_append_cstr(dst, cap, &len,
+                       "# nr name calls=N avg=cycles max=cycles "
+                       "kcyc=total/1000, then log2(cycles):count\n");
+    for (uint32_t nr = 0; nr < SYSSTAT_NR_MAX; nr++) {
+        sysstat_entry_t *s = &stats[nr];
+        if (!s->calls)
+            continue;
+        strbuf_append_dec_u32(dst, cap, &len, nr);
+        strbuf_append_char(dst, cap, &len, ' ');
+        strbuf_append_cstr(dst, cap, &len, sysstat_name(nr));
+        strbuf_append_cstr(dst, cap, &len, " calls=");
+        strbuf_append_dec_u32(dst, cap, &len, s->calls);
+        strbuf_append_cstr(dst, cap, &len, " avg=");
+        strbuf_append_dec_u32(dst, cap, &len, div64_32(s->cycles, s->calls));
+        strbuf_append_cstr(dst, cap, &len, " max=");
+        strbuf_append_dec_u32(dst, cap, &len, s->max_cycles);
+        strbuf_append_cstr(dst, cap, &len, " kcyc=");
+        strbuf_append_dec_u32(dst, cap, &len, div64_32(s->cycles, 1000));
+        strbuf_append_cstr(dst, cap, &len, "\n   ");
+        for (int b = 0; b < SYSSTAT_BUCKETS; b++) {
+            if (!s->hist[b])
+                continue;
+            strbuf_append_char(dst, cap, &len, ' ');
+            strbuf_append_dec_u32(dst, cap, &len, (uint32_t)b);
+            strbuf_append_char(dst, cap, &len, ':');
+            strbuf_append_dec_u32(dst, cap, &len, s->hist[b]);
+        }
+        strbuf_append_char(dst, cap, &len, '\n');
+    }
+
+    strbuf_append_cstr(dst, cap, &len, "# per task: pid name calls kcyc\n");
+    for (int i = 0; i < MAX_TASKS; i++) {
+        task_t *t = task_get_by_index(i);
+        if ((t->id == 0 && i != 0) || t->state == TASK_TERMINATED ||
+            !t->sc_calls)
+            continue;
+        strbuf_append_cstr(dst, cap, &len, "task ");
+        strbuf_append_dec_u32(dst, cap, &len, t->id);
+        strbuf_append_char(dst, cap, &len, ' ');
+        strbuf_append_cstr(dst, cap, &len, t->name);
+        strbuf_append_cstr(dst, cap, &len, " calls=");
+        strbuf_append_dec_u32(dst, cap, &len, t->sc_calls);
+        strbuf_append_cstr(dst, cap, &len, " kcyc=");
+        strbuf_append_dec_u32(dst, cap, &len, div64_32(t->sc_cycles, 1000));
+        strbuf_append_char(dst, cap, &len, '\n');
+    }
+    return len;
+}
+
+int sysstat_trace_ctl(uint32_t pid, int enable) {
+    if (!pid)
+        return -1; // pid 0 marks a free slot
+    uint32_t irq = cpu_irq_save();
+    strace_ring_t *t = find_trace(pid);
+    int ret = 0;
+    if (enable && !t) {
+        t = find_trace(0);
+        if (t) {
+            t->pid = pid;
+            t->seq = t->head = t->tail = 0;
+            traces_active++;
+        } else {
+            ret = -1;
+        }
+    } else if (!enable && t) {
+        t->pid = 0;
+        traces_active--;
+    }
+    cpu_irq_restore(irq);
+    return ret;
+}
+
+int sysstat_trace_read(uint32_t pid, strace_event_t *out, int max) {
+    if (!pid)
+        return -1;
+    uint32_t irq = cpu_irq_save();
+    strace_ring_t *t = find_trace(pid);
+    int n = 0;
+    if (!t) {
+        cpu_irq_restore(irq);
+        return -1;
+    }
+    while (n < max && t->head != t->tail) {
+        out[n++] = t->events[t->head % STRACE_RING_EVENTS];
+        t->head++;
+    }
+    cpu_irq_restore(irq);
+    return n;
+}
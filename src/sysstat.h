@@ -0,0 +1,46 @@
+#ifndef _SYSSTAT_H
+#define _SYSSTAT_H
+
+#include "lib.h"
+
+// Per-syscall accounting: call counts, total/max TSC cycles and log2
+// latency histograms for every syscall number, plus per-task totals (in
+// task_t). Read as /mos/ksyscall; any write to that file resets it.
+// There is one CPU, so the global table is the per-CPU table.
+#define SYSSTAT_NR_MAX 80     // syscall numbers 0..SYSSTAT_NR_MAX-1
+#define SYSSTAT_BUCKETS 32    // bucket b counts latencies in [2^b, 2^(b+1))
+
+// strace: per-pid rings of completed syscalls, drained with
+// SYS_STRACE_READ. seq counts every syscall of the traced task, so a gap
+// means the ring overflowed and events were dropped.
+#define STRACE_MAX_TRACES 4
+#define STRACE_RING_EVENTS 256
+
+typedef struct {
+    uint32_t seq;
+    uint32_t nr;
+    uint32_t args[3];
+    int32_t ret;
+    uint32_t cycles; // saturates at 0xFFFFFFFF
+} strace_event_t;
+
+static inline uint64_t sysstat_now(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Account one completed syscall that started at TSC start
+void sysstat_record(uint32_t nr, uint32_t ebx, uint32_t ecx, uint32_t edx,
+                    uint32_t ret, uint64_t start);
+void sysstat_reset(void);
+// Text report for /mos/ksyscall
+uint32_t sysstat_format(char *dst, uint32_t cap);
+const char *sysstat_name(uint32_t nr);
+
+// Start (enable=1) or stop tracing pid. Returns 0, or -1 if no slot.
+int sysstat_trace_ctl(uint32_t pid, int enable);
+// Move up to max queued events for pid into out. Returns the count.
+int sysstat_trace_read(uint32_t pid, strace_event_t *out, int max);
+
+#endif
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Concurrent-connection benchmark for the mateOS httpd.
+
+Start the VM with the HTTP port forwarded (make run NET=1 HTTP=1), then:
+
+    python3 tools/http_concurrency_bench.py --clients 32 --rounds 5
+
+Each round opens --clients connections at once, sends a GET on each and
+reads the full response. Reports completed requests, connection resets,
+timeouts and latency percentiles, so runs before and after a kernel
+change can be compared directly.
+"""
+
+import argparse
+import socket
+import threading
+import time
+
+
+def one_request(host, port, path, timeout, results, idx):
+    start = time.monotonic()
+    try:
+        with socket.create_connection((host, port), timeout=timeout) as s:
+            s.settimeout(timeout)
+            req = "GET %s HTTP/1.0\r\nHost: %s\r\n\r\n" % (path, host)
+            s.sendall(req.encode())
+            got = 0
+            status = b""
+            while True:
+                chunk = s.recv(4096)
+                if not chunk:
+                    break
+                if not status:
+                    status = chunk.split(b"\r\n", 1)[0]
+                got += len(chunk)
+        ok = status.startswith(b"HTTP/") and got > 0
+        results[idx] = ("ok" if ok else "bad", time.monotonic() - start)
+    except ConnectionResetError:
+        results[idx] = ("reset", time.monotonic() - start)
+    except ConnectionRefusedError:
+        results[idx] = ("refused", time.monotonic() - start)
+    except socket.timeout:
+        results[idx] = ("timeout", time.monotonic() - start)
+    except OSError:
+        results[idx] = ("error", time.monotonic() - start)
+
+
+def run_round(args):
+    results = [None] * args.clients
+    threads = [
+        threading.Thread(
+            target=one_request,
+            args=(args.host, args.port, args.path, args.timeout, results, i),
+        )
+        for i in range(args.clients)
+    ]
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return results, time.monotonic() - start
+
+
+def percentile(sorted_vals, pct):
+    if not sorted_vals:
+        return 0.0
+    k = min(len(sorted_vals) - 1, int(round(pct / 100.0 * (len(sorted_vals) - 1))))
+    return sorted_vals[k]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--path", default="/")
+    ap.add_argument("--clients", type=int, default=16,
+                    help="concurrent connections per round")
+    ap.add_argument("--rounds", type=int, default=3)
+    ap.add_argument("--timeout", type=float, default=10.0,
+                    help="per-connection timeout in seconds")
+    args = ap.parse_args()
+
+    counts = {}
+    lat_ok = []
+    wall = 0.0
+    for r in range(args.rounds):
+        results, elapsed = run_round(args)
+        wall += elapsed
+        round_counts = {}
+        for outcome, lat in results:
+            round_counts[outcome] = round_counts.get(outcome, 0) + 1
+            counts[outcome] = counts.get(outcome, 0) + 1
+            if outcome == "ok":
+                lat_ok.append(lat)
+        print("round %d: %s in %.2fs" % (
+            r + 1,
+            " ".join("%s=%d" % kv for kv in sorted(round_counts.items())),
+            elapsed,
+        ))
+
+    total = args.clients * args.rounds
+    lat_ok.sort()
+    print("---")
+    print("requests   %d (%d concurrent x %d rounds)" % (total, args.clients, args.rounds))
+    for outcome in ("ok", "reset", "refused", "timeout", "bad", "error"):
+        if counts.get(outcome):
+            print("%-10s %d (%.1f%%)" % (outcome, counts[outcome],
+                                         100.0 * counts[outcome] / total))
+    if lat_ok:
+        print("latency    p50 %.1fms  p90 %.1fms  max %.1fms" % (
+            percentile(lat_ok, 50) * 1000,
+            percentile(lat_ok, 90) * 1000,
+            lat_ok[-1] * 1000,
+        ))
+    if wall > 0:
+        print("throughput %.1f req/s" % (counts.get("ok", 0) / wall))
+    return 0 if counts.get("ok", 0) == total else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Convert a mateOS kernel trace dump (/mos/ktrace) to Chrome trace JSON,
+which loads in https://ui.perfetto.dev or chrome://tracing.
+
+In the guest, write 1 to /mos/ktrace to start tracing and 0 to stop it,
+then fetch the dump. Either copy it onto the data disk (cp /mos/ktrace
+/data/ktrace.bin) or, with the HTTP server running, download it:
+
+    curl -o ktrace.bin http://localhost:8080/ktrace
+    python3 tools/ktrace2json.py ktrace.bin -o ktrace.json
+
+Timeline layout:
+  cpu0 process: "running" track (one slice per scheduled task), IRQ
+                track (handler slices), disk track (request slices)
+                and NIC instant events
+  tasks process: one thread per pid with its syscall slices, page faults,
+                 spawn and exit markers
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x4352544B  # "KTRC"
+HEADER = struct.Struct("<IHHIIII")
+RECORD = struct.Struct("<QBBH3I")
+
+(KT_SCHED_SWITCH, KT_TASK_SPAWN, KT_TASK_EXIT, KT_IRQ_ENTER, KT_IRQ_EXIT,
+ KT_SYSCALL_ENTER, KT_SYSCALL_EXIT, KT_PAGE_FAULT, KT_DISK_START,
+ KT_DISK_DONE, KT_NIC_RX, KT_NIC_TX_DONE) = range(1, 13)
+
+TASK_STATES = {0: "preempted", 1: "running", 2: "blocked", 3: "exited"}
+IRQ_NAMES = {0: "timer", 1: "keyboard", 12: "mouse", 14: "ata0", 15: "ata1"}
+
+CPU_PID = 0
+TASKS_PID = 1
+TID_RUNNING = 0
+TID_IRQ = 1
+TID_DISK = 2
+TID_NIC = 3
+
+
+def load_syscall_names(path):
+    """SYS_* numbers from the kernel's syscall.h, if it can be found."""
+    names = {}
+    try:
+        with open(path) as f:
+            for line in f:
+                m = re.match(r"#define SYS_(\w+)\s+(\d+)", line)
+                if m:
+                    names[int(m.group(2))] = m.group(1).lower()
+    except OSError:
+        pass
+    return names
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        sys.exit("ktrace2json: dump too short")
+    magic, version, rec_size, tsc_per_ms, count, lost, running = \
+        HEADER.unpack_from(data)
+    if magic != MAGIC or rec_size != RECORD.size:
+        sys.exit("ktrace2json: not a ktrace dump (magic %#x, record %d)" %
+                 (magic, rec_size))
+    if running:
+        print("ktrace2json: warning: dumped while tracing was running, "
+              "records may be torn", file=sys.stderr)
+    avail = (len(data) - HEADER.size) // RECORD.size
+    if avail < count:
+        print("ktrace2json: warning: dump truncated (%d of %d records)" %
+              (avail, count), file=sys.stderr)
+        count = avail
+    recs = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+            for i in range(count)]
+    return tsc_per_ms, lost, recs
+
+
+def convert(tsc_per_ms, recs, sc_names):
+    out = []
+    if not recs:
+        return out
+    t0 = recs[0][0]
+    # Without a calibration, show cycles as nanoseconds (1 GHz)
+    per_us = tsc_per_ms / 1000.0 if tsc_per_ms else 1000.0
+
+    def ts(tsc):
+        return (tsc - t0) / per_us
+
+    def meta(pid, tid, name):
+        out.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": tid,
+                    "args": {"name": name}})
+
+    out.append({"ph": "M", "name": "process_name", "pid": CPU_PID,
+                "args": {"name": "cpu0"}})
+    out.append({"ph": "M", "name": "process_name", "pid": TASKS_PID,
+                "args": {"name": "tasks"}})
+    meta(CPU_PID, TID_RUNNING, "running")
+    meta(CPU_PID, TID_IRQ, "irq")
+    meta(CPU_PID, TID_DISK, "disk")
+    meta(CPU_PID, TID_NIC, "nic")
+
+    seen = set()
+    running = None  # pid whose "running" slice is open
+    open_sc = {}    # pid -> open syscall nr
+    irq_depth = 0
+    disk_open = False
+
+    for tsc, cpu, ev, pid, a0, a1, a2 in recs:
+        t = ts(tsc)
+        if pid not in seen:
+            seen.add(pid)
+            meta(TASKS_PID, pid, "pid %d" % pid)
+        if running is None:
+            running = pid
+            out.append({"ph": "B", "name": "pid %d" % pid, "pid": CPU_PID,
+                        "tid": TID_RUNNING, "ts": t})
+
+        if ev == KT_SCHED_SWITCH:
+            if running is not None:
+                out.append({"ph": "E", "pid": CPU_PID, "tid": TID_RUNNING,
+                            "ts": t,
+                            "args": {"state": TASK_STATES.get(a2, a2)}})
+            running = a1
+            out.append({"ph": "B", "name": "pid %d" % a1, "pid": CPU_PID,
+                        "tid": TID_RUNNING, "ts": t})
+        elif ev in (KT_TASK_SPAWN, KT_TASK_EXIT):
+            name = ("spawn pid %d (ring %d)" % (a0, a2)
+                    if ev == KT_TASK_SPAWN else
+                    "exit pid %d code %d" % (a0, struct.unpack("<i",
+                                             struct.pack("<I", a1))[0]))
+            out.append({"ph": "i", "s": "t", "name": name, "pid": TASKS_PID,
+                        "tid": pid, "ts": t})
+        elif ev == KT_IRQ_ENTER:
+            irq_depth += 1
+            out.append({"ph": "B", "name": "irq %d %s" %
+                        (a0, IRQ_NAMES.get(a0, "")), "pid": CPU_PID,
+                        "tid": TID_IRQ, "ts": t})
+        elif ev == KT_IRQ_EXIT:
+            if irq_depth:
+                irq_depth -= 1
+                out.append({"ph": "E", "pid": CPU_PID, "tid": TID_IRQ,
+                            "ts": t})
+        elif ev == KT_SYSCALL_ENTER:
+            open_sc[pid] = a0
+            out.append({"ph": "B", "name": sc_names.get(a0, "syscall %d" % a0),
+                        "pid": TASKS_PID, "tid": pid, "ts": t,
+                        "args": {"ebx": hex(a1), "ecx": hex(a2)}})
+        elif ev == KT_SYSCALL_EXIT:
+            if open_sc.pop(pid, None) is not None:
+                ret = struct.unpack("<i", struct.pack("<I", a1))[0]
+                out.append({"ph": "E", "pid": TASKS_PID, "tid": pid, "ts": t,
+                            "args": {"ret": ret}})
+        elif ev == KT_PAGE_FAULT:
+            out.append({"ph": "i", "s": "t", "name": "page fault",
+                        "pid": TASKS_PID, "tid": pid, "ts": t,
+                        "args": {"addr": hex(a0), "eip": hex(a1),
+                                 "err": hex(a2)}})
+        elif ev == KT_DISK_START:
+            disk_open = True
+            out.append({"ph": "B", "name": "%s drive %d" %
+                        ("write" if a2 & 2 else "read", a2 & 1),
+                        "pid": CPU_PID, "tid": TID_DISK, "ts": t,
+                        "args": {"lba": a0, "sectors": a1}})
+        elif ev == KT_DISK_DONE:
+            if disk_open:
+                disk_open = False
+                out.append({"ph": "E", "pid": CPU_PID, "tid": TID_DISK,
+                            "ts": t, "args": {"ok": a1 == 0}})
+        elif ev == KT_NIC_RX:
+            out.append({"ph": "i", "s": "t", "name": "rx %d" % a0,
+                        "pid": CPU_PID, "tid": TID_NIC, "ts": t,
+                        "args": {"frames": a0, "budget": a1}})
+        elif ev == KT_NIC_TX_DONE:
+            out.append({"ph": "i", "s": "t", "name": "tx done %d" % a0,
+                        "pid": CPU_PID, "tid": TID_NIC, "ts": t})
+    return out
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("dump", help="binary dump of /mos/ktrace")
+    ap.add_argument("-o", "--output", default="-",
+                    help="JSON output file (default: stdout)")
+    ap.add_argument("--syscalls",
+                    default=os.path.join(here, "..", "src", "syscall.h"),
+                    help="syscall.h used to name syscall slices")
+    args = ap.parse_args()
+
+    with open(args.dump, "rb") as f:
+        data = f.read()
+    tsc_per_ms, lost, recs = parse(data)
+    events = convert(tsc_per_ms, recs, load_syscall_names(args.syscalls))
+    doc = {"traceEvents": events, "displayTimeUnit": "ns"}
+
+    if args.output == "-":
+        json.dump(doc, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(doc, f)
+    print("ktrace2json: %d records, %d overwritten, %s" %
+          (len(recs), lost, "%d TSC cycles/ms" % tsc_per_ms if tsc_per_ms
+           else "TSC uncalibrated"), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+"""
+Build a FAT32 superfloppy image for the mateOS data disk (/data).
+Supports subdirectories via --add-dir and root files via --add.
+Writes an FSInfo sector and a backup boot sector like mkfs.fat does.
+"""
+
+import argparse
+import os
+import struct
+
+from mkfat16_test_disk import (
+    build_lfn_dirents,
+    expand_paths,
+    mk_83_alias,
+    mk_83_name,
+    needs_lfn,
+    write_le16,
+    write_le32,
+)
+
+EOC = 0x0FFFFFFF
+FAT32_MIN_CLUSTERS = 65525  # fewer clusters than this and it is FAT16
+
+
+def read_le32(buf, off):
+    return struct.unpack("<I", buf[off : off + 4])[0]
+
+
+class Fat32Builder:
+    """Builds a FAT32 superfloppy image; the root directory is a cluster chain."""
+
+    def __init__(self, total_sectors=131072, sectors_per_cluster=1):
+        self.bytes_per_sector = 512
+        self.sectors_per_cluster = sectors_per_cluster
+        self.reserved_sectors = 32
+        self.fat_count = 2
+        self.fsinfo_sector = 1
+        self.backup_boot_sector = 6
+        self.total_sectors = total_sectors
+
+        # FAT size depends on the cluster count and vice versa; iterate.
+        fat_sz = 1
+        while True:
+            data = total_sectors - self.reserved_sectors - self.fat_count * fat_sz
+            clusters = data // sectors_per_cluster
+            need = ((clusters + 2) * 4 + 511) // 512
+            if need <= fat_sz:
+                break
+            fat_sz = need
+        self.sectors_per_fat = fat_sz
+        self.cluster_count = clusters
+        if clusters < FAT32_MIN_CLUSTERS:
+            raise SystemExit(
+                f"image too small for FAT32: {clusters} clusters (need {FAT32_MIN_CLUSTERS})"
+            )
+
+        self.fat_start = self.reserved_sectors
+        self.data_start = self.fat_start + self.fat_count * self.sectors_per_fat
+        self.cluster_bytes = self.bytes_per_sector * self.sectors_per_cluster
+
+        self.img = bytearray(total_sectors * self.bytes_per_sector)
+        self.next_cluster = 2
+
+        self._init_fat()
+        self.root_cluster = self._alloc_clusters(1)
+
+    def _write_boot_sector(self, lba):
+        off = lba * 512
+        bs = memoryview(self.img)[off : off + 512]
+        bs[0:3] = b"\xEB\x58\x90"
+        bs[3:11] = b"MATEFAT "
+        write_le16(bs, 11, self.bytes_per_sector)
+        bs[13] = self.sectors_per_cluster
+        write_le16(bs, 14, self.reserved_sectors)
+        bs[16] = self.fat_count
+        write_le16(bs, 17, 0)  # no fixed root directory
+        write_le16(bs, 19, 0)
+        bs[21] = 0xF8
+        write_le16(bs, 22, 0)  # 16-bit FAT size unused
+        write_le16(bs, 24, 63)
+        write_le16(bs, 26, 16)
+        write_le32(bs, 28, 0)
+        write_le32(bs, 32, self.total_sectors)
+        write_le32(bs, 36, self.sectors_per_fat)
+        write_le16(bs, 40, 0)  # mirror all FATs
+        write_le16(bs, 42, 0)
+        write_le32(bs, 44, self.root_cluster)
+        write_le16(bs, 48, self.fsinfo_sector)
+        write_le16(bs, 50, self.backup_boot_sector)
+        bs[64] = 0x80
+        bs[66] = 0x29
+        write_le32(bs, 67, 0x32335A4D)
+        bs[71:82] = b"MATEOS DATA"
+        bs[82:90] = b"FAT32   "
+        bs[510] = 0x55
+        bs[511] = 0xAA
+
+    def _write_fsinfo(self, lba):
+        off = lba * 512
+        fi = memoryview(self.img)[off : off + 512]
+        write_le32(fi, 0, 0x41615252)
+        write_le32(fi, 484, 0x61417272)
+        write_le32(fi, 488, self.cluster_count - (self.next_cluster - 2))
+        write_le32(fi, 492, self.next_cluster)
+        write_le32(fi, 508, 0xAA550000)
+
+    def _init_fat(self):
+        for fat_i in range(self.fat_count):
+            off = (self.fat_start + fat_i * self.sectors_per_fat) * 512
+            write_le32(self.img, off + 0, 0x0FFFFFF8)
+            write_le32(self.img, off + 4, EOC)
+
+    def _fat_set(self, cluster, value):
+        for fat_i in range(self.fat_count):
+            off = (self.fat_start + fat_i * self.sectors_per_fat) * 512
+            write_le32(self.img, off + cluster * 4, value)
+
+    def _fat_get(self, cluster):
+        off = self.fat_start * 512
+        return read_le32(self.img, off + cluster * 4) & 0x0FFFFFFF
+
+    def _cluster_offset(self, cluster):
+        """Byte offset in image for given data cluster."""
+        return (self.data_start + (cluster - 2) * self.sectors_per_cluster) * 512
+
+    def _alloc_clusters(self, count):
+        """Allocate a contiguous chain of clusters, return first cluster."""
+        first = self.next_cluster
+        if first + count > self.cluster_count + 2:
+            raise SystemExit("FAT32 image full")
+        for c in range(first, first + count):
+            self._fat_set(c, EOC if c == first + count - 1 else c + 1)
+        self.next_cluster += count
+        off = self._cluster_offset(first)
+        self.img[off : off + count * self.cluster_bytes] = bytes(count * self.cluster_bytes)
+        return first
+
+    def _dir_entries(self, dir_cluster, name, attr, first_cluster, file_size):
+        """Add LFN entries + short entry to a directory, growing its chain when full."""
+        if needs_lfn(name):
+            n = 1
+            while self._short_exists(dir_cluster, mk_83_alias(name, n)):
+                n += 1
+            name83 = mk_83_alias(name, n)
+            lfn_entries = build_lfn_dirents(name, name83)
+        else:
+            name83 = mk_83_name(name)
+            lfn_entries = []
+        slots = 1 + len(lfn_entries)
+
+        # LFN entries and the short entry are kept inside one sector.
+        per_sector = 512 // 32
+        c = dir_cluster
+        while True:
+            base = self._cluster_offset(c)
+            for s in range(self.sectors_per_cluster):
+                run = 0
+                for idx in range(per_sector):
+                    e_off = base + s * 512 + idx * 32
+                    if self.img[e_off] in (0x00, 0xE5):
+                        run += 1
+                        if run == slots:
+                            start = e_off - (slots - 1) * 32
+                            self._put_entries(start, lfn_entries, name83, attr,
+                                              first_cluster, file_size)
+                            return
+                    else:
+                        run = 0
+            nxt = self._fat_get(c)
+            if nxt >= 0x0FFFFFF8:
+                new = self._alloc_clusters(1)
+                self._fat_set(c, new)
+                c = new
+            else:
+                c = nxt
+
+    def _short_exists(self, dir_cluster, name83):
+        c = dir_cluster
+        while c < 0x0FFFFFF8:
+            base = self._cluster_offset(c)
+            for i in range(self.cluster_bytes // 32):
+                e = base + i * 32
+                if self.img[e] == 0:
+                    return False
+                if self.img[e : e + 11] == name83:
+                    return True
+            c = self._fat_get(c)
+        return False
+
+    def _put_entries(self, off, lfn_entries, name83, attr, first_cluster, file_size):
+        for lfn_e in lfn_entries:
+            self.img[off : off + 32] = lfn_e
+            off += 32
+        entry = bytearray(32)
+        entry[0:11] = name83
+        entry[11] = attr
+        write_le16(entry, 20, first_cluster >> 16)
+        write_le16(entry, 26, first_cluster & 0xFFFF)
+        write_le32(entry, 28, file_size)
+        self.img[off : off + 32] = entry
+
+    def add_file(self, dir_cluster, name, data):
+        """Add a file to a directory (root_cluster for the root)."""
+        size = len(data)
+        first = 0
+        if size:
+            first = self._alloc_clusters((size + self.cluster_bytes - 1) // self.cluster_bytes)
+            off = self._cluster_offset(first)
+            self.img[off : off + size] = data
+        self._dir_entries(dir_cluster, name, 0x20, first, size)
+        return first
+
+    def create_subdir(self, parent_cluster, name):
+        """Create a subdirectory. Returns its first cluster."""
+        dir_cluster = self._alloc_clusters(1)
+        self._dir_entries(parent_cluster, name, 0x10, dir_cluster, 0)
+        off = self._cluster_offset(dir_cluster)
+        parent = 0 if parent_cluster == self.root_cluster else parent_cluster
+        self._put_entries(off, [], b".          ", 0x10, dir_cluster, 0)
+        self._put_entries(off + 32, [], b"..         ", 0x10, parent, 0)
+        return dir_cluster
+
+    def write(self, path):
+        self._write_boot_sector(0)
+        self._write_fsinfo(self.fsinfo_sector)
+        self._write_boot_sector(self.backup_boot_sector)
+        self._write_fsinfo(self.backup_boot_sector + 1)
+        with open(path, "wb") as f:
+            f.write(self.img)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("out", nargs="?", default="data.img")
+    ap.add_argument(
+        "--add",
+        action="append",
+        default=[],
+        help="Host file to include in the FAT32 root (can repeat)",
+    )
+    ap.add_argument(
+        "--add-dir",
+        action="append",
+        nargs="+",
+        metavar=("DIRNAME", "FILE"),
+        help="Create subdirectory and add files to it: --add-dir logs file1 file2 ...",
+    )
+    ap.add_argument("--size-mb", type=int, default=64, help="Image size in MiB (min 33)")
+    ap.add_argument(
+        "--cluster-sectors",
+        type=int,
+        default=1,
+        help="Sectors per cluster (power of two)",
+    )
+    args = ap.parse_args()
+
+    builder = Fat32Builder(args.size_mb * 2048, args.cluster_sectors)
+    builder.add_file(builder.root_cluster, "README.TXT",
+                     b"mateOS FAT32 data disk\n")
+    for p in args.add:
+        with open(p, "rb") as f:
+            builder.add_file(builder.root_cluster, os.path.basename(p), f.read())
+    for entry in args.add_dir or []:
+        dir_cluster = builder.create_subdir(builder.root_cluster, entry[0])
+        for p in expand_paths(entry[1:]):
+            if os.path.isfile(p):
+                with open(p, "rb") as f:
+                    builder.add_file(dir_cluster, os.path.basename(p), f.read())
+    builder.write(args.out)
+
+    print(f"Wrote {args.out} ({args.size_mb} MiB, {builder.cluster_count} clusters "
+          f"of {builder.cluster_bytes} bytes)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libc.h"
+#include "syscalls.h"
+
+// allocbench - replay the malloc/free/realloc pattern of a tcc compile and
+// report the allocator's speed and heap footprint.
+//
+// The trace is synthetic but follows tcc's habits: a token/symbol table of
+// small allocations that live until the end, token strings and CStrings
+// that grow by realloc doubling and die with their statement, local Syms
+// freed when their function ends, and a few section buffers (text, data,
+// symtab, relocs) realloc'd up to a few hundred KB. Everything is freed at the end,
+// as tcc_delete() does, so the final heap size shows how much the
+// allocator handed back to the kernel.
+//
+// Started as the boot program (autorun=allocbench, so no argv) it runs as
+// the `make alloc-bench` benchmark and powers off afterwards.
+
+#define FUNCS 2000
+#define MAX_TOKSYMS 6000
+#define MAX_LIVE 512
+#define NSECTIONS 5
+#define SECTION_MAX (256u * 1024)
+
+static void *toksyms[MAX_TOKSYMS];
+static unsigned int ntoksyms;
+static void *live[MAX_LIVE];
+static unsigned char *sections[NSECTIONS];
+static unsigned int section_len[NSECTIONS];
+static unsigned int section_cap[NSECTIONS];
+
+static unsigned int rng = 0x2545F491u;
+static unsigned int ops;
+static unsigned int heap_base, heap_peak;
+
+static unsigned int rand32(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static unsigned long long rdtsc64(void) {
+    unsigned int lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+// 64/32 divide with divl (no libgcc here); saturates
+static unsigned int div64_32(unsigned long long n, unsigned int d) {
+    unsigned int hi = (unsigned int)(n >> 32), lo = (unsigned int)n;
+    if (!d || hi >= d)
+        return 0xFFFFFFFFu;
+    unsigned int q;
+    __asm__("divl %2" : "=a"(q), "+d"(hi) : "rm"(d), "a"(lo));
+    return q;
+}
+
+static void *xmalloc(unsigned int n) {
+    void *p = malloc(n);
+    if (!p) {
+        print("allocbench: out of memory\n");
+        exit(1);
+    }
+    ops++;
+    *(unsigned char *)p = 1; // touch it, as the caller would
+    return p;
+}
+
+static void *xrealloc(void *p, unsigned int n) {
+    p = realloc(p, n);
+    if (!p) {
+        print("allocbench: out of memory\n");
+        exit(1);
+    }
+    ops++;
+    return p;
+}
+
+static void xfree(void *p) {
+    free(p);
+    ops++;
+}
+
+// A token string or CString: starts small and doubles as tokens arrive
+static void *grow_buffer(unsigned int final) {
+    unsigned int cap = 16;
+    void *p = xmalloc(cap);
+    while (cap < final) {
+        cap *= 2;
+        p = xrealloc(p, cap);
+    }
+    return p;
+}
+
+// Append to a section, doubling its buffer like tcc's section_realloc()
+static void section_add(int s, unsigned int n) {
+    if (section_len[s] + n > SECTION_MAX)
+        return;
+    unsigned int need = section_len[s] + n;
+    if (need > section_cap[s]) {
+        unsigned int cap = section_cap[s] ? section_cap[s] : 256;
+        while (cap < need)
+            cap *= 2;
+        sections[s] = xrealloc(sections[s], cap);
+        section_cap[s] = cap;
+    }
+    sections[s][section_len[s]] = 1;
+    section_len[s] = need;
+}
+
+static void compile_function(void) {
+    // New identifiers: TokenSym is a header plus the name
+    unsigned int idents = 1 + rand32() % 4;
+    for (unsigned int i = 0; i < idents && ntoksyms < MAX_TOKSYMS; i++)
+        toksyms[ntoksyms++] = xmalloc(24 + 4 + rand32() % 28);
+
+    // Body: token strings for macros and inline args, CStrings for
+    // literals, and local Syms that stay live until the function ends
+    unsigned int nlive = 0;
+    unsigned int stmts = 8 + rand32() % 24;
+    for (unsigned int i = 0; i < stmts; i++) {
+        void *tok = grow_buffer(32 + rand32() % 2016);
+        void *cstr = grow_buffer(8 + rand32() % 120);
+        unsigned int syms = 1 + rand32() % 16;
+        for (unsigned int j = 0; j < syms && nlive < MAX_LIVE; j++)
+            live[nlive++] = xmalloc(16 + (rand32() % 6) * 8);
+        xfree(cstr);
+        xfree(tok);
+    }
+    // Leaving the function scope pops its Syms, newest first
+    while (nlive)
+        xfree(live[--nlive]);
+
+    // Code and data for the function, its symbol, string and relocations
+    section_add(0, 64 + rand32() % 256);
+    section_add(1, rand32() % 32);
+    section_add(2, 16);
+    section_add(3, 8 + rand32() % 24);
+    section_add(4, 8 * (1 + rand32() % 4));
+}
+
+static unsigned int heap_now(void) {
+    unsigned int brk = (unsigned int)sbrk(0);
+    if (brk > heap_peak)
+        heap_peak = brk;
+    return brk;
+}
+
+static int run(void) {
+    unsigned int start = get_ticks();
+    // Give the kernel's TSC calibration (64 ticks after boot) time to finish
+    while (!vdso()->tsc_per_ms && get_ticks() - start < 200)
+        sleep_ms(10);
+    unsigned int tsc_per_ms = vdso()->tsc_per_ms;
+
+    heap_base = heap_now();
+    unsigned long long t0 = rdtsc64();
+    for (unsigned int f = 0; f < FUNCS; f++) {
+        compile_function();
+        if ((f & 63) == 0)
+            heap_now();
+    }
+    heap_now();
+    // tcc_delete(): the symbol table, then the sections
+    while (ntoksyms)
+        xfree(toksyms[--ntoksyms]);
+    for (int s = 0; s < NSECTIONS; s++)
+        xfree(sections[s]);
+    unsigned long long cycles = rdtsc64() - t0;
+    unsigned int heap_end = heap_now();
+
+    printf("allocbench: %u functions, %u malloc/realloc/free calls\n", FUNCS,
+           ops);
+    if (tsc_per_ms) {
+        unsigned int us = div64_32(cycles * 1000, tsc_per_ms);
+        printf("allocbench: %u us, %u ns per call\n", us,
+               div64_32((unsigned long long)us * 1000, ops ? ops : 1));
+    } else {
+        print("allocbench: TSC not calibrated, no timing\n");
+    }
+    printf("allocbench: peak heap %u KB, after free-all %u KB\n",
+           (heap_peak - heap_base) >> 10, (heap_end - heap_base) >> 10);
+    print("allocbench: done\n");
+    return 0;
+}
+
+void _start(int argc, char **argv) {
+    (void)argv;
+    int rc = run();
+    if (argc == 0) {
+        debug_exit(rc);
+        shutdown();
+    }
+    exit(rc);
+}
@@ -1,6 +1,65 @@
 #include "libc.h"
 #include "syscalls.h"
 
+// Copies through the syscall ring: each batch queues CP_DEPTH read/write
+// pairs as one linked chain and runs them with a single ring_submit(). A
+// short read breaks the chain, so everything after it is skipped and the
+// partial chunk is written here before the next batch.
+
+#define CP_CHUNK 4096
+#define CP_DEPTH 8
+#define CP_RING_ENTRIES (CP_DEPTH * 2)
+
+static char bufs[CP_DEPTH][CP_CHUNK];
+static ring_sqe_t sqes[CP_RING_ENTRIES];
+static ring_cqe_t cqes[CP_RING_ENTRIES];
+static ring_t ring;
+
+// Returns 1 at end of file, 0 to continue, -1 on error
+static int copy_batch(int in, int out) {
+    for (int i = 0; i < CP_DEPTH; i++) {
+        ring_sqe_t *rd = ring_get_sqe(&ring);
+        ring_prep(rd, SYS_FREAD, (unsigned int)in, (unsigned int)bufs[i],
+                  CP_CHUNK, (unsigned int)i);
+        rd->flags = RING_F_LINK;
+        ring_sqe_t *wr = ring_get_sqe(&ring);
+        ring_prep(wr, SYS_FWRITE, (unsigned int)out, (unsigned int)bufs[i],
+                  CP_CHUNK, (unsigned int)i);
+        if (i < CP_DEPTH - 1)
+            wr->flags = RING_F_LINK;
+    }
+    if (ring_submit(&ring) != CP_RING_ENTRIES)
+        return -1;
+
+    // Completions come back in submission order: read, write, read, ...
+    int ret = 0;
+    for (int i = 0; i < CP_DEPTH; i++) {
+        int n = ring_peek_cqe(&ring)->res;
+        ring_cqe_seen(&ring);
+        int w = ring_peek_cqe(&ring)->res;
+        ring_cqe_seen(&ring);
+        if (ret != 0)
+            continue; // skipped by the broken chain
+        if (n < 0)
+            ret = -1;
+        else if (n == 0)
+            ret = 1;
+        else if (n < CP_CHUNK) {
+            // Short read: the linked write was skipped, finish it here
+            int off = 0;
+            while (off < n) {
+                int wn = fd_write(out, bufs[i] + off, (unsigned int)(n - off));
+                if (wn <= 0)
+                    return -1;
+                off += wn;
+            }
+            ret = 2;
+        } else if (w != CP_CHUNK)
+            ret = -1;
+    }
+    return ret == 2 ? 0 : ret;
+}
+
 void _start(int argc, char **argv) {
     if (argc < 3) {
         print("usage: cp <src> <dst>\n");
@@ -24,29 +83,15 @@ void _start(int argc, char **argv) {
         exit(1);
     }
 
-    char buf[256];
-    while (1) {
-        int n = fd_read(in, buf, sizeof(buf));
-        if (n < 0) {
-            print("cp: read failed\n");
-            close(in);
-            close(out);
-            exit(1);
-        }
-        if (n == 0)
-            break;
-
-        int off = 0;
-        while (off < n) {
-            int w = fd_write(out, buf + off, (unsigned int)(n - off));
-            if (w <= 0) {
-                print("cp: write failed\n");
-                close(in);
-                close(out);
-                exit(1);
-            }
-            off += w;
-        }
+    ring_init(&ring, sqes, cqes, CP_RING_ENTRIES);
+    int r;
+    while ((r = copy_batch(in, out)) == 0)
+        ;
+    if (r < 0) {
+        print("cp: copy failed\n");
+        close(in);
+        close(out);
+        exit(1);
     }
 
     close(in);
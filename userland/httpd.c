@@ -4,12 +4,18 @@
 #define ROUTE_NONE 0
 #define ROUTE_INDEX 1
 #define ROUTE_OS 2
+#define ROUTE_KTRACE 3
 
 static const char *ok_header = "HTTP/1.0 200 OK\r\n"
                                "Content-Type: text/html\r\n"
                                "Connection: close\r\n"
                                "\r\n";
 
+static const char *ok_binary_header = "HTTP/1.0 200 OK\r\n"
+                                      "Content-Type: application/octet-stream\r\n"
+                                      "Connection: close\r\n"
+                                      "\r\n";
+
 static const char *not_found_response =
     "HTTP/1.0 404 Not Found\r\n"
     "Content-Type: text/html\r\n"
@@ -23,26 +29,37 @@ static const char *not_found_response =
     "<p>Try <a href=\"/\">/</a> or <a "
     "href=\"/index.htm\">/index.htm</a></p></body></html>\n";
 
-static char file_body[8192];
 static char os_log[12288];
 static char os_page[32768];
 
+#define CLIENT_TIMEOUT_MS 5000
+#define HTTPD_BACKLOG 32
+
+// Sleep until the socket is ready for events. Returns 0 when ready, -1 on
+// timeout.
+static int wait_sock(int fd, unsigned short events, int timeout_ms) {
+    pollfd_t p;
+    p.fd = fd;
+    p.kind = POLL_KIND_SOCK;
+    p.events = events;
+    p.revents = 0;
+    p.pad = 0;
+    return poll(&p, 1, timeout_ms) > 0 ? 0 : -1;
+}
+
 static int send_all(int client, const char *buf, int len) {
     int sent = 0;
-    int retries = 0;
     while (sent < len) {
         int n = sock_send(client, buf + sent, (unsigned int)(len - sent));
         if (n > 0) {
             sent += n;
-            retries = 0;
             continue;
         }
         if (n < 0)
             return -1; // error — stop immediately
-        // n == 0: would-block, retry with a limit to avoid infinite loop
-        if (++retries > 500)
+        // n == 0: send buffer full, wait for ACKs to free space
+        if (wait_sock(client, POLLOUT, CLIENT_TIMEOUT_MS) < 0)
             return -1;
-        yield();
     }
     return 0;
 }
@@ -97,34 +114,48 @@ static int parse_route(const char *req, int req_len) {
     if (path_len > 3 && strncmp(req + path_start, "/os?", 4) == 0) {
         return ROUTE_OS;
     }
+    // Kernel trace dump for tools/ktrace2json.py
+    if (path_len == 7 && strncmp(req + path_start, "/ktrace", 7) == 0) {
+        return ROUTE_KTRACE;
+    }
 
     return ROUTE_NONE;
 }
 
-static int serve_index_htm(int client) {
-    int total = 0;
-    int fd = open("index.htm", O_RDONLY);
-    if (fd < 0)
-        fd = open("/index.htm", O_RDONLY);
-    if (fd < 0)
+static int serve_fd(int client, int fd, const char *header) {
+    int size = seek(fd, 0, SEEK_END);
+    if (size <= 0) {
+        close(fd);
         return -1;
+    }
 
-    while (total < (int)sizeof(file_body)) {
-        int n =
-            fd_read(fd, file_body + total,
-                    (unsigned int)(sizeof(file_body) - (unsigned int)total));
+    // The kernel streams the file into the socket as ACKs free space
+    send_all(client, header, strlen(header));
+    int sent = 0;
+    while (sent < size) {
+        int n = sendfile(client, fd, sent, (unsigned int)(size - sent));
         if (n <= 0)
             break;
-        total += n;
+        sent += n;
     }
     close(fd);
+    return 0;
+}
 
-    if (total <= 0)
+static int serve_index_htm(int client) {
+    int fd = open("index.htm", O_RDONLY);
+    if (fd < 0)
+        fd = open("/index.htm", O_RDONLY);
+    if (fd < 0)
         return -1;
+    return serve_fd(client, fd, ok_header);
+}
 
-    send_all(client, ok_header, strlen(ok_header));
-    send_all(client, file_body, total);
-    return 0;
+static int serve_ktrace(int client) {
+    int fd = open("/mos/ktrace", O_RDONLY);
+    if (fd < 0)
+        return -1;
+    return serve_fd(client, fd, ok_binary_header);
 }
 
 static int read_file(const char *path, char *dst, int cap) {
@@ -299,7 +330,8 @@ void _start(int argc, char **argv) {
     (void)argc;
     (void)argv;
 
-    int server = sock_listen(80);
+    // Queue concurrent clients while one request is being served
+    int server = sock_listen_backlog(80, HTTPD_BACKLOG);
     if (server < 0) {
         print("httpd: listen failed\n");
         exit(1);
@@ -307,16 +339,15 @@ void _start(int argc, char **argv) {
     print("httpd: listening on port 80\n");
 
     while (1) {
+        // Sleep in the kernel until a connection arrives
+        wait_sock(server, POLLIN, -1);
         int client = sock_accept(server);
-        if (client < 0) {
-            yield();
+        if (client < 0)
             continue;
-        }
 
         char buf[512];
         int total = 0;
-        int tries = 0;
-        while (total < (int)sizeof(buf) - 1 && tries < 500) {
+        while (total < (int)sizeof(buf) - 1) {
             int n = sock_recv(client, buf + total, sizeof(buf) - 1 - total);
             if (n > 0) {
                 total += n;
@@ -325,9 +356,8 @@ void _start(int argc, char **argv) {
                     break;
             } else if (n == 0) {
                 break;
-            } else {
-                yield();
-                tries++;
+            } else if (wait_sock(client, POLLIN, CLIENT_TIMEOUT_MS) < 0) {
+                break;
             }
         }
 
@@ -346,6 +376,8 @@ void _start(int argc, char **argv) {
             served = serve_index_htm(client);
         } else if (route == ROUTE_OS) {
             served = serve_os_page(client);
+        } else if (route == ROUTE_KTRACE) {
+            served = serve_ktrace(client);
         }
 
         if (served < 0) {
@@ -0,0 +1,185 @@
+#include "libc.h"
+#include "syscalls.h"
+
+// iperf          - loopback benchmarks: in-kernel lwiperf TCP, socket-layer
+//                  TCP throughput and UDP round-trip latency
+// iperf -s       - start the in-kernel iperf 2 server on port 5001
+// iperf -c <ip>  - 10s in-kernel TCP send test to an iperf 2 server
+//
+// Started as the boot program (autorun=iperf, so no argv) it runs the
+// loopback benchmarks as the `make net-bench` smoke test and exits QEMU.
+
+#define LOOPBACK 0x7F000001u
+#define STREAM_PORT 5002
+#define STREAM_BYTES (4 * 1024 * 1024)
+#define UDP_PORT_A 5003
+#define UDP_PORT_B 5004
+#define UDP_ROUNDS 1000
+#define WAIT_MS 2000
+
+static char buf[4096];
+
+static int wait_sock(int fd, unsigned short events) {
+    pollfd_t p;
+    p.fd = fd;
+    p.kind = POLL_KIND_SOCK;
+    p.events = events;
+    p.revents = 0;
+    p.pad = 0;
+    return poll(&p, 1, WAIT_MS) > 0 ? (int)p.revents : 0;
+}
+
+static unsigned int elapsed_ms(unsigned int start) {
+    unsigned int ms = (get_ticks() - start) * 10; // 100Hz ticks
+    return ms ? ms : 1;
+}
+
+static void print_rate(unsigned int bytes, unsigned int ms) {
+    // kbit/s without overflowing 32 bits: bytes * 8 / ms
+    print_num((int)(bytes / ms * 8));
+    print(" kbit/s (");
+    print_num((int)bytes);
+    print(" bytes in ");
+    print_num((int)ms);
+    print(" ms)\n");
+}
+
+static int bench_lwiperf(unsigned int ip_be) {
+    netbench_result_t r;
+    print("lwiperf tcp:   ");
+    if (netbench(NETBENCH_CLIENT, ip_be, &r) != 0) {
+        print("FAILED\n");
+        return -1;
+    }
+    print_num((int)r.kbps);
+    print(" kbit/s (");
+    print_num((int)r.bytes);
+    print(" bytes in ");
+    print_num((int)r.ms);
+    print(" ms)\n");
+    return 0;
+}
+
+// Stream through the socket syscalls over loopback, sender and receiver in
+// this one task
+static int bench_sock_stream(void) {
+    print("socket tcp:    ");
+    int ls = sock_listen(STREAM_PORT);
+    int c = sock_connect(LOOPBACK, STREAM_PORT);
+    int a = -1;
+    if (ls >= 0 && c >= 0 && (wait_sock(c, POLLOUT) & POLLOUT) &&
+        (wait_sock(ls, POLLIN) & POLLIN))
+        a = sock_accept(ls);
+    if (ls >= 0)
+        sock_close(ls);
+    if (a < 0) {
+        print("FAILED (connect)\n");
+        if (c >= 0)
+            sock_close(c);
+        return -1;
+    }
+    sock_setopt(a, SOCK_OPT_RCVBUF, 65536);
+
+    unsigned int start = get_ticks();
+    int sent = 0, got = 0;
+    while (got < STREAM_BYTES) {
+        if (sent < STREAM_BYTES) {
+            int n = sock_send(c, buf, sizeof(buf));
+            if (n > 0)
+                sent += n;
+        }
+        int r = sock_recv(a, buf, sizeof(buf));
+        if (r > 0) {
+            got += r;
+            continue;
+        }
+        if (r == 0 || !wait_sock(a, POLLIN))
+            break;
+    }
+    unsigned int ms = elapsed_ms(start);
+    sock_close(c);
+    sock_close(a);
+    if (got < STREAM_BYTES) {
+        print("FAILED (stalled)\n");
+        return -1;
+    }
+    print_rate((unsigned int)got, ms);
+    return 0;
+}
+
+// Ping-pong one small datagram between two UDP sockets
+static int bench_udp_rtt(void) {
+    print("socket udp rtt: ");
+    int u1 = udp_bind(UDP_PORT_A);
+    int u2 = udp_bind(UDP_PORT_B);
+    int done = 0;
+    unsigned int start = get_ticks();
+    while (u1 >= 0 && u2 >= 0 && done < UDP_ROUNDS) {
+        if (sock_sendto(u1, "ping", 4, LOOPBACK, UDP_PORT_B) < 0 ||
+            !(wait_sock(u2, POLLIN) & POLLIN) ||
+            sock_recvfrom(u2, buf, sizeof(buf), 0, 0) != 4)
+            break;
+        if (sock_sendto(u2, "pong", 4, LOOPBACK, UDP_PORT_A) < 0 ||
+            !(wait_sock(u1, POLLIN) & POLLIN) ||
+            sock_recvfrom(u1, buf, sizeof(buf), 0, 0) != 4)
+            break;
+        done++;
+    }
+    unsigned int ms = elapsed_ms(start);
+    if (u1 >= 0)
+        sock_close(u1);
+    if (u2 >= 0)
+        sock_close(u2);
+    if (done < UDP_ROUNDS) {
+        print("FAILED\n");
+        return -1;
+    }
+    print_num((int)(ms * 1000 / UDP_ROUNDS));
+    print(" us avg over ");
+    print_num(UDP_ROUNDS);
+    print(" round trips\n");
+    return 0;
+}
+
+static int bench_loopback(void) {
+    int fails = 0;
+    if (bench_lwiperf(0) < 0)
+        fails++;
+    if (bench_sock_stream() < 0)
+        fails++;
+    if (bench_udp_rtt() < 0)
+        fails++;
+    return fails;
+}
+
+void _start(int argc, char **argv) {
+    if (argc == 0) {
+        int fails = bench_loopback();
+        print(fails ? "iperf: FAIL\n" : "iperf: PASS\n");
+        debug_exit(fails);
+        shutdown();
+        exit(fails);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "-s") == 0) {
+        if (netbench(NETBENCH_SERVER, 0, 0) != 0) {
+            print("iperf: network stack not available\n");
+            exit(1);
+        }
+        print("iperf: server listening on port 5001\n");
+        exit(0);
+    }
+    if (argc >= 2 && strcmp(argv[1], "-c") == 0) {
+        unsigned int ip_be;
+        if (argc < 3 || parse_ip4(argv[2], &ip_be) != 0) {
+            print("usage: iperf [-s | -c <ip>]\n");
+            exit(1);
+        }
+        exit(bench_lwiperf(ip_be) < 0 ? 1 : 0);
+    }
+    if (argc >= 2) {
+        print("usage: iperf [-s | -c <ip>]\n");
+        exit(1);
+    }
+    exit(bench_loopback() ? 1 : 0);
+}
@@ -23,13 +23,51 @@ char **environ = 0;
 
 int *__errno_location(void) { return &errno; }
 
-typedef struct alloc_hdr {
-    unsigned int size;       // requested allocation size (bytes)
-    unsigned int cap;        // total block capacity including header (bytes)
-    struct alloc_hdr *next;  // free list link (non-NULL means block is free)
-} alloc_hdr_t;
-
-static alloc_hdr_t *g_free_list = (void *)0; // head of singly-linked free list
+// Heap chunks carry boundary tags: `head` holds the chunk size (a multiple
+// of 8) and flag bits, and `prev_size` holds the previous chunk's size while
+// that chunk is free, so free() merges with both neighbours in O(1). The
+// bin links overlay the user data of free chunks.
+typedef struct heap_chunk {
+    unsigned int prev_size;  // size of the previous chunk, valid if it is free
+    unsigned int head;       // size | CHUNK_INUSE | CHUNK_PREV_INUSE
+    struct heap_chunk *fd;   // bin links, only while free
+    struct heap_chunk *bk;
+} heap_chunk_t;
+
+#define CHUNK_INUSE 1u
+#define CHUNK_PREV_INUSE 2u
+#define CHUNK_FLAGS 7u
+#define CHUNK_HDR 8u  // prev_size + head, in front of the user pointer
+#define CHUNK_MIN 16u // header + bin links
+#define HEAP_MAX_REQUEST 0x7FFF0000u
+
+// Chunks under 256 bytes get an exact-size bin each (index size / 8); larger
+// ones share one bin per power of two and are taken best-fit
+#define NSMALL_BINS 32
+#define NBINS 64
+// Freed chunks up to this size go to a per-size cache first: they stay
+// marked in use, so a malloc of the same size is a pop and nothing merges
+// with them until the cache is flushed into the bins
+#define FAST_MAX 128u
+// Cached chunks can pin free memory away from the top, so the cache is
+// flushed (and the top trimmed) whenever free memory outside the top grows
+// this much past its low point since the last flush
+#define HEAP_FLUSH_BYTES 0x10000u
+
+// The heap grows in 16KB steps and gives memory back to the kernel once the
+// free top of the heap passes 128KB, keeping one step's worth
+#define HEAP_GRANULE 0x4000u
+#define HEAP_TRIM_THRESHOLD 0x20000u
+
+static heap_chunk_t *g_bins[NBINS];            // free chunks, LIFO per bin
+static unsigned int g_binmap[NBINS / 32];      // bit per non-empty bin
+static heap_chunk_t *g_fast[FAST_MAX / 8 + 1]; // cached small chunks
+static unsigned int g_fast_count;
+static unsigned int g_free_bytes; // in the bins and the cache, not the top
+static unsigned int g_free_low;   // low point of g_free_bytes since a flush
+static unsigned int g_pinned;     // free neighbours of cached chunks, bytes
+static heap_chunk_t *g_top;  // untouched space up to g_heap_end
+static char *g_heap_end;     // break as of our last sbrk
 
 typedef struct __mate_file {
     int fd;
@@ -62,11 +100,30 @@ static int c_isalpha(int c) {
 
 static unsigned int align8(unsigned int n) { return (n + 7u) & ~7u; }
 
+// Word-at-a-time helpers for the string routines. A dword holds a zero byte
+// iff (x - 0x01010101) & ~x & 0x80808080 is nonzero. Loads are dword
+// aligned, so they never cross into a page past the terminator.
+typedef unsigned int __attribute__((may_alias)) word_t;
+
+#define WORD_ONES 0x01010101u
+#define WORD_HIGHS 0x80808080u
+
+static inline int word_has_zero(unsigned int x) {
+    return ((x - WORD_ONES) & ~x & WORD_HIGHS) != 0;
+}
+
 size_t strlen(const char *s) {
-    int n = 0;
-    while (s[n])
-        n++;
-    return (size_t)n;
+    const char *p = s;
+    while ((unsigned int)p & 3) {
+        if (!*p)
+            return (size_t)(p - s);
+        p++;
+    }
+    while (!word_has_zero(*(const word_t *)p))
+        p += 4;
+    while (*p)
+        p++;
+    return (size_t)(p - s);
 }
 
 char *strcpy(char *dst, const char *src) {
@@ -102,14 +159,28 @@ char *strncat(char *dst, const char *src, size_t n) {
 }
 
 char *strchr(const char *s, int c) {
-    while (*s) {
+    unsigned int pat = (unsigned char)c * WORD_ONES;
+    while ((unsigned int)s & 3) {
         if (*s == (char)c)
             return (char *)s;
+        if (!*s)
+            return NULL;
+        s++;
+    }
+    // Skip whole dwords holding neither the NUL nor c (x ^ pat zeroes c)
+    for (;;) {
+        unsigned int w = *(const word_t *)s;
+        if (word_has_zero(w) || word_has_zero(w ^ pat))
+            break;
+        s += 4;
+    }
+    for (;;) {
+        if (*s == (char)c)
+            return (char *)s;
+        if (!*s)
+            return NULL;
         s++;
     }
-    if (c == '\0')
-        return (char *)s;
-    return NULL;
 }
 
 char *strrchr(const char *s, int c) {
@@ -155,6 +226,23 @@ char *strpbrk(const char *s, const char *accept) {
 }
 
 int strcmp(const char *a, const char *b) {
+    // Compare dwords while both strings share an alignment; stop at the
+    // first dword that differs or holds the NUL and finish bytewise
+    if ((((unsigned int)a ^ (unsigned int)b) & 3) == 0) {
+        while ((unsigned int)a & 3) {
+            if (!*a || *a != *b)
+                return (unsigned char)*a - (unsigned char)*b;
+            a++;
+            b++;
+        }
+        for (;;) {
+            unsigned int wa = *(const word_t *)a;
+            if (wa != *(const word_t *)b || word_has_zero(wa))
+                break;
+            a += 4;
+            b += 4;
+        }
+    }
     while (*a && *a == *b) {
         a++;
         b++;
@@ -173,42 +261,106 @@ int strncmp(const char *a, const char *b, size_t n) {
     return 0;
 }
 
+// Bulk copies and fills use the string instructions: a few byte moves to
+// dword align the destination, rep movsd/stosd, then the 0-3 byte tail.
+// rep has a startup cost of around a hundred cycles, so runs shorter than
+// MEM_REP_MIN (most struct copies and realloc moves) use a dword loop.
+#define MEM_REP_MIN 512
+
+static inline void rep_movsb(void **d, const void **s, size_t n) {
+    __asm__ volatile("rep movsb"
+                     : "+D"(*d), "+S"(*s), "+c"(n)
+                     :
+                     : "memory");
+}
+
+static inline void rep_movsd(void **d, const void **s, size_t n) {
+    __asm__ volatile("rep movsl"
+                     : "+D"(*d), "+S"(*s), "+c"(n)
+                     :
+                     : "memory");
+}
+
+static inline void rep_stosb(void **d, unsigned int v, size_t n) {
+    __asm__ volatile("rep stosb" : "+D"(*d), "+c"(n) : "a"(v) : "memory");
+}
+
+static inline void rep_stosd(void **d, unsigned int v, size_t n) {
+    __asm__ volatile("rep stosl" : "+D"(*d), "+c"(n) : "a"(v) : "memory");
+}
+
 void *memset(void *dst, int c, size_t n) {
-    unsigned char *d = (unsigned char *)dst;
-    size_t i;
-    for (i = 0; i < n; i++)
-        d[i] = (unsigned char)c;
+    void *d = dst;
+    unsigned int v = (unsigned char)c * WORD_ONES;
+    if (n < MEM_REP_MIN) {
+        unsigned char *p = (unsigned char *)dst;
+        for (; n >= 8; n -= 8, p += 8) {
+            *(word_t *)p = v;
+            *(word_t *)(p + 4) = v;
+        }
+        while (n--)
+            *p++ = (unsigned char)v;
+        return dst;
+    }
+    size_t head = (0u - (unsigned int)d) & 3;
+    rep_stosb(&d, v, head);
+    n -= head;
+    rep_stosd(&d, v, n >> 2);
+    rep_stosb(&d, v, n & 3);
     return dst;
 }
 
 void *memcpy(void *dst, const void *src, size_t n) {
-    unsigned char *d = (unsigned char *)dst;
-    const unsigned char *s = (const unsigned char *)src;
-    size_t i;
-    for (i = 0; i < n; i++)
-        d[i] = s[i];
+    void *d = dst;
+    const void *s = src;
+    if (n < MEM_REP_MIN) {
+        unsigned char *pd = (unsigned char *)dst;
+        const unsigned char *ps = (const unsigned char *)src;
+        for (; n >= 8; n -= 8, pd += 8, ps += 8) {
+            unsigned int a = *(const word_t *)ps;
+            unsigned int b = *(const word_t *)(ps + 4);
+            *(word_t *)pd = a;
+            *(word_t *)(pd + 4) = b;
+        }
+        while (n--)
+            *pd++ = *ps++;
+        return dst;
+    }
+    size_t head = (0u - (unsigned int)d) & 3;
+    rep_movsb(&d, &s, head);
+    n -= head;
+    rep_movsd(&d, &s, n >> 2);
+    rep_movsb(&d, &s, n & 3);
     return dst;
 }
 
 void *memmove(void *dst, const void *src, size_t n) {
     unsigned char *d = (unsigned char *)dst;
     const unsigned char *s = (const unsigned char *)src;
-    size_t i;
-    if (d == s || n == 0)
-        return dst;
-    if (d < s) {
-        for (i = 0; i < n; i++)
-            d[i] = s[i];
-    } else {
-        for (i = n; i > 0; i--)
-            d[i - 1] = s[i - 1];
+    // rep movs is architecturally a forward loop, so memcpy is safe unless
+    // dst starts inside src
+    if (d <= s || d >= s + n)
+        return memcpy(dst, src, n);
+    // dst overlaps the end of src: copy backwards a dword at a time
+    while (n >= 4) {
+        n -= 4;
+        *(word_t *)(d + n) = *(const word_t *)(s + n);
     }
+    while (n--)
+        d[n] = s[n];
     return dst;
 }
 
 int memcmp(const void *a, const void *b, size_t n) {
     const unsigned char *pa = (const unsigned char *)a;
     const unsigned char *pb = (const unsigned char *)b;
+    // Skip the equal prefix a dword at a time (x86 allows unaligned loads),
+    // then find the first differing byte
+    while (n >= 4 && *(const word_t *)pa == *(const word_t *)pb) {
+        pa += 4;
+        pb += 4;
+        n -= 4;
+    }
     size_t i;
     for (i = 0; i < n; i++) {
         if (pa[i] != pb[i])
@@ -320,37 +472,242 @@ unsigned long long __isoc23_strtoull(const char *nptr, char **endptr,
     return strtoull(nptr, endptr, base);
 }
 
-void *malloc(size_t n) {
-    if (n == 0)
+static unsigned int chunk_size(const heap_chunk_t *c) {
+    return c->head & ~CHUNK_FLAGS;
+}
+
+static heap_chunk_t *chunk_at(heap_chunk_t *c, unsigned int off) {
+    return (heap_chunk_t *)((char *)c + off);
+}
+
+static void *chunk_mem(heap_chunk_t *c) { return (char *)c + CHUNK_HDR; }
+
+static heap_chunk_t *mem_chunk(void *p) {
+    return (heap_chunk_t *)((char *)p - CHUNK_HDR);
+}
+
+static unsigned int top_size(void) {
+    return g_top ? (unsigned int)(g_heap_end - (char *)g_top) : 0;
+}
+
+static unsigned int request_size(size_t n) {
+    unsigned int need = align8((unsigned int)n + CHUNK_HDR);
+    return need < CHUNK_MIN ? CHUNK_MIN : need;
+}
+
+static unsigned int bin_index(unsigned int size) {
+    if (size < NSMALL_BINS * 8)
+        return size >> 3;
+    // 256..511 -> 32, 512..1023 -> 33, ...
+    return NSMALL_BINS + (31 - __builtin_clz(size)) - 8;
+}
+
+static void bin_insert(heap_chunk_t *c) {
+    unsigned int idx = bin_index(chunk_size(c));
+    c->bk = NULL;
+    c->fd = g_bins[idx];
+    if (c->fd)
+        c->fd->bk = c;
+    g_bins[idx] = c;
+    g_binmap[idx >> 5] |= 1u << (idx & 31);
+    g_free_bytes += chunk_size(c);
+}
+
+static void bin_unlink(heap_chunk_t *c) {
+    unsigned int idx = bin_index(chunk_size(c));
+    if (c->bk)
+        c->bk->fd = c->fd;
+    else
+        g_bins[idx] = c->fd;
+    if (c->fd)
+        c->fd->bk = c->bk;
+    if (!g_bins[idx])
+        g_binmap[idx >> 5] &= ~(1u << (idx & 31));
+    g_free_bytes -= chunk_size(c);
+}
+
+// First non-empty bin at or above idx, or NBINS
+static unsigned int binmap_find(unsigned int idx) {
+    while (idx < NBINS) {
+        unsigned int bits = g_binmap[idx >> 5] & (~0u << (idx & 31));
+        if (bits)
+            return (idx & ~31u) + (unsigned int)__builtin_ctz(bits);
+        idx = (idx & ~31u) + 32;
+    }
+    return NBINS;
+}
+
+// Tag c as a free chunk of size bytes (the caller bins or tops it)
+static void set_free(heap_chunk_t *c, unsigned int size) {
+    heap_chunk_t *next = chunk_at(c, size);
+    c->head = size | (c->head & CHUNK_PREV_INUSE);
+    next->prev_size = size;
+    next->head &= ~CHUNK_PREV_INUSE;
+}
+
+static void set_inuse(heap_chunk_t *c, unsigned int size) {
+    c->head = size | CHUNK_INUSE | (c->head & CHUNK_PREV_INUSE);
+    chunk_at(c, size)->head |= CHUNK_PREV_INUSE;
+}
+
+// Make room for at least need bytes in the top chunk. If something else
+// moved the break since our last sbrk, the old top is left behind as a
+// permanently allocated fence and the heap carries on in the new region.
+static int heap_grow(unsigned int need) {
+    char *cur = (char *)sbrk(0);
+    int contiguous = g_top && cur == g_heap_end;
+    unsigned int have = contiguous ? top_size() : 0;
+    // + 8 covers aligning a fresh region's start
+    unsigned int incr = (need - have + 8 + HEAP_GRANULE - 1) &
+                        ~(HEAP_GRANULE - 1);
+    if (incr > HEAP_MAX_REQUEST)
+        return -1;
+    char *base = (char *)sbrk((int)incr);
+    if (base == (char *)-1)
+        return -1;
+    if (contiguous && base == g_heap_end) {
+        g_heap_end += incr;
+        return 0;
+    }
+    if (g_top)
+        g_top->head = top_size() | CHUNK_INUSE |
+                      (g_top->head & CHUNK_PREV_INUSE);
+    g_top = (heap_chunk_t *)align8((unsigned int)base);
+    g_top->head = CHUNK_PREV_INUSE;
+    g_heap_end = base + incr;
+    return 0;
+}
+
+// Hand the free top of the heap back to the kernel once it is large
+static void heap_trim(void) {
+    unsigned int size = top_size();
+    if (size < HEAP_TRIM_THRESHOLD || (char *)sbrk(0) != g_heap_end)
+        return;
+    unsigned int release = (size - HEAP_GRANULE) & ~0xFFFu;
+    if (sbrk(-(int)release) != (void *)-1)
+        g_heap_end -= release;
+}
+
+// Return a chunk to the bins, merging with free neighbours (a free chunk
+// is never next to another) or into the top chunk
+static void chunk_release(heap_chunk_t *c) {
+    unsigned int size = chunk_size(c);
+    if (!(c->head & CHUNK_PREV_INUSE)) {
+        size += c->prev_size;
+        c = (heap_chunk_t *)((char *)c - c->prev_size);
+        bin_unlink(c);
+    }
+    heap_chunk_t *next = chunk_at(c, size);
+    if (next == g_top) {
+        c->head &= CHUNK_PREV_INUSE;
+        g_top = c;
+        return;
+    }
+    if (!(next->head & CHUNK_INUSE)) {
+        bin_unlink(next);
+        size += chunk_size(next);
+    }
+    set_free(c, size);
+    bin_insert(c);
+}
+
+// Release every cached small chunk so it can merge with its neighbours
+static void heap_flush_fast(void) {
+    for (unsigned int i = 0; i <= FAST_MAX / 8; i++) {
+        while (g_fast[i]) {
+            heap_chunk_t *c = g_fast[i];
+            g_fast[i] = c->fd;
+            g_free_bytes -= chunk_size(c);
+            chunk_release(c);
+        }
+    }
+    g_fast_count = 0;
+}
+
+// Flush the cache so everything free can reach the top, then trim it
+static void heap_consolidate(void) {
+    heap_flush_fast();
+    heap_trim();
+    g_free_low = g_free_bytes;
+    g_pinned = 0;
+}
+
+// Carve need bytes off the front of the top chunk
+static heap_chunk_t *top_take(unsigned int need) {
+    if (top_size() < need + CHUNK_MIN && heap_grow(need + CHUNK_MIN) < 0)
         return NULL;
-    {
-        unsigned int need =
-            align8((unsigned int)n + (unsigned int)sizeof(alloc_hdr_t));
-
-        // Search free list for a block with enough capacity (first fit)
-        alloc_hdr_t **pp = &g_free_list;
-        while (*pp) {
-            alloc_hdr_t *h = *pp;
-            if (h->cap >= need) {
-                *pp = h->next;   // unlink from free list
-                h->next = (void *)0;
-                h->size = (unsigned int)n;
-                return (void *)(h + 1);
+    heap_chunk_t *c = g_top;
+    g_top = chunk_at(c, need);
+    g_top->head = CHUNK_PREV_INUSE;
+    c->head = need | CHUNK_INUSE | (c->head & CHUNK_PREV_INUSE);
+    return c;
+}
+
+// Smallest binned chunk that fits: the exact small bin, best fit within a
+// large bin, else the first chunk of the next non-empty bin up. Splits off
+// any remainder big enough to stand alone.
+static heap_chunk_t *bin_take(unsigned int need) {
+    unsigned int idx = bin_index(need);
+    heap_chunk_t *c = NULL;
+    if (idx >= NSMALL_BINS) {
+        for (heap_chunk_t *p = g_bins[idx]; p; p = p->fd) {
+            unsigned int sz = chunk_size(p);
+            if (sz >= need && (!c || sz < chunk_size(c))) {
+                c = p;
+                if (sz == need)
+                    break;
             }
-            pp = &h->next;
         }
-
-        // No suitable free block — grow heap
-        alloc_hdr_t *h = (alloc_hdr_t *)sbrk((int)need);
-        if ((unsigned int)h == 0xFFFFFFFFu) {
-            write(2, "[malloc fail: sbrk returned -1]\n", 32);
+        idx++;
+    }
+    if (!c) {
+        idx = binmap_find(idx);
+        if (idx == NBINS)
             return NULL;
-        }
-        h->size = (unsigned int)n;
-        h->cap  = need;
-        h->next = (void *)0;
-        return (void *)(h + 1);
+        c = g_bins[idx];
+    }
+    bin_unlink(c);
+
+    unsigned int size = chunk_size(c);
+    if (size - need >= CHUNK_MIN) {
+        heap_chunk_t *rest = chunk_at(c, need);
+        rest->head = CHUNK_PREV_INUSE;
+        set_free(rest, size - need);
+        bin_insert(rest);
+        size = need;
+    }
+    set_inuse(c, size);
+    return c;
+}
+
+void *malloc(size_t n) {
+    if (n == 0 || n > HEAP_MAX_REQUEST)
+        return NULL;
+    unsigned int need = request_size(n);
+    heap_chunk_t *c;
+    if (need <= FAST_MAX && (c = g_fast[need >> 3])) {
+        g_fast[need >> 3] = c->fd;
+        g_fast_count--;
+        g_free_bytes -= need;
+        if (g_free_bytes < g_free_low)
+            g_free_low = g_free_bytes;
+        return chunk_mem(c);
+    }
+    c = bin_take(need);
+    // Flush the cache into the bins before growing the heap
+    if (!c && g_fast_count && top_size() < need + CHUNK_MIN) {
+        heap_flush_fast();
+        c = bin_take(need);
     }
+    if (!c)
+        c = top_take(need);
+    if (!c) {
+        write(2, "[malloc fail: sbrk returned -1]\n", 32);
+        return NULL;
+    }
+    if (g_free_bytes < g_free_low)
+        g_free_low = g_free_bytes;
+    return chunk_mem(c);
 }
 
 void *calloc(size_t n, size_t sz) {
@@ -366,11 +723,33 @@ void *calloc(size_t n, size_t sz) {
 void free(void *p) {
     if (!p)
         return;
-    // Recover header sitting directly before the user data pointer
-    alloc_hdr_t *h = ((alloc_hdr_t *)p) - 1;
-    // Prepend to free list
-    h->next = g_free_list;
-    g_free_list = h;
+    heap_chunk_t *c = mem_chunk(p);
+    unsigned int size = chunk_size(c);
+    // A chunk next to the top is merged into it rather than cached, so the
+    // cache never holds the top down. Free neighbours of a cached chunk are
+    // counted, as a flush is what lets them merge.
+    heap_chunk_t *next = chunk_at(c, size);
+    if (size <= FAST_MAX && next != g_top) {
+        if (!(c->head & CHUNK_PREV_INUSE))
+            g_pinned += c->prev_size;
+        if (!(next->head & CHUNK_INUSE))
+            g_pinned += chunk_size(next);
+        c->fd = g_fast[size >> 3];
+        g_fast[size >> 3] = c;
+        g_fast_count++;
+        g_free_bytes += size;
+    } else {
+        chunk_release(c);
+    }
+    // Consolidate when free memory has piled up since the last flush, when
+    // cached chunks are holding apart enough free memory, or when the top
+    // is worth trimming
+    if (g_free_bytes >= g_free_low + HEAP_FLUSH_BYTES ||
+        g_pinned >= HEAP_TRIM_THRESHOLD ||
+        top_size() >= HEAP_TRIM_THRESHOLD)
+        heap_consolidate();
+    else if (g_free_bytes < g_free_low)
+        g_free_low = g_free_bytes;
 }
 
 void *realloc(void *p, size_t n) {
@@ -380,22 +759,50 @@ void *realloc(void *p, size_t n) {
         free(p);
         return NULL;
     }
-    {
-        alloc_hdr_t *h = ((alloc_hdr_t *)p) - 1;
-        // If the existing block already has enough capacity, reuse it
-        unsigned int need = align8((unsigned int)n + (unsigned int)sizeof(alloc_hdr_t));
-        if (h->cap >= need) {
-            h->size = (unsigned int)n;
+    if (n > HEAP_MAX_REQUEST)
+        return NULL;
+
+    heap_chunk_t *c = mem_chunk(p);
+    unsigned int size = chunk_size(c);
+    unsigned int need = request_size(n);
+    if (size < need) {
+        // Grow in place into the top chunk or a free chunk that follows
+        heap_chunk_t *next = chunk_at(c, size);
+        if (next == g_top && top_size() < need - size + CHUNK_MIN)
+            heap_grow(need - size + CHUNK_MIN);
+        if (next == g_top && top_size() >= need - size + CHUNK_MIN) {
+            g_top = chunk_at(c, need);
+            g_top->head = CHUNK_PREV_INUSE;
+            c->head = need | (c->head & CHUNK_FLAGS);
             return p;
         }
-        void *np = malloc(n);
-        if (!np)
-            return NULL;
-        size_t copy = h->size < n ? h->size : n;
-        memcpy(np, p, copy);
-        free(p);
-        return np;
+        if (next != g_top && !(next->head & CHUNK_INUSE) &&
+            size + chunk_size(next) >= need) {
+            bin_unlink(next);
+            size += chunk_size(next);
+            set_inuse(c, size);
+        } else {
+            // A buffer that had to move is likely to keep growing, so put
+            // it at the start of the top chunk, where it can grow in place
+            heap_chunk_t *nc = top_size() >= need + CHUNK_MIN ? top_take(need)
+                                                              : NULL;
+            void *np = nc ? chunk_mem(nc) : malloc(n);
+            if (!np)
+                return NULL;
+            memcpy(np, p, size - CHUNK_HDR);
+            free(p);
+            return np;
+        }
     }
+
+    // Give back a tail big enough to stand alone as a chunk
+    if (size - need >= CHUNK_MIN) {
+        heap_chunk_t *rest = chunk_at(c, need);
+        c->head = need | (c->head & CHUNK_FLAGS);
+        rest->head = (size - need) | CHUNK_INUSE | CHUNK_PREV_INUSE;
+        free(chunk_mem(rest));
+    }
+    return p;
 }
 
 static int write_all(int fd, const char *buf, int len) {
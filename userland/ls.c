@@ -21,24 +21,11 @@ static int cmp_ext_grouped(const char *a, const char *b) {
     return strcmp(a, b);
 }
 
-static void swap_names(char a[32], char b[32]) {
-    char t[32];
-    memcpy(t, a, sizeof(t));
-    memcpy(a, b, sizeof(t));
-    memcpy(b, t, sizeof(t));
-}
-
-static void swap_types(int *a, int *b) {
-    int t = *a;
-    *a = *b;
-    *b = t;
-}
-
-static int max_name_len(char names[][32], int types[], int count) {
+static int max_name_len(dirent_t **ents, int count) {
     int max = 0;
     for (int i = 0; i < count; i++) {
-        int n = strlen(names[i]);
-        if (types[i])
+        int n = ents[i]->namelen;
+        if (ents[i]->type)
             n++; // account for trailing '/'
         if (n > max)
             max = n;
@@ -57,7 +44,7 @@ static void print_padded(const char *s, int extra, int width) {
 
 void _start(int argc, char **argv) {
     int by_ext = 0;
-    const char *path = 0; // NULL = use cwd via readdir
+    const char *path = 0; // NULL = list the cwd
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-x") == 0 || strcmp(argv[i], "--ext") == 0) {
@@ -67,53 +54,59 @@ void _start(int argc, char **argv) {
         }
     }
 
-    char names[256][32];
-    int types[256]; // 0=file, 1=dir
-    int count = 0;
-
-    if (path) {
-        // List a specific directory
-        while (count < 256 &&
-               readdir_path(path, (unsigned int)count, names[count]) > 0) {
-            // Build full path for stat
-            char fullpath[96];
-            int pi = 0;
-            for (int j = 0; path[j] && pi < 90; j++)
-                fullpath[pi++] = path[j];
-            if (pi > 0 && fullpath[pi - 1] != '/')
-                fullpath[pi++] = '/';
-            for (int j = 0; names[count][j] && pi < 95; j++)
-                fullpath[pi++] = names[count][j];
-            fullpath[pi] = '\0';
-
-            stat_t st;
-            types[count] = (stat(fullpath, &st) == 0 && st.type == 1) ? 1 : 0;
-            count++;
-        }
-    } else {
-        // List current working directory (uses cwd via kernel)
-        while (count < 256 && readdir((unsigned int)count, names[count],
-                                      sizeof(names[count])) > 0) {
-            stat_t st;
-            types[count] =
-                (stat(names[count], &st) == 0 && st.type == 1) ? 1 : 0;
-            count++;
+    // Pull the whole directory in a few getdents calls; each record
+    // already carries the type, so no per-entry stat is needed.
+    int fd = opendir(path);
+    if (fd < 0) {
+        print("ls: cannot open ");
+        print(path ? path : ".");
+        print("\n");
+        exit(1);
+    }
+    char *recs = 0;
+    unsigned int used = 0, cap = 0;
+    while (1) {
+        if (cap - used < 1024) {
+            unsigned int ncap = cap ? cap * 2 : 4096;
+            char *nr = (char *)realloc(recs, ncap);
+            if (!nr)
+                break;
+            recs = nr;
+            cap = ncap;
         }
+        int n = getdents(fd, recs + used, cap - used);
+        if (n <= 0)
+            break;
+        used += (unsigned int)n;
     }
+    close(fd);
+
+    int count = 0;
+    for (unsigned int off = 0; off < used;
+         off += ((dirent_t *)(recs + off))->reclen)
+        count++;
+    dirent_t **ents = (dirent_t **)malloc((count ? count : 1) * sizeof(*ents));
+    if (!ents)
+        exit(1);
+    count = 0;
+    for (unsigned int off = 0; off < used;
+         off += ((dirent_t *)(recs + off))->reclen)
+        ents[count++] = (dirent_t *)(recs + off);
 
     for (int i = 0; i < count; i++) {
         for (int j = i + 1; j < count; j++) {
-            int c = by_ext ? cmp_ext_grouped(names[i], names[j])
-                           : cmp_alpha(names[i], names[j]);
+            int c = by_ext ? cmp_ext_grouped(ents[i]->name, ents[j]->name)
+                           : cmp_alpha(ents[i]->name, ents[j]->name);
             if (c > 0) {
-                swap_names(names[i], names[j]);
-                swap_types(&types[i], &types[j]);
+                dirent_t *t = ents[i];
+                ents[i] = ents[j];
+                ents[j] = t;
             }
         }
     }
 
     if (count > 0) {
-        int name_w = max_name_len(names, types, count) + 2;
+        int name_w = max_name_len(ents, count) + 2;
         if (name_w < 12)
             name_w = 12;
         if (name_w > 30)
@@ -133,11 +126,11 @@ void _start(int argc, char **argv) {
                 if (idx >= count)
                     continue;
                 if (c == cols - 1) {
-                    print(names[idx]);
-                    if (types[idx])
+                    print(ents[idx]->name);
+                    if (ents[idx]->type)
                         print("/");
                 } else {
-                    print_padded(names[idx], types[idx], name_w);
+                    print_padded(ents[idx]->name, ents[idx]->type, name_w);
                 }
             }
             print("\n");
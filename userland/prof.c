@@ -0,0 +1,466 @@
+#include <stdlib.h>
+
+#include "libc.h"
+#include "syscalls.h"
+
+// prof <prog> [args...] - run prog under the kernel's sampling profiler and
+// print a flat profile and a call graph of its samples.
+//
+// Samples come from /mos/kprof (one per timer tick: EIP, ring, pid and a
+// frame-pointer stack walk). User addresses are resolved against the
+// program's own ELF symbol table, kernel addresses against /boot/dmos.bin.
+// Call stacks need frame pointers: build with `make PROFILE=1`.
+
+#define PROF_FILE "/mos/kprof"
+#define KERNEL_IMAGE "/boot/dmos.bin"
+#define KERNEL_BASE 0xC0000000u
+
+// Must match src/prof.h
+#define PROF_MAGIC 0x464F5250u
+#define PROF_STACK_DEPTH 6
+
+typedef struct {
+    unsigned int magic;
+    unsigned short version;
+    unsigned short sample_size;
+    unsigned int hz;
+    unsigned int count;
+    unsigned int dropped;
+    unsigned int running;
+} prof_header_t;
+
+typedef struct {
+    unsigned int eip;
+    unsigned short pid;
+    unsigned char ring;
+    unsigned char depth;
+    unsigned int stack[PROF_STACK_DEPTH];
+} prof_sample_t;
+
+#define ELF_SHT_SYMTAB 2u
+#define ELF_STT_FUNC 2u
+
+typedef struct __attribute__((packed)) {
+    unsigned char e_ident[16];
+    unsigned short e_type;
+    unsigned short e_machine;
+    unsigned int e_version;
+    unsigned int e_entry;
+    unsigned int e_phoff;
+    unsigned int e_shoff;
+    unsigned int e_flags;
+    unsigned short e_ehsize;
+    unsigned short e_phentsize;
+    unsigned short e_phnum;
+    unsigned short e_shentsize;
+    unsigned short e_shnum;
+    unsigned short e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct __attribute__((packed)) {
+    unsigned int sh_name;
+    unsigned int sh_type;
+    unsigned int sh_flags;
+    unsigned int sh_addr;
+    unsigned int sh_offset;
+    unsigned int sh_size;
+    unsigned int sh_link;
+    unsigned int sh_info;
+    unsigned int sh_addralign;
+    unsigned int sh_entsize;
+} elf32_shdr_t;
+
+typedef struct __attribute__((packed)) {
+    unsigned int st_name;
+    unsigned int st_value;
+    unsigned int st_size;
+    unsigned char st_info;
+    unsigned char st_other;
+    unsigned short st_shndx;
+} elf32_sym_t;
+
+// One function: symbol range plus the counters for this run
+typedef struct {
+    unsigned int addr;
+    unsigned int size; // 0 = up to the next symbol
+    const char *name;
+    int kernel;
+    unsigned int self;  // samples with the EIP in this function
+    unsigned int total; // samples with this function anywhere on the stack
+} func_t;
+
+// Caller -> callee arc, keyed by func indices
+typedef struct {
+    int caller;
+    int callee;
+    unsigned int count;
+} arc_t;
+
+#define MAX_FUNCS 8192
+#define ARC_SLOTS 4096 // power of two
+#define FLAT_ROWS 25
+#define GRAPH_ROWS 10
+#define GRAPH_ARCS 3
+
+static func_t funcs[MAX_FUNCS + 2];
+static int nfuncs;
+static int unknown_user, unknown_kernel;
+static arc_t arcs[ARC_SLOTS];
+static char progname[64];
+
+static int read_at(int fd, unsigned int off, void *buf, unsigned int len) {
+    if (seek(fd, (int)off, SEEK_SET) != (int)off)
+        return -1;
+    unsigned int got = 0;
+    while (got < len) {
+        int n = fd_read(fd, (char *)buf + got, len - got);
+        if (n <= 0)
+            return -1;
+        got += (unsigned int)n;
+    }
+    return 0;
+}
+
+// Add the function symbols of an ELF file; returns how many were added
+static int load_symbols(const char *path, int kernel) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    elf32_ehdr_t eh;
+    elf32_shdr_t *sh = 0;
+    elf32_sym_t *syms = 0;
+    char *strtab = 0;
+    int added = -1;
+
+    if (read_at(fd, 0, &eh, sizeof(eh)) != 0 || eh.e_ident[0] != 0x7F ||
+        eh.e_ident[1] != 'E' || eh.e_shentsize != sizeof(elf32_shdr_t))
+        goto out;
+    sh = malloc(eh.e_shnum * sizeof(elf32_shdr_t));
+    if (!sh || read_at(fd, eh.e_shoff, sh,
+                       eh.e_shnum * sizeof(elf32_shdr_t)) != 0)
+        goto out;
+
+    int si = -1;
+    for (int i = 0; i < eh.e_shnum; i++) {
+        if (sh[i].sh_type == ELF_SHT_SYMTAB) {
+            si = i;
+            break;
+        }
+    }
+    if (si < 0 || sh[si].sh_link >= eh.e_shnum) {
+        added = 0; // stripped
+        goto out;
+    }
+    const elf32_shdr_t *ss = &sh[si], *st = &sh[ss->sh_link];
+    syms = malloc(ss->sh_size);
+    strtab = malloc(st->sh_size + 1);
+    if (!syms || !strtab || read_at(fd, ss->sh_offset, syms, ss->sh_size) ||
+        read_at(fd, st->sh_offset, strtab, st->sh_size))
+        goto out;
+    strtab[st->sh_size] = '\0';
+
+    added = 0;
+    unsigned int n = ss->sh_size / sizeof(elf32_sym_t);
+    for (unsigned int i = 0; i < n && nfuncs < MAX_FUNCS; i++) {
+        const elf32_sym_t *s = &syms[i];
+        if ((s->st_info & 0xF) != ELF_STT_FUNC || !s->st_value ||
+            s->st_name >= st->sh_size)
+            continue;
+        func_t *f = &funcs[nfuncs++];
+        f->addr = s->st_value;
+        f->size = s->st_size;
+        f->name = strtab + s->st_name;
+        f->kernel = kernel;
+        added++;
+    }
+    strtab = 0; // names stay referenced by funcs[]
+
+out:
+    free(strtab);
+    free(syms);
+    free(sh);
+    close(fd);
+    return added;
+}
+
+static int by_addr(const void *a, const void *b) {
+    unsigned int x = ((const func_t *)a)->addr, y = ((const func_t *)b)->addr;
+    return x < y ? -1 : x > y;
+}
+
+// Index of the function containing addr
+static int lookup(unsigned int addr) {
+    int lo = 0, hi = nfuncs - 1, best = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (funcs[mid].addr <= addr) {
+            best = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    int kernel = addr >= KERNEL_BASE;
+    if (best < 0 || funcs[best].kernel != kernel ||
+        (funcs[best].size && addr >= funcs[best].addr + funcs[best].size))
+        return kernel ? unknown_kernel : unknown_user;
+    return best;
+}
+
+static void add_arc(int caller, int callee) {
+    unsigned int h = ((unsigned int)caller * 31u + (unsigned int)callee) &
+                     (ARC_SLOTS - 1);
+    for (int probe = 0; probe < ARC_SLOTS; probe++) {
+        arc_t *a = &arcs[(h + probe) & (ARC_SLOTS - 1)];
+        if (a->count && (a->caller != caller || a->callee != callee))
+            continue;
+        a->caller = caller;
+        a->callee = callee;
+        a->count++;
+        return;
+    }
+}
+
+static void account(const prof_sample_t *s) {
+    int chain[PROF_STACK_DEPTH + 1];
+    int n = 0;
+    chain[n++] = lookup(s->eip);
+    for (int i = 0; i < s->depth && i < PROF_STACK_DEPTH; i++)
+        chain[n++] = lookup(s->stack[i] - 1); // inside the call insn
+
+    funcs[chain[0]].self++;
+    for (int i = 0; i < n; i++) {
+        int seen = 0;
+        for (int j = 0; j < i; j++)
+            seen |= chain[j] == chain[i];
+        if (!seen)
+            funcs[chain[i]].total++; // recursion counts once
+        if (i > 0)
+            add_arc(chain[i], chain[i - 1]);
+    }
+}
+
+static void print_name(int fi) {
+    if (funcs[fi].kernel)
+        print("[k] ");
+    print(funcs[fi].name);
+}
+
+// "12.3" for part/whole
+static void print_pct(unsigned int part, unsigned int whole) {
+    unsigned int t = whole ? part * 1000u / whole : 0;
+    if (t < 1000)
+        print(" ");
+    if (t < 100)
+        print(" ");
+    print_num((int)(t / 10));
+    print(".");
+    print_num((int)(t % 10));
+}
+
+static void print_count(unsigned int v, int width) {
+    char buf[12];
+    itoa((int)v, buf);
+    for (int pad = width - (int)strlen(buf); pad > 0; pad--)
+        print(" ");
+    print(buf);
+}
+
+static unsigned int func_key(int fi, int by_total) {
+    return by_total ? funcs[fi].total : funcs[fi].self;
+}
+
+// Indices of the funcs with the largest key, biggest first
+static int top_funcs(int *out, int max, int by_total) {
+    int n = 0;
+    for (int i = 0; i < nfuncs + 2; i++) {
+        unsigned int v = func_key(i, by_total);
+        if (!v)
+            continue;
+        int pos;
+        if (n < max)
+            pos = n++;
+        else if (v <= func_key(out[max - 1], by_total))
+            continue;
+        else
+            pos = max - 1;
+        for (; pos > 0 && func_key(out[pos - 1], by_total) < v; pos--)
+            out[pos] = out[pos - 1];
+        out[pos] = i;
+    }
+    return n;
+}
+
+static void print_arcs(int fi, int callers) {
+    int best[GRAPH_ARCS];
+    int n = 0;
+    for (int i = 0; i < ARC_SLOTS; i++) {
+        const arc_t *a = &arcs[i];
+        if (!a->count || (callers ? a->callee : a->caller) != fi)
+            continue;
+        int pos;
+        if (n < GRAPH_ARCS)
+            pos = n++;
+        else if (a->count <= arcs[best[GRAPH_ARCS - 1]].count)
+            continue;
+        else
+            pos = GRAPH_ARCS - 1;
+        for (; pos > 0 && arcs[best[pos - 1]].count < a->count; pos--)
+            best[pos] = best[pos - 1];
+        best[pos] = i;
+    }
+    for (int i = 0; i < n; i++) {
+        const arc_t *a = &arcs[best[i]];
+        print(callers ? "      <- " : "      -> ");
+        print_count(a->count, 6);
+        print("  ");
+        print_name(callers ? a->caller : a->callee);
+        print("\n");
+    }
+}
+
+static void report(unsigned int samples) {
+    int top[FLAT_ROWS];
+    int n = top_funcs(top, FLAT_ROWS, 0);
+    print("\nFlat profile:\n  self%  total%  samples  function\n");
+    for (int i = 0; i < n; i++) {
+        func_t *f = &funcs[top[i]];
+        print(" ");
+        print_pct(f->self, samples);
+        print("  ");
+        print_pct(f->total, samples);
+        print("  ");
+        print_count(f->self, 7);
+        print("  ");
+        print_name(top[i]);
+        print("\n");
+    }
+
+    n = top_funcs(top, GRAPH_ROWS, 1);
+    print("\nCall graph (by inclusive samples; <- callers, -> callees):\n");
+    for (int i = 0; i < n; i++) {
+        func_t *f = &funcs[top[i]];
+        print_pct(f->total, samples);
+        print("%  ");
+        print_name(top[i]);
+        print("\n");
+        print_arcs(top[i], 1);
+        print_arcs(top[i], 0);
+    }
+}
+
+static int prof_ctl(const char *cmd) {
+    int fd = open(PROF_FILE, O_WRONLY);
+    if (fd < 0)
+        return -1;
+    int r = fd_write(fd, cmd, 1);
+    close(fd);
+    return r == 1 ? 0 : -1;
+}
+
+// Whole /mos/kprof snapshot in a malloc'd buffer
+static prof_header_t *read_samples(void) {
+    int fd = open(PROF_FILE, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    prof_header_t hdr;
+    prof_header_t *all = 0;
+    if (read_at(fd, 0, &hdr, sizeof(hdr)) == 0 && hdr.magic == PROF_MAGIC &&
+        hdr.sample_size == sizeof(prof_sample_t)) {
+        unsigned int len = sizeof(hdr) + hdr.count * sizeof(prof_sample_t);
+        all = malloc(len);
+        if (all && read_at(fd, 0, all, len) != 0) {
+            free(all);
+            all = 0;
+        }
+    }
+    close(fd);
+    return all;
+}
+
+// "foo" runs bin/foo.elf, like the shell; anything with a '/' or an
+// extension is used as given
+static const char *resolve(const char *cmd) {
+    for (const char *p = cmd; *p; p++) {
+        if (*p == '/' || *p == '.')
+            return cmd;
+    }
+    strcpy(progname, "bin/");
+    strncpy(progname + 4, cmd, sizeof(progname) - 9);
+    progname[sizeof(progname) - 5] = '\0';
+    strcat(progname, ".elf");
+    return progname;
+}
+
+void _start(int argc, char **argv) {
+    if (argc < 2) {
+        print("usage: prof <prog> [args...]\n");
+        exit(1);
+    }
+
+    const char *path = resolve(argv[1]);
+    argv[1] = (char *)path;
+    if (prof_ctl("1") != 0) {
+        print("prof: cannot start sampling (" PROF_FILE ")\n");
+        exit(1);
+    }
+    int child = spawn_argv(path, (const char **)&argv[1], argc - 1);
+    if (child < 0) {
+        prof_ctl("0");
+        print("prof: cannot run ");
+        print(path);
+        print("\n");
+        exit(1);
+    }
+    int code = wait(child);
+    prof_ctl("0");
+
+    prof_header_t *hdr = read_samples();
+    if (!hdr) {
+        print("prof: cannot read " PROF_FILE "\n");
+        exit(1);
+    }
+
+    int nu = load_symbols(path, 0);
+    int nk = load_symbols(KERNEL_IMAGE, 1);
+    qsort(funcs, (size_t)nfuncs, sizeof(func_t), by_addr);
+    unknown_user = nfuncs;
+    unknown_kernel = nfuncs + 1;
+    funcs[unknown_user].name = "[unknown]";
+    funcs[unknown_kernel].name = "[unknown]";
+    funcs[unknown_kernel].kernel = 1;
+
+    const prof_sample_t *s = (const prof_sample_t *)(hdr + 1);
+    unsigned int mine = 0, in_kernel = 0;
+    for (unsigned int i = 0; i < hdr->count; i++) {
+        if (s[i].pid != (unsigned short)child)
+            continue;
+        account(&s[i]);
+        mine++;
+        if (s[i].ring == 0)
+            in_kernel++;
+    }
+
+    print("prof: ");
+    print(path);
+    print(" exited with ");
+    print_num(code);
+    print("\n  ");
+    print_num((int)mine);
+    print(" samples at ");
+    print_num((int)hdr->hz);
+    print(" Hz (");
+    print_num((int)in_kernel);
+    print(" in kernel), ");
+    print_num((int)hdr->dropped);
+    print(" dropped, ");
+    print_num(nu < 0 ? 0 : nu);
+    print(" user / ");
+    print_num(nk < 0 ? 0 : nk);
+    print(" kernel symbols\n");
+    if (nk < 0)
+        print("  (no " KERNEL_IMAGE ": kernel samples show as [k] [unknown])\n");
+    if (mine)
+        report(mine);
+    exit(0);
+}
@@ -0,0 +1,175 @@
+#include "libc.h"
+#include "syscalls.h"
+
+// strace <prog> [args...] - run prog and print each syscall it makes:
+//
+//     name(arg1, arg2, arg3) = ret <cycles>
+//
+// Tracing starts once the child has been spawned, so the first few calls of
+// a very short-lived program can be missed. Events the kernel had to drop
+// because we fell behind are reported as a gap.
+
+#define EVENT_BATCH 32
+#define POLL_MS 10
+
+static const char *const names[] = {
+    [SYS_WRITE] = "write",
+    [SYS_EXIT] = "exit",
+    [SYS_YIELD] = "yield",
+    [4] = "exec",
+    [SYS_GFX_INIT] = "gfx_init",
+    [SYS_GFX_EXIT] = "gfx_exit",
+    [SYS_GETKEY] = "getkey",
+    [SYS_SPAWN] = "spawn",
+    [SYS_WAIT] = "wait",
+    [SYS_READDIR] = "readdir",
+    [SYS_GETPID] = "getpid",
+    [SYS_TASKINFO] = "taskinfo",
+    [SYS_SHUTDOWN] = "shutdown",
+    [SYS_WIN_CREATE] = "win_create",
+    [SYS_WIN_DESTROY] = "win_destroy",
+    [SYS_WIN_WRITE] = "win_write",
+    [SYS_WIN_READ] = "win_read",
+    [SYS_WIN_GETKEY] = "win_getkey",
+    [SYS_WIN_SENDKEY] = "win_sendkey",
+    [SYS_WIN_LIST] = "win_list",
+    [SYS_GFX_INFO] = "gfx_info",
+    [SYS_TASKLIST] = "tasklist",
+    [SYS_WAIT_NB] = "wait_nb",
+    [SYS_PING] = "ping",
+    [SYS_NETCFG] = "netcfg",
+    [SYS_NETGET] = "netget",
+    [SYS_SLEEPMS] = "sleep_ms",
+    [SYS_SOCK_LISTEN] = "sock_listen",
+    [SYS_SOCK_ACCEPT] = "sock_accept",
+    [SYS_SOCK_SEND] = "sock_send",
+    [SYS_SOCK_RECV] = "sock_recv",
+    [SYS_SOCK_CLOSE] = "sock_close",
+    [SYS_WIN_READ_TEXT] = "win_read_text",
+    [SYS_WIN_SET_STDOUT] = "win_set_stdout",
+    [SYS_GETMOUSE] = "getmouse",
+    [SYS_OPEN] = "open",
+    [SYS_FREAD] = "fread",
+    [SYS_FWRITE] = "fwrite",
+    [SYS_CLOSE] = "close",
+    [SYS_SEEK] = "seek",
+    [SYS_STAT] = "stat",
+    [SYS_DETACH] = "detach",
+    [SYS_UNLINK] = "unlink",
+    [SYS_KILL] = "kill",
+    [SYS_GETTICKS] = "getticks",
+    [SYS_MKDIR] = "mkdir",
+    [SYS_CHDIR] = "chdir",
+    [SYS_GETCWD] = "getcwd",
+    [SYS_RMDIR] = "rmdir",
+    [SYS_NETSTATS] = "netstats",
+    [SYS_SBRK] = "sbrk",
+    [SYS_DEBUG_EXIT] = "debug_exit",
+    [SYS_RENAME] = "rename",
+    [SYS_FTRUNCATE] = "ftruncate",
+    [SYS_PIPE_CREATE] = "pipe_create",
+    [SYS_PIPE_DESTROY] = "pipe_destroy",
+    [SYS_OPENDIR] = "opendir",
+    [SYS_GETDENTS] = "getdents",
+    [SYS_POLL] = "poll",
+    [SYS_SOCK_SETOPT] = "sock_setopt",
+    [SYS_SOCK_CONNECT] = "sock_connect",
+    [SYS_UDP_BIND] = "udp_bind",
+    [SYS_SOCK_SENDMSGS] = "sock_sendmsgs",
+    [SYS_SOCK_RECVMSGS] = "sock_recvmsgs",
+    [SYS_SENDFILE] = "sendfile",
+    [SYS_NETBENCH] = "netbench",
+    [SYS_SYSENTER] = "sysenter",
+    [SYS_RING_ENTER] = "ring_enter",
+    [SYS_STRACE] = "strace",
+    [SYS_STRACE_READ] = "strace_read",
+};
+
+static strace_event_t events[EVENT_BATCH];
+static unsigned int next_seq;
+static char progname[64];
+
+static void print_event(const strace_event_t *e) {
+    if (e->seq != next_seq) {
+        print("--- ");
+        print_num((int)(e->seq - next_seq));
+        print(" events dropped ---\n");
+    }
+    next_seq = e->seq + 1;
+
+    if (e->nr < sizeof(names) / sizeof(names[0]) && names[e->nr])
+        print(names[e->nr]);
+    else {
+        print("syscall_");
+        print_num((int)e->nr);
+    }
+    print("(");
+    for (int i = 0; i < 3; i++) {
+        if (i)
+            print(", ");
+        print_hex(e->args[i]);
+    }
+    print(") = ");
+    print_num(e->ret);
+    print(" <");
+    print_num((int)e->cycles);
+    print(">\n");
+}
+
+static int drain(int pid) {
+    int n;
+    while ((n = strace_read(pid, events, EVENT_BATCH)) > 0) {
+        for (int i = 0; i < n; i++)
+            print_event(&events[i]);
+    }
+    return n;
+}
+
+// "foo" runs bin/foo.elf, like the shell; anything with a '/' or an
+// extension is used as given
+static const char *resolve(const char *cmd) {
+    for (const char *p = cmd; *p; p++) {
+        if (*p == '/' || *p == '.')
+            return cmd;
+    }
+    strcpy(progname, "bin/");
+    strncpy(progname + 4, cmd, sizeof(progname) - 9);
+    progname[sizeof(progname) - 5] = '\0';
+    strcat(progname, ".elf");
+    return progname;
+}
+
+void _start(int argc, char **argv) {
+    if (argc < 2) {
+        print("usage: strace <prog> [args...]\n");
+        exit(1);
+    }
+
+    const char *path = resolve(argv[1]);
+    argv[1] = (char *)path;
+    int child = spawn_argv(path, (const char **)&argv[1], argc - 1);
+    if (child < 0) {
+        print("strace: cannot run ");
+        print(path);
+        print("\n");
+        exit(1);
+    }
+    if (strace(child, 1) != 0) {
+        print("strace: no free trace slot\n");
+        wait(child);
+        exit(1);
+    }
+
+    int code;
+    while ((code = wait_nb(child)) == -1) {
+        drain(child);
+        sleep_ms(POLL_MS);
+    }
+    drain(child);
+    strace(child, 0);
+
+    print("+++ exited with ");
+    print_num(code);
+    print(" +++\n");
+    exit(0);
+}
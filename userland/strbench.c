@@ -0,0 +1,205 @@
+#include <stdio.h>
+
+#include "libc.h"
+#include "syscalls.h"
+
+// strbench - throughput of the libc string and memory routines per size
+// class, next to the plain byte loops they replaced.
+//
+// Started as the boot program (autorun=strbench, so no argv) it runs as the
+// `make libc-bench` benchmark and powers off afterwards.
+
+// Each case moves about this many bytes, so the small sizes loop many times
+#define BENCH_BYTES (4u * 1024 * 1024)
+#define BENCH_MAX_SIZE (64u * 1024)
+
+enum { OP_MEMCPY, OP_MEMSET, OP_MEMMOVE, OP_MEMCMP, OP_STRLEN, OP_STRCHR,
+       OP_STRCMP, OP_COUNT };
+
+static const char *const op_names[OP_COUNT] = {
+    "memcpy", "memset", "memmove", "memcmp", "strlen", "strchr", "strcmp",
+};
+
+static const unsigned int sizes[] = {16, 256, 4096, BENCH_MAX_SIZE};
+
+// Room for the memmove overlap and the misaligned source
+static unsigned char buf_a[BENCH_MAX_SIZE + 16];
+static unsigned char buf_b[BENCH_MAX_SIZE + 16];
+static volatile unsigned int sink;
+
+static unsigned long long rdtsc64(void) {
+    unsigned int lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+// 64/32 divide with divl (no libgcc here); saturates
+static unsigned int div64_32(unsigned long long n, unsigned int d) {
+    unsigned int hi = (unsigned int)(n >> 32), lo = (unsigned int)n;
+    if (!d || hi >= d)
+        return 0xFFFFFFFFu;
+    unsigned int q;
+    __asm__("divl %2" : "=a"(q), "+d"(hi) : "rm"(d), "a"(lo));
+    return q;
+}
+
+// The pre-optimisation byte loops. Keep gcc from turning them back into
+// calls to the routines under test.
+#define BYTE_LOOP                                                              \
+    __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+
+static BYTE_LOOP void byte_copy(unsigned char *d, const unsigned char *s,
+                                unsigned int n) {
+    for (unsigned int i = 0; i < n; i++)
+        d[i] = s[i];
+}
+
+static BYTE_LOOP void byte_move_back(unsigned char *d, const unsigned char *s,
+                                     unsigned int n) {
+    for (unsigned int i = n; i > 0; i--)
+        d[i - 1] = s[i - 1];
+}
+
+static BYTE_LOOP void byte_set(unsigned char *d, int c, unsigned int n) {
+    for (unsigned int i = 0; i < n; i++)
+        d[i] = (unsigned char)c;
+}
+
+static BYTE_LOOP int byte_cmp(const unsigned char *a, const unsigned char *b,
+                              unsigned int n) {
+    for (unsigned int i = 0; i < n; i++) {
+        if (a[i] != b[i])
+            return (int)a[i] - (int)b[i];
+    }
+    return 0;
+}
+
+static BYTE_LOOP unsigned int byte_strlen(const char *s) {
+    unsigned int n = 0;
+    while (s[n])
+        n++;
+    return n;
+}
+
+static BYTE_LOOP const char *byte_strchr(const char *s, int c) {
+    while (*s) {
+        if (*s == (char)c)
+            return s;
+        s++;
+    }
+    return c ? 0 : s;
+}
+
+static BYTE_LOOP int byte_strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+static void run_once(int op, int fast, unsigned int size) {
+    unsigned char *a = buf_a, *b = buf_b;
+    switch (op) {
+    case OP_MEMCPY:
+        // Misaligned source, as for most copies out of packed structures
+        if (fast)
+            memcpy(a, b + 1, size);
+        else
+            byte_copy(a, b + 1, size);
+        break;
+    case OP_MEMSET:
+        if (fast)
+            memset(a, 0x5A, size);
+        else
+            byte_set(a, 0x5A, size);
+        break;
+    case OP_MEMMOVE:
+        // Overlapping, destination above the source: the backward path
+        if (fast)
+            memmove(a + 8, a, size);
+        else
+            byte_move_back(a + 8, a, size);
+        break;
+    case OP_MEMCMP:
+        sink = fast ? (unsigned int)memcmp(a, b, size)
+                    : (unsigned int)byte_cmp(a, b, size);
+        break;
+    case OP_STRLEN:
+        sink = fast ? strlen((const char *)a) : byte_strlen((const char *)a);
+        break;
+    case OP_STRCHR:
+        sink = fast ? (unsigned int)strchr((const char *)a, '!')
+                    : (unsigned int)byte_strchr((const char *)a, '!');
+        break;
+    case OP_STRCMP:
+        sink = fast ? (unsigned int)strcmp((const char *)a, (const char *)b)
+                    : (unsigned int)byte_strcmp((const char *)a,
+                                                (const char *)b);
+        break;
+    }
+}
+
+// Equal buffers holding a size-1 character string, reset before each case
+// because memcpy/memset/memmove rewrite buf_a
+static void fill(unsigned int size) {
+    memset(buf_a, 'a', sizeof(buf_a));
+    memset(buf_b, 'a', sizeof(buf_b));
+    buf_a[size - 1] = 0;
+    buf_b[size - 1] = 0;
+}
+
+// MB/s (10^6 bytes) for one routine at one size
+static unsigned int bench(int op, int fast, unsigned int size,
+                          unsigned int tsc_per_ms) {
+    unsigned int iters = BENCH_BYTES / size;
+    fill(size);
+    run_once(op, fast, size); // warm the caches and TLB
+    fill(size);
+    unsigned long long start = rdtsc64();
+    for (unsigned int i = 0; i < iters; i++) {
+        run_once(op, fast, size);
+        __asm__ volatile("" ::: "memory");
+    }
+    unsigned long long cycles = rdtsc64() - start;
+    unsigned int us = div64_32(cycles * 1000, tsc_per_ms);
+    if (!us || us == 0xFFFFFFFFu)
+        return 0;
+    return iters * size / us;
+}
+
+static int run_all(void) {
+    unsigned int start = get_ticks();
+    // Give the kernel's TSC calibration (64 ticks after boot) time to finish
+    while (!vdso()->tsc_per_ms && get_ticks() - start < 200)
+        sleep_ms(10);
+    unsigned int tsc_per_ms = vdso()->tsc_per_ms;
+    if (!tsc_per_ms) {
+        print("strbench: TSC not calibrated\n");
+        return 1;
+    }
+
+    printf("strbench: %u MB per case, TSC %u kHz\n", BENCH_BYTES >> 20,
+           tsc_per_ms);
+    printf("%-8s %6s %10s %10s\n", "routine", "bytes", "libc MB/s",
+           "byte MB/s");
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            unsigned int fast = bench(op, 1, sizes[i], tsc_per_ms);
+            unsigned int slow = bench(op, 0, sizes[i], tsc_per_ms);
+            printf("%-8s %6u %10u %10u\n", op_names[op], sizes[i], fast, slow);
+        }
+    }
+    print("strbench: done\n");
+    return 0;
+}
+
+void _start(int argc, char **argv) {
+    (void)argv;
+    int rc = run_all();
+    if (argc == 0) {
+        debug_exit(rc);
+        shutdown();
+    }
+    exit(rc);
+}
@@ -1,37 +1,71 @@
 #include "syscalls.h"
 
-// Low-level syscall helpers.
-static inline int __syscall0(unsigned int n) {
-    int ret;
-    __asm__ volatile("int $0x80" : "=a"(ret) : "a"(n) : "memory");
-    return ret;
-}
-
-static inline int __syscall1(unsigned int n, unsigned int a1) {
-    int ret;
-    __asm__ volatile("int $0x80" : "=a"(ret) : "a"(n), "b"(a1) : "memory");
-    return ret;
-}
+// Low-level syscall helpers. Two entry paths: SYSENTER when the kernel has
+// set it up (checked on the first call), int 0x80 otherwise.
+static int sc_sysenter = -1; // -1 = not yet checked
 
-static inline int __syscall2(unsigned int n, unsigned int a1, unsigned int a2) {
+static inline int __int80(unsigned int n, unsigned int a1, unsigned int a2,
+                          unsigned int a3) {
     int ret;
     __asm__ volatile("int $0x80"
                      : "=a"(ret)
-                     : "a"(n), "b"(a1), "c"(a2)
+                     : "a"(n), "b"(a1), "c"(a2), "d"(a3)
                      : "memory");
     return ret;
 }
 
-static inline int __syscall3(unsigned int n, unsigned int a1, unsigned int a2,
+// SYSENTER takes args 2-3 in ESI/EDI because ECX/EDX carry the stack
+// pointer and return address; the kernel's SYSEXIT clobbers ECX/EDX.
+static inline int __sysenter(unsigned int n, unsigned int a1, unsigned int a2,
                              unsigned int a3) {
     int ret;
-    __asm__ volatile("int $0x80"
+    __asm__ volatile("movl %%esp, %%ecx\n\t"
+                     "movl $1f, %%edx\n\t"
+                     "sysenter\n"
+                     "1:"
                      : "=a"(ret)
-                     : "a"(n), "b"(a1), "c"(a2), "d"(a3)
-                     : "memory");
+                     : "a"(n), "b"(a1), "S"(a2), "D"(a3)
+                     : "ecx", "edx", "memory", "cc");
     return ret;
 }
 
+static inline int use_sysenter(void) {
+    if (__builtin_expect(sc_sysenter < 0, 0))
+        sc_sysenter = __int80(SYS_SYSENTER, 0, 0, 0) == 1;
+    return sc_sysenter;
+}
+
+static inline int __syscall3(unsigned int n, unsigned int a1, unsigned int a2,
+                             unsigned int a3) {
+    if (use_sysenter())
+        return __sysenter(n, a1, a2, a3);
+    return __int80(n, a1, a2, a3);
+}
+
+static inline int __syscall0(unsigned int n) { return __syscall3(n, 0, 0, 0); }
+
+static inline int __syscall1(unsigned int n, unsigned int a1) {
+    return __syscall3(n, a1, 0, 0);
+}
+
+static inline int __syscall2(unsigned int n, unsigned int a1, unsigned int a2) {
+    return __syscall3(n, a1, a2, 0);
+}
+
+int syscall_raw(unsigned int n, unsigned int a1, unsigned int a2,
+                unsigned int a3) {
+    return __syscall3(n, a1, a2, a3);
+}
+
+int syscall_fast_path(int enable) {
+    if (!enable) {
+        sc_sysenter = 0;
+        return 0;
+    }
+    sc_sysenter = -1;
+    return use_sysenter();
+}
+
 int write(int fd, const void *buf, unsigned int len) {
     return __syscall3(SYS_WRITE, (unsigned int)fd, (unsigned int)buf, len);
 }
@@ -56,7 +90,10 @@ unsigned char getkey(unsigned int flags) {
     return (unsigned char)__syscall1(SYS_GETKEY, flags);
 }
 
-unsigned int gfx_info(void) { return (unsigned int)__syscall0(SYS_GFX_INFO); }
+unsigned int gfx_info(void) {
+    const volatile vdso_data_t *v = vdso();
+    return v ? v->gfx_info : (unsigned int)__syscall0(SYS_GFX_INFO);
+}
 
 int spawn(const char *filename) {
     return __syscall3(SYS_SPAWN, (unsigned int)filename, 0, 0);
@@ -79,7 +116,10 @@ int readdir_path(const char *path, unsigned int index, char *buf) {
                       (unsigned int)buf);
 }
 
-int getpid(void) { return __syscall0(SYS_GETPID); }
+int getpid(void) {
+    const volatile vdso_data_t *v = vdso();
+    return v ? (int)v->pid : __syscall0(SYS_GETPID);
+}
 
 void taskinfo(void) { (void)__syscall0(SYS_TASKINFO); }
 
@@ -138,13 +178,26 @@ int net_get(unsigned int *ip_be, unsigned int *mask_be, unsigned int *gw_be) {
 }
 
 int net_stats(unsigned int *rx_packets, unsigned int *tx_packets) {
-    return __syscall2(SYS_NETSTATS, (unsigned int)rx_packets,
-                      (unsigned int)tx_packets);
+    const volatile vdso_data_t *v = vdso();
+    if (!v || !rx_packets || !tx_packets)
+        return __syscall2(SYS_NETSTATS, (unsigned int)rx_packets,
+                          (unsigned int)tx_packets);
+    unsigned int seq;
+    do {
+        seq = v->seq;
+        *rx_packets = v->rx_packets;
+        *tx_packets = v->tx_packets;
+    } while ((seq & 1) || seq != v->seq);
+    return 0;
 }
 
 int sleep_ms(unsigned int ms) { return __syscall1(SYS_SLEEPMS, ms); }
 
-int sock_listen(unsigned int port) { return __syscall1(SYS_SOCK_LISTEN, port); }
+int sock_listen(unsigned int port) { return sock_listen_backlog(port, 0); }
+
+int sock_listen_backlog(unsigned int port, int backlog) {
+    return __syscall2(SYS_SOCK_LISTEN, port, (unsigned int)backlog);
+}
 
 int sock_accept(int fd) {
     return __syscall1(SYS_SOCK_ACCEPT, (unsigned int)fd);
@@ -160,6 +213,117 @@ int sock_recv(int fd, void *buf, unsigned int len) {
 
 int sock_close(int fd) { return __syscall1(SYS_SOCK_CLOSE, (unsigned int)fd); }
 
+int sock_setopt(int fd, int opt, unsigned int value) {
+    return __syscall3(SYS_SOCK_SETOPT, (unsigned int)fd, (unsigned int)opt,
+                      value);
+}
+
+int sock_connect(unsigned int ip_be, unsigned int port) {
+    return __syscall2(SYS_SOCK_CONNECT, ip_be, port);
+}
+
+int udp_bind(unsigned int port) { return __syscall1(SYS_UDP_BIND, port); }
+
+int sock_sendmmsg(int fd, sock_msg_t *msgs, unsigned int n) {
+    return __syscall3(SYS_SOCK_SENDMSGS, (unsigned int)fd, (unsigned int)msgs,
+                      n);
+}
+
+int sock_recvmmsg(int fd, sock_msg_t *msgs, unsigned int n) {
+    return __syscall3(SYS_SOCK_RECVMSGS, (unsigned int)fd, (unsigned int)msgs,
+                      n);
+}
+
+int sock_sendto(int fd, const void *buf, unsigned int len,
+                unsigned int ip_be, unsigned int port) {
+    sock_msg_t m;
+    m.ip_be = ip_be;
+    m.port = (unsigned short)port;
+    m.len = (unsigned short)len;
+    m.buf = (void *)buf;
+    m.flags = 0;
+    m.pad = 0;
+    int n = sock_sendmmsg(fd, &m, 1);
+    return n == 1 ? (int)len : -1;
+}
+
+int sock_recvfrom(int fd, void *buf, unsigned int len, unsigned int *ip_be,
+                  unsigned int *port) {
+    sock_msg_t m;
+    m.len = (unsigned short)(len > 0xFFFF ? 0xFFFF : len);
+    m.buf = buf;
+    if (sock_recvmmsg(fd, &m, 1) != 1)
+        return -1;
+    if (ip_be)
+        *ip_be = m.ip_be;
+    if (port)
+        *port = m.port;
+    return m.len;
+}
+
+int sendfile(int sock, int fd, int offset, unsigned int len) {
+    if (offset >= 0 && seek(fd, offset, SEEK_SET) != offset)
+        return -1;
+    return __syscall3(SYS_SENDFILE, (unsigned int)sock, (unsigned int)fd, len);
+}
+
+int netbench(int op, unsigned int ip_be, netbench_result_t *out) {
+    return __syscall3(SYS_NETBENCH, (unsigned int)op, ip_be, (unsigned int)out);
+}
+
+int ring_init(ring_t *r, ring_sqe_t *sqes, ring_cqe_t *cqes,
+              unsigned int entries) {
+    if (!entries || entries > RING_MAX_ENTRIES || (entries & (entries - 1)))
+        return -1;
+    r->sq_head = r->sq_tail = 0;
+    r->cq_head = r->cq_tail = 0;
+    r->entries = entries;
+    r->sqes = sqes;
+    r->cqes = cqes;
+    return 0;
+}
+
+ring_sqe_t *ring_get_sqe(ring_t *r) {
+    if (r->sq_tail - r->sq_head >= r->entries)
+        return 0;
+    ring_sqe_t *sqe = &r->sqes[r->sq_tail & (r->entries - 1)];
+    r->sq_tail++;
+    sqe->flags = 0;
+    return sqe;
+}
+
+void ring_prep(ring_sqe_t *sqe, unsigned int op, unsigned int a1,
+               unsigned int a2, unsigned int a3, unsigned int user_data) {
+    sqe->op = op;
+    sqe->args[0] = a1;
+    sqe->args[1] = a2;
+    sqe->args[2] = a3;
+    sqe->user_data = user_data;
+}
+
+int ring_enter(ring_t *r, unsigned int to_submit) {
+    return __syscall2(SYS_RING_ENTER, (unsigned int)r, to_submit);
+}
+
+int strace(int pid, int enable) {
+    return __syscall2(SYS_STRACE, (unsigned int)pid, (unsigned int)enable);
+}
+
+int strace_read(int pid, strace_event_t *ev, int max) {
+    return __syscall3(SYS_STRACE_READ, (unsigned int)pid, (unsigned int)ev,
+                      (unsigned int)max);
+}
+
+int ring_submit(ring_t *r) { return ring_enter(r, r->sq_tail - r->sq_head); }
+
+ring_cqe_t *ring_peek_cqe(ring_t *r) {
+    if (r->cq_head == r->cq_tail)
+        return 0;
+    return &r->cqes[r->cq_head & (r->entries - 1)];
+}
+
+void ring_cqe_seen(ring_t *r) { r->cq_head++; }
+
 int win_read_text(int wid, char *buf, int max_len) {
     return __syscall3(SYS_WIN_READ_TEXT, (unsigned int)wid, (unsigned int)buf,
                       (unsigned int)max_len);
@@ -203,7 +367,47 @@ int unlink(const char *path) {
 
 int kill(int task_id) { return __syscall1(SYS_KILL, (unsigned int)task_id); }
 
-unsigned int get_ticks(void) { return (unsigned int)__syscall0(SYS_GETTICKS); }
+unsigned int get_ticks(void) {
+    const volatile vdso_data_t *v = vdso();
+    return v ? v->ticks : (unsigned int)__syscall0(SYS_GETTICKS);
+}
+
+const volatile vdso_data_t *vdso(void) {
+    const volatile vdso_data_t *v = (const volatile vdso_data_t *)VDSO_VADDR;
+    return v->magic == VDSO_MAGIC ? v : 0;
+}
+
+unsigned int uptime_ms(void) {
+    const volatile vdso_data_t *v = vdso();
+    if (!v)
+        return (unsigned int)__syscall0(SYS_GETTICKS) * 10;
+
+    // Snapshot the tick fields, retrying if a timer tick landed mid-read
+    unsigned int seq, ticks, tsc_lo, per_ms, hz;
+    do {
+        seq = v->seq;
+        ticks = v->ticks;
+        tsc_lo = v->tsc_lo;
+        per_ms = v->tsc_per_ms;
+        hz = v->tick_hz;
+    } while ((seq & 1) || seq != v->seq);
+
+    unsigned int tick_ms = hz ? 1000 / hz : 10;
+    unsigned int ms = ticks * tick_ms;
+    if (per_ms) {
+        unsigned int lo, hi;
+        __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        // Cap below one tick so the result never runs ahead of the next
+        unsigned int extra = (lo - tsc_lo) / per_ms;
+        ms += extra < tick_ms ? extra : tick_ms - 1;
+    }
+    return ms;
+}
+
+unsigned int mem_free_frames(void) {
+    const volatile vdso_data_t *v = vdso();
+    return v ? v->free_frames : 0;
+}
 
 int detach(void) { return __syscall0(SYS_DETACH); }
 
@@ -227,6 +431,19 @@ int ftruncate(int fd, unsigned int length) {
     return __syscall2(SYS_FTRUNCATE, (unsigned int)fd, length);
 }
 
+int opendir(const char *path) {
+    return __syscall1(SYS_OPENDIR, (unsigned int)path);
+}
+
+int getdents(int fd, void *buf, unsigned int size) {
+    return __syscall3(SYS_GETDENTS, (unsigned int)fd, (unsigned int)buf, size);
+}
+
+int poll(pollfd_t *fds, unsigned int nfds, int timeout_ms) {
+    return __syscall3(SYS_POLL, (unsigned int)fds, nfds,
+                      (unsigned int)timeout_ms);
+}
+
 int pipe_create(const char *name) {
     return __syscall1(SYS_PIPE_CREATE, (unsigned int)name);
 }
@@ -57,6 +57,53 @@
 #define SYS_FTRUNCATE    54
 #define SYS_PIPE_CREATE  55
 #define SYS_PIPE_DESTROY 56
+#define SYS_OPENDIR      57
+#define SYS_GETDENTS     58
+#define SYS_POLL         59
+#define SYS_SOCK_SETOPT  60
+#define SYS_SOCK_CONNECT 61
+#define SYS_UDP_BIND     62
+#define SYS_SOCK_SENDMSGS 63
+#define SYS_SOCK_RECVMSGS 64
+#define SYS_SENDFILE 65
+#define SYS_NETBENCH 66
+#define SYS_SYSENTER 67
+#define SYS_RING_ENTER 68
+#define SYS_STRACE 69
+#define SYS_STRACE_READ 70
+
+// Read-only kernel data page mapped into every process (must match kernel's
+// vdso_data_t). get_ticks(), getpid(), gfx_info() and net_stats() read it
+// instead of trapping; the counters are refreshed every timer tick.
+#define VDSO_VADDR 0x003FF000u
+#define VDSO_MAGIC 0x4F534456u
+
+typedef struct {
+    unsigned int magic;
+    unsigned int seq;        // odd while the kernel is updating the tick fields
+    unsigned int ticks;      // 100Hz timer ticks since boot
+    unsigned int tick_hz;
+    unsigned int tsc_lo;     // TSC at the last tick
+    unsigned int tsc_hi;
+    unsigned int tsc_per_ms; // 0 until the kernel has calibrated the TSC
+    unsigned int free_frames; // free physical 4KB frames
+    unsigned int total_frames;
+    unsigned int rx_packets;
+    unsigned int tx_packets;
+    unsigned int pid;        // running task
+    unsigned int gfx_info;
+} vdso_data_t;
+
+// The shared page, or 0 if the kernel has not set it up
+const volatile vdso_data_t *vdso(void);
+// Milliseconds since boot, interpolated between ticks with the TSC
+unsigned int uptime_ms(void);
+// Free physical memory in 4KB frames
+unsigned int mem_free_frames(void);
+
+// Raw syscall (eax=n, args in ebx/ecx/edx); always traps into the kernel
+int syscall_raw(unsigned int n, unsigned int a1, unsigned int a2,
+                unsigned int a3);
 
 // Syscall wrappers
 int write(int fd, const void *buf, unsigned int len);
@@ -120,12 +167,137 @@ int net_stats(unsigned int *rx_packets, unsigned int *tx_packets);
 int sleep_ms(unsigned int ms);
 
 // TCP socket syscalls
+// sock_listen_backlog queues up to backlog established connections for
+// sock_accept (0 = kernel default of 8, max 32).
 int sock_listen(unsigned int port);
+int sock_listen_backlog(unsigned int port, int backlog);
 int sock_accept(int fd);
 int sock_send(int fd, const void *buf, unsigned int len);
 int sock_recv(int fd, void *buf, unsigned int len);
 int sock_close(int fd);
 
+// Per-socket buffer sizes in bytes (inherited from a listener by accepted
+// sockets). The kernel clamps RCVBUF to [TCP window + 1, 64K] and SNDBUF
+// to [MSS, stack send buffer].
+#define SOCK_OPT_RCVBUF 1
+#define SOCK_OPT_SNDBUF 2
+int sock_setopt(int fd, int opt, unsigned int value);
+
+// Outbound TCP: returns an fd immediately while the handshake runs. Poll
+// for POLLOUT (connected) or POLLERR/POLLHUP (failed) before sending.
+int sock_connect(unsigned int ip_be, unsigned int port);
+
+// UDP sockets (must match kernel's sock_msg_t). udp_bind(0) picks an
+// ephemeral port. sock_sendmmsg/sock_recvmmsg move up to n (max 64)
+// datagrams of at most 1472 bytes in one call and return how many were
+// moved; recv returns -1 when nothing is queued. On receive, len is the
+// buffer size in and the bytes stored out.
+#define SOCK_MSG_TRUNC 0x1
+
+typedef struct {
+    unsigned int ip_be;
+    unsigned short port;
+    unsigned short len;
+    void *buf;
+    unsigned short flags;
+    unsigned short pad;
+} sock_msg_t;
+
+int udp_bind(unsigned int port);
+int sock_sendmmsg(int fd, sock_msg_t *msgs, unsigned int n);
+int sock_recvmmsg(int fd, sock_msg_t *msgs, unsigned int n);
+int sock_sendto(int fd, const void *buf, unsigned int len,
+                unsigned int ip_be, unsigned int port);
+int sock_recvfrom(int fd, void *buf, unsigned int len, unsigned int *ip_be,
+                  unsigned int *port);
+
+// Send up to len bytes of an open file over a TCP socket without copying
+// them through userland, starting at offset (-1 = current position). The
+// file position ends just past the bytes sent. Blocks while the socket's
+// send buffer is full; returns bytes sent (0 at EOF) or -1.
+int sendfile(int sock, int fd, int offset, unsigned int len);
+
+// In-kernel iperf 2 compatible TCP test (lwiperf), must match the kernel's
+// netbench_result_t. NETBENCH_SERVER listens on port 5001;
+// NETBENCH_CLIENT runs a 10s send test to ip_be (0 = 127.0.0.1) and
+// blocks until it finishes. Returns 0 on success.
+#define NETBENCH_SERVER 0
+#define NETBENCH_CLIENT 1
+
+typedef struct {
+    unsigned int bytes;
+    unsigned int ms;
+    unsigned int kbps;
+    int status; // 0 = completed, -1 = aborted
+} netbench_result_t;
+
+int netbench(int op, unsigned int ip_be, netbench_result_t *out);
+
+// Batched syscalls (must match the kernel's ring_t). Queue entries with
+// ring_get_sqe() + ring_prep(), run them all with ring_submit() (one trap),
+// then drain results with ring_peek_cqe() / ring_cqe_seen(). Entries run in
+// order; file, pipe and socket syscalls are accepted, anything else
+// completes with -1. RING_F_LINK makes the next entry complete with -1
+// unless this one succeeded (>= 0, and a full transfer for reads/writes).
+#define RING_MAX_ENTRIES 256
+#define RING_F_LINK 0x1
+
+typedef struct {
+    unsigned int op; // SYS_* number
+    unsigned int args[3];
+    unsigned int user_data;
+    unsigned int flags;
+} ring_sqe_t;
+
+typedef struct {
+    unsigned int user_data;
+    int res;
+} ring_cqe_t;
+
+typedef struct {
+    unsigned int sq_head;
+    unsigned int sq_tail;
+    unsigned int cq_head;
+    unsigned int cq_tail;
+    unsigned int entries; // power of two
+    ring_sqe_t *sqes;
+    ring_cqe_t *cqes;
+} ring_t;
+
+int ring_init(ring_t *r, ring_sqe_t *sqes, ring_cqe_t *cqes,
+              unsigned int entries);
+// Next free submission slot, or 0 if the queue is full
+ring_sqe_t *ring_get_sqe(ring_t *r);
+void ring_prep(ring_sqe_t *sqe, unsigned int op, unsigned int a1,
+               unsigned int a2, unsigned int a3, unsigned int user_data);
+// Run everything queued; returns the number of entries consumed
+int ring_submit(ring_t *r);
+int ring_enter(ring_t *r, unsigned int to_submit);
+// Oldest unread completion, or 0 if there is none
+ring_cqe_t *ring_peek_cqe(ring_t *r);
+void ring_cqe_seen(ring_t *r);
+
+// strace: the kernel queues every completed syscall of a traced pid (up to
+// 256 unread). seq counts all of the task's syscalls, so a gap between two
+// events means the queue overflowed and events were dropped.
+typedef struct {
+    unsigned int seq;
+    unsigned int nr; // SYS_* number
+    unsigned int args[3];
+    int ret;
+    unsigned int cycles; // TSC cycles spent in the kernel
+} strace_event_t;
+
+// Start (enable=1) or stop tracing pid; 0 on success, -1 if no slot is free
+int strace(int pid, int enable);
+// Take up to max queued events; returns the count or -1 if pid isn't traced
+int strace_read(int pid, strace_event_t *ev, int max);
+
+// Syscalls enter the kernel with SYSENTER when the CPU and kernel support
+// it, else with int 0x80. syscall_fast_path(0) forces int 0x80,
+// syscall_fast_path(1) re-enables SYSENTER; returns 1 if it is in use.
+int syscall_fast_path(int enable);
+
 // Window stdout redirection
 int win_read_text(int wid, char *buf, int max_len);
 int win_set_stdout(int wid);
@@ -175,6 +347,45 @@ int debug_exit(int code);
 int rename(const char *oldpath, const char *newpath);
 int ftruncate(int fd, unsigned int length);
 
+// Directory entry record filled by getdents (must match kernel's
+// vfs_dirent_t). Records are packed; advance by reclen.
+typedef struct {
+    unsigned int size;
+    unsigned short reclen;
+    unsigned char type;    // 0=file, 1=dir
+    unsigned char namelen;
+    char name[];           // NUL-terminated
+} dirent_t;
+
+// Directory streams: opendir(NULL) lists the cwd. getdents returns bytes
+// of whole records, 0 at the end, -1 if buf can't hold the next record.
+// seek(fd, 0, SEEK_SET) rewinds; close() releases the fd.
+int opendir(const char *path);
+int getdents(int fd, void *buf, unsigned int size);
+
+// Readiness polling (must match kernel's pollfd_t). fd is a VFS fd, socket
+// fd or window id depending on kind. Blocks until an entry is ready or
+// timeout_ms passes (-1 = forever, 0 = don't block); returns the number of
+// entries with revents set, 0 on timeout, -1 on error.
+#define POLL_KIND_FILE 0
+#define POLL_KIND_SOCK 1
+#define POLL_KIND_WIN  2
+#define POLLIN   0x1
+#define POLLOUT  0x2
+#define POLLERR  0x8
+#define POLLHUP  0x10
+#define POLLNVAL 0x20
+
+typedef struct {
+    int fd;
+    unsigned short kind;
+    unsigned short events;
+    unsigned short revents;
+    unsigned short pad;
+} pollfd_t;
+
+int poll(pollfd_t *fds, unsigned int nfds, int timeout_ms);
+
 // Named kernel pipe syscalls (/pipe/<name>)
 // pipe_create: create a named pipe that persists until pipe_destroy
 // pipe_destroy: destroy named pipe (wakes blocked readers/writers)
@@ -2010,12 +2010,13 @@ static int test_free(void) {
     if (matched != 8) { print("  FAIL: not all blocks reused from free list\n\n"); return 0; }
     print("  - 8 blocks freed and reused: OK\n");
 
-    // Smaller malloc after free of larger block must also reuse (fits within capacity)
-    void *big = malloc(128);
-    if (!big) { print("  FAIL: malloc 128\n\n"); return 0; }
+    // Smaller malloc after free of larger block must also reuse it (split).
+    // Both sizes are above the small-object cache, which reuses exact sizes.
+    void *big = malloc(1024);
+    if (!big) { print("  FAIL: malloc 1024\n\n"); return 0; }
     free(big);
-    void *small = malloc(32);
-    if (!small) { print("  FAIL: malloc 32 after free 128\n\n"); return 0; }
+    void *small = malloc(512);
+    if (!small) { print("  FAIL: malloc 512 after free 1024\n\n"); return 0; }
     if (small != big) { print("  FAIL: smaller alloc didn't reuse larger freed block\n\n"); return 0; }
     free(small);
     print("  - small alloc reuses larger freed block: OK\n");
@@ -2535,6 +2536,58 @@ static int test_string_funcs(void) {
     if (!zeroed) { print("  FAIL: calloc not zeroed\n\n"); return 0; }
     print("  - calloc zeroed: OK\n");
 
+    // Word-at-a-time paths: every alignment and lengths across the head,
+    // dword body and tail, against byte-by-byte expectations
+    static unsigned char sa[96], sb[96];
+    for (int off = 0; off < 4; off++) {
+        for (int n = 0; n < 40; n++) {
+            for (int i = 0; i < 96; i++) {
+                sa[i] = (unsigned char)('a' + i % 23);
+                sb[i] = 0xEE;
+            }
+            memcpy(sb + off, sa + 3, n);
+            for (int i = 0; i < 96; i++) {
+                unsigned char want = (i >= off && i < off + n)
+                                         ? sa[3 + i - off] : 0xEE;
+                if (sb[i] != want) { print("  FAIL: memcpy sweep\n\n"); return 0; }
+            }
+            memset(sb + off, 0x11, n);
+            for (int i = off; i < off + n; i++)
+                if (sb[i] != 0x11) { print("  FAIL: memset sweep\n\n"); return 0; }
+            if (sb[off + n] != 0xEE) { print("  FAIL: memset overrun\n\n"); return 0; }
+            memmove(sa + off + 5, sa + off, n);
+            for (int i = 0; i < n; i++)
+                if (sa[off + 5 + i] != (unsigned char)('a' + (off + i) % 23)) {
+                    print("  FAIL: memmove sweep\n\n"); return 0;
+                }
+
+            for (int i = 0; i < 96; i++)
+                sa[i] = sb[i] = (unsigned char)('a' + i % 23);
+            sa[off + n] = sb[off + n] = 0;
+            if (strlen((char *)sa + off) != (size_t)n) { print("  FAIL: strlen sweep\n\n"); return 0; }
+            if (strcmp((char *)sa + off, (char *)sb + off) != 0 ||
+                memcmp(sa + off, sb + off, n) != 0) {
+                print("  FAIL: strcmp/memcmp equal sweep\n\n"); return 0;
+            }
+            if (strchr((char *)sa + off, 0) != (char *)sa + off + n ||
+                strchr((char *)sa + off, 'Z') != 0) {
+                print("  FAIL: strchr sweep\n\n"); return 0;
+            }
+            if (n > 0) {
+                sb[off + n - 1] = 'z' + 1;
+                if (strcmp((char *)sa + off, (char *)sb + off) >= 0 ||
+                    memcmp(sa + off, sb + off, n) >= 0) {
+                    print("  FAIL: strcmp/memcmp order sweep\n\n"); return 0;
+                }
+                sa[off + n - 1] = '!';
+                if (strchr((char *)sa + off, '!') != (char *)sa + off + n - 1) {
+                    print("  FAIL: strchr find sweep\n\n"); return 0;
+                }
+            }
+        }
+    }
+    print("  - alignment/length sweep: OK\n");
+
     print("  PASSED\n\n");
     return 1;
 }
@@ -2635,6 +2688,1388 @@ static int test_named_pipes(void) {
     return 1;
 }
 
+static unsigned char bigfile_buf[40000];
+
+static unsigned char bigfile_byte(unsigned int off) {
+    return (unsigned char)((off * 7u) ^ (off >> 9));
+}
+
+static int test_large_file_seek(void) {
+    print("TEST 56: large file seek/append\n");
+
+    for (unsigned int i = 0; i < sizeof(bigfile_buf); i++)
+        bigfile_buf[i] = bigfile_byte(i);
+
+    // Write in odd-sized chunks so writes straddle sectors and clusters
+    int fd = open("_big.tmp", O_CREAT | O_RDWR | O_TRUNC);
+    if (fd < 0) { print("  FAIL: create\n\n"); return 0; }
+    unsigned int done = 0;
+    while (done < 30000) {
+        unsigned int n = 3001;
+        if (n > 30000 - done) n = 30000 - done;
+        if (fd_write(fd, bigfile_buf + done, n) != (int)n) {
+            print("  FAIL: chunked write\n\n"); close(fd); unlink("_big.tmp"); return 0;
+        }
+        done += n;
+    }
+    close(fd);
+
+    // Append the rest in small pieces
+    fd = open("_big.tmp", O_WRONLY | O_APPEND);
+    while (done < sizeof(bigfile_buf)) {
+        unsigned int n = 97;
+        if (n > sizeof(bigfile_buf) - done) n = sizeof(bigfile_buf) - done;
+        if (fd_write(fd, bigfile_buf + done, n) != (int)n) {
+            print("  FAIL: append\n\n"); close(fd); unlink("_big.tmp"); return 0;
+        }
+        done += n;
+    }
+    close(fd);
+
+    stat_t st;
+    if (stat("_big.tmp", &st) != 0 || st.size != sizeof(bigfile_buf)) {
+        print("  FAIL: size after append\n\n"); unlink("_big.tmp"); return 0;
+    }
+    print("  - chunked write + append: OK\n");
+
+    // Random-offset reads, backwards and forwards
+    static const unsigned int offs[] = { 39000, 511, 20480, 12345, 0, 33333, 4097 };
+    fd = open("_big.tmp", O_RDONLY);
+    for (unsigned int k = 0; k < sizeof(offs) / sizeof(offs[0]); k++) {
+        unsigned char rb[700];
+        if (seek(fd, (int)offs[k], SEEK_SET) != (int)offs[k]) {
+            print("  FAIL: seek\n\n"); close(fd); unlink("_big.tmp"); return 0;
+        }
+        int n = fd_read(fd, rb, sizeof(rb));
+        int want = (int)sizeof(rb);
+        if (offs[k] + sizeof(rb) > sizeof(bigfile_buf))
+            want = (int)(sizeof(bigfile_buf) - offs[k]);
+        if (n != want) {
+            print("  FAIL: short read\n\n"); close(fd); unlink("_big.tmp"); return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (rb[i] != bigfile_byte(offs[k] + (unsigned int)i)) {
+                print("  FAIL: content mismatch\n\n"); close(fd); unlink("_big.tmp"); return 0;
+            }
+        }
+    }
+    close(fd);
+    print("  - random-offset reads: OK\n");
+
+    unlink("_big.tmp");
+    print("  PASSED\n\n");
+    return 1;
+}
+
+// ============================================================
+// Test 57: FAT32 data disk (/data) — skipped when not attached
+// ============================================================
+static int test_fat32_data(void) {
+    print("TEST 57: FAT32 data disk\n");
+
+    stat_t st;
+    if (stat("/data", &st) != 0 || st.type != 1) {
+        print("  SKIP: no /data disk (make run DATA=1)\n\n");
+        return 1;
+    }
+
+    if (mkdir("/data/_t32") != 0) {
+        print("  FAIL: mkdir /data/_t32\n\n");
+        return 0;
+    }
+    // Long name forces VFAT entries; large enough to span many clusters
+    const char *name = "/data/_t32/a long file name.bin";
+    int fd = open(name, O_CREAT | O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        print("  FAIL: create\n\n");
+        rmdir("/data/_t32");
+        return 0;
+    }
+    for (unsigned int i = 0; i < sizeof(bigfile_buf); i++)
+        bigfile_buf[i] = bigfile_byte(i);
+    if (fd_write(fd, bigfile_buf, sizeof(bigfile_buf)) != (int)sizeof(bigfile_buf)) {
+        print("  FAIL: write\n\n");
+        close(fd); unlink(name); rmdir("/data/_t32");
+        return 0;
+    }
+    close(fd);
+    print("  - create + write: OK\n");
+
+    if (rename(name, "/data/_t32/moved.bin") != 0) {
+        print("  FAIL: rename\n\n");
+        unlink(name); rmdir("/data/_t32");
+        return 0;
+    }
+    fd = open("/data/_t32/MOVED.BIN", O_RDONLY);
+    if (fd < 0) {
+        print("  FAIL: open after rename\n\n");
+        unlink("/data/_t32/moved.bin"); rmdir("/data/_t32");
+        return 0;
+    }
+    unsigned char rb[500];
+    unsigned int pos = 0;
+    int ok = 1;
+    while (ok) {
+        int n = fd_read(fd, rb, sizeof(rb));
+        if (n <= 0)
+            break;
+        for (int i = 0; i < n; i++)
+            if (rb[i] != bigfile_byte(pos + (unsigned int)i))
+                ok = 0;
+        pos += (unsigned int)n;
+    }
+    close(fd);
+    if (!ok || pos != sizeof(bigfile_buf)) {
+        print("  FAIL: read back\n\n");
+        unlink("/data/_t32/moved.bin"); rmdir("/data/_t32");
+        return 0;
+    }
+    print("  - rename + read back: OK\n");
+
+    if (unlink("/data/_t32/moved.bin") != 0 || rmdir("/data/_t32") != 0) {
+        print("  FAIL: cleanup\n\n");
+        return 0;
+    }
+    print("  - unlink + rmdir: OK\n");
+    print("  PASSED\n\n");
+    return 1;
+}
+
+// ============================================================
+// Test 58: Directory streams (opendir/getdents)
+// ============================================================
+static int name_eq_ci(const char *a, const char *b) {
+    for (; *a && *b; a++, b++) {
+        char ca = (*a >= 'a' && *a <= 'z') ? *a - 32 : *a;
+        char cb = (*b >= 'a' && *b <= 'z') ? *b - 32 : *b;
+        if (ca != cb)
+            return 0;
+    }
+    return *a == *b;
+}
+
+static char dents_buf[4096];
+
+// Count a directory through getdents; remembers the type/size of `want`.
+static int dents_count(const char *path, const char *want, int *type,
+                       unsigned int *size, int *calls) {
+    int fd = opendir(path);
+    if (fd < 0)
+        return -1;
+    int count = 0, n;
+    *calls = 0;
+    while ((n = getdents(fd, dents_buf, sizeof(dents_buf))) > 0) {
+        (*calls)++;
+        for (int off = 0; off < n;) {
+            dirent_t *de = (dirent_t *)(dents_buf + off);
+            if (de->reclen == 0 || (de->reclen & 3) || de->name[de->namelen])
+                return -2;
+            if (want && name_eq_ci(de->name, want)) {
+                *type = de->type;
+                *size = de->size;
+            }
+            off += de->reclen;
+            count++;
+        }
+    }
+    close(fd);
+    return n < 0 ? -3 : count;
+}
+
+static int test_getdents(void) {
+    print("TEST 58: Directory streams (opendir/getdents)\n");
+
+    int type = -1, calls = 0;
+    unsigned int size = 0;
+    int count = dents_count("bin", "test.elf", &type, &size, &calls);
+    int legacy = 0;
+    char name[32];
+    while (legacy < 1024 && readdir_path("bin", legacy, name) > 0)
+        legacy++;
+    stat_t st;
+    if (count <= 0 || count != legacy || type != 0 ||
+        stat("bin/test.elf", &st) != 0 || size != st.size) {
+        print("  FAIL: bin listing count=");
+        print_num(count);
+        print(" readdir=");
+        print_num(legacy);
+        print("\n\n");
+        return 0;
+    }
+    print("  - /bin: ");
+    print_num(count);
+    print(" entries in ");
+    print_num(calls);
+    print(" getdents call(s), matches readdir: OK\n");
+
+    type = -1;
+    if (dents_count("/", "bin", &type, &size, &calls) <= 0 || type != 1) {
+        print("  FAIL: / should list bin as a directory\n\n");
+        return 0;
+    }
+    print("  - / lists bin/ with type dir: OK\n");
+
+    int fd = opendir("bin");
+    if (fd < 0 || getdents(fd, dents_buf, 4) != -1 ||
+        fd_read(fd, dents_buf, 16) != -1) {
+        print("  FAIL: short buffer / read on dir fd not rejected\n\n");
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    int first = getdents(fd, dents_buf, sizeof(dents_buf));
+    if (first <= 0 || seek(fd, 0, SEEK_SET) != 0 ||
+        getdents(fd, dents_buf, sizeof(dents_buf)) != first) {
+        print("  FAIL: rewind\n\n");
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    print("  - short buffer, read(), rewind: OK\n");
+
+    fd = open("/_gdtest.txt", O_CREAT | O_RDWR | O_TRUNC);
+    if (fd < 0 || fd_write(fd, "abc", 3) != 3) {
+        print("  FAIL: create /_gdtest.txt\n\n");
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    close(fd);
+    type = -1;
+    dents_count("/", "_gdtest.txt", &type, &size, &calls);
+    unlink("/_gdtest.txt");
+    int after_type = -1;
+    dents_count("/", "_gdtest.txt", &after_type, &size, &calls);
+    if (type != 0 || after_type != -1) {
+        print("  FAIL: listing not updated after create/unlink\n\n");
+        return 0;
+    }
+    print("  - create/unlink visible in next listing: OK\n");
+
+    if (opendir("/no_such_dir") >= 0) {
+        print("  FAIL: opendir of missing dir succeeded\n\n");
+        return 0;
+    }
+    print("  - missing dir rejected: OK\n");
+    print("  PASSED\n\n");
+    return 1;
+}
+
+static int test_poll(void) {
+    print("TEST 59: poll readiness\n");
+
+    if (pipe_create("polltest") != 0) {
+        print("  FAIL: pipe_create\n\n");
+        return 0;
+    }
+    int wfd = open("/pipe/polltest", O_WRONLY);
+    int rfd = open("/pipe/polltest", O_RDONLY);
+    if (wfd < 0 || rfd < 0) {
+        print("  FAIL: open pipe fds\n\n");
+        if (wfd >= 0)
+            close(wfd);
+        if (rfd >= 0)
+            close(rfd);
+        pipe_destroy("polltest");
+        return 0;
+    }
+
+    pollfd_t p[2];
+    memset(p, 0, sizeof(p));
+    p[0].fd = rfd;
+    p[0].kind = POLL_KIND_FILE;
+    p[0].events = POLLIN;
+    p[1].fd = wfd;
+    p[1].kind = POLL_KIND_FILE;
+    p[1].events = POLLOUT;
+    int ok = 1;
+
+    // Empty pipe: only the writer is ready
+    if (poll(p, 2, 0) != 1 || p[0].revents != 0 || p[1].revents != POLLOUT) {
+        print("  FAIL: empty pipe readiness\n");
+        ok = 0;
+    } else {
+        print("  - empty pipe: writer ready, reader not: OK\n");
+    }
+
+    // Reader alone on an empty pipe times out after sleeping
+    unsigned int t0 = get_ticks();
+    int n = poll(p, 1, 50);
+    unsigned int waited = get_ticks() - t0;
+    if (n != 0 || waited < 4) {
+        print("  FAIL: timeout n=");
+        print_num(n);
+        print(" ticks=");
+        print_num((int)waited);
+        print("\n");
+        ok = 0;
+    } else {
+        print("  - 50ms timeout on empty pipe: OK\n");
+    }
+
+    // Data makes the reader ready
+    if (fd_write(wfd, "x", 1) != 1 || poll(p, 1, -1) != 1 ||
+        p[0].revents != POLLIN) {
+        print("  FAIL: reader not ready after write\n");
+        ok = 0;
+    } else {
+        print("  - reader ready after write: OK\n");
+    }
+
+    // Bad descriptors are reported, not errors
+    pollfd_t bad;
+    memset(&bad, 0, sizeof(bad));
+    bad.fd = 15;
+    bad.kind = POLL_KIND_SOCK;
+    bad.events = POLLIN;
+    if (poll(&bad, 1, 0) != 1 || bad.revents != POLLNVAL) {
+        print("  FAIL: POLLNVAL for bad socket\n");
+        ok = 0;
+    } else {
+        print("  - bad socket fd -> POLLNVAL: OK\n");
+    }
+
+    close(wfd);
+    close(rfd);
+    pipe_destroy("polltest");
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 60: socket table, accept queue and buffer options — skipped when
+// the network stack is down
+static int test_sock_opts(void) {
+    print("TEST 60: socket accept queue and buffer options\n");
+
+    int ls = sock_listen_backlog(8081, 4);
+    if (ls < 0) {
+        print("  SKIP: network stack down\n\n");
+        return 1;
+    }
+    int ok = 1;
+
+    pollfd_t p;
+    memset(&p, 0, sizeof(p));
+    p.fd = ls;
+    p.kind = POLL_KIND_SOCK;
+    p.events = POLLIN;
+    if (sock_accept(ls) != -1 || poll(&p, 1, 0) != 0) {
+        print("  FAIL: empty accept queue reported ready\n");
+        ok = 0;
+    } else {
+        print("  - empty accept queue: OK\n");
+    }
+
+    if (sock_setopt(ls, SOCK_OPT_RCVBUF, 32768) != 0 ||
+        sock_setopt(ls, SOCK_OPT_SNDBUF, 4096) != 0 ||
+        sock_setopt(ls, 99, 1) != -1 || sock_setopt(63, SOCK_OPT_RCVBUF,
+                                                    8192) != -1) {
+        print("  FAIL: setopt\n");
+        ok = 0;
+    } else {
+        print("  - setopt RCVBUF/SNDBUF, bad opt/fd rejected: OK\n");
+    }
+
+    sock_close(ls);
+    ls = sock_listen(8081);
+    if (ls < 0) {
+        print("  FAIL: relisten after close\n");
+        ok = 0;
+    } else {
+        print("  - socket freed and port reusable: OK\n");
+        sock_close(ls);
+    }
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 61: UDP batches and outbound TCP over loopback (works without a
+// NIC)
+#define LOOPBACK_IP_BE 0x7F000001u // 127.0.0.1
+
+static int wait_sock_ready(int fd, unsigned short events) {
+    pollfd_t p;
+    memset(&p, 0, sizeof(p));
+    p.fd = fd;
+    p.kind = POLL_KIND_SOCK;
+    p.events = events;
+    if (poll(&p, 1, 2000) != 1)
+        return 0;
+    return p.revents;
+}
+
+static int test_udp_connect(void) {
+    print("TEST 61: UDP batches and TCP connect (loopback)\n");
+
+    int u = udp_bind(9091);
+    if (u < 0) {
+        print("  SKIP: network stack down\n\n");
+        return 1;
+    }
+    int ok = 1;
+
+    char out[4][8];
+    sock_msg_t msgs[4];
+    for (int i = 0; i < 4; i++) {
+        memcpy(out[i], "dgram-0", 8);
+        out[i][6] = (char)('0' + i);
+        msgs[i].ip_be = LOOPBACK_IP_BE;
+        msgs[i].port = 9091;
+        msgs[i].len = 8;
+        msgs[i].buf = out[i];
+        msgs[i].flags = 0;
+        msgs[i].pad = 0;
+    }
+    int sent = sock_sendmmsg(u, msgs, 4);
+
+    char in[4][8];
+    int got = 0;
+    while (got < 4 && (wait_sock_ready(u, POLLIN) & POLLIN)) {
+        for (int i = 0; i < 4; i++) {
+            msgs[i].len = sizeof(in[i]);
+            msgs[i].buf = in[i];
+        }
+        int n = sock_recvmmsg(u, msgs, (unsigned int)(4 - got));
+        for (int i = 0; i < n; i++) {
+            if (msgs[i].len != 8 || memcmp(in[i], out[got + i], 8) != 0 ||
+                msgs[i].port != 9091)
+                ok = 0;
+        }
+        if (n > 0)
+            got += n;
+    }
+    sock_close(u);
+    if (sent != 4 || got != 4 || !ok) {
+        print("  FAIL: UDP batch sent=");
+        print_num(sent);
+        print(" got=");
+        print_num(got);
+        print("\n");
+        ok = 0;
+    } else {
+        print("  - 4 datagrams via one sendmmsg/recvmmsg round: OK\n");
+    }
+
+    int ls = sock_listen(8082);
+    int c = sock_connect(LOOPBACK_IP_BE, 8082);
+    int a = -1;
+    char buf[8];
+    int r = 0;
+    if (ls >= 0 && c >= 0 && (wait_sock_ready(c, POLLOUT) & POLLOUT) &&
+        (wait_sock_ready(ls, POLLIN) & POLLIN) && (a = sock_accept(ls)) >= 0 &&
+        sock_send(c, "ping", 4) == 4 && (wait_sock_ready(a, POLLIN) & POLLIN))
+        r = sock_recv(a, buf, sizeof(buf));
+    if (r != 4 || memcmp(buf, "ping", 4) != 0) {
+        print("  FAIL: TCP connect/accept/send over loopback\n");
+        ok = 0;
+    } else {
+        print("  - connect, accept, send/recv: OK\n");
+    }
+    if (a >= 0)
+        sock_close(a);
+    if (c >= 0)
+        sock_close(c);
+    if (ls >= 0)
+        sock_close(ls);
+
+    int bad = sock_connect(LOOPBACK_IP_BE, 8083); // nobody listening
+    if (bad < 0 || !(wait_sock_ready(bad, POLLOUT) & (POLLERR | POLLHUP))) {
+        print("  FAIL: refused connect not reported\n");
+        ok = 0;
+    } else {
+        print("  - refused connect -> POLLERR/POLLHUP: OK\n");
+    }
+    if (bad >= 0)
+        sock_close(bad);
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 62: bulk TCP over loopback through the socket TX ring; the sender
+// closes with data still unacked and the receiver must still get it all
+#define BULK_BYTES 49152
+
+static unsigned char bulk_byte(int i) { return (unsigned char)(i * 7 + (i >> 8)); }
+
+static int test_tcp_bulk(void) {
+    print("TEST 62: TCP bulk send via TX ring (loopback)\n");
+
+    int ls = sock_listen(8084);
+    if (ls < 0) {
+        print("  SKIP: network stack down\n\n");
+        return 1;
+    }
+    int c = sock_connect(LOOPBACK_IP_BE, 8084);
+    int a = -1;
+    if (c >= 0 && (wait_sock_ready(c, POLLOUT) & POLLOUT) &&
+        (wait_sock_ready(ls, POLLIN) & POLLIN))
+        a = sock_accept(ls);
+    sock_close(ls);
+    if (a < 0) {
+        print("  FAIL: loopback connect/accept\n\n");
+        if (c >= 0)
+            sock_close(c);
+        return 0;
+    }
+
+    unsigned char chunk[1024];
+    int sent = 0, got = 0, bad = 0, stalls = 0;
+    while (got < BULK_BYTES && stalls < 3) {
+        if (c >= 0 && sent < BULK_BYTES) {
+            int n = BULK_BYTES - sent;
+            if (n > (int)sizeof(chunk))
+                n = (int)sizeof(chunk);
+            for (int i = 0; i < n; i++)
+                chunk[i] = bulk_byte(sent + i);
+            int w = sock_send(c, chunk, (unsigned int)n);
+            if (w > 0)
+                sent += w;
+            if (sent == BULK_BYTES) {
+                sock_close(c); // data still in flight: close must not drop it
+                c = -1;
+            }
+        }
+        if (!(wait_sock_ready(a, POLLIN) & (POLLIN | POLLHUP))) {
+            stalls++;
+            continue;
+        }
+        int r = sock_recv(a, chunk, sizeof(chunk));
+        if (r == 0)
+            break;
+        for (int i = 0; i < r; i++)
+            if (chunk[i] != bulk_byte(got + i))
+                bad++;
+        if (r > 0)
+            got += r;
+    }
+    if (c >= 0)
+        sock_close(c);
+    sock_close(a);
+
+    if (got != BULK_BYTES || bad) {
+        print("  FAIL: sent=");
+        print_num(sent);
+        print(" got=");
+        print_num(got);
+        print(" bad=");
+        print_num(bad);
+        print("\n\n");
+        return 0;
+    }
+    print("  - 48KB sent, closed early, received intact: OK\n");
+    print("  PASSED\n\n");
+    return 1;
+}
+
+// Test 63: sendfile() streams a file into a TCP socket over loopback,
+// honouring the offset and advancing the file position
+#define SF_BYTES 20000
+
+static int test_sendfile(void) {
+    print("TEST 63: sendfile into TCP (loopback)\n");
+
+    int ls = sock_listen(8085);
+    if (ls < 0) {
+        print("  SKIP: network stack down\n\n");
+        return 1;
+    }
+    int fd = open("_sf.tmp", O_CREAT | O_RDWR);
+    unsigned char chunk[1000];
+    int wrote = 0;
+    for (int off = 0; fd >= 0 && off < SF_BYTES; off += (int)sizeof(chunk)) {
+        for (int i = 0; i < (int)sizeof(chunk); i++)
+            chunk[i] = bulk_byte(off + i);
+        if (fd_write(fd, chunk, sizeof(chunk)) == (int)sizeof(chunk))
+            wrote += (int)sizeof(chunk);
+    }
+
+    int c = sock_connect(LOOPBACK_IP_BE, 8085);
+    int a = -1;
+    if (c >= 0 && (wait_sock_ready(c, POLLOUT) & POLLOUT) &&
+        (wait_sock_ready(ls, POLLIN) & POLLIN))
+        a = sock_accept(ls);
+    sock_close(ls);
+    int ok = 1;
+    if (fd < 0 || wrote != SF_BYTES || a < 0) {
+        print("  FAIL: setup (file or loopback connect)\n\n");
+        ok = 0;
+        goto out;
+    }
+    // Room for the whole file on the receiving side: sendfile blocks the
+    // only task that could drain it otherwise
+    sock_setopt(a, SOCK_OPT_RCVBUF, 65536);
+
+    int skip = 1000;
+    int n = sendfile(c, fd, skip, SF_BYTES);
+    int pos = seek(fd, 0, SEEK_CUR);
+    if (n != SF_BYTES - skip || pos != SF_BYTES) {
+        print("  FAIL: sendfile returned ");
+        print_num(n);
+        print(" pos=");
+        print_num(pos);
+        print("\n");
+        ok = 0;
+    } else {
+        print("  - sendfile from offset 1000, position advanced: OK\n");
+    }
+    if (sendfile(c, fd, -1, 100) != 0) {
+        print("  FAIL: sendfile at EOF should return 0\n");
+        ok = 0;
+    }
+    sock_close(c);
+    c = -1;
+
+    int got = 0, bad = 0;
+    while (wait_sock_ready(a, POLLIN) & (POLLIN | POLLHUP)) {
+        int r = sock_recv(a, chunk, sizeof(chunk));
+        if (r == 0)
+            break;
+        for (int i = 0; i < r; i++)
+            if (chunk[i] != bulk_byte(skip + got + i))
+                bad++;
+        if (r > 0)
+            got += r;
+    }
+    if (got != SF_BYTES - skip || bad) {
+        print("  FAIL: received ");
+        print_num(got);
+        print(" bad=");
+        print_num(bad);
+        print("\n");
+        ok = 0;
+    } else {
+        print("  - receiver got the file tail intact: OK\n");
+    }
+
+out:
+    if (a >= 0)
+        sock_close(a);
+    if (c >= 0)
+        sock_close(c);
+    if (fd >= 0)
+        close(fd);
+    unlink("_sf.tmp");
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 64: SYSENTER vs int 0x80 round trip — SYS_GETPID through each path,
+// reporting cycles per call. 2^20 calls so the average is a shift (no
+// 64-bit division in this libc).
+#define SYSCALL_BENCH_SHIFT 20
+#define SYSCALL_BENCH_CALLS (1 << SYSCALL_BENCH_SHIFT)
+
+static unsigned long long rdtsc64(void) {
+    unsigned int lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+static int bench_getpid(int pid, unsigned int *cycles) {
+    unsigned long long t0 = rdtsc64();
+    for (int i = 0; i < SYSCALL_BENCH_CALLS; i++) {
+        if (syscall_raw(SYS_GETPID, 0, 0, 0) != pid)
+            return -1;
+    }
+    *cycles = (unsigned int)((rdtsc64() - t0) >> SYSCALL_BENCH_SHIFT);
+    return 0;
+}
+
+static int test_syscall_paths(void) {
+    print("TEST 64: syscall entry paths (getpid x 1M)\n");
+
+    int pid = getpid();
+    int fast = syscall_fast_path(1);
+    unsigned int int80 = 0, sysenter = 0;
+    int ok = 1;
+
+    syscall_fast_path(0);
+    if (bench_getpid(pid, &int80) != 0) {
+        print("  FAIL: int 0x80 getpid mismatch\n");
+        ok = 0;
+    }
+    syscall_fast_path(1);
+    print("  - int 0x80: ");
+    print_num((int)int80);
+    print(" cycles/call\n");
+
+    if (!fast) {
+        print("  - SYSENTER: not supported by this CPU, skipped\n");
+    } else if (bench_getpid(pid, &sysenter) != 0) {
+        print("  FAIL: SYSENTER getpid mismatch\n");
+        ok = 0;
+    } else {
+        print("  - SYSENTER: ");
+        print_num((int)sysenter);
+        print(" cycles/call\n");
+    }
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 65: vDSO page — values read without a syscall agree with the
+// syscalls, the page is read-only to syscalls, and uptime_ms() is monotonic
+static int test_vdso(void) {
+    print("TEST 65: shared kernel data page\n");
+
+    const volatile vdso_data_t *v = vdso();
+    if (!v) {
+        print("  FAIL: no vDSO page mapped\n");
+        return 0;
+    }
+    int ok = 1;
+
+    if (getpid() != syscall_raw(SYS_GETPID, 0, 0, 0)) {
+        print("  FAIL: page pid differs from SYS_GETPID\n");
+        ok = 0;
+    }
+    if (gfx_info() != (unsigned int)syscall_raw(SYS_GFX_INFO, 0, 0, 0)) {
+        print("  FAIL: page gfx_info differs from SYS_GFX_INFO\n");
+        ok = 0;
+    }
+    unsigned int t_page = get_ticks();
+    unsigned int t_sys = (unsigned int)syscall_raw(SYS_GETTICKS, 0, 0, 0);
+    if (t_sys - t_page > 1) {
+        print("  FAIL: page ticks lag SYS_GETTICKS\n");
+        ok = 0;
+    }
+    unsigned int rx = 0, tx = 0, rx2 = 0, tx2 = 0;
+    net_stats(&rx, &tx);
+    syscall_raw(SYS_NETSTATS, (unsigned int)&rx2, (unsigned int)&tx2, 0);
+    if (rx > rx2 || tx > tx2) {
+        print("  FAIL: page packet counters ahead of SYS_NETSTATS\n");
+        ok = 0;
+    }
+    if (!mem_free_frames() || mem_free_frames() >= v->total_frames) {
+        print("  FAIL: implausible free frame count\n");
+        ok = 0;
+    }
+    if (ok)
+        print("  - pid, ticks, gfx_info, net and memory counters: OK\n");
+
+    // Below USER_REGION_START, so syscalls must refuse to write into it
+    if (stat("bin/hello.elf", (stat_t *)VDSO_VADDR) != -1) {
+        print("  FAIL: stat() wrote into the vDSO page\n");
+        ok = 0;
+    } else {
+        print("  - page rejected as a syscall buffer: OK\n");
+    }
+
+    unsigned int prev = uptime_ms(), start = get_ticks();
+    while (get_ticks() - start < 5) {
+        unsigned int now = uptime_ms();
+        if (now < prev) {
+            print("  FAIL: uptime_ms went backwards\n");
+            ok = 0;
+            break;
+        }
+        prev = now;
+    }
+    unsigned int ms = uptime_ms(), ticks = get_ticks();
+    if (ms + 10 < ticks * 10 || ms > ticks * 10 + 10) {
+        print("  FAIL: uptime_ms disagrees with ticks\n");
+        ok = 0;
+    } else {
+        print("  - uptime_ms monotonic, TSC ");
+        print(v->tsc_per_ms ? "calibrated: " : "not calibrated yet: ");
+        print_num((int)v->tsc_per_ms);
+        print(" cycles/ms\n");
+    }
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 66: syscall ring — entry semantics, then a 256KB file copy through
+// read/write traps vs linked ring batches, and the ring-based cp.elf
+#define RC_BYTES (256 * 1024)
+#define RC_CHUNK 4096
+#define RC_DEPTH 8
+// Kernel heap address a forged ring header points its completions at
+#define RING_KERNEL_ADDR 0xC0500000u
+
+static unsigned char rc_bufs[RC_DEPTH][RC_CHUNK];
+static ring_sqe_t rc_sqes[RC_DEPTH * 2];
+static ring_cqe_t rc_cqes[RC_DEPTH * 2];
+
+static int rc_results(ring_t *r, const int *want, int n) {
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        ring_cqe_t *cqe = ring_peek_cqe(r);
+        if (!cqe || cqe->user_data != (unsigned int)i || cqe->res != want[i])
+            ok = 0;
+        if (cqe)
+            ring_cqe_seen(r);
+    }
+    return ok && !ring_peek_cqe(r);
+}
+
+static int rc_copy_sync(int in, int out) {
+    int n;
+    while ((n = fd_read(in, rc_bufs[0], RC_CHUNK)) > 0) {
+        if (fd_write(out, rc_bufs[0], (unsigned int)n) != n)
+            return -1;
+    }
+    return n;
+}
+
+// The source size is known, so every chunk is a full transfer and one
+// chain per batch covers it
+static int rc_copy_ring(ring_t *r, int in, int out) {
+    for (int off = 0; off < RC_BYTES; off += RC_DEPTH * RC_CHUNK) {
+        for (int i = 0; i < RC_DEPTH; i++) {
+            ring_sqe_t *sqe = ring_get_sqe(r);
+            ring_prep(sqe, SYS_FREAD, (unsigned int)in,
+                      (unsigned int)rc_bufs[i], RC_CHUNK, 0);
+            sqe->flags = RING_F_LINK;
+            sqe = ring_get_sqe(r);
+            ring_prep(sqe, SYS_FWRITE, (unsigned int)out,
+                      (unsigned int)rc_bufs[i], RC_CHUNK, 0);
+            sqe->flags = RING_F_LINK;
+        }
+        if (ring_submit(r) != RC_DEPTH * 2)
+            return -1;
+        ring_cqe_t *cqe;
+        while ((cqe = ring_peek_cqe(r)) != 0) {
+            if (cqe->res != RC_CHUNK)
+                return -1;
+            ring_cqe_seen(r);
+        }
+    }
+    return 0;
+}
+
+static int rc_verify(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    int off = 0, n, ok = 1;
+    while (ok && (n = fd_read(fd, rc_bufs[0], RC_CHUNK)) > 0) {
+        for (int i = 0; i < n; i++)
+            if (rc_bufs[0][i] != bulk_byte(off + i))
+                ok = 0;
+        off += n;
+    }
+    close(fd);
+    return ok && off == RC_BYTES;
+}
+
+static void rc_report(const char *label, unsigned int ms) {
+    print(label);
+    print_num(RC_BYTES / 1024 * 1000 / (int)(ms ? ms : 1));
+    print(" KB/s (");
+    print_num((int)ms);
+    print(" ms)\n");
+}
+
+static int test_ring(void) {
+    print("TEST 66: syscall ring (batched syscalls)\n");
+
+    ring_t ring;
+    ring_init(&ring, rc_sqes, rc_cqes, RC_DEPTH * 2);
+    int ok = 1;
+
+    // write -> seek -> read linked, then a broken chain and a refused op
+    int fd = open("_ring.tmp", O_CREAT | O_TRUNC | O_RDWR);
+    char got[4] = {0};
+    ring_prep(ring_get_sqe(&ring), SYS_FWRITE, (unsigned int)fd,
+              (unsigned int)"abc", 3, 0);
+    ring.sqes[0].flags = RING_F_LINK;
+    ring_prep(ring_get_sqe(&ring), SYS_SEEK, (unsigned int)fd, 0, SEEK_SET, 1);
+    ring.sqes[1].flags = RING_F_LINK;
+    ring_prep(ring_get_sqe(&ring), SYS_FREAD, (unsigned int)fd,
+              (unsigned int)got, 3, 2);
+    ring_prep(ring_get_sqe(&ring), SYS_FREAD, (unsigned int)-1,
+              (unsigned int)got, 3, 3);
+    ring.sqes[3].flags = RING_F_LINK;
+    ring_prep(ring_get_sqe(&ring), SYS_FWRITE, (unsigned int)fd,
+              (unsigned int)"x", 1, 4);
+    ring_prep(ring_get_sqe(&ring), SYS_GETPID, 0, 0, 0, 5);
+    static const int want[] = {3, 0, 3, -1, -1, -1};
+    int n = ring_submit(&ring);
+    if (fd < 0 || n != 6 || !rc_results(&ring, want, 6) ||
+        strcmp(got, "abc") != 0 || seek(fd, 0, SEEK_CUR) != 3) {
+        print("  FAIL: ring entry results/links\n");
+        ok = 0;
+    } else {
+        print("  - linked chain, broken link skipped, GETPID refused: OK\n");
+    }
+    if (fd >= 0)
+        close(fd);
+    unlink("_ring.tmp");
+
+    // An entry that reads a forged header over the ring cannot redirect
+    // the completions: the kernel works from its own copy of the header
+    int hf = open("_ring.hdr", O_CREAT | O_TRUNC | O_RDWR);
+    ring_init(&ring, rc_sqes, rc_cqes, RC_DEPTH * 2);
+    ring_prep(ring_get_sqe(&ring), SYS_FREAD, (unsigned int)hf,
+              (unsigned int)&ring, sizeof(ring), 0);
+    ring_prep(ring_get_sqe(&ring), SYS_GETPID, 0, 0, 0, 1);
+    ring_t forged = ring;
+    forged.cqes = (ring_cqe_t *)RING_KERNEL_ADDR;
+    int forged_ok = hf >= 0 &&
+                    fd_write(hf, &forged, sizeof(forged)) == sizeof(forged) &&
+                    seek(hf, 0, SEEK_SET) == 0;
+    n = forged_ok ? ring_submit(&ring) : -1;
+    ring.cqes = rc_cqes;
+    static const int want_forged[] = {(int)sizeof(ring_t), -1};
+    if (n != 2 || !rc_results(&ring, want_forged, 2)) {
+        print("  FAIL: forged ring header redirected completions\n");
+        ok = 0;
+    } else {
+        print("  - forged header read into the ring ignored: OK\n");
+    }
+    if (hf >= 0)
+        close(hf);
+    unlink("_ring.hdr");
+
+    // Source file for the copies
+    int src = open("_rc.src", O_CREAT | O_TRUNC | O_RDWR);
+    for (int off = 0; src >= 0 && off < RC_BYTES; off += RC_CHUNK) {
+        for (int i = 0; i < RC_CHUNK; i++)
+            rc_bufs[0][i] = bulk_byte(off + i);
+        if (fd_write(src, rc_bufs[0], RC_CHUNK) != RC_CHUNK) {
+            close(src);
+            src = -1;
+        }
+    }
+    if (src < 0) {
+        print("  FAIL: could not write _rc.src\n\n");
+        return 0;
+    }
+    close(src);
+
+    int in = open("_rc.src", O_RDONLY);
+    int out = open("_rc.a", O_CREAT | O_TRUNC | O_RDWR);
+    unsigned int t0 = uptime_ms();
+    int r = (in >= 0 && out >= 0) ? rc_copy_sync(in, out) : -1;
+    unsigned int sync_ms = uptime_ms() - t0;
+    close(in);
+    close(out);
+
+    in = open("_rc.src", O_RDONLY);
+    out = open("_rc.b", O_CREAT | O_TRUNC | O_RDWR);
+    t0 = uptime_ms();
+    int r2 = (in >= 0 && out >= 0) ? rc_copy_ring(&ring, in, out) : -1;
+    unsigned int ring_ms = uptime_ms() - t0;
+    close(in);
+    close(out);
+
+    if (r < 0 || r2 < 0 || !rc_verify("_rc.a") || !rc_verify("_rc.b")) {
+        print("  FAIL: copy mismatch\n");
+        ok = 0;
+    } else {
+        rc_report("  - read/write traps (4KB): ", sync_ms);
+        rc_report("  - ring, 8 pairs/submit:   ", ring_ms);
+    }
+
+    const char *argv[] = {"bin/cp.elf", "_rc.src", "_rc.c", 0};
+    int child = spawn_argv("bin/cp.elf", argv, 3);
+    if (child < 0 || wait(child) != 0 || !rc_verify("_rc.c")) {
+        print("  FAIL: cp.elf copy\n");
+        ok = 0;
+    } else {
+        print("  - cp.elf (ring) copy verified: OK\n");
+    }
+
+    unlink("_rc.src");
+    unlink("_rc.a");
+    unlink("_rc.b");
+    unlink("_rc.c");
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 67: syscall accounting — /mos/ksyscall counts exactly the calls made
+// since a reset, and strace() on ourselves sees them in order
+static char ks_buf[16384];
+
+static int ks_read(void) {
+    int fd = open("/mos/ksyscall", O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int off = 0, n;
+    while (off < (int)sizeof(ks_buf) - 1 &&
+           (n = fd_read(fd, ks_buf + off, sizeof(ks_buf) - 1 - off)) > 0)
+        off += n;
+    close(fd);
+    ks_buf[off] = '\0';
+    return off;
+}
+
+static int test_syscall_stats(void) {
+    print("TEST 67: syscall stats and strace\n");
+    int ok = 1;
+
+    int fd = open("/mos/ksyscall", O_WRONLY);
+    if (fd < 0 || fd_write(fd, "0", 1) != 1) {
+        print("  FAIL: reset via /mos/ksyscall\n");
+        ok = 0;
+    }
+    if (fd >= 0)
+        close(fd);
+    for (int i = 0; i < 100; i++)
+        syscall_raw(SYS_GETPID, 0, 0, 0);
+    if (ks_read() <= 0 || !strstr(ks_buf, " getpid calls=100 ")) {
+        print("  FAIL: expected getpid calls=100 after reset\n");
+        ok = 0;
+    } else {
+        print("  - 100 getpid calls counted since reset: OK\n");
+    }
+
+    int pid = getpid();
+    strace_event_t ev[16];
+    if (strace(pid, 1) != 0) {
+        print("  FAIL: strace attach\n");
+        return 0;
+    }
+    for (int i = 0; i < 3; i++)
+        syscall_raw(SYS_GETPID, 0, 0, 0);
+    int n = strace_read(pid, ev, 16);
+    strace(pid, 0);
+    int seen = 0;
+    for (int i = 0; i < n; i++) {
+        if (i > 0 && ev[i].seq != ev[i - 1].seq + 1)
+            break;
+        if (ev[i].nr == SYS_GETPID && ev[i].ret == pid)
+            seen++;
+    }
+    if (seen != 3) {
+        print("  FAIL: strace saw ");
+        print_num(seen);
+        print(" of 3 getpid calls\n");
+        ok = 0;
+    } else {
+        print("  - strace: 3 getpid events in sequence: OK\n");
+    }
+    if (strace_read(pid, ev, 16) != -1) {
+        print("  FAIL: strace_read after detach\n");
+        ok = 0;
+    }
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 68: sampling profiler — a busy loop started with "1" on /mos/kprof
+// shows up as user-mode samples of this task, and "0" stops sampling
+typedef struct {
+    unsigned int magic;
+    unsigned short version;
+    unsigned short sample_size;
+    unsigned int hz;
+    unsigned int count;
+    unsigned int dropped;
+    unsigned int running;
+} kprof_header_t;
+
+typedef struct {
+    unsigned int eip;
+    unsigned short pid;
+    unsigned char ring;
+    unsigned char depth;
+    unsigned int stack[6];
+} kprof_sample_t;
+
+static int kprof_ctl(const char *cmd) {
+    int fd = open("/mos/kprof", O_WRONLY);
+    if (fd < 0)
+        return -1;
+    int r = fd_write(fd, cmd, 1);
+    close(fd);
+    return r;
+}
+
+static int test_kprof(void) {
+    print("TEST 68: sampling profiler (/mos/kprof)\n");
+    int ok = 1;
+
+    if (kprof_ctl("x") != -1) {
+        print("  FAIL: bad control byte accepted\n");
+        ok = 0;
+    }
+    if (kprof_ctl("1") != 1) {
+        print("  FAIL: start sampling\n");
+        return 0;
+    }
+    volatile unsigned int spin = 0;
+    unsigned int start = get_ticks();
+    while (get_ticks() - start < 20)
+        spin++;
+    kprof_ctl("0");
+
+    int fd = open("/mos/kprof", O_RDONLY);
+    kprof_header_t hdr;
+    if (fd < 0 || fd_read(fd, &hdr, sizeof(hdr)) != (int)sizeof(hdr) ||
+        hdr.magic != 0x464F5250u ||
+        hdr.sample_size != sizeof(kprof_sample_t) || hdr.running) {
+        print("  FAIL: bad /mos/kprof header\n");
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    int pid = getpid(), mine = 0, bad = 0;
+    kprof_sample_t smp;
+    for (unsigned int i = 0; i < hdr.count; i++) {
+        if (fd_read(fd, &smp, sizeof(smp)) != (int)sizeof(smp)) {
+            bad++;
+            break;
+        }
+        if (smp.pid != pid || smp.ring != 3)
+            continue;
+        if (smp.eip < 0x00400000u || smp.eip >= 0xC0000000u || smp.depth > 6)
+            bad++;
+        mine++;
+    }
+    close(fd);
+    if (mine < 10 || bad) {
+        print("  FAIL: ");
+        print_num(mine);
+        print(" user samples of this task, ");
+        print_num(bad);
+        print(" malformed\n");
+        ok = 0;
+    } else {
+        print("  - ");
+        print_num(mine);
+        print(" user samples over 20 ticks: OK\n");
+    }
+
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// Test 69: kernel event trace — a traced getpid shows up in /mos/ktrace as
+// an enter/exit pair for this pid, with timestamps in order
+typedef struct {
+    unsigned int magic;
+    unsigned short version;
+    unsigned short rec_size;
+    unsigned int tsc_per_ms;
+    unsigned int count;
+    unsigned int lost;
+    unsigned int running;
+} ktrace_header_t;
+
+typedef struct {
+    unsigned long long tsc;
+    unsigned char cpu;
+    unsigned char event;
+    unsigned short pid;
+    unsigned int args[3];
+} ktrace_rec_t;
+
+#define KT_SYSCALL_ENTER 6
+#define KT_SYSCALL_EXIT 7
+
+static int ktrace_ctl(const char *cmd) {
+    int fd = open("/mos/ktrace", O_WRONLY);
+    if (fd < 0)
+        return -1;
+    int r = fd_write(fd, cmd, 1);
+    close(fd);
+    return r;
+}
+
+static int test_ktrace(void) {
+    print("TEST 69: kernel event trace (/mos/ktrace)\n");
+    int pid = getpid();
+
+    if (ktrace_ctl("1") != 1) {
+        print("  FAIL: start tracing\n");
+        return 0;
+    }
+    syscall_raw(SYS_GETPID, 0, 0, 0);
+    yield();
+    ktrace_ctl("0");
+
+    int fd = open("/mos/ktrace", O_RDONLY);
+    ktrace_header_t hdr;
+    if (fd < 0 || fd_read(fd, &hdr, sizeof(hdr)) != (int)sizeof(hdr) ||
+        hdr.magic != 0x4352544Bu || hdr.rec_size != sizeof(ktrace_rec_t) ||
+        hdr.running || !hdr.count) {
+        print("  FAIL: bad /mos/ktrace header\n");
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    int entered = 0, paired = 0, ordered = 1;
+    unsigned long long last = 0;
+    ktrace_rec_t r;
+    for (unsigned int i = 0; i < hdr.count; i++) {
+        if (fd_read(fd, &r, sizeof(r)) != (int)sizeof(r))
+            break;
+        if (r.tsc < last)
+            ordered = 0;
+        last = r.tsc;
+        if (r.pid != pid || r.args[0] != SYS_GETPID)
+            continue;
+        if (r.event == KT_SYSCALL_ENTER)
+            entered = 1;
+        else if (r.event == KT_SYSCALL_EXIT && entered &&
+                 r.args[1] == (unsigned int)pid)
+            paired = 1;
+    }
+    close(fd);
+
+    int ok = 1;
+    if (!paired) {
+        print("  FAIL: no getpid enter/exit pair for this pid\n");
+        ok = 0;
+    }
+    if (!ordered) {
+        print("  FAIL: timestamps out of order\n");
+        ok = 0;
+    }
+    if (ok) {
+        print("  - ");
+        print_num((int)hdr.count);
+        print(" records, getpid enter/exit traced: OK\n");
+    }
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// ============================================================
+// TEST 70: Syscalls on unmapped user memory fail with -1
+// ============================================================
+// The guard page below the user stack is inside the user region but never
+// mapped, so only the page fault fixup path can turn these into errors.
+#define UNMAPPED_USER_ADDR 0xBFFF0000u
+
+static int test_uaccess_fault(void) {
+    print("TEST 70: syscalls on unmapped user memory\n");
+    unsigned int bad = UNMAPPED_USER_ADDR;
+    stat_t st;
+    int ok = 1;
+
+    if (syscall_raw(SYS_STAT, bad, (unsigned int)&st, 0) != -1 ||
+        syscall_raw(SYS_OPEN, bad, O_RDONLY, 0) != -1 ||
+        syscall_raw(SYS_RENAME, (unsigned int)"/nope", bad, 0) != -1) {
+        print("  FAIL: unmapped path accepted\n");
+        ok = 0;
+    }
+    if (syscall_raw(SYS_STAT, (unsigned int)"/", bad, 0) != -1 ||
+        syscall_raw(SYS_GETCWD, bad, 64, 0) != -1) {
+        print("  FAIL: unmapped output buffer accepted\n");
+        ok = 0;
+    }
+    if (syscall_raw(SYS_WRITE, 1, bad, 8) != -1 ||
+        syscall_raw(SYS_POLL, bad, 1, 0) != -1) {
+        print("  FAIL: unmapped input buffer accepted\n");
+        ok = 0;
+    }
+    // A buffer that starts in the heap and runs past the last mapped page
+    // fails as a whole
+    unsigned int brk_end = ((unsigned int)sbrk(0) + 0xFFFu) & ~0xFFFu;
+    char cwd[64];
+    if (!getcwd(cwd, sizeof(cwd)) ||
+        syscall_raw(SYS_GETCWD, brk_end - 1, 64, 0) != -1) {
+        print("  FAIL: getcwd across the end of the heap\n");
+        ok = 0;
+    }
+    if (ok)
+        print("  - stat/open/rename/getcwd/write/poll return -1: OK\n");
+    print(ok ? "  PASSED\n\n" : "\n");
+    return ok;
+}
+
+// ============================================================
+// TEST 71: malloc coalescing, in-place realloc and heap trimming
+// ============================================================
+static int test_malloc_heap(void) {
+    print("TEST 71: malloc coalescing/realloc/trim\n");
+
+    // Three freed neighbours merge into one block (guard keeps them off
+    // the top of the heap). 4000 bytes is more than any earlier test
+    // leaves free, so all four come from the top, in order.
+    char *a = malloc(4000), *b = malloc(4000), *c = malloc(4000);
+    char *guard = malloc(4000);
+    if (!a || !b || !c || !guard) { print("  FAIL: malloc 4000\n\n"); return 0; }
+    free(a);
+    free(c);
+    free(b);
+    char *d = malloc(12000);
+    // Without the merge no free block is big enough and d lands past guard
+    if (!d || d > guard) { print("  FAIL: freed neighbours not coalesced\n\n"); return 0; }
+    free(d);
+    print("  - coalesce 3 neighbours: OK\n");
+
+    // realloc grows into a free block that follows, keeping the data
+    char *x = malloc(300), *y = malloc(300);
+    if (!x || !y) { print("  FAIL: malloc 300\n\n"); return 0; }
+    for (int i = 0; i < 300; i++)
+        x[i] = (char)i;
+    free(y);
+    char *x2 = realloc(x, 500);
+    if (x2 != x) { print("  FAIL: realloc did not grow in place\n\n"); return 0; }
+    for (int i = 0; i < 300; i++)
+        if (x2[i] != (char)i) { print("  FAIL: realloc lost data\n\n"); return 0; }
+    free(x2);
+    free(guard);
+    print("  - realloc in place: OK\n");
+
+    // Freeing a large block at the top hands the pages back to the kernel
+    unsigned int brk0 = (unsigned int)sbrk(0);
+    char *huge = malloc(512 * 1024);
+    if (!huge) { print("  FAIL: malloc 512K\n\n"); return 0; }
+    huge[0] = 1;
+    huge[512 * 1024 - 1] = 1;
+    unsigned int brk1 = (unsigned int)sbrk(0);
+    free(huge);
+    unsigned int brk2 = (unsigned int)sbrk(0);
+    if (brk1 <= brk0 || brk1 - brk2 < 256 * 1024) {
+        print("  FAIL: heap not trimmed after free\n\n");
+        return 0;
+    }
+    huge = malloc(512 * 1024);
+    if (!huge) { print("  FAIL: malloc 512K after trim\n\n"); return 0; }
+    huge[512 * 1024 - 1] = 2;
+    free(huge);
+    print("  - heap trimmed on free: OK\n");
+
+    // Large blocks with small ones between them: the small frees go to the
+    // cache last, yet the heap must still shrink back once all are free
+    char *big[48], *small[48];
+    brk0 = (unsigned int)sbrk(0);
+    for (int i = 0; i < 48; i++) {
+        big[i] = malloc(24 * 1024);
+        small[i] = malloc(40);
+        if (!big[i] || !small[i]) { print("  FAIL: malloc mixed\n\n"); return 0; }
+        big[i][0] = small[i][0] = 1;
+    }
+    brk1 = (unsigned int)sbrk(0);
+    for (int i = 0; i < 48; i++)
+        free(big[i]);
+    for (int i = 0; i < 48; i++)
+        free(small[i]);
+    brk2 = (unsigned int)sbrk(0);
+    if (brk1 - brk0 < 1024 * 1024 || brk2 > brk0 + 128 * 1024) {
+        print("  FAIL: heap not trimmed after mixed free-all\n\n");
+        return 0;
+    }
+    print("  - mixed free-all trims heap: OK\n");
+
+    // Raw sbrk shrink returns pages and refuses to go below the program
+    void *base = sbrk(0);
+    if (sbrk(8192) != base || sbrk(-8192) != (char *)base + 8192 ||
+        sbrk(0) != base) {
+        print("  FAIL: sbrk shrink\n\n");
+        return 0;
+    }
+    if (sbrk(-0x10000000) != (void *)-1) {
+        print("  FAIL: sbrk shrink below program accepted\n\n");
+        return 0;
+    }
+    print("  - sbrk shrink: OK\n");
+
+    print("  PASSED\n\n");
+    return 1;
+}
+
 // ============================================================
 // Entry point
 // ============================================================
@@ -2646,7 +4081,7 @@ void _start(int argc, char **argv) {
     print("========================================\n\n");
 
     int passed = 0;
-    int total = 55;
+    int total = 71;
 
     // Run all tests
     if (test_syscalls())
@@ -2759,6 +4194,38 @@ void _start(int argc, char **argv) {
         passed++; // 54
     if (test_named_pipes())
         passed++; // 55
+    if (test_large_file_seek())
+        passed++; // 56
+    if (test_fat32_data())
+        passed++; // 57
+    if (test_getdents())
+        passed++; // 58
+    if (test_poll())
+        passed++; // 59
+    if (test_sock_opts())
+        passed++; // 60
+    if (test_udp_connect())
+        passed++; // 61
+    if (test_tcp_bulk())
+        passed++; // 62
+    if (test_sendfile())
+        passed++; // 63
+    if (test_syscall_paths())
+        passed++; // 64
+    if (test_vdso())
+        passed++; // 65
+    if (test_ring())
+        passed++; // 66
+    if (test_syscall_stats())
+        passed++; // 67
+    if (test_kprof())
+        passed++; // 68
+    if (test_ktrace())
+        passed++; // 69
+    if (test_uaccess_fault())
+        passed++; // 70
+    if (test_malloc_heap())
+        passed++; // 71
 
     print("========================================\n");
     print("  Results: ");
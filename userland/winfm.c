@@ -371,22 +371,24 @@ static void load_files(void) {
     all_count = 0;
     file_total = 0;
 
-    char name[NAME_MAX];
-    int i = 0;
-    while (readdir((unsigned int)i, name, sizeof(name)) > 0) {
-        if (all_count < MAX_FILES) {
-            copy_name(all_files[all_count], name, NAME_MAX);
-            // Check if entry is a directory using stat()
-            stat_t st;
-            file_is_dir[all_count] = 0;
-            if (stat(name, &st) == 0 && st.type == 1) {
-                file_is_dir[all_count] = 1;
+    // One getdents call returns dozens of entries with their types.
+    static char dbuf[2048];
+    int fd = opendir(0);
+    if (fd >= 0) {
+        int n;
+        while ((n = getdents(fd, dbuf, sizeof(dbuf))) > 0) {
+            for (int off = 0; off < n; off += ((dirent_t *)(dbuf + off))->reclen) {
+                dirent_t *de = (dirent_t *)(dbuf + off);
+                if (all_count < MAX_FILES) {
+                    copy_name(all_files[all_count], de->name, NAME_MAX);
+                    file_is_dir[all_count] = de->type == 1;
+                    all_count++;
+                }
+                file_total++;
             }
-            all_count++;
         }
-        i++;
+        close(fd);
     }
-    file_total = i;
 
     update_title();
     rebuild_ext_filters();